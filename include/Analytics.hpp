@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include "CSVScanner.hpp"
+#include "MarketDataSeries.hpp"
+
+/// @brief Kernels over the contiguous columns of a series, a DataCache snapshot's view or a received
+/// MarketDataSeries. None of them allocate, results go to arrays the caller provides. The instruction
+/// set is picked at runtime as for the CSV scan: AVX2 when the CPU has it, scalar otherwise (SSE2
+/// runs the scalar code). The paths differ only in summation order, so results agree to rounding.
+/// Values are expected to be finite
+namespace Analytics
+{
+    using CSVScan::SimdLevel;
+
+    struct Extremes
+    {
+        double min;
+        double max;
+    };
+
+    enum class Compare
+    {
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        Equal,
+        NotEqual
+    };
+
+    // Sum of price * volume over the sum of volume, 0 when there is no volume
+    double vwap(const double *price, const double *volume, size_t n,
+                SimdLevel level = CSVScan::detectSimdLevel());
+
+    // VWAP of bars, weighting each bar's typical price (high + low + close) / 3 by its volume
+    double vwap(const MarketDataView &bars, SimdLevel level = CSVScan::detectSimdLevel());
+
+    // Smallest and largest value, both NaN when n is 0
+    Extremes extremes(const double *values, size_t n, SimdLevel level = CSVScan::detectSimdLevel());
+
+    // Simple returns, out[i] = values[i + 1] / values[i] - 1. Writes n - 1 entries, returns how many
+    size_t returns(const double *values, size_t n, double *out, SimdLevel level = CSVScan::detectSimdLevel());
+
+    // Rolling windows: out[i] covers values[i .. i + window - 1], n - window + 1 entries are written, none
+    // when n < window. Each returns how many it wrote. Sums are carried from one window to the next and
+    // recomputed exactly every few thousand windows so rounding does not build up
+
+    size_t rollingMean(const double *values, size_t n, size_t window, double *out,
+                       SimdLevel level = CSVScan::detectSimdLevel());
+
+    // Sample standard deviation, window must be at least 2
+    size_t rollingStdDev(const double *values, size_t n, size_t window, double *out,
+                         SimdLevel level = CSVScan::detectSimdLevel());
+
+    // Three comparisons per value whatever the window (van Herk / Gil-Werman), out doubles as the scratch
+    size_t rollingMin(const double *values, size_t n, size_t window, double *out);
+    size_t rollingMax(const double *values, size_t n, size_t window, double *out);
+
+    // Ascending indices of the values for which `value op threshold` holds, out needs room for n.
+    // Returns how many were written
+    size_t select(const double *values, size_t n, Compare op, double threshold, size_t *out,
+                  SimdLevel level = CSVScan::detectSimdLevel());
+}
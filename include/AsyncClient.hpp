@@ -0,0 +1,174 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/asio.hpp>
+#include "MarketDataSeries.hpp"
+#include "Protocol.hpp"
+#include "WireEncoder.hpp"
+
+/// @brief Outcome of one request made through an AsyncClient
+struct ClientResult
+{
+    bool ok = false;
+    std::string error;                    // The server's ERROR line, or why the connection failed
+    std::vector<MarketDataSeries> series; // One per requested symbol in request order, empty for a symbol without data
+    uint64_t version = 0;                 // fetch: version of the server's data the series is at
+    bool modified = false;                // fetch: the server sent bars, the cached copy was not current
+};
+
+/// @brief Programmatic client of a MarketDataServer, the console front end in MarketDataClient is built on it.
+///
+/// Runs on the caller's io_context and never blocks: every operation returns at once and completes
+/// through a callback, invoked on one of the io_context's threads, or through a future. Requests are
+/// pipelined on a single connection, any number may be outstanding; the server answers in request order
+/// and the answers are matched to the requests that way. Subscription pushes arriving in between are
+/// routed to their subscription by symbol. The receive buffer and the body buffer belong to the
+/// connection and are reused for every response.
+///
+/// All state lives on a strand, so the io_context may be run by several threads. A future must not be
+/// waited on from a thread that runs the io_context
+class AsyncClient : public std::enable_shared_from_this<AsyncClient>
+{
+public:
+    using ConnectHandler = std::function<void(const boost::system::error_code &error)>;
+    using ResponseHandler = std::function<void(ClientResult result)>;
+
+    // Called with the local copy of the series when the subscription starts and after every pushed change.
+    // changed holds the bars of that change, every bar for the first call and after a reset.
+    // Return false to unsubscribe
+    using UpdateHandler =
+        std::function<bool(const MarketDataSeries &series, const MarketDataSeries &changed, uint64_t version)>;
+
+    static std::shared_ptr<AsyncClient> create(boost::asio::io_context &ioc);
+
+    AsyncClient(const AsyncClient &) = delete;
+    AsyncClient &operator=(const AsyncClient &) = delete;
+
+    // Resolve and connect. Requests made before the connection is up are sent once it is
+    void connect(const std::string &host, unsigned short port, ConnectHandler handler);
+    std::future<void> connect(const std::string &host, unsigned short port); // Throws system_error from get()
+
+    void get(const std::string &symbol, WireFormat format, ResponseHandler handler);
+    std::future<ClientResult> get(const std::string &symbol, WireFormat format = WireFormat::CSV);
+
+    // GET evaluated on the server, only the bars query keeps are sent. Columns left out by COLUMNS are NaN
+    void query(const std::string &symbol, const Protocol::Query &query, WireFormat format, ResponseHandler handler);
+    std::future<ClientResult> query(const std::string &symbol, const Protocol::Query &query,
+                                    WireFormat format = WireFormat::CSV);
+
+    // One MGET for every symbol, result.series follows the order of symbols
+    void mget(const std::vector<std::string> &symbols, WireFormat format, ResponseHandler handler);
+    std::future<ClientResult> mget(const std::vector<std::string> &symbols, WireFormat format = WireFormat::CSV);
+
+    // GET through the client's versioned cache. The first fetch of a symbol transfers every bar, later ones
+    // send the cached version (GET <symbol> SINCE=<version>) and get back nothing when it is still current,
+    // only the bars changed since when the server still knows them. result.series holds the whole current
+    // series either way
+    void fetch(const std::string &symbol, WireFormat format, ResponseHandler handler);
+    std::future<ClientResult> fetch(const std::string &symbol, WireFormat format = WireFormat::CSV);
+
+    // Drop the cached copies, the next fetch of each symbol transfers it whole. connect does it too
+    void clearCache();
+
+    // Keep a local copy of symbol current from the server's pushes. onEnd, if set, is called once when the
+    // subscription ends: ok after an unsubscribe, with the error if it was refused or the connection failed.
+    // Its result holds the last local copy. One subscription per symbol
+    void subscribe(const std::string &symbol, WireFormat format, UpdateHandler onUpdate, ResponseHandler onEnd = nullptr);
+    void unsubscribe(const std::string &symbol);
+
+    // Close the connection, every outstanding request and subscription fails with "Connection closed"
+    void close();
+
+private:
+    enum class PendingKind
+    {
+        Get,
+        MGet,
+        Fetch,
+        Sub,
+        Unsub
+    };
+
+    // A request sent (or queued to be sent) and not answered yet
+    struct Pending
+    {
+        PendingKind kind = PendingKind::Get;
+        std::string symbol; // Fetch, Sub and Unsub
+        ResponseHandler handler;
+        uint64_t since = 0; // Fetch: cached version the request was conditional on, 0 for none
+    };
+
+    // Local copy of a symbol as of a server version, kept by fetch
+    struct CachedSeries
+    {
+        uint64_t version = 0;
+        MarketDataSeries series;
+    };
+
+    // A push that overtook the SUBSCRIBED answer, applied after it when newer
+    struct EarlyPush
+    {
+        uint64_t version;
+        bool reset;
+        MarketDataSeries changed;
+    };
+
+    struct Subscription
+    {
+        UpdateHandler onUpdate;
+        ResponseHandler onEnd;
+        MarketDataSeries series;
+        bool started = false;  // SUBSCRIBED received
+        bool stopping = false; // UNSUB sent, pushes still in flight are dropped
+        std::vector<EarlyPush> early;
+    };
+
+    // One data frame (header line and body) decoded, or the ERROR line in its place
+    using FrameHandler = std::function<void(bool ok, std::string error, MarketDataSeries series)>;
+
+    explicit AsyncClient(boost::asio::io_context &ioc);
+
+    // Everything below runs on m_strand
+    void queue(const Protocol::Request &request, Pending pending);
+    void flush();
+    void readLine(std::function<void(std::string line)> handler);
+    void readMessage();
+    void onMessage(const std::string &line);
+    void readFrame(FrameHandler handler);
+    void onFrameHeader(const std::string &line, FrameHandler handler);
+    void readBatch(size_t index, std::shared_ptr<ClientResult> result, ResponseHandler handler);
+    void completeFetch(Pending &pending, const std::string &kind, uint64_t version, MarketDataSeries changed);
+    void onStreamFrame(const std::string &kind, const std::string &symbol, uint64_t version, MarketDataSeries changed);
+    void deliver(const std::string &symbol, Subscription &subscription, bool reset, uint64_t version,
+                 MarketDataSeries changed);
+    void stop(const std::string &symbol, Subscription &subscription);
+    void endSubscription(const std::string &symbol, bool ok, const std::string &error);
+    bool takePending(PendingKind kind, Pending &pending, const std::string &line);
+    void fail(const std::string &error);
+    void abort(const std::string &error);
+
+    boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
+    boost::asio::ip::tcp::resolver m_resolver;
+    boost::asio::ip::tcp::socket m_socket;
+    bool m_connecting = false;
+    bool m_connected = false;
+    bool m_failed = false;
+    uint64_t m_generation = 0; // Bumped when a connection ends, completions from an older socket are ignored
+
+    std::string m_queued;  // Request lines not written yet
+    std::string m_writing; // Lines of the write in progress
+    std::deque<Pending> m_pending;
+    ResponseHandler m_reading; // Request whose frames are being read, off m_pending, so abort() fails it itself
+    std::unordered_map<std::string, Subscription> m_subscriptions;
+    std::unordered_map<std::string, CachedSeries> m_cache; // Dropped on connect, versions mean nothing to another server
+
+    boost::asio::streambuf m_buffer; // Bytes read past the current line
+    std::string m_body;              // Body of the current frame, grows to the largest one seen
+};
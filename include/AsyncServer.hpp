@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+
+/// @brief Bytes answering one request. The buffers are written with a single gathered write and must
+/// stay valid while owners are held, so a shared payload goes out without being copied
+struct ServerResponse
+{
+    std::vector<boost::asio::const_buffer> buffers;
+    std::vector<std::shared_ptr<const void>> owners;
+    bool closeConnection = false; // Close once this response is written, requests after it are dropped
+
+    // Response that owns its text, for short replies such as error lines
+    static ServerResponse fromString(std::string text);
+
+    // Queue other's bytes after these, for batched and pipelined responses
+    void append(ServerResponse other);
+
+    size_t size() const { return boost::asio::buffer_size(buffers); }
+};
+
+/// @brief One client connection of an AsyncServer, for sending outside of request/response, e.g. pushed
+/// updates. Hold it as a weak_ptr: the connection goes away when the client disconnects
+class ServerConnection
+{
+public:
+    virtual ~ServerConnection() = default;
+
+    // Queue response behind everything already queued on the connection. Thread safe and never blocks.
+    // A client that lets more than AsyncServer::MAX_QUEUED_BYTES pile up is disconnected
+    virtual void send(ServerResponse response) = 0;
+};
+
+/// @brief Counters of an AsyncServer, read while it runs
+struct AsyncServerStats
+{
+    size_t activeConnections = 0;
+    size_t peakConnections = 0;
+    uint64_t acceptedConnections = 0;
+    uint64_t acceptErrors = 0; // Mostly running out of file descriptors, accepting backs off and retries
+    uint64_t slowConsumers = 0; // Connections dropped for not reading what was sent to them
+    uint64_t requests = 0;
+    uint64_t bytesSent = 0;
+};
+
+/// @brief Line based TCP server on a fixed pool of io_context threads. Accepts, reads and writes are
+/// all asynchronous, a connection costs one small state object instead of a thread, so the number of
+/// clients is bounded by file descriptors rather than by threads and their stacks.
+///
+/// Connections are persistent: every request line is passed to the handler on an io thread and the
+/// responses go back in request order until the client disconnects. Requests a client pipelines are
+/// answered together in one gathered write. Data may also be pushed to a connection at any time
+/// through ServerConnection::send, it is written between responses. The handler must be thread safe
+/// and should not block, it runs on the threads that serve every other connection
+class AsyncServer
+{
+public:
+    using RequestHandler =
+        std::function<ServerResponse(const std::string &line, const std::shared_ptr<ServerConnection> &connection)>;
+
+    // Longest request line accepted, a client sending more without a newline is dropped
+    static constexpr size_t MAX_REQUEST_LENGTH = 4096;
+
+    // Most pipelined requests answered by one write, later ones wait for the next
+    static constexpr size_t MAX_PIPELINED_RESPONSES = 64;
+
+    // Most bytes waiting to be written to one connection before it counts as a slow consumer
+    static constexpr size_t MAX_QUEUED_BYTES = 64 * 1024 * 1024;
+
+    // threads of 0 uses one per core
+    AsyncServer(RequestHandler handler, size_t threads = 0);
+    ~AsyncServer();
+
+    AsyncServer(const AsyncServer &) = delete;
+    AsyncServer &operator=(const AsyncServer &) = delete;
+
+    // Bind and listen on every interface. When the port is taken, falls back to a system assigned
+    // port if allowFallback is set and throws otherwise. Returns the port actually bound
+    unsigned short listen(unsigned short port, bool allowFallback = true);
+
+    // Start accepting on the io thread pool, returns immediately
+    void start();
+
+    // Block until stop() is called and the io threads have finished
+    void wait();
+
+    // Stop accepting, close every connection and let the io threads return once the handlers in flight
+    // finished. Safe from any thread, returns without waiting for it
+    void stop();
+
+    unsigned short port() const { return m_port; }
+    size_t threadCount() const { return m_threadCount; }
+    AsyncServerStats stats() const;
+
+    // Shared with the connections, which may outlive a single accept
+    struct Counters
+    {
+        std::atomic<size_t> active{0};
+        std::atomic<size_t> peak{0};
+        std::atomic<uint64_t> accepted{0};
+        std::atomic<uint64_t> acceptErrors{0};
+        std::atomic<uint64_t> slowConsumers{0};
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> bytesSent{0};
+    };
+
+    // Live connections, for stop() to close. Shared with the connections, which leave it when destroyed
+    struct Sessions;
+
+private:
+    void doAccept();
+
+    boost::asio::io_context m_ioc;
+    boost::asio::ip::tcp::acceptor m_acceptor;     // On its own strand, stop() closes it from another thread
+    boost::asio::steady_timer m_acceptRetry;       // On the acceptor's strand
+    RequestHandler m_handler;
+    size_t m_threadCount;
+    unsigned short m_port = 0;
+
+    std::vector<std::thread> m_threads;
+    std::shared_ptr<Counters> m_counters;
+    std::shared_ptr<Sessions> m_sessions;
+};
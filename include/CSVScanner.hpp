@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace CSVScan
+{
+    /// @brief Instruction set used by the structural scan, picked at runtime
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // Best level the running CPU supports
+    SimdLevel detectSimdLevel();
+
+    const char *simdLevelName(SimdLevel level);
+
+    /// @brief Write the offsets of every ',' and '\n' in [data, data + size) to out, offsets are shifted by base
+    /// out must have room for size entries, returns how many were written
+    size_t findStructurals(const char *data, size_t size, size_t base, size_t *out, SimdLevel level);
+}
+
+/// @brief Fields of one decoded CSV row, as views into the scanned buffer
+struct CSVRow
+{
+    static constexpr size_t MAX_FIELDS = 16;
+
+    std::array<std::string_view, MAX_FIELDS> fields;
+    size_t count = 0;      // Number of fields on the line, may exceed MAX_FIELDS
+    std::string_view line; // Whole line without the line terminator
+};
+
+/// @brief Two stage CSV reader: a vectorized pass indexes the structural characters
+/// of a window of the buffer, then rows are decoded from that index without rescanning bytes.
+/// The buffer is not copied and must outlive the scanner.
+class CSVScanner
+{
+public:
+    explicit CSVScanner(std::string_view buffer, CSVScan::SimdLevel level = CSVScan::detectSimdLevel());
+
+    // Decode the next non empty row, returns false once the buffer is exhausted
+    bool nextRow(CSVRow &row);
+
+    CSVScan::SimdLevel simdLevel() const { return m_level; }
+
+private:
+    // Index the next window holding structurals, returns false when everything has been scanned
+    bool refill();
+
+    // Bytes indexed per refill, keeps the index small enough to stay in cache. A shorter buffer gets an
+    // index only as large as itself
+    static constexpr size_t WINDOW_BYTES = 64 * 1024;
+
+    std::string_view m_buffer;
+    CSVScan::SimdLevel m_level;
+    std::vector<size_t> m_positions;
+    size_t m_count = 0;    // Valid entries in m_positions
+    size_t m_next = 0;     // Next entry to consume
+    size_t m_scanned = 0;  // Bytes of the buffer indexed so far
+    size_t m_rowStart = 0; // Offset where the next row begins
+};
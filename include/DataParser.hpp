@@ -6,24 +6,13 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <memory> // for the std::unique_prt
+#include <functional>
+#include "MarketDataSeries.hpp"
 
-struct MarketDataEntry
-{
-    std::string m_timestamp;
-    double m_open;
-    double m_high;
-    double m_low;
-    double m_close;
-    double m_volume;
-
-    MarketDataEntry() = default;
-    MarketDataEntry(const std::string &timestamp, double open, double high, double low, double close, double volume)
-        : m_timestamp(timestamp), m_open(open), m_high(high), m_low(low), m_close(close), m_volume(volume) {}
-
-    // Virutal destrocutor for proper clensing out
-    ~MarketDataEntry() = default;
-};
+class MappedFile;
+struct CSVLayout;
 
 /// @brief Interface for Parsing Structs
 class IDataParser
@@ -32,40 +21,97 @@ public:
     IDataParser() = default; // Tell compiler to generate it, with default
     virtual ~IDataParser() = default;
 
+    // Receives consecutive batches of rows in source order, the batch may be moved from.
+    // Return false to stop parsing early
+    using BatchCallback = std::function<bool(MarketDataSeries &batch)>;
+
+    static constexpr size_t DEFAULT_BATCH_SIZE = 4096;
+
+    // Stream the source in batches of at most batchSize rows, memory stays bounded by the batch
+    // Returns false on errors or when no row could be parsed
+    virtual bool parseBatches(size_t batchSize, const BatchCallback &onBatch) = 0;
+
+    // Materialize every row, a thin wrapper over parseBatches
     virtual bool parseData() = 0; // Pure Virtual Data
 
     // Virutal getDta that can be ised for retrived polymorfic results
-    virtual const std::vector<MarketDataEntry> &getData() const = 0;
+    virtual const MarketDataSeries &getData() const = 0;
 
     // Disable copying to avoid slicing problems with polimorphics behaviour
     // Slicing fyi is when a copy od a derived class object to a base class object, and it copyes only the base one (slicing it)
     // This way we are used to use pointers
     IDataParser(const IDataParser &) = delete;
     IDataParser &operator=(const IDataParser &) = delete;
+
+protected:
+    // Collect all batches into out, shared by the parseData implementations
+    bool collectAll(MarketDataSeries &out);
+};
+
+/// @brief How DataParserCSV gets the file bytes
+enum class CSVReadMode
+{
+    Buffered,    // Read the file line by line through an ifstream
+    MemoryMapped // mmap the file and parse fields straight from the mapped bytes
 };
 
 class DataParserCSV : public IDataParser
 {
 public:
-    explicit DataParserCSV(const std::string &CSVPath);
-    virtual const std::vector<MarketDataEntry> &getData() const override;
+    // threads only applies to MemoryMapped: 1 parses serially, 0 uses every hardware thread
+    explicit DataParserCSV(const std::string &CSVPath, CSVReadMode mode = CSVReadMode::Buffered, size_t threads = 1);
+
+    // Parse CSV text already in memory, e.g. a received payload, in place as a mapped file is parsed.
+    // Nothing is copied, the bytes must outlive the parser. threads as for MemoryMapped
+    DataParserCSV(const char *data, size_t size, size_t threads = 1);
+    virtual const MarketDataSeries &getData() const override;
+    virtual bool parseBatches(size_t batchSize, const BatchCallback &onBatch) override;
     virtual bool parseData() override;
 
 private:
+    bool parseBuffered(size_t batchSize, const BatchCallback &onBatch);
+    bool parseMapped(size_t batchSize, const BatchCallback &onBatch);
+    bool parseInMemory(size_t batchSize, const BatchCallback &onBatch);
+
+    // Skip the header line of content and parse the rest, serially or in parallel. file, when content is
+    // mapped from one, lets consumed pages go. Returns the number of rows handed to onBatch
+    size_t parseContent(std::string_view content, MappedFile *file, size_t batchSize, const BatchCallback &onBatch);
+
+    // Split the body at line boundaries, parse the chunks concurrently and emit them in file order.
+    // Every partition is held until all threads finish, so memory is no longer bounded by the batch.
+    // Returns the number of rows handed to onBatch
+    size_t parseParallel(std::string_view body, const CSVLayout &layout, size_t threads, size_t batchSize,
+                         const BatchCallback &onBatch);
+
     std::string m_CSVPath;
-    std::vector<MarketDataEntry> m_data;
+    CSVReadMode m_mode;
+    size_t m_threads;
+    bool m_inMemory = false;
+    std::string_view m_content; // The caller's bytes when m_inMemory
+    MarketDataSeries m_data;
 };
 
 class DataParserJson : public IDataParser
 {
 public:
     explicit DataParserJson(const std::string &jsonContent);
-    virtual const std::vector<MarketDataEntry> &getData() const override;
+
+    // Parse incrementally from a stream, e.g. an HTTP body still being received.
+    // The stream is consumed by the first parse and must outlive the parser
+    explicit DataParserJson(std::istream &source);
+
+    // Parse JSON text already in memory in place, the bytes must outlive the parser
+    DataParserJson(const char *data, size_t size);
+
+    virtual const MarketDataSeries &getData() const override;
+    virtual bool parseBatches(size_t batchSize, const BatchCallback &onBatch) override;
     virtual bool parseData() override;
 
 private:
     std::string m_jsonContent;
-    std::vector<MarketDataEntry> m_data;
+    std::string_view m_content; // Parsed in place of m_jsonContent when set
+    std::istream *m_source = nullptr;
+    MarketDataSeries m_data;
 };
 
 /**
@@ -78,14 +124,23 @@ public:
     static std::unique_ptr<IDataParser> createParser(const std::string &source);
 
     // Specific factory methods
-    static std::unique_ptr<IDataParser> createCSVParser(const std::string &filePath);
+    // CSV files are memory mapped by default, large history files are parsed without copying them
+    static std::unique_ptr<IDataParser> createCSVParser(const std::string &filePath,
+                                                        CSVReadMode mode = CSVReadMode::MemoryMapped,
+                                                        size_t threads = 1);
     static std::unique_ptr<IDataParser> createJSONParser(const std::string &jsonContent);
+
+    // Parsers over bytes already in memory, e.g. a payload in a receive buffer, parsed in place without
+    // copies or temporary files. The bytes must outlive the parser. createBufferParser picks JSON when the
+    // content starts with '{' or '[', CSV otherwise
+    static std::unique_ptr<IDataParser> createBufferParser(std::string_view content);
+    static std::unique_ptr<IDataParser> createCSVBufferParser(std::string_view content, size_t threads = 1);
 };
 
 namespace ParsingFunctions
 {
 
     // Function to parse the file locatedin the pathFileCSV and return a const object of the DataParserCSV
-    std::vector<MarketDataEntry> readCSV(const char *pathFileCSV);
+    MarketDataSeries readCSV(const char *pathFileCSV);
 
 };
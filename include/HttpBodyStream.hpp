@@ -0,0 +1,77 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <streambuf>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+/// @brief std::streambuf over the body of an HTTP response that is still being received.
+/// Each underflow pulls the next piece of body from the socket through beast's parser, so a
+/// consumer reading the stream (e.g. a SAX JSON parser) works while the rest is in flight.
+/// The header is read by the constructor; chunked and content-length bodies are both handled.
+template <typename SyncReadStream>
+class HttpBodyStreambuf : public std::streambuf
+{
+public:
+    HttpBodyStreambuf(SyncReadStream &stream, boost::beast::flat_buffer &buffer)
+        : m_stream(stream), m_buffer(buffer)
+    {
+        // "outputsize=full" responses can be well past beast's default 8 MB limit. An explicit
+        // maximum rather than boost::none, some beast versions reject any Content-Length with none
+        m_parser.body_limit(std::numeric_limits<std::uint64_t>::max());
+        boost::beast::http::read_header(m_stream, m_buffer, m_parser);
+    }
+
+    unsigned status() const { return m_parser.get().result_int(); }
+
+    // True once the last byte of the body has been received
+    bool done() const { return m_parser.is_done(); }
+
+    bool keepAlive() const { return m_parser.keep_alive(); }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+        {
+            return traits_type::to_int_type(*gptr());
+        }
+
+        // read_some may only consume framing (chunk headers), loop until body bytes show up
+        while (!m_parser.is_done())
+        {
+            auto &body = m_parser.get().body();
+            body.data = m_chunk.data();
+            body.size = m_chunk.size();
+
+            boost::beast::error_code ec;
+            boost::beast::http::read_some(m_stream, m_buffer, m_parser, ec);
+            if (ec == boost::beast::http::error::need_buffer)
+            {
+                ec = {};
+            }
+            if (ec)
+            {
+                throw boost::beast::system_error(ec);
+            }
+
+            size_t received = m_chunk.size() - body.size;
+            if (received > 0)
+            {
+                setg(m_chunk.data(), m_chunk.data(), m_chunk.data() + received);
+                return traits_type::to_int_type(*gptr());
+            }
+        }
+
+        return traits_type::eof();
+    }
+
+private:
+    static constexpr size_t CHUNK_BYTES = 64 * 1024;
+
+    SyncReadStream &m_stream;
+    boost::beast::flat_buffer &m_buffer;
+    boost::beast::http::response_parser<boost::beast::http::buffer_body> m_parser;
+    std::array<char, CHUNK_BYTES> m_chunk;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/// @brief Read-only memory mapping of a whole file (RAII)
+/// The mapping lives as long as the object, so string_views handed out by view() must not outlive it
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    // A mapping owns the pages, copying it would double unmap
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool isOpen() const { return m_open; }
+    const char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+    std::string_view view() const { return std::string_view(m_data, m_size); }
+
+    // Drop the pages of the first length bytes from memory once they have been consumed,
+    // they are read back from the file if touched again
+    void release(size_t length);
+
+private:
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_released = 0;
+    bool m_open = false;
+};
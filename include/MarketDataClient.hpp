@@ -1,30 +1,82 @@
 #pragma once
 #include <string>
 #include <boost/asio.hpp>
+#include "AsyncClient.hpp"
 #include "Logger.hpp"
 #include "DataParser.hpp"
+#include "MulticastFeed.hpp"
+#include "Protocol.hpp"
+#include "WireDecoder.hpp"
+#include "WireEncoder.hpp"
+#include <functional>
 #include <memory>
+#include <vector>
 
 using namespace boost::asio;
 using ip::tcp;
 
 namespace MarketDataClient
 {
-    // Connect to a market data server
-    void connectToServer(const std::string& serverAddress, int port);
+    // Connect to a market data server, data is requested in the given wire format
+    void connectToServer(const std::string& serverAddress, int port, WireFormat format = WireFormat::CSV);
     
-    // Handle market data received from the server
-    void handleMarketData(std::shared_ptr<tcp::socket> socket);
+    // The console's filter choice: a query the server evaluates, or the summary of every bar
+    struct FilterChoice
+    {
+        Protocol::Query query;
+        bool summary = false;
+    };
+
+    // Display the answer to a request for symbols, as filter asked
+    void handleMarketData(const ClientResult& result, const std::vector<std::string>& symbols,
+                          const FilterChoice& filter = FilterChoice());
+
+    // Read one response (CSV, BIN1 or DDC1, whichever the header announces) into out. False on an error reply.
+    // buffer belongs to the connection: it holds bytes already read past this response for the next one
+    bool receiveMarketData(tcp::socket& socket, boost::asio::streambuf& buffer, MarketDataSeries& out);
+
+    // Same, for a connection that has no other response in flight
+    bool receiveMarketData(std::shared_ptr<tcp::socket> socket, MarketDataSeries& out);
+
+    // Read an MGET response into out, one series per requested symbol in request order. A symbol the
+    // server had no data for is left empty. False if the whole request was rejected
+    bool receiveBatch(tcp::socket& socket, boost::asio::streambuf& buffer, std::vector<MarketDataSeries>& out);
     
+    // Called with the local copy of the series once the subscription starts and after every pushed change.
+    // changed holds the bars of that change, every bar for the first call and after a reset.
+    // Return false to unsubscribe
+    using SubscriptionCallback =
+        std::function<bool(const MarketDataSeries& series, const MarketDataSeries& changed, uint64_t version)>;
+
+    // Subscribe to symbol on an open connection and keep a local series current from the pushed updates
+    // until onUpdate returns false (then unsubscribes) or the connection drops. False if refused or dropped
+    bool followSymbol(tcp::socket& socket, boost::asio::streambuf& buffer, const std::string& symbol,
+                      WireFormat format, const SubscriptionCallback& onUpdate);
+
+    // Console front end for followSymbol, prints each update as it arrives
+    void subscribeToServer(const std::string& serverAddress, int port, const std::string& symbol,
+                           WireFormat format = WireFormat::CSV);
+
+    // Receive the server's multicast feed and print each update, gaps are filled over TCP with RETX
+    // from the server at serverAddress:port. Runs until the process is stopped
+    void followMulticast(const MulticastConfig& config, const std::string& serverAddress, int port);
+
+    // Follow the server's shared memory ring /dev/shm/<name> and print each bar as it is published.
+    // Runs until the process is stopped
+    void followSharedMemory(const std::string& name);
+
     // Display market data in the console
-    void displayMarketData(const std::vector<MarketDataEntry>& data, size_t maxEntries = 100);
+    void displayMarketData(const MarketDataView& data, size_t maxEntries = 100);
+
+    // Ask how to filter the data before it is requested, the filter is sent to the server with the request
+    FilterChoice promptForFilter();
 
-    // Display filtered market data
-    void displayFilteredData(const std::vector<MarketDataEntry>& entries);
+    // Display VWAP, price range, last return and rolling mean / standard deviation of the close
+    void displaySummary(const MarketDataView& data, size_t window = 20);
 
     // Allow user to prompt the symbol
     std::string promptForSymbol();
 
-    // New function for interactive client loop
-    void runClientInteractionLoop(std::shared_ptr<tcp::socket> socket);
+    // Interactive client loop, a console front end over client
+    void runClientInteractionLoop(const std::shared_ptr<AsyncClient>& client, WireFormat format = WireFormat::CSV);
 };
\ No newline at end of file
@@ -0,0 +1,206 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <vector>
+
+// Columns start on their own cache line so scans never share a line with a neighbour
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/// @brief Allocator handing out cache line aligned blocks, used for the series columns
+template <typename T>
+struct CacheAlignedAllocator
+{
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U> &) {}
+
+    T *allocate(size_t n)
+    {
+        return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t(CACHE_LINE_SIZE)));
+    }
+
+    void deallocate(T *p, size_t)
+    {
+        ::operator delete(p, std::align_val_t(CACHE_LINE_SIZE));
+    }
+
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheAlignedAllocator<U> &) const { return false; }
+};
+
+template <typename T>
+using AlignedColumn = std::vector<T, CacheAlignedAllocator<T>>;
+
+class MarketDataView;
+
+/// @brief Read-only proxy for one bar of a columnar series, nothing is copied.
+/// Only valid while the view it came from is alive
+class MarketDataRow
+{
+public:
+    MarketDataRow(const MarketDataView &view, size_t index) : m_view(&view), m_index(index) {}
+
+    int64_t timestamp() const; // Nanoseconds since the Unix epoch
+    double open() const;
+    double high() const;
+    double low() const;
+    double close() const;
+    double volume() const;
+
+private:
+    const MarketDataView *m_view;
+    size_t m_index;
+};
+
+/// @brief Non-owning view over contiguous OHLCV columns, for per-row access and slicing
+class MarketDataView
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = MarketDataRow;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = MarketDataRow;
+
+        iterator(const MarketDataView &view, size_t index) : m_view(&view), m_index(index) {}
+
+        MarketDataRow operator*() const { return MarketDataRow(*m_view, m_index); }
+        iterator &operator++()
+        {
+            ++m_index;
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        const MarketDataView *m_view;
+        size_t m_index;
+    };
+
+    MarketDataView() = default;
+    MarketDataView(const int64_t *timestamps, const double *open, const double *high, const double *low,
+                   const double *close, const double *volume, size_t size)
+        : m_timestamp(timestamps), m_open(open), m_high(high), m_low(low), m_close(close), m_volume(volume), m_size(size) {}
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const int64_t *timestamps() const { return m_timestamp; }
+    const double *open() const { return m_open; }
+    const double *high() const { return m_high; }
+    const double *low() const { return m_low; }
+    const double *close() const { return m_close; }
+    const double *volume() const { return m_volume; }
+
+    MarketDataRow operator[](size_t index) const { return MarketDataRow(*this, index); }
+    iterator begin() const { return iterator(*this, 0); }
+    iterator end() const { return iterator(*this, m_size); }
+
+    // Rows with from <= timestamp <= to, found by binary search. The view must be sorted by time
+    MarketDataView timeRange(int64_t from, int64_t to) const;
+
+    // Rows [first, first + count), clamped to the view
+    MarketDataView slice(size_t first, size_t count) const
+    {
+        first = first < m_size ? first : m_size;
+        count = count < m_size - first ? count : m_size - first;
+        return MarketDataView(m_timestamp + first, m_open + first, m_high + first, m_low + first,
+                              m_close + first, m_volume + first, count);
+    }
+
+private:
+    const int64_t *m_timestamp = nullptr;
+    const double *m_open = nullptr;
+    const double *m_high = nullptr;
+    const double *m_low = nullptr;
+    const double *m_close = nullptr;
+    const double *m_volume = nullptr;
+    size_t m_size = 0;
+};
+
+inline int64_t MarketDataRow::timestamp() const { return m_view->timestamps()[m_index]; }
+inline double MarketDataRow::open() const { return m_view->open()[m_index]; }
+inline double MarketDataRow::high() const { return m_view->high()[m_index]; }
+inline double MarketDataRow::low() const { return m_view->low()[m_index]; }
+inline double MarketDataRow::close() const { return m_view->close()[m_index]; }
+inline double MarketDataRow::volume() const { return m_view->volume()[m_index]; }
+
+/// @brief Columnar (struct of arrays) OHLCV series: int64 timestamps plus one contiguous,
+/// cache line aligned array per price field
+class MarketDataSeries
+{
+public:
+    size_t size() const { return m_timestamp.size(); }
+    bool empty() const { return m_timestamp.empty(); }
+
+    // Rows that fit before any column reallocates
+    size_t capacity() const;
+
+    void reserve(size_t rows);
+    void clear();
+
+    void push_back(int64_t timestamp, double open, double high, double low, double close, double volume)
+    {
+        m_timestamp.push_back(timestamp);
+        m_open.push_back(open);
+        m_high.push_back(high);
+        m_low.push_back(low);
+        m_close.push_back(close);
+        m_volume.push_back(volume);
+    }
+
+    void push_back(const MarketDataRow &row)
+    {
+        push_back(row.timestamp(), row.open(), row.high(), row.low(), row.close(), row.volume());
+    }
+
+    // Overwrite the prices and volume of an existing row, the timestamp stays
+    void setValues(size_t index, double open, double high, double low, double close, double volume)
+    {
+        m_open[index] = open;
+        m_high[index] = high;
+        m_low[index] = low;
+        m_close[index] = close;
+        m_volume[index] = volume;
+    }
+
+    // Append every row of a view, column by column
+    void append(const MarketDataView &rows);
+
+    bool isSortedByTime() const;
+
+    // Reorder the rows by timestamp, rows sharing a timestamp keep their order
+    void sortByTime();
+
+    // Invalidated by any call that grows the series
+    MarketDataView view() const
+    {
+        return MarketDataView(m_timestamp.data(), m_open.data(), m_high.data(), m_low.data(),
+                              m_close.data(), m_volume.data(), size());
+    }
+
+    const int64_t *timestamps() const { return m_timestamp.data(); }
+    const double *open() const { return m_open.data(); }
+    const double *high() const { return m_high.data(); }
+    const double *low() const { return m_low.data(); }
+    const double *close() const { return m_close.data(); }
+    const double *volume() const { return m_volume.data(); }
+
+private:
+    AlignedColumn<int64_t> m_timestamp;
+    AlignedColumn<double> m_open;
+    AlignedColumn<double> m_high;
+    AlignedColumn<double> m_low;
+    AlignedColumn<double> m_close;
+    AlignedColumn<double> m_volume;
+};
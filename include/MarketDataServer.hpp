@@ -1,6 +1,13 @@
 #pragma once
+#include <functional>
 #include <memory>
+#include "AsyncServer.hpp"
 #include "DataParser.hpp"
+#include "MulticastFeed.hpp"
+#include "Protocol.hpp"
+#include "SharedMemoryRing.hpp"
+#include "UpstreamClient.hpp"
+#include "WireEncoder.hpp"
 #include <boost/asio.hpp>
 #include <utility>
 #include <string>
@@ -24,35 +31,169 @@ namespace MarketDataServer
     std::vector<std::string> symbols = {"APPL"};
     bool useCSV = false;                                                       // By default dont use CSV
     std::string dataPath = std::string(DATA_FOLDER) + "/market_data_test.csv"; // Optional falback to CSV path
+    size_t csvParseThreads = 0;                                                // Threads for the CSV fallback parse, 0 = all cores
+    std::string apiHost = "www.alphavantage.co";                               // Upstream market data API
+    std::string apiPort = "443";
+    bool apiUseTls = true;                                                     // Plain HTTP is only meant for local stand-ins
+    size_t maxConcurrentFetches = 4;                                           // Symbol fetches in flight per refresh cycle
+    double requestsPerMinute = 5;                                              // Upstream quota (Alpha Vantage free tier), 0 = unlimited
+    size_t requestBurst = 5;                                                   // Requests allowed back to back before the quota applies
+    size_t ioThreads = 0;                                                      // Threads serving client connections, 0 = one per core
+    bool enableMulticast = false;                                              // Also publish cache updates to a multicast group
+    MulticastConfig multicast;
+    bool enableSharedMemory = false;                                           // Also publish cache updates to a /dev/shm ring
+    std::string sharedMemoryName = "market_data_ring";
+    size_t sharedMemorySlots = 1 << 16;                                        // 128 bytes each
   };
 
+  /// @brief What a DataCache::mergeData call changed
+  struct MergeResult
+  {
+    size_t appended = 0; // Bars newer than anything cached
+    size_t revised = 0;  // Cached bars whose values changed, e.g. the still forming last minute
+    size_t inserted = 0; // Older bars that filled a gap in the cached history
+    uint64_t version = 0;
+
+    bool changed() const { return appended + revised + inserted > 0; }
+  };
+
+  // Versions whose changes a snapshot keeps for conditional GETs (SINCE=<version>)
+  constexpr size_t MAX_RECENT_CHANGES = 64;
+
+  /// @brief Bars one merged version added or revised, shared by the snapshots that still list it
+  struct VersionDelta
+  {
+    uint64_t version = 0;     // The version these changes produced
+    MarketDataSeries changed; // Sorted by time
+    PayloadCache payloads;    // Wire encodings of changed, built on first send
+  };
+
+  /// @brief Immutable published state of one symbol. Holding the shared_ptr keeps the bars alive,
+  /// so a reader can scan the view for as long as it likes while newer versions get published
+  struct MarketDataSnapshot
+  {
+    MarketDataView view;
+    uint64_t version = 0;
+    std::shared_ptr<const void> keepAlive; // Owns the columns behind view
+    PayloadCache payloads;                  // Wire encodings of view, built on first send
+
+    // Changes of the latest merged versions, oldest first, the last one made this version. Emptied when
+    // the series is replaced: a client holding an older version then needs the whole series again
+    std::vector<std::shared_ptr<const VersionDelta>> recentChanges;
+  };
+
+  /// @brief One version published by a DataCache, as handed to its update listener
+  struct CacheUpdate
+  {
+    std::string symbol;
+    std::shared_ptr<const MarketDataSnapshot> snapshot; // The version just published
+    std::shared_ptr<const VersionDelta> delta;          // Bars added or revised by it, null when replaced
+    bool replaced = false;                              // Whole series replaced
+
+    // The bars of delta, sorted by time, empty when replaced
+    MarketDataView changed() const { return delta ? delta->changed.view() : MarketDataView(); }
+  };
+
+  /// @brief Latest series per symbol. Every series is kept sorted by timestamp, so the
+  /// timestamp column doubles as the time index for range lookups. Each symbol carries a
+  /// version that increases whenever its bars change.
+  ///
+  /// Reads are RCU style: snapshot() atomically loads the current version. It takes no cache wide
+  /// lock and copies nothing, but the atomic shared_ptr loads are not lock free: libstdc++ guards
+  /// each with a mutex from a small global pool, held for the reference count update. Writers are
+  /// serialised among themselves, build the next version and publish it with an atomic store.
+  /// Appends that fit the column capacity are written past the end that published snapshots can
+  /// see, so the common refresh publishes without copying the history
   class DataCache
   {
   public:
-    void updateData(const std::string &symbol, const std::vector<MarketDataEntry> &data);
-    std::vector<MarketDataEntry> getData(const std::string &symbol) const;
+    DataCache();
+
+    // Replace the whole series of a symbol
+    void updateData(const std::string &symbol, const MarketDataSeries &data);
+
+    // Fold freshly fetched bars into the cached series, deduplicated by timestamp. Cost is
+    // O(log n + fetched bars) when the fetch overlaps the cached tail, the usual refresh case
+    MergeResult mergeData(const std::string &symbol, const MarketDataSeries &data);
+
+    // Current version of a symbol, null if it was never stored. Two atomic shared_ptr loads (the slot
+    // map, then the slot), no cache wide lock and no copy
+    std::shared_ptr<const MarketDataSnapshot> snapshot(const std::string &symbol) const;
+
+    // Owning copies, prefer snapshot() on hot paths
+    MarketDataSeries getData(const std::string &symbol) const;
+
+    // Bars with from <= timestamp <= to (epoch nanoseconds), O(log n) plus the rows returned
+    MarketDataSeries getRange(const std::string &symbol, int64_t from, int64_t to) const;
+
+    // 0 for a symbol that was never stored
+    uint64_t version(const std::string &symbol) const;
+
+    // Called after every published change, under the writer lock: updates of a symbol arrive one at a
+    // time in version order. Must be quick, every writer waits for it
+    using UpdateListener = std::function<void(const CacheUpdate &update)>;
+    void setUpdateListener(UpdateListener listener);
 
   private:
-    std::unordered_map<std::string, std::vector<MarketDataEntry>> m_cache;
-    mutable std::mutex m_mutex;
+    struct Slot
+    {
+      std::shared_ptr<const MarketDataSnapshot> current; // Published, read with atomic_load
+      std::shared_ptr<MarketDataSeries> storage;         // Columns behind current, touched by writers only
+    };
+    using SlotMap = std::unordered_map<std::string, std::shared_ptr<Slot>>;
+
+    // Slot of a symbol, created (copy on write of the map) if needed. m_writeMutex must be held
+    Slot &writableSlot(const std::string &symbol);
+
+    // Make storage the current version of the slot. delta is what a merge changed, null for a replacement
+    static void publish(Slot &slot, std::shared_ptr<MarketDataSeries> storage, uint64_t version,
+                        std::shared_ptr<const VersionDelta> delta);
+
+    std::shared_ptr<const SlotMap> m_slots; // Replaced only when a symbol is added
+    std::mutex m_writeMutex;
+    UpdateListener m_listener;              // Guarded by m_writeMutex
   };
 
   // Start the server with the given configuration
   void StartServer(const ServerConfig& config);
 
-  void accept_connections(tcp::acceptor &acceptor);
-
-
-  // Handler for a single client connections
-  void HandleClient(std::shared_ptr<tcp::socket> socket);
+  // Answer one request line (GET, MGET, SUB, UNSUB, RETX or QUIT), called on the server's io threads. Never blocks
+  // on the network. Subscriptions push to connection, without one SUB is refused. Any other line is answered
+  // "ERROR: Unknown command\n"
+  ServerResponse HandleRequest(const std::string &line, const std::shared_ptr<ServerConnection> &connection);
 
   // Fetch data from Alpha Vantage API
  std::string FetchMarketData(const std::string& symbol, const std::string& apiKey);
 
+  // Fetch intraday bars and parse them while the body is still downloading.
+  // Bars reach onBatch as soon as they are decoded, the body is never buffered whole
+  // Uses a client shared across calls, so connections and TLS sessions are reused between symbols
+  bool StreamMarketData(const ServerConfig &config, const std::string &symbol,
+                        const IDataParser::BatchCallback &onBatch);
+
+  bool StreamMarketData(UpstreamClient &client, const std::string &apiKey, const std::string &symbol,
+                        const IDataParser::BatchCallback &onBatch);
+
   void DataUpdateTask(const ServerConfig config);
 
-  // Send market data to a client
-  void SendMarketData(std::shared_ptr<tcp::socket> socket, const std::string &symbol);
+  // Current bars of a symbol in the requested format, or an error line when there are none
+  ServerResponse MarketDataResponse(const std::string &symbol, WireFormat format = WireFormat::CSV);
+
+  // Answer to "GET <symbol> SINCE=<since>" from a client holding version since: "NOT_MODIFIED:<symbol>:<version>"
+  // when that is still current, "DELTA:<symbol>:<version>" and the bars changed after since when the
+  // snapshot's recent changes reach back to it, "SNAPSHOT:<symbol>:<version>" and every bar otherwise.
+  // The bars follow as a response of their own would. An error line when there is no data
+  ServerResponse ConditionalResponse(const std::string &symbol, uint64_t since, WireFormat format = WireFormat::CSV);
+
+  // Rows of view a query keeps, ascending. The timestamp conditions narrow the range by binary search, the
+  // others are evaluated column by column with Analytics::select in blocks scanned back from the newest bar,
+  // only until LIMIT is met. The view must be sorted by time
+  void SelectRows(const MarketDataView &view, const Protocol::Query &query, std::vector<size_t> &rows);
+
+  // Answer to a GET or MGET carrying a query: only the bars it keeps, encoded for this request in the
+  // requested format and framed as MarketDataResponse frames them. An error line when there is no data
+  ServerResponse QueryResponse(const std::string &symbol, const Protocol::Query &query,
+                               WireFormat format = WireFormat::CSV);
 
   // Method for Startting periodic fetching
   std::thread StartPeriodicFetching(const ServerConfig& config);
@@ -60,8 +201,34 @@ namespace MarketDataServer
   // Method to stop periodic fetching
   void StopPeriodicFetching();
 
+  // Fold bars into the served cache, as a refresh does
+  MergeResult MergeMarketData(const std::string &symbol, const MarketDataSeries &data);
+
+  // Publish every later cache update to a multicast group and answer RETX from it. Null if the socket
+  // could not be set up. Replaces a feed already running
+  std::shared_ptr<MulticastPublisher> StartMulticast(const MulticastConfig &config);
+
+  // Stop publishing to the multicast group, RETX is refused from then on
+  void StopMulticast();
+
+  // Write every later cache update into the shared memory ring /dev/shm/<name>, for readers on this
+  // host (SharedMemoryReader). Null if the object could not be created. Replaces a ring already running
+  std::shared_ptr<SharedMemoryPublisher> StartSharedMemory(const std::string &name, size_t slots);
+
+  // Stop writing to the ring and remove its shared memory object
+  void StopSharedMemory();
+
+  // Connections currently subscribed to a symbol
+  size_t SubscriberCount(const std::string &symbol);
+
+  // Current published snapshot of a symbol, null if there is none. No lock and no copy
+  std::shared_ptr<const MarketDataSnapshot> GetSnapshot(const std::string &symbol);
+
   // Get the latest data for a symbol
- std::vector<MarketDataEntry> GetLatestData(const std::string& symbol);
+ MarketDataSeries GetLatestData(const std::string& symbol);
+
+  // Get the bars of a symbol within [from, to] (epoch nanoseconds)
+ MarketDataSeries GetDataRange(const std::string& symbol, int64_t from, int64_t to);
 
   /// @brief
   /// Establish HTTPS connection
@@ -0,0 +1,238 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/asio.hpp>
+#include "AsyncServer.hpp"
+#include "MarketDataSeries.hpp"
+
+/// @brief UDP multicast feed of cache updates, for one-to-many distribution inside the network.
+///
+/// Every datagram carries one symbol and is numbered per symbol. Layout, little-endian:
+///   0  uint32 magic "MDF1"       4  uint8 flags       5  uint8 symbol length       6  uint16 bar count
+///   8  uint64 sequence, from 1 per symbol, heartbeats repeat the last one
+///   16 uint64 cache version the bars belong to
+///   24 symbol, zero padded to a multiple of 8, then bar count 48 byte WireRecords
+///
+/// A receiver that sees a sequence gap asks the server for the missing datagrams over the TCP port:
+/// "RETX <SYMBOL> FROM=<first> TO=<last>" is answered with "RETX:<SYMBOL>:<count>:<bytes>\n" followed
+/// by count datagrams, each preceded by its uint16 little-endian length
+namespace MulticastFeed
+{
+    constexpr uint32_t MAGIC = 0x3146444D; // "MDF1" in memory order
+    constexpr size_t HEADER_SIZE = 24;
+
+    // Largest datagram sent, below the 1280 byte minimum IPv6 MTU so nothing fragments
+    constexpr size_t MAX_DATAGRAM = 1200;
+
+    enum Flags : uint8_t
+    {
+        FLAG_RESET = 1,    // The series was replaced, receivers should take a new snapshot with GET
+        FLAG_HEARTBEAT = 2 // No bars, sequence is the last one sent: lets receivers spot a lost final datagram
+    };
+
+    struct Packet
+    {
+        uint8_t flags = 0;
+        uint64_t sequence = 0;
+        uint64_t version = 0;
+        std::string symbol;
+        MarketDataSeries bars;
+    };
+
+    // Parse one datagram, false if it is not a well formed feed datagram
+    bool decode(const char *data, size_t size, Packet &out);
+}
+
+struct MulticastConfig
+{
+    std::string group = "239.255.0.1";        // Administratively scoped, stays inside the organisation
+    unsigned short port = 30001;
+    std::string interfaceAddress = "0.0.0.0"; // Interface to send on and join with, 127.0.0.1 for loopback
+    int ttl = 1;                              // Router hops, 1 keeps the feed on the local subnet
+    bool loopback = true;                     // Deliver to receivers on the sending host too
+    size_t retransmitDepth = 4096;            // Datagrams kept per symbol for RETX
+    std::chrono::milliseconds heartbeatInterval{1000}; // 0 disables heartbeats
+};
+
+struct MulticastPublisherStats
+{
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0; // Send failed or the socket buffer was full, receivers recover these with RETX
+    uint64_t heartbeats = 0;
+    uint64_t retransmitted = 0;
+};
+
+/// @brief Sends cache updates to a multicast group and keeps the recent datagrams of every symbol
+/// for retransmission. Sends never block: a full socket buffer drops the datagram, receivers
+/// recover it with RETX. Thread safe
+class MulticastPublisher
+{
+public:
+    explicit MulticastPublisher(const MulticastConfig &config);
+    ~MulticastPublisher();
+
+    MulticastPublisher(const MulticastPublisher &) = delete;
+    MulticastPublisher &operator=(const MulticastPublisher &) = delete;
+
+    // Send the bars one version of symbol changed, split over as many datagrams as they need.
+    // A reset sends a single FLAG_RESET datagram, receivers fetch the new series themselves
+    void publish(const std::string &symbol, uint64_t version, bool reset, const MarketDataView &bars);
+
+    // RETX reply with the buffered datagrams of symbol in [from, to], those no longer buffered are left out
+    ServerResponse retransmit(const std::string &symbol, uint64_t from, uint64_t to);
+
+    // Heartbeat for every symbol sent so far, also sent by a background thread every heartbeatInterval
+    void sendHeartbeats();
+
+    MulticastPublisherStats stats() const;
+    const MulticastConfig &config() const { return m_config; }
+
+private:
+    struct SymbolFeed
+    {
+        uint64_t nextSequence = 1;
+        uint64_t lastVersion = 0;
+        std::deque<std::shared_ptr<const std::string>> recent; // Length prefixed datagrams, oldest first
+    };
+
+    // Send one length prefixed datagram, m_mutex must be held
+    void send(const std::string &framed);
+
+    MulticastConfig m_config;
+    boost::asio::io_context m_ioc;
+    boost::asio::ip::udp::socket m_socket;
+    boost::asio::ip::udp::endpoint m_destination;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, SymbolFeed> m_feeds;
+    MulticastPublisherStats m_stats;
+
+    std::mutex m_heartbeatMutex;
+    std::condition_variable m_heartbeatWake;
+    bool m_stopping = false;
+    std::thread m_heartbeatThread;
+};
+
+/// @brief One update as delivered by a FeedReceiver, in sequence order per symbol
+struct FeedUpdate
+{
+    std::string symbol;
+    uint64_t sequence = 0;
+    uint64_t version = 0;
+    bool reset = false;   // Local state of the symbol is stale (series replaced, or datagrams lost for good): GET it again
+    bool recovered = false; // Arrived through RETX
+    MarketDataSeries bars;
+};
+
+struct FeedReceiverStats
+{
+    uint64_t datagrams = 0;
+    uint64_t malformed = 0;
+    uint64_t duplicates = 0;
+    uint64_t heartbeats = 0;
+    uint64_t gaps = 0;         // Times a sequence gap was detected
+    uint64_t recovered = 0;    // Datagrams filled in by RETX
+    uint64_t lost = 0;         // Datagrams neither received nor retransmitted
+    uint64_t retransmitRequests = 0;
+};
+
+/// @brief Receives the multicast feed, puts each symbol's datagrams back in sequence and fills gaps
+/// over TCP with RETX. A symbol's stream starts at the first datagram seen, earlier history is what
+/// GET is for. Not thread safe, run() and onDatagram() belong to one thread; stop() may be called from any
+class FeedReceiver
+{
+public:
+    using UpdateCallback = std::function<void(const FeedUpdate &update)>;
+
+    FeedReceiver(const MulticastConfig &config, const std::string &serverAddress, unsigned short serverPort,
+                 UpdateCallback onUpdate);
+
+    // Join the group and process datagrams until stop()
+    void run();
+    // Process datagrams handed over with post() until stop(), without joining the group
+    void serve();
+    void stop();
+
+    // Hand over a datagram received elsewhere, it is processed on the thread in run() or serve()
+    void post(const char *data, size_t size);
+
+    FeedReceiverStats stats() const { return m_stats; }
+
+private:
+    struct Pending
+    {
+        MulticastFeed::Packet packet;
+        bool recovered = false;
+    };
+
+    struct SymbolState
+    {
+        uint64_t next = 0;                  // Next sequence to deliver, 0 until the first datagram
+        uint64_t requested = 0;             // Last sequence a queued RETX asks for
+        std::map<uint64_t, Pending> pending; // Arrived ahead of a gap
+    };
+
+    struct Retransmit
+    {
+        std::string symbol;
+        uint64_t from = 0;
+        uint64_t to = 0;
+        int attempt = 0;
+    };
+
+    void onDatagram(const char *data, size_t size);
+
+    // Queue a RETX for [from, to] of symbol, less what an earlier one already asks for. Datagrams keep
+    // being received meanwhile, those of symbol wait in state.pending until the answer is in
+    void recover(const std::string &symbol, SymbolState &state, uint64_t from, uint64_t to);
+
+    // Deliver pending datagrams from state.next on. Sequences up to giveUpThrough that are still
+    // missing are counted as lost and skipped, later gaps wait
+    void drain(const std::string &symbol, SymbolState &state, uint64_t giveUpThrough);
+
+    void deliver(MulticastFeed::Packet &packet, bool recovered);
+
+    // Send the RETX at the front of m_retransmits on the persistent TCP connection, connecting first if
+    // it is not open. One is in flight at a time, the server answers them in order anyway
+    void sendRetransmit();
+    void writeRetransmit();
+    void onRetransmitHeader(size_t length);
+    void onRetransmitBody();
+
+    // Retry the front RETX once on a fresh connection, then give up on its range
+    void retransmitFailed(const std::string &error);
+
+    // Fold the answer to the front RETX into its symbol, deliver what is now in order and send the next
+    void finishRetransmit(std::vector<MulticastFeed::Packet> packets);
+
+    MulticastConfig m_config;
+    std::string m_serverAddress;
+    unsigned short m_serverPort;
+    UpdateCallback m_onUpdate;
+
+    std::unordered_map<std::string, SymbolState> m_symbols;
+    FeedReceiverStats m_stats;
+
+    boost::asio::io_context m_ioc;
+    boost::asio::ip::udp::socket m_socket;
+    boost::asio::ip::tcp::resolver m_resolver;
+    boost::asio::ip::tcp::socket m_retransmitSocket;
+    boost::asio::streambuf m_retransmitBuffer;
+    std::deque<Retransmit> m_retransmits; // Front one is in flight
+    std::string m_retransmitLine;
+    std::string m_retransmitBody;
+    std::atomic<bool> m_stopping{false};
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Analytics.hpp"
+#include "WireEncoder.hpp"
+
+/// @brief Line based request protocol between MarketDataClient and MarketDataServer.
+/// A request is one line: "<COMMAND> <SYMBOL...> [OPTION=VALUE ...]\n", e.g. "GET AAPL FORMAT=BIN1".
+/// Connections stay open, a client may send any number of requests without waiting for the responses,
+/// which come back in request order
+namespace Protocol
+{
+    enum class Command
+    {
+        Get,   // "GET <SYMBOL> [SINCE=<version>]", one response, see MarketDataServer::ConditionalResponse for SINCE
+               // and Query for the options selecting bars on the server
+        MGet,  // "MGET <SYMBOL> <SYMBOL>...", "BATCH:<count>\n" then one response per symbol in request order
+        Sub,   // "SUB <SYMBOL>", the current bars then every later change pushed, see SubscriptionHub.hpp
+        Unsub, // "UNSUB <SYMBOL>", stop the pushes, answered with "UNSUBSCRIBED:<SYMBOL>\n"
+        Retx,  // "RETX <SYMBOL> FROM=<first> TO=<last>", multicast datagrams again, see MulticastFeed.hpp
+        Quit   // "QUIT", the server closes the connection
+    };
+
+    // Most symbols one MGET may ask for
+    constexpr size_t MAX_BATCH_SYMBOLS = 64;
+
+    // Most datagrams one RETX may ask for
+    constexpr uint64_t MAX_RETRANSMIT = 1024;
+
+    // Most conditions one request may carry
+    constexpr size_t MAX_PREDICATES = 8;
+
+    // Largest response body a client accepts. The server never sends more, a connection with more than
+    // AsyncServer::MAX_QUEUED_BYTES waiting is dropped, so a larger header is corrupt or hostile
+    constexpr size_t MAX_FRAME_BYTES = 64 * 1024 * 1024;
+
+    // One condition of a WHERE option: "<column><op><value>" with op one of < <= > >= = !=, e.g. "close>100"
+    // or "timestamp>=2025-01-16T09:30:00". The timestamp takes < <= > >= = only
+    struct Predicate
+    {
+        Column column = Column::Close;
+        Analytics::Compare op = Analytics::Compare::Greater;
+        double value = 0.0; // Value columns
+        int64_t time = 0;   // Timestamp, nanoseconds since the Unix epoch
+    };
+
+    /// @brief Bars selected by the server for a GET or MGET, so only they cross the network. Applied in
+    /// order: the WHERE conditions, EVERY counted back from the newest match so it is always kept, then
+    /// LIMIT. Not combined with SINCE
+    struct Query
+    {
+        std::vector<Predicate> where; // WHERE=<cond>[,<cond>...], every condition must hold
+        unsigned columns = ALL_COLUMNS; // COLUMNS=<column>[,<column>...], CSV only, the timestamp is always sent
+        size_t every = 1;               // EVERY=<k>, every k-th bar
+        size_t limit = 0;               // LIMIT=<n>, the newest n bars, 0 for no limit
+
+        bool empty() const { return where.empty() && columns == ALL_COLUMNS && every == 1 && limit == 0; }
+    };
+
+    struct Request
+    {
+        Command command = Command::Get;
+        std::vector<std::string> symbols;
+        WireFormat format = WireFormat::CSV; // CSV unless the client asks for FORMAT=...
+        uint64_t from = 0;                   // RETX sequence range, FROM=... and TO=...
+        uint64_t to = 0;
+        bool conditional = false; // GET with SINCE=..., answered relative to the version the client holds
+        uint64_t since = 0;
+        Query query;
+    };
+
+    // Parse one request line (trailing "\r\n" allowed). On failure error says why
+    bool parseRequest(std::string_view line, Request &request, std::string &error);
+
+    // The request line for request, newline included
+    std::string formatRequest(const Request &request);
+
+    // Header line that starts an MGET response, newline included
+    std::string batchHeader(size_t count);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+
+/// @brief Token bucket: holds up to burst tokens and refills at ratePerSecond. A rate of 0
+/// disables limiting. Thread safe, acquire() blocks the caller until a token is available
+class TokenBucket
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double ratePerSecond, size_t burst);
+
+    // Take one token, sleeping until the bucket has refilled enough
+    void acquire();
+
+    // Take one token only if one is available right now
+    bool tryAcquire();
+
+    double ratePerSecond() const { return m_rate; }
+
+private:
+    // Add the tokens earned since the last refill, m_mutex must be held
+    void refill(Clock::time_point now);
+
+    const double m_rate;
+    const double m_capacity;
+
+    std::mutex m_mutex;
+    double m_tokens;
+    Clock::time_point m_lastRefill;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "RateLimiter.hpp"
+
+/// @brief Outcome of one pass over the symbol list
+struct RefreshCycleReport
+{
+    size_t symbols = 0;
+    size_t succeeded = 0;
+    size_t failed = 0;
+    double elapsedMs = 0.0;    // Whole cycle, including rate limit waits
+    double slowestMs = 0.0;    // Longest single symbol refresh
+    double throttledMs = 0.0;  // Time workers spent waiting for the rate limiter, summed
+};
+
+/// @brief Refreshes a symbol list with up to maxConcurrent fetches in flight. Every fetch first takes
+/// a token from a bucket that persists across cycles, so the upstream quota holds over time and not
+/// just within one cycle
+class RefreshScheduler
+{
+public:
+    // Refresh one symbol, true on success. Called from worker threads, must be thread safe
+    using RefreshFunction = std::function<bool(const std::string &symbol)>;
+
+    // requestsPerMinute of 0 means no rate limit
+    RefreshScheduler(size_t maxConcurrent, double requestsPerMinute, size_t burst);
+
+    // Blocks until every symbol was refreshed once
+    RefreshCycleReport runCycle(const std::vector<std::string> &symbols, const RefreshFunction &refresh);
+
+    size_t maxConcurrent() const { return m_maxConcurrent; }
+
+private:
+    size_t m_maxConcurrent;
+    TokenBucket m_limiter;
+};
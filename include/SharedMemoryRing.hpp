@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "MarketDataSeries.hpp"
+#include "WireEncoder.hpp"
+
+/// @brief Shared memory transport of cache updates for consumers on the server's host.
+///
+/// A single producer, multi consumer ring of fixed size records in a POSIX shared memory object
+/// (/dev/shm/<name>). The producer writes every changed bar into the next slot; readers map the object
+/// read-only and follow it at their own pace, each with its own cursor, so they neither write to the
+/// ring nor make system calls once it is mapped. Every slot is a seqlock: its sequence is odd while
+/// the producer writes it and 2 * (position + 1) once the record at that position is complete. A reader
+/// copies the record out and checks the sequence again; a change means the producer lapped it
+namespace SharedMemoryRing
+{
+    constexpr uint32_t MAGIC = 0x31524D53; // "SMR1" in memory order
+    constexpr size_t MAX_SYMBOL = 15;      // Longer symbols are not published to the ring
+
+    enum Flags : uint32_t
+    {
+        FLAG_RESET = 1 // The series was replaced, the record carries no bar: GET the symbol again
+    };
+
+    /// @brief One ring record: a bar of a symbol, or a reset of the symbol
+    struct Record
+    {
+        char symbol[MAX_SYMBOL + 1]; // Zero terminated
+        uint64_t version;            // Cache version the bar belongs to
+        uint32_t flags;
+        uint32_t reserved;
+        WireRecord bar;
+    };
+
+    /// @brief Slot of the ring, two cache lines so neighbouring slots never share one
+    struct alignas(64) Slot
+    {
+        std::atomic<uint64_t> sequence;
+        Record record;
+    };
+
+    /// @brief Start of the shared object, the slots follow it
+    struct alignas(64) Header
+    {
+        uint32_t magic;
+        uint32_t slotSize;
+        uint64_t capacity;                    // Slots, a power of two
+        alignas(64) std::atomic<uint64_t> written; // Records published since the ring was created
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring sequences must be lock free to live in shared memory");
+}
+
+struct SharedMemoryPublisherStats
+{
+    uint64_t records = 0;
+    uint64_t resets = 0;
+    uint64_t skipped = 0; // Symbols too long for a record
+};
+
+/// @brief Producer side of the ring. Creates (or takes over) /dev/shm/<name> and unlinks it when
+/// destroyed. publish() must be called from one thread at a time, the DataCache update listener is
+class SharedMemoryPublisher
+{
+public:
+    // capacity is rounded up to a power of two slots
+    SharedMemoryPublisher(const std::string &name, size_t capacity);
+    ~SharedMemoryPublisher();
+
+    SharedMemoryPublisher(const SharedMemoryPublisher &) = delete;
+    SharedMemoryPublisher &operator=(const SharedMemoryPublisher &) = delete;
+
+    bool isOpen() const { return m_header != nullptr; }
+    const std::string &name() const { return m_name; }
+    size_t capacity() const { return m_capacity; }
+
+    // One record per bar, or a single FLAG_RESET record when the series was replaced
+    void publish(const std::string &symbol, uint64_t version, bool reset, const MarketDataView &bars);
+
+    SharedMemoryPublisherStats stats() const;
+
+private:
+    void write(const SharedMemoryRing::Record &record);
+
+    std::string m_name;
+    size_t m_capacity = 0;
+    size_t m_mappedSize = 0;
+    SharedMemoryRing::Header *m_header = nullptr;
+    SharedMemoryRing::Slot *m_slots = nullptr;
+
+    std::atomic<uint64_t> m_resets{0};
+    std::atomic<uint64_t> m_skipped{0};
+};
+
+/// @brief Consumer side of the ring, one per reading thread. Starts at the newest record, so it sees
+/// what is published after it was opened. No system call after the constructor
+class SharedMemoryReader
+{
+public:
+    enum class ReadResult
+    {
+        Record,  // out holds the next record
+        Empty,   // Nothing new yet
+        Overrun  // The producer lapped this reader, it skipped to the oldest record still in the ring
+    };
+
+    explicit SharedMemoryReader(const std::string &name);
+    ~SharedMemoryReader();
+
+    SharedMemoryReader(const SharedMemoryReader &) = delete;
+    SharedMemoryReader &operator=(const SharedMemoryReader &) = delete;
+
+    bool isOpen() const { return m_header != nullptr; }
+
+    // Next record in publication order. The record is copied straight from the slot into out, the one
+    // copy the seqlock needs to tell a complete record from one being overwritten
+    ReadResult next(SharedMemoryRing::Record &out);
+
+    // Records skipped because of overruns so far
+    uint64_t missed() const { return m_missed; }
+
+    // Position of the next record, in records published since the ring was created
+    uint64_t position() const { return m_position; }
+
+private:
+    size_t m_mappedSize = 0;
+    const SharedMemoryRing::Header *m_header = nullptr;
+    const SharedMemoryRing::Slot *m_slots = nullptr;
+    uint64_t m_mask = 0;
+    uint64_t m_position = 0;
+    uint64_t m_missed = 0;
+};
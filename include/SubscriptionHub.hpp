@@ -0,0 +1,51 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AsyncServer.hpp"
+#include "MarketDataServer.hpp"
+#include "WireEncoder.hpp"
+
+/// @brief Connections subscribed to a symbol ("SUB <symbol>"), and the fan-out of cache updates to them.
+///
+/// A subscription starts with "SUBSCRIBED:<symbol>:<version>\n" and the bars of that version. Each later
+/// version is pushed as "UPDATE:<symbol>:<version>\n" followed by only the bars it added or revised, or as
+/// "RESET:<symbol>:<version>\n" and every bar when the series was replaced. The bars are framed like a GET
+/// response in the subscriber's format. An update is encoded once per format and the same buffers are
+/// queued on every subscriber, so fan-out costs one encode plus a small post per connection
+class SubscriptionHub
+{
+public:
+    using SnapshotSource = std::function<std::shared_ptr<const MarketDataServer::MarketDataSnapshot>(const std::string &symbol)>;
+
+    explicit SubscriptionHub(SnapshotSource source);
+
+    // Start (or restart, e.g. to change format) the subscription of connection to symbol. Returns the
+    // response opening the stream, updates published after its snapshot follow on the connection
+    ServerResponse subscribe(const std::string &symbol, WireFormat format, const std::shared_ptr<ServerConnection> &connection);
+
+    // Stop pushing symbol to connection, false if it was not subscribed
+    bool unsubscribe(const std::string &symbol, const std::shared_ptr<ServerConnection> &connection);
+
+    // Queue update on every subscriber of its symbol, forgetting connections that have closed.
+    // Meant to be the DataCache update listener, which delivers updates of a symbol in version order
+    void publish(const MarketDataServer::CacheUpdate &update);
+
+    // Live subscriptions to symbol
+    size_t subscriberCount(const std::string &symbol) const;
+
+private:
+    struct Subscriber
+    {
+        std::weak_ptr<ServerConnection> connection;
+        WireFormat format;
+        uint64_t version; // Last version the subscriber has, older updates are not sent again
+    };
+
+    SnapshotSource m_source;
+    mutable std::mutex m_mutex; // Orders subscribe against publish, so no version is missed or sent twice
+    std::unordered_map<std::string, std::vector<Subscriber>> m_subscribers;
+};
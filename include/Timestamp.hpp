@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// @brief Conversion between textual timestamps and int64 nanoseconds since the Unix epoch.
+/// Timestamps carry no zone, they are treated as UTC.
+namespace Timestamp
+{
+    constexpr int64_t NANOS_PER_SECOND = 1000000000;
+
+    // Room needed by format(), "YYYY-MM-DDTHH:MM:SS.fffffffff" plus slack
+    constexpr size_t MAX_FORMATTED_LENGTH = 32;
+
+    // Accepts "YYYY-MM-DD", "YYYY-MM-DD HH:MM:SS" and "YYYY-MM-DDTHH:MM:SS" with an optional fraction.
+    // Fields sit at fixed offsets, so digits are decoded arithmetically and validated together at the end.
+    // A leap second (:60) has no int64 instant of its own and is rejected. nanos is only written on success
+    bool parse(std::string_view text, int64_t &nanos);
+
+    // Writes "YYYY-MM-DDTHH:MM:SS" plus the shortest of .mmm/.uuuuuu/.nnnnnnnnn that is exact,
+    // returns the number of characters written to out
+    size_t format(int64_t nanos, char *out);
+
+    std::string toString(int64_t nanos);
+}
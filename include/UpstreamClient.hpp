@@ -0,0 +1,89 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+
+struct UpstreamConfig
+{
+    std::string host = "www.alphavantage.co";
+    std::string port = "443";
+    bool useTls = true;
+    size_t maxIdleConnections = 4;                          // Keep-alive connections kept for reuse
+    std::chrono::seconds resolveTtl = std::chrono::minutes(5); // How long a DNS answer is reused
+};
+
+/// @brief Counters of one UpstreamClient, latencies cover write of the request to the last body byte
+struct UpstreamStats
+{
+    size_t requests = 0;
+    size_t failures = 0;
+    size_t connectionsOpened = 0;
+    size_t connectionsReused = 0;
+    size_t resolves = 0;
+    size_t tlsHandshakes = 0;
+    size_t tlsResumed = 0;
+    double totalLatencyMs = 0.0;
+    double minLatencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+    double lastLatencyMs = 0.0;
+
+    double meanLatencyMs() const { return requests > failures ? totalLatencyMs / (requests - failures) : 0.0; }
+};
+
+/// @brief HTTP/1.1 GET client for one upstream host that keeps its setup cost off the request path:
+/// the DNS answer is cached, finished connections go back to a keep-alive pool, and new TLS
+/// connections resume the last session instead of a full handshake. Safe to share between threads,
+/// every request runs on its own pooled connection
+class UpstreamClient
+{
+public:
+    // Reads the response body as it arrives, returning false marks the request failed
+    using BodyHandler = std::function<bool(std::istream &body)>;
+
+    explicit UpstreamClient(UpstreamConfig config = {});
+    ~UpstreamClient();
+
+    UpstreamClient(const UpstreamClient &) = delete;
+    UpstreamClient &operator=(const UpstreamClient &) = delete;
+
+    // GET target, handler is only called for a 200 response. Errors are logged and return false
+    bool get(const std::string &target, const BodyHandler &handler);
+
+    // Drop every pooled connection, the cached TLS session and DNS answer are kept
+    void closeIdle();
+
+    UpstreamStats stats() const;
+    const UpstreamConfig &config() const { return m_config; }
+
+private:
+    struct Connection;
+
+    std::unique_ptr<Connection> acquire(bool &reused);
+    std::unique_ptr<Connection> connect();
+    void release(std::unique_ptr<Connection> connection);
+    boost::asio::ip::tcp::resolver::results_type resolve();
+
+    // One attempt on one connection, true once the response has been handled
+    bool exchange(Connection &connection, const std::string &target, const BodyHandler &handler,
+                  bool &responseStarted, bool &reusable);
+
+    void record(double latencyMs, bool ok);
+
+    UpstreamConfig m_config;
+    boost::asio::io_context m_ioc;
+    boost::asio::ssl::context m_sslContext;
+
+    mutable std::mutex m_mutex; // Guards everything below
+    std::vector<std::unique_ptr<Connection>> m_idle;
+    boost::asio::ip::tcp::resolver::results_type m_endpoints;
+    std::chrono::steady_clock::time_point m_resolvedAt;
+    SSL_SESSION *m_session = nullptr;
+    UpstreamStats m_stats;
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <boost/asio/streambuf.hpp>
+#include "MarketDataSeries.hpp"
+#include "WireEncoder.hpp"
+
+/// @brief Client side of the wire format: the header lines of the server's responses and the bodies they
+/// announce. Shared by AsyncClient and the blocking console client, neither depends on the other for it
+namespace WireDecoder
+{
+    // Parse the header line of one response: "DATA_SIZE:<bytes>", "BIN1:<rows>" or "DDC1:<rows>:<bytes>".
+    // False for any other line, or a body over Protocol::MAX_FRAME_BYTES. rows is 0 for CSV, whose row count
+    // only the body tells
+    bool parseDataHeader(const std::string &line, WireFormat &format, size_t &rows, size_t &bodySize);
+
+    // Start a size byte body that follows a header line read into buffer: body is resized to size and the
+    // bytes the line read already pulled in are moved over, buffered says how many. The caller reads the
+    // rest from the socket. False, with body and buffer untouched, when size is over limit
+    bool startBody(boost::asio::streambuf &buffer, size_t size, size_t limit, std::string &body, size_t &buffered);
+
+    // Decode the body that header announced into out, which should be empty. BIN1 records are byte swapped
+    // in place when the host is big-endian
+    bool decodeBody(WireFormat format, char *body, size_t size, size_t rows, MarketDataSeries &out);
+
+    // "KIND:SYMBOL:VERSION" header of a subscription message (SUBSCRIBED, UPDATE or RESET), false for anything else
+    bool parseStreamHeader(const std::string &line, std::string &kind, std::string &symbol, uint64_t &version);
+
+    // Any "KIND:SYMBOL:VERSION" line, subscription messages and the answers to conditional GETs
+    // (NOT_MODIFIED, DELTA or SNAPSHOT)
+    bool parseVersionedHeader(const std::string &line, std::string &kind, std::string &symbol, uint64_t &version);
+
+    // Insert or overwrite bars of series by timestamp, as a pushed update does
+    void applyChanges(MarketDataSeries &series, const MarketDataView &changed);
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "MarketDataSeries.hpp"
+
+// Encodings the server can send a series in
+enum class WireFormat
+{
+    CSV,  // "DATA_SIZE:<bytes>\n", then a "timestamp,open,high,low,close,volume" line plus one line per bar
+    BIN1, // "BIN1:<rows>\n", then rows fixed size little-endian WireRecords
+    DDC1, // "DDC1:<rows>:<bytes>\n", then bytes of varint compressed bars, see WireEncoder::decodeCompressed
+    Count
+};
+
+// Columns of a bar in wire order. Bit i of a column mask stands for column i
+enum class Column
+{
+    Timestamp,
+    Open,
+    High,
+    Low,
+    Close,
+    Volume,
+    Count
+};
+constexpr unsigned ALL_COLUMNS = (1u << static_cast<unsigned>(Column::Count)) - 1;
+
+/// @brief One bar of the BIN1 format: 48 bytes, little-endian, no padding. A received body is an
+/// array of these and is used in place, nothing is parsed
+struct WireRecord
+{
+    int64_t timestamp; // Nanoseconds since the Unix epoch
+    double open;
+    double high;
+    double low;
+    double close;
+    double volume;
+};
+static_assert(sizeof(WireRecord) == 48, "BIN1 records are 48 bytes on the wire");
+
+/// @brief A complete response (size header plus body) in one immutable buffer, shared by every
+/// send of the same snapshot
+struct EncodedPayload
+{
+    std::string buffer;
+    size_t offset = 0; // The header is written right-aligned in front of the body
+    size_t rows = 0;
+
+    std::string_view bytes() const { return std::string_view(buffer).substr(offset); }
+};
+
+namespace WireEncoder
+{
+    // Longest CSV line: timestamp, five shortest round-trip doubles, separators and newline
+    constexpr size_t MAX_CSV_ROW_LENGTH = 32 + 5 * 25 + 6;
+
+    // Writes row index of view as a CSV line, returns the number of characters written.
+    // std::to_chars throughout, nothing is allocated
+    size_t writeCsvRow(const MarketDataView &view, size_t index, char *out);
+
+    // Header line followed by the body in the given format
+    std::shared_ptr<const EncodedPayload> encode(const MarketDataView &view, WireFormat format);
+
+    // CSV of only the columns in the mask, in wire order and named in the header line. The timestamp is
+    // always written. Binary formats have a fixed record and always carry every column
+    std::shared_ptr<const EncodedPayload> encodeCsv(const MarketDataView &view, unsigned columns);
+
+    // Name used in CSV headers and requests, "timestamp", "open", ...
+    const char *columnName(Column column);
+    bool parseColumn(std::string_view name, Column &column);
+
+    // Name used in requests and header lines, "CSV", "BIN1" or "DDC1"
+    const char *formatName(WireFormat format);
+    bool parseFormat(std::string_view name, WireFormat &format);
+
+    // Columns from received BIN1 records, records must already be in host byte order
+    void decodeRecords(const WireRecord *records, size_t count, MarketDataSeries &out);
+
+    // Swap a record received on a big-endian host into host order, a no-op on little-endian hosts
+    void toHostOrder(WireRecord *records, size_t count);
+
+    // Most decimals DDC1 scales a column by before falling back to raw doubles
+    constexpr uint8_t MAX_DDC1_DECIMALS = 9;
+    constexpr uint8_t DDC1_RAW = 0xFF;
+
+    // Append rows bars of a DDC1 body to out. The body starts with two bytes, the decimals of the price
+    // columns and of the volume column. Prices and volumes are integers of that many decimals (ticks);
+    // DDC1_RAW stores the group as 8 byte little-endian doubles instead, used when some value is not a
+    // short decimal. Each bar is then a run of zigzag LEB128 varints: the timestamp's delta of delta,
+    // the close ticks' delta from the previous close, open, high and low as ticks from the bar's close,
+    // and the volume ticks. Lossless: the encoder only picks a scale every value round trips through.
+    // False, with out left as it was, for a truncated or malformed body
+    bool decodeCompressed(const char *data, size_t size, size_t rows, MarketDataSeries &out);
+}
+
+/// @brief Payloads of one immutable view, each format encoded at most once on first use.
+/// Thread safe, concurrent callers of a format still being encoded wait for that one encode
+class PayloadCache
+{
+public:
+    std::shared_ptr<const EncodedPayload> get(const MarketDataView &view, WireFormat format) const;
+
+private:
+    static constexpr size_t FORMAT_COUNT = static_cast<size_t>(WireFormat::Count);
+
+    mutable std::array<std::once_flag, FORMAT_COUNT> m_once;
+    mutable std::array<std::shared_ptr<const EncodedPayload>, FORMAT_COUNT> m_payloads;
+};
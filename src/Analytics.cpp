@@ -0,0 +1,583 @@
+#include "Analytics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ANALYTICS_X86 1
+#endif
+
+namespace Analytics
+{
+    namespace
+    {
+        // Windows between exact recomputations of a rolling sum, at least the window itself so the
+        // recomputation never costs more than one extra addition per value
+        constexpr size_t RESYNC_INTERVAL = 4096;
+
+        size_t resyncInterval(size_t window)
+        {
+            return std::max(RESYNC_INTERVAL, window);
+        }
+
+        bool useAVX2(SimdLevel level)
+        {
+#ifdef ANALYTICS_X86
+            return level == SimdLevel::AVX2;
+#else
+            (void)level;
+            return false;
+#endif
+        }
+
+        double sumScalar(const double *values, size_t n)
+        {
+            double sum = 0.0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                sum += values[i];
+            }
+            return sum;
+        }
+
+        // Sum and sum of squares of values - shift
+        void shiftedSumsScalar(const double *values, size_t n, double shift, double &sum, double &squares)
+        {
+            sum = 0.0;
+            squares = 0.0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                double y = values[i] - shift;
+                sum += y;
+                squares += y * y;
+            }
+        }
+
+        double stdDev(double sum, double squares, size_t window)
+        {
+            double variance = (squares - sum * sum / window) / (window - 1);
+            return variance > 0.0 ? std::sqrt(variance) : 0.0;
+        }
+
+        template <typename Op>
+        size_t selectScalar(const double *values, size_t n, double threshold, size_t *out, Op op)
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                // Branch free append, as in the CSV scan
+                out[count] = i;
+                count += op(values[i], threshold);
+            }
+            return count;
+        }
+
+#ifdef ANALYTICS_X86
+        __attribute__((target("avx2"))) inline double horizontalSum(__m256d v)
+        {
+            __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+        }
+
+        // Inclusive prefix sum of the four lanes
+        __attribute__((target("avx2"))) inline __m256d prefixSum(__m256d d)
+        {
+            const __m256d zero = _mm256_setzero_pd();
+            d = _mm256_add_pd(d, _mm256_blend_pd(_mm256_permute4x64_pd(d, _MM_SHUFFLE(2, 1, 0, 3)), zero, 0x1));
+            return _mm256_add_pd(d, _mm256_blend_pd(_mm256_permute4x64_pd(d, _MM_SHUFFLE(1, 0, 3, 2)), zero, 0x3));
+        }
+
+        __attribute__((target("avx2"))) inline __m256d lastLane(__m256d v)
+        {
+            return _mm256_permute4x64_pd(v, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+
+        __attribute__((target("avx2"))) double sumAVX2(const double *values, size_t n)
+        {
+            __m256d a = _mm256_setzero_pd();
+            __m256d b = _mm256_setzero_pd();
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                a = _mm256_add_pd(a, _mm256_loadu_pd(values + i));
+                b = _mm256_add_pd(b, _mm256_loadu_pd(values + i + 4));
+            }
+            return horizontalSum(_mm256_add_pd(a, b)) + sumScalar(values + i, n - i);
+        }
+
+        __attribute__((target("avx2"))) void shiftedSumsAVX2(const double *values, size_t n, double shift,
+                                                             double &sum, double &squares)
+        {
+            const __m256d offset = _mm256_set1_pd(shift);
+            __m256d s = _mm256_setzero_pd();
+            __m256d q = _mm256_setzero_pd();
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256d y = _mm256_sub_pd(_mm256_loadu_pd(values + i), offset);
+                s = _mm256_add_pd(s, y);
+                q = _mm256_add_pd(q, _mm256_mul_pd(y, y));
+            }
+            double tailSum = 0.0;
+            double tailSquares = 0.0;
+            shiftedSumsScalar(values + i, n - i, shift, tailSum, tailSquares);
+            sum = horizontalSum(s) + tailSum;
+            squares = horizontalSum(q) + tailSquares;
+        }
+
+        __attribute__((target("avx2"))) double vwapAVX2(const double *price, const double *volume, size_t n)
+        {
+            __m256d notional = _mm256_setzero_pd();
+            __m256d traded = _mm256_setzero_pd();
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256d v = _mm256_loadu_pd(volume + i);
+                notional = _mm256_add_pd(notional, _mm256_mul_pd(_mm256_loadu_pd(price + i), v));
+                traded = _mm256_add_pd(traded, v);
+            }
+            double totalNotional = horizontalSum(notional);
+            double totalVolume = horizontalSum(traded);
+            for (; i < n; ++i)
+            {
+                totalNotional += price[i] * volume[i];
+                totalVolume += volume[i];
+            }
+            return totalVolume != 0.0 ? totalNotional / totalVolume : 0.0;
+        }
+
+        __attribute__((target("avx2"))) double typicalVwapAVX2(const MarketDataView &bars)
+        {
+            const double *high = bars.high();
+            const double *low = bars.low();
+            const double *close = bars.close();
+            const double *volume = bars.volume();
+            const __m256d third = _mm256_set1_pd(1.0 / 3.0);
+            __m256d notional = _mm256_setzero_pd();
+            __m256d traded = _mm256_setzero_pd();
+            size_t i = 0;
+            for (; i + 4 <= bars.size(); i += 4)
+            {
+                __m256d typical = _mm256_mul_pd(
+                    _mm256_add_pd(_mm256_add_pd(_mm256_loadu_pd(high + i), _mm256_loadu_pd(low + i)),
+                                  _mm256_loadu_pd(close + i)),
+                    third);
+                __m256d v = _mm256_loadu_pd(volume + i);
+                notional = _mm256_add_pd(notional, _mm256_mul_pd(typical, v));
+                traded = _mm256_add_pd(traded, v);
+            }
+            double totalNotional = horizontalSum(notional);
+            double totalVolume = horizontalSum(traded);
+            for (; i < bars.size(); ++i)
+            {
+                totalNotional += (high[i] + low[i] + close[i]) * (1.0 / 3.0) * volume[i];
+                totalVolume += volume[i];
+            }
+            return totalVolume != 0.0 ? totalNotional / totalVolume : 0.0;
+        }
+
+        __attribute__((target("avx2"))) Extremes extremesAVX2(const double *values, size_t n)
+        {
+            __m256d low = _mm256_set1_pd(values[0]);
+            __m256d high = low;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                __m256d v = _mm256_loadu_pd(values + i);
+                low = _mm256_min_pd(low, v);
+                high = _mm256_max_pd(high, v);
+            }
+            alignas(32) double lows[4];
+            alignas(32) double highs[4];
+            _mm256_store_pd(lows, low);
+            _mm256_store_pd(highs, high);
+            Extremes result{std::min(std::min(lows[0], lows[1]), std::min(lows[2], lows[3])),
+                            std::max(std::max(highs[0], highs[1]), std::max(highs[2], highs[3]))};
+            for (; i < n; ++i)
+            {
+                result.min = std::min(result.min, values[i]);
+                result.max = std::max(result.max, values[i]);
+            }
+            return result;
+        }
+
+        __attribute__((target("avx2"))) size_t returnsAVX2(const double *values, size_t n, double *out)
+        {
+            const __m256d one = _mm256_set1_pd(1.0);
+            size_t i = 0;
+            for (; i + 5 <= n; i += 4)
+            {
+                __m256d ratio = _mm256_div_pd(_mm256_loadu_pd(values + i + 1), _mm256_loadu_pd(values + i));
+                _mm256_storeu_pd(out + i, _mm256_sub_pd(ratio, one));
+            }
+            for (; i + 1 < n; ++i)
+            {
+                out[i] = values[i + 1] / values[i] - 1.0;
+            }
+            return n - 1;
+        }
+
+        // Windows [first, end) from the sum of window first - 1: each step adds the value entering the
+        // window and drops the one leaving it, four windows at a time through a prefix sum of those changes
+        __attribute__((target("avx2"))) void rollingMeanAVX2(const double *values, size_t window, size_t first,
+                                                             size_t end, double sum, double *out)
+        {
+            const __m256d size = _mm256_set1_pd(static_cast<double>(window));
+            __m256d carry = _mm256_set1_pd(sum);
+            size_t i = first;
+            for (; i + 4 <= end; i += 4)
+            {
+                __m256d change = _mm256_sub_pd(_mm256_loadu_pd(values + i + window - 1), _mm256_loadu_pd(values + i - 1));
+                __m256d sums = _mm256_add_pd(carry, prefixSum(change));
+                _mm256_storeu_pd(out + i, _mm256_div_pd(sums, size));
+                carry = lastLane(sums);
+            }
+            sum = _mm256_cvtsd_f64(carry);
+            for (; i < end; ++i)
+            {
+                sum += values[i + window - 1] - values[i - 1];
+                out[i] = sum / window;
+            }
+        }
+
+        __attribute__((target("avx2"))) void rollingStdDevAVX2(const double *values, size_t window, size_t first,
+                                                               size_t end, double shift, double sum, double squares,
+                                                               double *out)
+        {
+            const __m256d offset = _mm256_set1_pd(shift);
+            const __m256d size = _mm256_set1_pd(static_cast<double>(window));
+            const __m256d degrees = _mm256_set1_pd(static_cast<double>(window - 1));
+            const __m256d zero = _mm256_setzero_pd();
+            __m256d sumCarry = _mm256_set1_pd(sum);
+            __m256d squaresCarry = _mm256_set1_pd(squares);
+            size_t i = first;
+            for (; i + 4 <= end; i += 4)
+            {
+                __m256d entering = _mm256_sub_pd(_mm256_loadu_pd(values + i + window - 1), offset);
+                __m256d leaving = _mm256_sub_pd(_mm256_loadu_pd(values + i - 1), offset);
+                __m256d sums = _mm256_add_pd(sumCarry, prefixSum(_mm256_sub_pd(entering, leaving)));
+                __m256d squareSums = _mm256_add_pd(
+                    squaresCarry,
+                    prefixSum(_mm256_sub_pd(_mm256_mul_pd(entering, entering), _mm256_mul_pd(leaving, leaving))));
+                __m256d variance = _mm256_div_pd(
+                    _mm256_sub_pd(squareSums, _mm256_div_pd(_mm256_mul_pd(sums, sums), size)), degrees);
+                _mm256_storeu_pd(out + i, _mm256_sqrt_pd(_mm256_max_pd(variance, zero)));
+                sumCarry = lastLane(sums);
+                squaresCarry = lastLane(squareSums);
+            }
+            sum = _mm256_cvtsd_f64(sumCarry);
+            squares = _mm256_cvtsd_f64(squaresCarry);
+            for (; i < end; ++i)
+            {
+                double entering = values[i + window - 1] - shift;
+                double leaving = values[i - 1] - shift;
+                sum += entering - leaving;
+                squares += entering * entering - leaving * leaving;
+                out[i] = stdDev(sum, squares, window);
+            }
+        }
+
+        template <int Predicate>
+        __attribute__((target("avx2"))) size_t selectAVX2(const double *values, size_t n, double threshold,
+                                                          size_t *out)
+        {
+            const __m256d bound = _mm256_set1_pd(threshold);
+            size_t count = 0;
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(values + i), bound, Predicate));
+                for (size_t lane = 0; lane < 4; ++lane)
+                {
+                    out[count] = i + lane;
+                    count += (mask >> lane) & 1;
+                }
+            }
+            return count;
+        }
+#endif
+
+        template <typename Pick>
+        size_t rollingExtreme(const double *values, size_t n, size_t window, double *out, Pick pick)
+        {
+            if (window == 0 || n < window)
+            {
+                return 0;
+            }
+            size_t count = n - window + 1;
+
+            // Blocks of window outputs: out[i] = pick(extreme of values[i .. block end], extreme of the next
+            // block's values up to i + window - 1). The suffix extremes are written to out first
+            for (size_t block = 0; block < count; block += window)
+            {
+                size_t last = block + window - 1;
+                size_t blockEnd = std::min(block + window, count);
+
+                double suffix = values[last];
+                size_t i = last;
+                for (; i >= blockEnd; --i)
+                {
+                    suffix = pick(values[i], suffix);
+                }
+                for (++i; i-- > block;)
+                {
+                    suffix = pick(values[i], suffix);
+                    out[i] = suffix;
+                }
+
+                if (block + 1 < blockEnd)
+                {
+                    double prefix = values[block + window];
+                    for (i = block + 1;;)
+                    {
+                        out[i] = pick(out[i], prefix);
+                        if (++i == blockEnd)
+                        {
+                            break;
+                        }
+                        prefix = pick(prefix, values[i + window - 1]);
+                    }
+                }
+            }
+            return count;
+        }
+    }
+
+    double vwap(const double *price, const double *volume, size_t n, SimdLevel level)
+    {
+#ifdef ANALYTICS_X86
+        if (useAVX2(level))
+        {
+            return vwapAVX2(price, volume, n);
+        }
+#endif
+        (void)level;
+        double notional = 0.0;
+        double traded = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            notional += price[i] * volume[i];
+            traded += volume[i];
+        }
+        return traded != 0.0 ? notional / traded : 0.0;
+    }
+
+    double vwap(const MarketDataView &bars, SimdLevel level)
+    {
+#ifdef ANALYTICS_X86
+        if (useAVX2(level))
+        {
+            return typicalVwapAVX2(bars);
+        }
+#endif
+        (void)level;
+        double notional = 0.0;
+        double traded = 0.0;
+        for (size_t i = 0; i < bars.size(); ++i)
+        {
+            notional += (bars.high()[i] + bars.low()[i] + bars.close()[i]) * (1.0 / 3.0) * bars.volume()[i];
+            traded += bars.volume()[i];
+        }
+        return traded != 0.0 ? notional / traded : 0.0;
+    }
+
+    Extremes extremes(const double *values, size_t n, SimdLevel level)
+    {
+        if (n == 0)
+        {
+            double nan = std::numeric_limits<double>::quiet_NaN();
+            return Extremes{nan, nan};
+        }
+#ifdef ANALYTICS_X86
+        if (useAVX2(level))
+        {
+            return extremesAVX2(values, n);
+        }
+#endif
+        (void)level;
+        Extremes result{values[0], values[0]};
+        for (size_t i = 1; i < n; ++i)
+        {
+            result.min = std::min(result.min, values[i]);
+            result.max = std::max(result.max, values[i]);
+        }
+        return result;
+    }
+
+    size_t returns(const double *values, size_t n, double *out, SimdLevel level)
+    {
+        if (n < 2)
+        {
+            return 0;
+        }
+#ifdef ANALYTICS_X86
+        if (useAVX2(level))
+        {
+            return returnsAVX2(values, n, out);
+        }
+#endif
+        (void)level;
+        for (size_t i = 0; i + 1 < n; ++i)
+        {
+            out[i] = values[i + 1] / values[i] - 1.0;
+        }
+        return n - 1;
+    }
+
+    size_t rollingMean(const double *values, size_t n, size_t window, double *out, SimdLevel level)
+    {
+        if (window == 0 || n < window)
+        {
+            return 0;
+        }
+        size_t count = n - window + 1;
+        bool avx2 = useAVX2(level);
+        for (size_t start = 0; start < count; start += resyncInterval(window))
+        {
+            size_t end = std::min(count, start + resyncInterval(window));
+#ifdef ANALYTICS_X86
+            if (avx2)
+            {
+                double sum = sumAVX2(values + start, window);
+                out[start] = sum / window;
+                rollingMeanAVX2(values, window, start + 1, end, sum, out);
+                continue;
+            }
+#endif
+            double sum = sumScalar(values + start, window);
+            out[start] = sum / window;
+            for (size_t i = start + 1; i < end; ++i)
+            {
+                sum += values[i + window - 1] - values[i - 1];
+                out[i] = sum / window;
+            }
+        }
+        (void)avx2;
+        return count;
+    }
+
+    size_t rollingStdDev(const double *values, size_t n, size_t window, double *out, SimdLevel level)
+    {
+        if (window < 2 || n < window)
+        {
+            return 0;
+        }
+        size_t count = n - window + 1;
+        bool avx2 = useAVX2(level);
+        for (size_t start = 0; start < count; start += resyncInterval(window))
+        {
+            size_t end = std::min(count, start + resyncInterval(window));
+
+            // Centred on a nearby value, the sum of squares would otherwise dwarf the variance
+            double shift = values[start];
+            double sum = 0.0;
+            double squares = 0.0;
+#ifdef ANALYTICS_X86
+            if (avx2)
+            {
+                shiftedSumsAVX2(values + start, window, shift, sum, squares);
+                out[start] = stdDev(sum, squares, window);
+                rollingStdDevAVX2(values, window, start + 1, end, shift, sum, squares, out);
+                continue;
+            }
+#endif
+            shiftedSumsScalar(values + start, window, shift, sum, squares);
+            out[start] = stdDev(sum, squares, window);
+            for (size_t i = start + 1; i < end; ++i)
+            {
+                double entering = values[i + window - 1] - shift;
+                double leaving = values[i - 1] - shift;
+                sum += entering - leaving;
+                squares += entering * entering - leaving * leaving;
+                out[i] = stdDev(sum, squares, window);
+            }
+        }
+        (void)avx2;
+        return count;
+    }
+
+    size_t rollingMin(const double *values, size_t n, size_t window, double *out)
+    {
+        return rollingExtreme(values, n, window, out, [](double a, double b)
+                              { return b < a ? b : a; });
+    }
+
+    size_t rollingMax(const double *values, size_t n, size_t window, double *out)
+    {
+        return rollingExtreme(values, n, window, out, [](double a, double b)
+                              { return b > a ? b : a; });
+    }
+
+    size_t select(const double *values, size_t n, Compare op, double threshold, size_t *out, SimdLevel level)
+    {
+        size_t count = 0;
+        size_t done = 0;
+#ifdef ANALYTICS_X86
+        if (useAVX2(level))
+        {
+            switch (op)
+            {
+            case Compare::Less:
+                count = selectAVX2<_CMP_LT_OQ>(values, n, threshold, out);
+                break;
+            case Compare::LessEqual:
+                count = selectAVX2<_CMP_LE_OQ>(values, n, threshold, out);
+                break;
+            case Compare::Greater:
+                count = selectAVX2<_CMP_GT_OQ>(values, n, threshold, out);
+                break;
+            case Compare::GreaterEqual:
+                count = selectAVX2<_CMP_GE_OQ>(values, n, threshold, out);
+                break;
+            case Compare::Equal:
+                count = selectAVX2<_CMP_EQ_OQ>(values, n, threshold, out);
+                break;
+            case Compare::NotEqual:
+                count = selectAVX2<_CMP_NEQ_UQ>(values, n, threshold, out);
+                break;
+            }
+            done = n - n % 4;
+        }
+#endif
+        (void)level;
+
+        // The scalar path, or the values past the last full vector
+        size_t *tail = out + count;
+        const double *rest = values + done;
+        size_t left = n - done;
+        size_t found = 0;
+        switch (op)
+        {
+        case Compare::Less:
+            found = selectScalar(rest, left, threshold, tail, [](double v, double t)
+                                 { return v < t; });
+            break;
+        case Compare::LessEqual:
+            found = selectScalar(rest, left, threshold, tail, [](double v, double t)
+                                 { return v <= t; });
+            break;
+        case Compare::Greater:
+            found = selectScalar(rest, left, threshold, tail, [](double v, double t)
+                                 { return v > t; });
+            break;
+        case Compare::GreaterEqual:
+            found = selectScalar(rest, left, threshold, tail, [](double v, double t)
+                                 { return v >= t; });
+            break;
+        case Compare::Equal:
+            found = selectScalar(rest, left, threshold, tail, [](double v, double t)
+                                 { return v == t; });
+            break;
+        case Compare::NotEqual:
+            found = selectScalar(rest, left, threshold, tail, [](double v, double t)
+                                 { return v != t; });
+            break;
+        }
+        for (size_t i = 0; i < found; ++i)
+        {
+            tail[i] += done;
+        }
+        return count + found;
+    }
+}
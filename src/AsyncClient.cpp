@@ -0,0 +1,734 @@
+#include "AsyncClient.hpp"
+#include "Logger.hpp"
+#include "WireDecoder.hpp"
+#include <algorithm>
+#include <charconv>
+
+using boost::asio::ip::tcp;
+
+namespace
+{
+    ClientResult failed(std::string error)
+    {
+        ClientResult result;
+        result.error = std::move(error);
+        return result;
+    }
+
+    // Line without its "\r\n", for error texts
+    std::string trimmed(const std::string &line)
+    {
+        size_t end = line.find_last_not_of("\r\n");
+        return end == std::string::npos ? std::string() : line.substr(0, end + 1);
+    }
+}
+
+std::shared_ptr<AsyncClient> AsyncClient::create(boost::asio::io_context &ioc)
+{
+    return std::shared_ptr<AsyncClient>(new AsyncClient(ioc));
+}
+
+AsyncClient::AsyncClient(boost::asio::io_context &ioc)
+    : m_strand(boost::asio::make_strand(ioc)), m_resolver(m_strand), m_socket(m_strand)
+{
+}
+
+void AsyncClient::connect(const std::string &host, unsigned short port, ConnectHandler handler)
+{
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self, host, port, handler = std::move(handler)]
+                      {
+                          if (m_connecting || m_connected)
+                          {
+                              handler(boost::asio::error::already_connected);
+                              return;
+                          }
+                          m_connecting = true;
+                          m_failed = false;
+                          m_buffer.consume(m_buffer.size());
+                          m_cache.clear();
+
+                          uint64_t generation = m_generation;
+                          m_resolver.async_resolve(
+                              host, std::to_string(port),
+                              [this, self, host, handler, generation](const boost::system::error_code &error,
+                                                                      const tcp::resolver::results_type &endpoints)
+                              {
+                                  // Closed while resolving, a later connect may be under way already
+                                  if (generation != m_generation)
+                                  {
+                                      handler(boost::asio::error::operation_aborted);
+                                      return;
+                                  }
+                                  if (error)
+                                  {
+                                      fail("Cannot resolve " + host + ": " + error.message());
+                                      handler(error);
+                                      return;
+                                  }
+                                  boost::asio::async_connect(
+                                      m_socket, endpoints,
+                                      [this, self, handler, generation](const boost::system::error_code &error,
+                                                                        const tcp::endpoint &)
+                                      {
+                                          if (generation != m_generation)
+                                          {
+                                              handler(boost::asio::error::operation_aborted);
+                                              return;
+                                          }
+                                          if (error)
+                                          {
+                                              fail("Cannot connect: " + error.message());
+                                              handler(error);
+                                              return;
+                                          }
+                                          m_connecting = false;
+                                          m_connected = true;
+                                          boost::system::error_code ignored;
+                                          m_socket.set_option(tcp::no_delay(true), ignored);
+                                          readMessage();
+                                          flush();
+                                          handler(error);
+                                      });
+                              });
+                      });
+}
+
+std::future<void> AsyncClient::connect(const std::string &host, unsigned short port)
+{
+    auto promise = std::make_shared<std::promise<void>>();
+    connect(host, port, [promise](const boost::system::error_code &error)
+            {
+                if (error)
+                {
+                    promise->set_exception(std::make_exception_ptr(boost::system::system_error(error)));
+                }
+                else
+                {
+                    promise->set_value();
+                }
+            });
+    return promise->get_future();
+}
+
+void AsyncClient::get(const std::string &symbol, WireFormat format, ResponseHandler handler)
+{
+    Protocol::Request request;
+    request.command = Protocol::Command::Get;
+    request.symbols.push_back(symbol);
+    request.format = format;
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self, request = std::move(request), handler = std::move(handler)]() mutable
+                      { queue(request, Pending{PendingKind::Get, std::string(), std::move(handler)}); });
+}
+
+std::future<ClientResult> AsyncClient::get(const std::string &symbol, WireFormat format)
+{
+    auto promise = std::make_shared<std::promise<ClientResult>>();
+    get(symbol, format, [promise](ClientResult result)
+        { promise->set_value(std::move(result)); });
+    return promise->get_future();
+}
+
+void AsyncClient::query(const std::string &symbol, const Protocol::Query &query, WireFormat format,
+                        ResponseHandler handler)
+{
+    Protocol::Request request;
+    request.command = Protocol::Command::Get;
+    request.symbols.push_back(symbol);
+    request.format = format;
+    request.query = query;
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self, request = std::move(request), handler = std::move(handler)]() mutable
+                      { queue(request, Pending{PendingKind::Get, std::string(), std::move(handler)}); });
+}
+
+std::future<ClientResult> AsyncClient::query(const std::string &symbol, const Protocol::Query &query,
+                                             WireFormat format)
+{
+    auto promise = std::make_shared<std::promise<ClientResult>>();
+    this->query(symbol, query, format, [promise](ClientResult result)
+                { promise->set_value(std::move(result)); });
+    return promise->get_future();
+}
+
+void AsyncClient::mget(const std::vector<std::string> &symbols, WireFormat format, ResponseHandler handler)
+{
+    // The server would refuse the request, say why without a round trip
+    if (symbols.empty() || symbols.size() > Protocol::MAX_BATCH_SYMBOLS)
+    {
+        boost::asio::post(m_strand, [handler = std::move(handler)]
+                          { handler(failed("MGET takes 1 to " + std::to_string(Protocol::MAX_BATCH_SYMBOLS) + " symbols")); });
+        return;
+    }
+
+    Protocol::Request request;
+    request.command = Protocol::Command::MGet;
+    request.symbols = symbols;
+    request.format = format;
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self, request = std::move(request), handler = std::move(handler)]() mutable
+                      { queue(request, Pending{PendingKind::MGet, std::string(), std::move(handler)}); });
+}
+
+std::future<ClientResult> AsyncClient::mget(const std::vector<std::string> &symbols, WireFormat format)
+{
+    auto promise = std::make_shared<std::promise<ClientResult>>();
+    mget(symbols, format, [promise](ClientResult result)
+         { promise->set_value(std::move(result)); });
+    return promise->get_future();
+}
+
+void AsyncClient::fetch(const std::string &symbol, WireFormat format, ResponseHandler handler)
+{
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self, symbol, format, handler = std::move(handler)]() mutable
+                      {
+                          Protocol::Request request;
+                          request.command = Protocol::Command::Get;
+                          request.symbols.push_back(symbol);
+                          request.format = format;
+                          request.conditional = true;
+                          auto cached = m_cache.find(symbol);
+                          request.since = cached != m_cache.end() ? cached->second.version : 0;
+                          queue(request, Pending{PendingKind::Fetch, symbol, std::move(handler), request.since});
+                      });
+}
+
+std::future<ClientResult> AsyncClient::fetch(const std::string &symbol, WireFormat format)
+{
+    auto promise = std::make_shared<std::promise<ClientResult>>();
+    fetch(symbol, format, [promise](ClientResult result)
+          { promise->set_value(std::move(result)); });
+    return promise->get_future();
+}
+
+void AsyncClient::clearCache()
+{
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self]
+                      { m_cache.clear(); });
+}
+
+void AsyncClient::subscribe(const std::string &symbol, WireFormat format, UpdateHandler onUpdate, ResponseHandler onEnd)
+{
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self, symbol, format, onUpdate = std::move(onUpdate), onEnd = std::move(onEnd)]
+                      {
+                          if (!m_connecting && !m_connected)
+                          {
+                              if (onEnd)
+                              {
+                                  onEnd(failed("Not connected"));
+                              }
+                              return;
+                          }
+                          if (m_subscriptions.count(symbol))
+                          {
+                              if (onEnd)
+                              {
+                                  onEnd(failed("Already subscribed to " + symbol));
+                              }
+                              return;
+                          }
+
+                          Subscription &subscription = m_subscriptions[symbol];
+                          subscription.onUpdate = onUpdate;
+                          subscription.onEnd = onEnd;
+
+                          Protocol::Request request;
+                          request.command = Protocol::Command::Sub;
+                          request.symbols.push_back(symbol);
+                          request.format = format;
+                          queue(request, Pending{PendingKind::Sub, symbol, nullptr});
+                      });
+}
+
+void AsyncClient::unsubscribe(const std::string &symbol)
+{
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self, symbol]
+                      {
+                          auto it = m_subscriptions.find(symbol);
+                          if (it != m_subscriptions.end() && !it->second.stopping)
+                          {
+                              stop(symbol, it->second);
+                          }
+                      });
+}
+
+void AsyncClient::close()
+{
+    auto self = shared_from_this();
+    boost::asio::post(m_strand, [this, self]
+                      { abort("Connection closed"); });
+}
+
+void AsyncClient::queue(const Protocol::Request &request, Pending pending)
+{
+    if (!m_connecting && !m_connected)
+    {
+        if (pending.handler)
+        {
+            pending.handler(failed("Not connected"));
+        }
+        return;
+    }
+    m_pending.push_back(std::move(pending));
+    m_queued += Protocol::formatRequest(request);
+    flush();
+}
+
+void AsyncClient::flush()
+{
+    if (!m_connected || !m_writing.empty() || m_queued.empty())
+    {
+        return;
+    }
+
+    // Everything queued meanwhile goes out in one write, the two strings trade places and keep their capacity
+    m_writing.swap(m_queued);
+    auto self = shared_from_this();
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_writing),
+                             [this, self, generation = m_generation](const boost::system::error_code &error, size_t)
+                             {
+                                 if (generation != m_generation)
+                                 {
+                                     return;
+                                 }
+                                 m_writing.clear();
+                                 if (error)
+                                 {
+                                     fail("Connection lost: " + error.message());
+                                     return;
+                                 }
+                                 flush();
+                             });
+}
+
+void AsyncClient::readLine(std::function<void(std::string line)> handler)
+{
+    auto self = shared_from_this();
+    boost::asio::async_read_until(m_socket, m_buffer, '\n',
+                                  [this, self, generation = m_generation,
+                                   handler = std::move(handler)](const boost::system::error_code &error, size_t length)
+                                  {
+                                      if (generation != m_generation)
+                                      {
+                                          return;
+                                      }
+                                      if (error)
+                                      {
+                                          fail(error == boost::asio::error::eof ? "Connection closed by the server"
+                                                                                : "Connection lost: " + error.message());
+                                          return;
+                                      }
+                                      auto begin = boost::asio::buffers_begin(m_buffer.data());
+                                      std::string line(begin, begin + length);
+                                      m_buffer.consume(length);
+                                      handler(std::move(line));
+                                  });
+}
+
+void AsyncClient::readMessage()
+{
+    readLine([this](std::string line)
+             { onMessage(line); });
+}
+
+void AsyncClient::onMessage(const std::string &line)
+{
+    Pending pending;
+    if (line.compare(0, 6, "ERROR:") == 0)
+    {
+        if (m_pending.empty())
+        {
+            Logger::getInstance().log("Unrequested error from the server: " + trimmed(line), Logger::LogLevel::WARNING);
+        }
+        else
+        {
+            pending = std::move(m_pending.front());
+            m_pending.pop_front();
+            if (pending.kind == PendingKind::Sub)
+            {
+                endSubscription(pending.symbol, false, trimmed(line));
+            }
+            else if (pending.handler)
+            {
+                pending.handler(failed(trimmed(line)));
+            }
+        }
+        readMessage();
+        return;
+    }
+
+    if (line.compare(0, 6, "BATCH:") == 0)
+    {
+        if (!takePending(PendingKind::MGet, pending, line))
+        {
+            return;
+        }
+        size_t count = 0;
+        auto parsed = std::from_chars(line.data() + 6, line.data() + line.size(), count);
+        if (parsed.ec != std::errc() || count > Protocol::MAX_BATCH_SYMBOLS)
+        {
+            pending.handler(failed("Invalid batch header: " + trimmed(line)));
+            fail("Invalid batch header: " + trimmed(line));
+            return;
+        }
+        auto result = std::make_shared<ClientResult>();
+        result->ok = true;
+        result->series.resize(count);
+        m_reading = pending.handler;
+        readBatch(0, std::move(result), std::move(pending.handler));
+        return;
+    }
+
+    if (line.compare(0, 13, "UNSUBSCRIBED:") == 0)
+    {
+        if (takePending(PendingKind::Unsub, pending, line))
+        {
+            endSubscription(pending.symbol, true, std::string());
+            readMessage();
+        }
+        return;
+    }
+
+    std::string kind;
+    std::string symbol;
+    uint64_t version = 0;
+    bool versioned = WireDecoder::parseVersionedHeader(line, kind, symbol, version);
+    if (versioned && (kind == "NOT_MODIFIED" || kind == "DELTA" || kind == "SNAPSHOT"))
+    {
+        if (!takePending(PendingKind::Fetch, pending, line))
+        {
+            return;
+        }
+        if (kind == "NOT_MODIFIED")
+        {
+            completeFetch(pending, kind, version, MarketDataSeries());
+            readMessage();
+            return;
+        }
+        auto request = std::make_shared<Pending>(std::move(pending));
+        m_reading = request->handler;
+        readFrame([this, request, kind, version](bool ok, std::string error, MarketDataSeries changed)
+                  {
+                      m_reading = nullptr;
+                      if (ok)
+                      {
+                          completeFetch(*request, kind, version, std::move(changed));
+                      }
+                      else
+                      {
+                          request->handler(failed(error));
+                      }
+                      readMessage();
+                  });
+        return;
+    }
+    if (versioned && (kind == "SUBSCRIBED" || kind == "UPDATE" || kind == "RESET"))
+    {
+        if (kind == "SUBSCRIBED" && !takePending(PendingKind::Sub, pending, line))
+        {
+            return;
+        }
+        readFrame([this, kind, symbol, version](bool ok, std::string error, MarketDataSeries changed)
+                  {
+                      if (!ok)
+                      {
+                          fail("Unexpected error in a " + kind + " message: " + error);
+                          return;
+                      }
+                      onStreamFrame(kind, symbol, version, std::move(changed));
+                      readMessage();
+                  });
+        return;
+    }
+
+    if (!takePending(PendingKind::Get, pending, line))
+    {
+        return;
+    }
+    m_reading = pending.handler;
+    onFrameHeader(line, [this, handler = std::move(pending.handler)](bool ok, std::string error, MarketDataSeries series)
+                  {
+                      m_reading = nullptr;
+                      ClientResult result;
+                      result.ok = ok;
+                      result.error = std::move(error);
+                      if (ok)
+                      {
+                          result.series.push_back(std::move(series));
+                      }
+                      handler(std::move(result));
+                      readMessage();
+                  });
+}
+
+void AsyncClient::readFrame(FrameHandler handler)
+{
+    readLine([this, handler = std::move(handler)](std::string line)
+             { onFrameHeader(line, handler); });
+}
+
+void AsyncClient::onFrameHeader(const std::string &line, FrameHandler handler)
+{
+    // An MGET answers a symbol without data with an ERROR line in place of its frame
+    if (line.compare(0, 6, "ERROR:") == 0)
+    {
+        handler(false, trimmed(line), MarketDataSeries());
+        return;
+    }
+
+    WireFormat format;
+    size_t rows = 0;
+    size_t size = 0;
+    if (!WireDecoder::parseDataHeader(line, format, rows, size))
+    {
+        fail("Invalid header from the server: " + trimmed(line));
+        return;
+    }
+
+    // Bytes the line read pulled in already come from the receive buffer, the rest straight from the socket
+    size_t buffered = 0;
+    if (!WireDecoder::startBody(m_buffer, size, Protocol::MAX_FRAME_BYTES, m_body, buffered))
+    {
+        fail("Invalid header from the server: " + trimmed(line));
+        return;
+    }
+
+    auto decode = [this, format, rows, handler = std::move(handler)]
+    {
+        MarketDataSeries series;
+        // The frame was read whole, a body that does not decode fails only its own request
+        if (!WireDecoder::decodeBody(format, m_body.data(), m_body.size(), rows, series))
+        {
+            handler(false, std::string("Malformed ") + WireEncoder::formatName(format) + " body", MarketDataSeries());
+            return;
+        }
+        handler(true, std::string(), std::move(series));
+    };
+    if (buffered == size)
+    {
+        decode();
+        return;
+    }
+
+    auto self = shared_from_this();
+    boost::asio::async_read(m_socket, boost::asio::buffer(m_body.data() + buffered, size - buffered),
+                            [this, self, generation = m_generation,
+                             decode = std::move(decode)](const boost::system::error_code &error, size_t)
+                            {
+                                if (generation != m_generation)
+                                {
+                                    return;
+                                }
+                                if (error)
+                                {
+                                    fail("Connection lost: " + error.message());
+                                    return;
+                                }
+                                decode();
+                            });
+}
+
+void AsyncClient::readBatch(size_t index, std::shared_ptr<ClientResult> result, ResponseHandler handler)
+{
+    if (index == result->series.size())
+    {
+        m_reading = nullptr;
+        handler(std::move(*result));
+        readMessage();
+        return;
+    }
+
+    // Each series is framed as a single response would be, a symbol without data is left empty
+    readFrame([this, index, result, handler = std::move(handler)](bool ok, std::string, MarketDataSeries series)
+              {
+                  if (ok)
+                  {
+                      result->series[index] = std::move(series);
+                  }
+                  readBatch(index + 1, result, handler);
+              });
+}
+
+void AsyncClient::completeFetch(Pending &pending, const std::string &kind, uint64_t version, MarketDataSeries changed)
+{
+    auto cached = m_cache.find(pending.symbol);
+    if (kind == "SNAPSHOT")
+    {
+        CachedSeries &entry = m_cache[pending.symbol];
+        entry.series = std::move(changed);
+        entry.version = version;
+        cached = m_cache.find(pending.symbol);
+    }
+    else if (cached == m_cache.end() || cached->second.version < pending.since)
+    {
+        // The copy the request was conditional on was dropped meanwhile
+        pending.handler(failed("Cached copy of " + pending.symbol + " was dropped, fetch it again"));
+        return;
+    }
+    else if (kind == "DELTA")
+    {
+        // Applied over a copy already newer than since (an earlier answer) the bars only get their newest values again
+        WireDecoder::applyChanges(cached->second.series, changed.view());
+        cached->second.version = std::max(cached->second.version, version);
+    }
+
+    ClientResult result;
+    result.ok = true;
+    result.version = cached->second.version;
+    result.modified = kind != "NOT_MODIFIED";
+    result.series.push_back(cached->second.series);
+    pending.handler(std::move(result));
+}
+
+void AsyncClient::onStreamFrame(const std::string &kind, const std::string &symbol, uint64_t version,
+                                MarketDataSeries changed)
+{
+    // Pushes still in flight after an UNSUB (or for a subscription already ended) are dropped
+    auto it = m_subscriptions.find(symbol);
+    if (it == m_subscriptions.end() || it->second.stopping)
+    {
+        return;
+    }
+    Subscription &subscription = it->second;
+
+    if (kind == "SUBSCRIBED")
+    {
+        subscription.started = true;
+        deliver(symbol, subscription, true, version, std::move(changed));
+        std::vector<EarlyPush> early = std::move(subscription.early);
+        for (auto &push : early)
+        {
+            if (push.version > version && !subscription.stopping)
+            {
+                deliver(symbol, subscription, push.reset, push.version, std::move(push.changed));
+            }
+        }
+        return;
+    }
+
+    // The server may push a change before its SUBSCRIBED answer is written
+    if (!subscription.started)
+    {
+        subscription.early.push_back({version, kind == "RESET", std::move(changed)});
+        return;
+    }
+    deliver(symbol, subscription, kind == "RESET", version, std::move(changed));
+}
+
+void AsyncClient::deliver(const std::string &symbol, Subscription &subscription, bool reset, uint64_t version,
+                          MarketDataSeries changed)
+{
+    if (reset)
+    {
+        subscription.series = changed;
+    }
+    else
+    {
+        WireDecoder::applyChanges(subscription.series, changed.view());
+    }
+    if (!subscription.onUpdate(subscription.series, changed, version))
+    {
+        stop(symbol, subscription);
+    }
+}
+
+void AsyncClient::stop(const std::string &symbol, Subscription &subscription)
+{
+    subscription.stopping = true;
+    Protocol::Request request;
+    request.command = Protocol::Command::Unsub;
+    request.symbols.push_back(symbol);
+    queue(request, Pending{PendingKind::Unsub, symbol, nullptr});
+}
+
+void AsyncClient::endSubscription(const std::string &symbol, bool ok, const std::string &error)
+{
+    auto it = m_subscriptions.find(symbol);
+    if (it == m_subscriptions.end())
+    {
+        return;
+    }
+    ResponseHandler onEnd = std::move(it->second.onEnd);
+    ClientResult result;
+    result.ok = ok;
+    result.error = error;
+    result.series.push_back(std::move(it->second.series));
+    m_subscriptions.erase(it);
+    if (onEnd)
+    {
+        onEnd(std::move(result));
+    }
+}
+
+bool AsyncClient::takePending(PendingKind kind, Pending &pending, const std::string &line)
+{
+    // Answers come in request order, anything else means the two sides no longer agree on the stream
+    if (m_pending.empty() || m_pending.front().kind != kind)
+    {
+        fail("Unexpected message from the server: " + trimmed(line));
+        return false;
+    }
+    pending = std::move(m_pending.front());
+    m_pending.pop_front();
+    return true;
+}
+
+void AsyncClient::fail(const std::string &error)
+{
+    if (m_failed)
+    {
+        return;
+    }
+    Logger::getInstance().log("Market data connection: " + error, Logger::LogLevel::ERROR);
+    abort(error);
+}
+
+void AsyncClient::abort(const std::string &error)
+{
+    if (m_failed)
+    {
+        return;
+    }
+    m_failed = true;
+    m_connecting = false;
+    m_connected = false;
+    ++m_generation;
+    boost::system::error_code ignored;
+    m_resolver.cancel();
+    m_socket.close(ignored);
+    m_queued.clear();
+    m_writing.clear();
+
+    // Handlers may issue new requests, which fail at once now
+    ResponseHandler reading = std::move(m_reading);
+    m_reading = nullptr;
+    std::deque<Pending> pending;
+    pending.swap(m_pending);
+    std::unordered_map<std::string, Subscription> subscriptions;
+    subscriptions.swap(m_subscriptions);
+    if (reading)
+    {
+        reading(failed(error));
+    }
+    for (auto &request : pending)
+    {
+        if (request.handler)
+        {
+            request.handler(failed(error));
+        }
+    }
+    for (auto &[symbol, subscription] : subscriptions)
+    {
+        if (subscription.onEnd)
+        {
+            ClientResult result = failed(error);
+            result.series.push_back(std::move(subscription.series));
+            subscription.onEnd(std::move(result));
+        }
+    }
+}
@@ -0,0 +1,387 @@
+#include "AsyncServer.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    class Session;
+}
+
+struct AsyncServer::Sessions
+{
+    std::mutex mutex;
+    std::unordered_map<const Session *, std::weak_ptr<Session>> live;
+};
+
+namespace
+{
+    // Pause before accepting again after a failed accept, typically EMFILE. Retrying at once would spin
+    constexpr auto ACCEPT_RETRY_DELAY = std::chrono::milliseconds(50);
+
+    /// @brief State of one client connection, kept alive by the handler of its pending operation.
+    /// The socket runs on its own strand, so the connection's handlers never run concurrently.
+    ///
+    /// Responses and pushed data queue up in m_queued while a write is in flight and go out together
+    /// in the next one. After a batch of requests the next is read only once a write completed, so a
+    /// client that pipelines without reading cannot make the server buffer without limit
+    class Session : public ServerConnection, public std::enable_shared_from_this<Session>
+    {
+    public:
+        Session(tcp::socket socket, const AsyncServer::RequestHandler &handler,
+                std::shared_ptr<AsyncServer::Counters> counters, std::shared_ptr<AsyncServer::Sessions> sessions)
+            : m_socket(std::move(socket)), m_buffer(AsyncServer::MAX_REQUEST_LENGTH), m_handler(handler),
+              m_counters(std::move(counters)), m_sessions(std::move(sessions))
+        {
+            size_t active = ++m_counters->active;
+            size_t peak = m_counters->peak.load();
+            while (active > peak && !m_counters->peak.compare_exchange_weak(peak, active))
+            {
+            }
+        }
+
+        ~Session()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sessions->mutex);
+                m_sessions->live.erase(this);
+            }
+            --m_counters->active;
+        }
+
+        void start()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_sessions->mutex);
+                m_sessions->live.emplace(this, weak_from_this());
+            }
+            readRequest();
+        }
+
+        // Close from outside the connection's handlers, the pending operations then fail and release it
+        void shutdown()
+        {
+            net::post(m_socket.get_executor(), [self = shared_from_this()] { self->close(); });
+        }
+
+        void send(ServerResponse response) override
+        {
+            net::post(m_socket.get_executor(), [self = shared_from_this(), response = std::move(response)]() mutable
+                      {
+                          if (self->m_closed)
+                          {
+                              return;
+                          }
+                          if (self->m_queuedBytes + response.size() > AsyncServer::MAX_QUEUED_BYTES)
+                          {
+                              ++self->m_counters->slowConsumers;
+                              Logger::getInstance().log("Dropping a client that stopped reading, " +
+                                                            std::to_string(self->m_queuedBytes) + " bytes queued",
+                                                        Logger::LogLevel::WARNING);
+                              self->close();
+                              return;
+                          }
+                          self->enqueue(std::move(response));
+                          self->flush();
+                      });
+        }
+
+    private:
+        void readRequest()
+        {
+            m_reading = true;
+            net::async_read_until(m_socket, m_buffer, '\n',
+                                  [self = shared_from_this()](const boost::system::error_code &ec, size_t length)
+                                  { self->onRequest(ec, length); });
+        }
+
+        void onRequest(const boost::system::error_code &ec, size_t length)
+        {
+            m_reading = false;
+
+            // Client went away, or sent MAX_REQUEST_LENGTH bytes without a newline
+            if (ec)
+            {
+                close();
+                return;
+            }
+            handleLine(length);
+
+            // Requests the client pipelined behind this one are already buffered, answer them in the same write
+            for (size_t answered = 1; answered < AsyncServer::MAX_PIPELINED_RESPONSES && !m_queued.closeConnection;
+                 ++answered)
+            {
+                std::string_view buffered(static_cast<const char *>(m_buffer.data().data()), m_buffer.size());
+                size_t newline = buffered.find('\n');
+                if (newline == std::string_view::npos)
+                {
+                    break;
+                }
+                handleLine(newline + 1);
+            }
+            flush();
+        }
+
+        // Answer the request line at the front of m_buffer, length includes the newline
+        void handleLine(size_t length)
+        {
+            auto begin = net::buffers_begin(m_buffer.data());
+            std::string line(begin, begin + (length - 1));
+            m_buffer.consume(length);
+            ++m_counters->requests;
+
+            try
+            {
+                enqueue(m_handler(line, shared_from_this()));
+            }
+            catch (const std::exception &e)
+            {
+                Logger::getInstance().log("Request handler error: " + std::string(e.what()), Logger::LogLevel::ERROR);
+                enqueue(ServerResponse::fromString("ERROR: internal server error\n"));
+            }
+        }
+
+        void enqueue(ServerResponse response)
+        {
+            m_queuedBytes += response.size();
+            m_queued.append(std::move(response));
+        }
+
+        // Write whatever is queued, or go back to reading requests when there is nothing to write
+        void flush()
+        {
+            if (m_writing || m_closed)
+            {
+                return;
+            }
+            if (m_queued.buffers.empty() && !m_queued.closeConnection)
+            {
+                if (!m_reading)
+                {
+                    readRequest();
+                }
+                return;
+            }
+
+            m_response = std::move(m_queued);
+            m_queued = ServerResponse();
+            m_queuedBytes = 0;
+            m_writing = true;
+            net::async_write(m_socket, m_response.buffers,
+                             [self = shared_from_this()](const boost::system::error_code &ec, size_t written)
+                             { self->onResponseWritten(ec, written); });
+        }
+
+        void onResponseWritten(const boost::system::error_code &ec, size_t written)
+        {
+            m_writing = false;
+            m_counters->bytesSent += written;
+            if (ec || m_response.closeConnection)
+            {
+                close();
+                return;
+            }
+            m_response = ServerResponse();
+
+            // Take the next requests even while pushed data keeps the writes busy
+            if (!m_reading)
+            {
+                readRequest();
+            }
+            flush();
+        }
+
+        void close()
+        {
+            if (m_closed)
+            {
+                return;
+            }
+            m_closed = true;
+            m_queued = ServerResponse();
+            boost::system::error_code ignored;
+            m_socket.shutdown(tcp::socket::shutdown_both, ignored);
+            m_socket.close(ignored);
+        }
+
+        tcp::socket m_socket;
+        net::streambuf m_buffer;
+        const AsyncServer::RequestHandler &m_handler;
+        std::shared_ptr<AsyncServer::Counters> m_counters;
+        std::shared_ptr<AsyncServer::Sessions> m_sessions;
+        ServerResponse m_response; // Write in flight, owns its buffers
+        ServerResponse m_queued;   // Waiting for the write in flight to finish
+        size_t m_queuedBytes = 0;
+        bool m_reading = false;
+        bool m_writing = false;
+        bool m_closed = false;
+    };
+}
+
+ServerResponse ServerResponse::fromString(std::string text)
+{
+    auto owned = std::make_shared<const std::string>(std::move(text));
+    ServerResponse response;
+    response.buffers.push_back(net::buffer(*owned));
+    response.owners.push_back(std::move(owned));
+    return response;
+}
+
+void ServerResponse::append(ServerResponse other)
+{
+    if (buffers.empty() && owners.empty())
+    {
+        other.closeConnection = other.closeConnection || closeConnection;
+        *this = std::move(other);
+        return;
+    }
+    buffers.insert(buffers.end(), other.buffers.begin(), other.buffers.end());
+    owners.insert(owners.end(), std::make_move_iterator(other.owners.begin()),
+                  std::make_move_iterator(other.owners.end()));
+    closeConnection = closeConnection || other.closeConnection;
+}
+
+AsyncServer::AsyncServer(RequestHandler handler, size_t threads)
+    : m_acceptor(net::make_strand(m_ioc)), m_acceptRetry(m_acceptor.get_executor()), m_handler(std::move(handler)),
+      m_threadCount(threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency())),
+      m_counters(std::make_shared<Counters>()), m_sessions(std::make_shared<Sessions>())
+{
+}
+
+AsyncServer::~AsyncServer()
+{
+    stop();
+    wait();
+}
+
+unsigned short AsyncServer::listen(unsigned short port, bool allowFallback)
+{
+    tcp::endpoint endpoint(tcp::v4(), port);
+    m_acceptor.open(endpoint.protocol());
+    m_acceptor.set_option(tcp::acceptor::reuse_address(true));
+
+    boost::system::error_code ec;
+    m_acceptor.bind(endpoint, ec);
+    if (ec)
+    {
+        if (!allowFallback)
+        {
+            throw boost::system::system_error(ec);
+        }
+        Logger::getInstance().log("Cannot bind to port " + std::to_string(port) + ": " + ec.message(),
+                                  Logger::LogLevel::WARNING);
+
+        // System assigned port instead
+        endpoint.port(0);
+        m_acceptor.bind(endpoint);
+        Logger::getInstance().log("Using alternative port: " + std::to_string(m_acceptor.local_endpoint().port()),
+                                  Logger::LogLevel::INFO);
+    }
+
+    // A burst of connects queues in the kernel instead of being refused while accepts catch up
+    m_acceptor.listen(net::socket_base::max_listen_connections);
+    m_port = m_acceptor.local_endpoint().port();
+    return m_port;
+}
+
+void AsyncServer::start()
+{
+    doAccept();
+    m_threads.reserve(m_threadCount);
+    for (size_t i = 0; i < m_threadCount; ++i)
+    {
+        m_threads.emplace_back([this] { m_ioc.run(); });
+    }
+}
+
+void AsyncServer::wait()
+{
+    for (auto &thread : m_threads)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+}
+
+void AsyncServer::stop()
+{
+    // On the acceptor's strand, so no accept completes after it and every session it made is registered.
+    // With the acceptor and the sockets closed nothing is left pending and the io threads return
+    net::post(m_acceptor.get_executor(), [this]
+              {
+                  boost::system::error_code ignored;
+                  m_acceptor.close(ignored);
+                  m_acceptRetry.cancel();
+
+                  std::vector<std::shared_ptr<Session>> sessions;
+                  {
+                      std::lock_guard<std::mutex> lock(m_sessions->mutex);
+                      for (const auto &[key, session] : m_sessions->live)
+                      {
+                          if (auto live = session.lock())
+                          {
+                              sessions.push_back(std::move(live));
+                          }
+                      }
+                  }
+                  for (const auto &session : sessions)
+                  {
+                      session->shutdown();
+                  }
+              });
+}
+
+AsyncServerStats AsyncServer::stats() const
+{
+    AsyncServerStats stats;
+    stats.activeConnections = m_counters->active;
+    stats.peakConnections = m_counters->peak;
+    stats.acceptedConnections = m_counters->accepted;
+    stats.acceptErrors = m_counters->acceptErrors;
+    stats.slowConsumers = m_counters->slowConsumers;
+    stats.requests = m_counters->requests;
+    stats.bytesSent = m_counters->bytesSent;
+    return stats;
+}
+
+void AsyncServer::doAccept()
+{
+    // Each connection gets its own strand, so its handlers are serialised without a lock
+    m_acceptor.async_accept(net::make_strand(m_ioc),
+                            [this](const boost::system::error_code &ec, tcp::socket socket)
+                            {
+                                if (ec == net::error::operation_aborted || !m_acceptor.is_open())
+                                {
+                                    return;
+                                }
+                                if (ec)
+                                {
+                                    ++m_counters->acceptErrors;
+                                    Logger::getInstance().log("Accept failed: " + ec.message(), Logger::LogLevel::WARNING);
+                                    m_acceptRetry.expires_after(ACCEPT_RETRY_DELAY);
+                                    m_acceptRetry.async_wait([this](const boost::system::error_code &waitError)
+                                                             {
+                                                                 if (!waitError && m_acceptor.is_open())
+                                                                 {
+                                                                     doAccept();
+                                                                 }
+                                                             });
+                                    return;
+                                }
+
+                                ++m_counters->accepted;
+                                boost::system::error_code ignored;
+                                socket.set_option(tcp::no_delay(true), ignored);
+                                std::make_shared<Session>(std::move(socket), m_handler, m_counters, m_sessions)->start();
+                                doAccept();
+                            });
+}
@@ -0,0 +1,216 @@
+#include "CSVScanner.hpp"
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSVSCAN_X86 1
+#endif
+
+namespace CSVScan
+{
+    namespace
+    {
+        size_t scanScalar(const char *data, size_t size, size_t base, size_t *out)
+        {
+            size_t count = 0;
+            for (size_t i = 0; i < size; ++i)
+            {
+                // Branch free append, the slot is simply overwritten when the byte is not structural
+                out[count] = base + i;
+                count += (data[i] == ',') | (data[i] == '\n');
+            }
+            return count;
+        }
+
+        // Expand a 64 bit match mask into offsets, one iteration per set bit
+        inline size_t flattenMask(uint64_t mask, size_t offset, size_t *out)
+        {
+            size_t count = 0;
+            while (mask != 0)
+            {
+                out[count++] = offset + static_cast<size_t>(__builtin_ctzll(mask));
+                mask &= mask - 1;
+            }
+            return count;
+        }
+
+#ifdef CSVSCAN_X86
+        __attribute__((target("sse2"))) size_t scanSSE2(const char *data, size_t size, size_t base, size_t *out)
+        {
+            const __m128i comma = _mm_set1_epi8(',');
+            const __m128i newline = _mm_set1_epi8('\n');
+            size_t count = 0;
+            size_t i = 0;
+
+            // 64 bytes per step, four 16 byte lanes folded into one mask
+            for (; i + 64 <= size; i += 64)
+            {
+                uint64_t mask = 0;
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + lane * 16));
+                    __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, newline));
+                    mask |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(hits))) << (lane * 16);
+                }
+                count += flattenMask(mask, base + i, out + count);
+            }
+
+            return count + scanScalar(data + i, size - i, base + i, out + count);
+        }
+
+        __attribute__((target("avx2"))) size_t scanAVX2(const char *data, size_t size, size_t base, size_t *out)
+        {
+            const __m256i comma = _mm256_set1_epi8(',');
+            const __m256i newline = _mm256_set1_epi8('\n');
+            size_t count = 0;
+            size_t i = 0;
+
+            // 64 bytes per step, two 32 byte lanes folded into one mask
+            for (; i + 64 <= size; i += 64)
+            {
+                __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + 32));
+                __m256i hitsLo = _mm256_or_si256(_mm256_cmpeq_epi8(lo, comma), _mm256_cmpeq_epi8(lo, newline));
+                __m256i hitsHi = _mm256_or_si256(_mm256_cmpeq_epi8(hi, comma), _mm256_cmpeq_epi8(hi, newline));
+                uint64_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hitsLo)) |
+                                (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hitsHi))) << 32);
+                count += flattenMask(mask, base + i, out + count);
+            }
+
+            return count + scanScalar(data + i, size - i, base + i, out + count);
+        }
+#endif
+    }
+
+    SimdLevel detectSimdLevel()
+    {
+#ifdef CSVSCAN_X86
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return SimdLevel::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return SimdLevel::SSE2;
+        }
+#endif
+        return SimdLevel::Scalar;
+    }
+
+    const char *simdLevelName(SimdLevel level)
+    {
+        switch (level)
+        {
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::SSE2:
+            return "SSE2";
+        case SimdLevel::Scalar:
+            break;
+        }
+        return "Scalar";
+    }
+
+    size_t findStructurals(const char *data, size_t size, size_t base, size_t *out, SimdLevel level)
+    {
+#ifdef CSVSCAN_X86
+        switch (level)
+        {
+        case SimdLevel::AVX2:
+            return scanAVX2(data, size, base, out);
+        case SimdLevel::SSE2:
+            return scanSSE2(data, size, base, out);
+        case SimdLevel::Scalar:
+            break;
+        }
+#else
+        (void)level;
+#endif
+        return scanScalar(data, size, base, out);
+    }
+}
+
+CSVScanner::CSVScanner(std::string_view buffer, CSVScan::SimdLevel level)
+    : m_buffer(buffer), m_level(level), m_positions(std::min(WINDOW_BYTES, buffer.size() + 1))
+{
+}
+
+bool CSVScanner::refill()
+{
+    // A window may hold no structural character at all (very long field), keep going until one does
+    while (m_scanned < m_buffer.size())
+    {
+        size_t length = std::min(WINDOW_BYTES, m_buffer.size() - m_scanned);
+        m_count = CSVScan::findStructurals(m_buffer.data() + m_scanned, length, m_scanned, m_positions.data(), m_level);
+        m_next = 0;
+        m_scanned += length;
+        if (m_count > 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CSVScanner::nextRow(CSVRow &row)
+{
+    while (m_rowStart < m_buffer.size())
+    {
+        row.count = 0;
+        size_t fieldStart = m_rowStart;
+        size_t rowEnd = m_buffer.size();
+        bool lineDone = false;
+
+        while (!lineDone)
+        {
+            if (m_next == m_count && !refill())
+            {
+                // Last line without a trailing newline
+                break;
+            }
+
+            size_t pos = m_positions[m_next++];
+            if (m_buffer[pos] == ',')
+            {
+                if (row.count < CSVRow::MAX_FIELDS)
+                {
+                    row.fields[row.count] = m_buffer.substr(fieldStart, pos - fieldStart);
+                }
+                ++row.count;
+                fieldStart = pos + 1;
+            }
+            else
+            {
+                rowEnd = pos;
+                lineDone = true;
+            }
+        }
+
+        // Windows line endings leave a '\r' on the last field
+        size_t fieldEnd = rowEnd;
+        if (fieldEnd > fieldStart && m_buffer[fieldEnd - 1] == '\r')
+        {
+            --fieldEnd;
+        }
+
+        std::string_view line = m_buffer.substr(m_rowStart, fieldEnd - m_rowStart);
+        m_rowStart = lineDone ? rowEnd + 1 : m_buffer.size();
+
+        // Skip blank lines
+        if (line.empty())
+        {
+            continue;
+        }
+
+        if (row.count < CSVRow::MAX_FIELDS)
+        {
+            row.fields[row.count] = m_buffer.substr(fieldStart, fieldEnd - fieldStart);
+        }
+        ++row.count;
+        row.line = line;
+        return true;
+    }
+
+    return false;
+}
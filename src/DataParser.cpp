@@ -1,33 +1,519 @@
 #include "DataParser.hpp"
 #include "Logger.hpp"
 #include "BenchMark.hpp"
+#include "MappedFile.hpp"
+#include "CSVScanner.hpp"
+#include "Timestamp.hpp"
 #include <algorithm> // for std::min
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <thread>
+#include <string_view>
 #include <nlohmann/json.hpp>
 
 // Used for Json parsing
 using json = nlohmann::json;
 constexpr const int NUMELEMENTS = 10000;
+// Typical OHLCV line length, only used to size the output up front
+constexpr const size_t AVG_CSV_LINE_BYTES = 48;
+// Below this many bytes per thread a parallel parse costs more than it saves
+constexpr const size_t MIN_PARALLEL_CHUNK_BYTES = 1 << 20;
+
+// Field of each column (timestamp, open, high, low, close, volume) on a line
+struct CSVLayout
+{
+    static constexpr size_t NO_FIELD = SIZE_MAX;
+
+    std::array<size_t, 6> fields = {0, 1, 2, 3, 4, 5};
+    size_t required = 6; // Fields a line needs
+};
+
+namespace
+{
+    // Strip blanks around a field, iostream extraction used to skip them for us
+    std::string_view trimField(std::string_view field)
+    {
+        while (!field.empty() && (field.front() == ' ' || field.front() == '\t')) {
+            field.remove_prefix(1);
+        }
+        while (!field.empty() && (field.back() == ' ' || field.back() == '\t')) {
+            field.remove_suffix(1);
+        }
+        return field;
+    }
+
+    // Parse a whole field as a double, without allocating or touching the locale
+    bool parseNumber(std::string_view field, double& value)
+    {
+        field = trimField(field);
+        const char* last = field.data() + field.size();
+        auto result = std::from_chars(field.data(), last, value);
+        return result.ec == std::errc() && result.ptr == last;
+    }
+
+    // Split one line on its commas, a trailing '\r' is dropped
+    void splitLine(std::string_view line, CSVRow& row)
+    {
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        row.line = line;
+        row.count = 0;
+        for (size_t start = 0;;) {
+            size_t comma = line.find(',', start);
+            size_t end = comma == std::string_view::npos ? line.size() : comma;
+            if (row.count < CSVRow::MAX_FIELDS) {
+                row.fields[row.count] = line.substr(start, end - start);
+            }
+            ++row.count;
+            if (comma == std::string_view::npos) {
+                break;
+            }
+            start = comma + 1;
+        }
+    }
+
+    // Columns as named by the header line, e.g. "timestamp,close" from a projected server response.
+    // A header that does not name the timestamp column is taken for the usual six columns
+    CSVLayout layoutFromHeader(const CSVRow& header)
+    {
+        static constexpr const char* NAMES[6] = {"timestamp", "open", "high", "low", "close", "volume"};
+        CSVLayout layout;
+        layout.fields.fill(CSVLayout::NO_FIELD);
+        layout.required = 0;
+        for (size_t f = 0; f < std::min(header.count, CSVRow::MAX_FIELDS); ++f) {
+            std::string_view name = trimField(header.fields[f]);
+            for (size_t c = 0; c < 6; ++c) {
+                if (name == NAMES[c] && layout.fields[c] == CSVLayout::NO_FIELD) {
+                    layout.fields[c] = f;
+                    layout.required = std::max(layout.required, f + 1);
+                }
+            }
+        }
+        return layout.fields[0] == CSVLayout::NO_FIELD ? CSVLayout() : layout;
+    }
+
+    // Decode one row, trailing extra columns are ignored. Columns the layout lacks are NaN
+    bool parseCSVRow(const CSVRow& row, const CSVLayout& layout, MarketDataSeries& out)
+    {
+        if (row.count < layout.required) {
+            return false;
+        }
+
+        const auto& fields = row.fields;
+        int64_t timestamp;
+        double values[5];
+        if (!Timestamp::parse(trimField(fields[layout.fields[0]]), timestamp)) {
+            return false;
+        }
+        for (size_t c = 0; c < 5; ++c) {
+            size_t field = layout.fields[c + 1];
+            if (field == CSVLayout::NO_FIELD) {
+                values[c] = std::numeric_limits<double>::quiet_NaN();
+            }
+            else if (!parseNumber(fields[field], values[c])) {
+                return false;
+            }
+        }
+
+        out.push_back(timestamp, values[0], values[1], values[2], values[3], values[4]);
+        return true;
+    }
+
+    // Accumulates parsed rows and hands them to the consumer every batchSize rows
+    class BatchSink
+    {
+    public:
+        BatchSink(size_t batchSize, const IDataParser::BatchCallback& onBatch)
+            : m_batchSize(std::max<size_t>(1, batchSize)), m_onBatch(onBatch)
+        {
+            m_batch.reserve(std::min<size_t>(m_batchSize, NUMELEMENTS));
+        }
+
+        // Add a row, returns false once the consumer asked to stop
+        bool push_back(int64_t timestamp, double open, double high, double low, double close, double volume)
+        {
+            m_batch.push_back(timestamp, open, high, low, close, volume);
+            return !batchFull() || flush();
+        }
+
+        // Add already decoded rows column by column, split across batches as needed
+        bool append(const MarketDataView& rows)
+        {
+            for (size_t offset = 0; offset < rows.size();) {
+                size_t take = std::min(rows.size() - offset, m_batchSize - m_batch.size());
+                m_batch.append(rows.slice(offset, take));
+                offset += take;
+                if (batchFull() && !flush()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Hand over the pending rows, returns false once the consumer asked to stop
+        bool flush()
+        {
+            if (!m_batch.empty() && !m_stopped) {
+                m_rows += m_batch.size();
+                m_stopped = !m_onBatch(m_batch);
+            }
+            m_batch.clear();
+            return !m_stopped;
+        }
+
+        // Direct access for decoders that append to the batch themselves
+        MarketDataSeries& batch() { return m_batch; }
+        bool batchFull() const { return m_batch.size() >= m_batchSize; }
+
+        // Rows handed to the consumer so far
+        size_t rows() const { return m_rows; }
+
+    private:
+        size_t m_batchSize;
+        const IDataParser::BatchCallback& m_onBatch;
+        MarketDataSeries m_batch;
+        size_t m_rows = 0;
+        bool m_stopped = false;
+    };
+
+    // Parse every row of a block of whole lines, bad lines are logged and skipped
+    void parseCSVChunk(std::string_view chunk, const CSVLayout& layout, MarketDataSeries& out)
+    {
+        // Structural characters are indexed with SIMD, rows are decoded from that index
+        CSVScanner scanner(chunk);
+        CSVRow row;
+
+        while (scanner.nextRow(row)) {
+            if (!parseCSVRow(row, layout, out)) {
+                Logger::getInstance().log("Bad Line: " + std::string(row.line), Logger::LogLevel::WARNING);
+            }
+        }
+    }
+
+    /// @brief SAX handler for the Alpha Vantage "Time Series (...)" responses and plain arrays of
+    /// OHLCV objects. Bars are decoded as the tokens go by and pushed to the sink, no DOM is built.
+    /// What is skipped and what fails the response is as with the DOM parser it replaced: a bar under a
+    /// timestamp key that does not parse is skipped, a missing or malformed price fails the response.
+    /// An array entry without one of the six keys or with a timestamp that does not parse is skipped,
+    /// a value of the wrong type fails the response
+    class MarketDataSaxHandler : public nlohmann::json_sax<json>
+    {
+    public:
+        explicit MarketDataSaxHandler(BatchSink& sink) : m_sink(sink) {}
+
+        bool null() override { return otherValue(); }
+        bool boolean(bool val) override { return numberValue(val ? 1.0 : 0.0); }
+        bool number_integer(number_integer_t val) override { return numberValue(static_cast<double>(val)); }
+        bool number_unsigned(number_unsigned_t val) override { return numberValue(static_cast<double>(val)); }
+        bool number_float(number_float_t val, const string_t&) override { return numberValue(val); }
+        bool binary(binary_t&) override { return otherValue(); }
+
+        bool string(string_t& val) override
+        {
+            if (m_depth == 1 && m_section == Section::Message) {
+                m_apiMessage = val;
+                return true;
+            }
+            if (!inBar()) {
+                return notABar();
+            }
+            if (m_field == TIMESTAMP_FIELD) {
+                m_timestampParsed = Timestamp::parse(val, m_timestamp);
+            }
+            else if (m_field >= 0 && (m_topIsArray || !parseNumber(val, m_values[m_field]))) {
+                // Alpha Vantage quotes every number, the array form does not
+                m_bad |= 1u << m_field;
+            }
+            return true;
+        }
+
+        bool start_object(std::size_t) override
+        {
+            if (inBar() && m_field >= 0) {
+                m_bad |= 1u << m_field;
+            }
+            ++m_depth;
+            bool seriesBar = m_section == Section::Series && m_depth == 3;
+            bool arrayBar = m_topIsArray && m_depth == 2;
+            if (seriesBar || arrayBar) {
+                m_barDepth = m_depth;
+                m_seen = 0;
+                m_bad = 0;
+                m_timestampParsed = false;
+                m_field = -1;
+            }
+            return true;
+        }
+
+        bool key(string_t& val) override
+        {
+            if (m_depth == 1 && !m_topIsArray) {
+                m_section = sectionFor(val);
+                m_foundSeries |= m_section == Section::Series;
+                m_foundMessage |= m_section == Section::Message;
+            }
+            else if (m_section == Section::Series && m_depth == 2) {
+                // Bar objects are keyed by their timestamp
+                m_seriesKeyValid = Timestamp::parse(val, m_timestamp);
+                if (!m_seriesKeyValid) {
+                    Logger::getInstance().log("Bad timestamp: " + val, Logger::LogLevel::WARNING);
+                }
+            }
+            else if (inBar()) {
+                m_field = fieldFor(val, m_topIsArray);
+                if (m_field >= 0) {
+                    m_seen |= 1u << m_field;
+                }
+            }
+            return true;
+        }
+
+        bool end_object() override
+        {
+            if (inBar()) {
+                m_barDepth = 0;
+                Verdict verdict = m_topIsArray ? arrayVerdict() : seriesVerdict();
+                if (verdict == Verdict::Malformed) {
+                    --m_depth;
+                    return malformed();
+                }
+                if (verdict == Verdict::Push && !m_sink.push_back(m_timestamp, m_values[0], m_values[1],
+                                                                  m_values[2], m_values[3], m_values[4])) {
+                    // Consumer asked to stop, abort the parse
+                    m_stopped = true;
+                    --m_depth;
+                    return false;
+                }
+            }
+            if (m_depth == 2 && m_section == Section::Series) {
+                m_section = Section::None;
+            }
+            --m_depth;
+            return true;
+        }
+
+        bool start_array(std::size_t) override
+        {
+            if (inBar() && m_field >= 0) {
+                m_bad |= 1u << m_field;
+            }
+            else if (!notABar()) {
+                return false;
+            }
+            if (++m_depth == 1) {
+                m_topIsArray = true;
+            }
+            return true;
+        }
+
+        bool end_array() override
+        {
+            --m_depth;
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override
+        {
+            Logger::getInstance().log("JSON parsing error: " + std::string(ex.what()), Logger::LogLevel::ERROR);
+            m_failed = true;
+            return false;
+        }
+
+        bool stopped() const { return m_stopped; }
+        bool failed() const { return m_failed; }
+        bool topIsArray() const { return m_topIsArray; }
+        bool foundSeries() const { return m_foundSeries; }
+        bool foundMessage() const { return m_foundMessage; }
+        const std::string& apiMessage() const { return m_apiMessage; }
+
+    private:
+        enum class Section
+        {
+            None,
+            Series, // "Time Series (...)" object
+            Message // Rate limit or error text
+        };
+
+        enum class Verdict
+        {
+            Push,
+            Skip,
+            Malformed
+        };
+
+        // Bit positions in m_seen and m_bad, prices first so they index m_values directly
+        static constexpr int TIMESTAMP_FIELD = 5;
+        static constexpr unsigned PRICE_FIELDS = 0x1f;
+        static constexpr unsigned ALL_FIELDS = 0x3f;
+
+        static Section sectionFor(const std::string& key)
+        {
+            if (key.compare(0, 13, "Time Series (") == 0) {
+                return Section::Series;
+            }
+            if (key == "Information" || key == "Error" || key == "Note" || key == "Error Message") {
+                return Section::Message;
+            }
+            return Section::None;
+        }
+
+        static int fieldFor(const std::string& key, bool arrayForm)
+        {
+            if (arrayForm) {
+                if (key == "open") return 0;
+                if (key == "high") return 1;
+                if (key == "low") return 2;
+                if (key == "close") return 3;
+                if (key == "volume") return 4;
+                if (key == "timestamp") return TIMESTAMP_FIELD;
+                return -1;
+            }
+            if (key == "1. open") return 0;
+            if (key == "2. high") return 1;
+            if (key == "3. low") return 2;
+            if (key == "4. close") return 3;
+            if (key == "5. volume") return 4;
+            return -1;
+        }
+
+        bool inBar() const { return m_barDepth != 0 && m_depth == m_barDepth; }
+
+        // Bar of a time series: every price a quoted number, unless the key already had it skipped
+        Verdict seriesVerdict() const
+        {
+            if (!m_seriesKeyValid) {
+                return Verdict::Skip;
+            }
+            return (m_seen & PRICE_FIELDS) == PRICE_FIELDS && m_bad == 0 ? Verdict::Push : Verdict::Malformed;
+        }
+
+        // Entry of the array form: the six keys present, a string timestamp and numeric prices
+        Verdict arrayVerdict() const
+        {
+            if ((m_seen & ALL_FIELDS) != ALL_FIELDS) {
+                return Verdict::Skip;
+            }
+            if (m_bad & (1u << TIMESTAMP_FIELD)) {
+                return Verdict::Malformed;
+            }
+            if (!m_timestampParsed) {
+                return Verdict::Skip;
+            }
+            return m_bad == 0 ? Verdict::Push : Verdict::Malformed;
+        }
+
+        bool malformed()
+        {
+            Logger::getInstance().log("Malformed bar in JSON response", Logger::LogLevel::ERROR);
+            m_failed = true;
+            return false;
+        }
+
+        // A value of the time series that is no bar object fails the response, unless its key was skipped
+        bool notABar()
+        {
+            if (m_section == Section::Series && m_depth == 2 && m_seriesKeyValid) {
+                return malformed();
+            }
+            return true;
+        }
+
+        bool numberValue(double value)
+        {
+            if (!inBar()) {
+                return notABar();
+            }
+            if (m_field >= 0 && m_field != TIMESTAMP_FIELD && m_topIsArray) {
+                m_values[m_field] = value;
+            }
+            else if (m_field >= 0) {
+                m_bad |= 1u << m_field;
+            }
+            return true;
+        }
+
+        bool otherValue()
+        {
+            if (!inBar()) {
+                return notABar();
+            }
+            if (m_field >= 0) {
+                m_bad |= 1u << m_field;
+            }
+            return true;
+        }
+
+        BatchSink& m_sink;
+        size_t m_depth = 0;
+        size_t m_barDepth = 0; // Depth of the bar object being decoded, 0 outside of one
+        Section m_section = Section::None;
+        bool m_topIsArray = false;
+        bool m_foundSeries = false;
+        bool m_foundMessage = false;
+        bool m_seriesKeyValid = false;
+        bool m_stopped = false;
+        bool m_failed = false;
+        std::string m_apiMessage;
+
+        // Bar under construction
+        int64_t m_timestamp = 0;
+        double m_values[5] = {};
+        int m_field = -1;
+        unsigned m_seen = 0;  // Fields whose key was present
+        unsigned m_bad = 0;   // Fields whose value has the wrong type or does not parse
+        bool m_timestampParsed = false;
+    };
+}
+
+//----------------------------------------------
+// IDataParser Implementation
+//----------------------------------------------
+
+bool IDataParser::collectAll(MarketDataSeries& out)
+{
+    out.clear();
+    return parseBatches(DEFAULT_BATCH_SIZE, [&out](MarketDataSeries& batch) {
+        out.append(batch.view());
+        return true;
+    });
+}
 
 //----------------------------------------------
 // DataParserCSV Implementation
 //----------------------------------------------
 
-DataParserCSV::DataParserCSV(const std::string& CSVPath)
-    : m_CSVPath(CSVPath)
+DataParserCSV::DataParserCSV(const std::string& CSVPath, CSVReadMode mode, size_t threads)
+    : m_CSVPath(CSVPath), m_mode(mode), m_threads(threads)
+{
+}
+
+DataParserCSV::DataParserCSV(const char* data, size_t size, size_t threads)
+    : m_mode(CSVReadMode::MemoryMapped), m_threads(threads), m_inMemory(true), m_content(data, size)
 {
 }
 
 bool DataParserCSV::parseData()
+{
+    return collectAll(m_data);
+}
+
+bool DataParserCSV::parseBatches(size_t batchSize, const BatchCallback& onBatch)
+{
+    if (m_inMemory) {
+        return parseInMemory(batchSize, onBatch);
+    }
+    return m_mode == CSVReadMode::MemoryMapped ? parseMapped(batchSize, onBatch) : parseBuffered(batchSize, onBatch);
+}
+
+bool DataParserCSV::parseBuffered(size_t batchSize, const BatchCallback& onBatch)
 {
     Timer timer;
     timer.start();
     
-    // Clear any previously parsed data
-    m_data.clear();
-    
-    // Reserve space for efficiency (avoid multiple reallocations)
-    m_data.reserve(NUMELEMENTS); // Adjust based on expected data size
-    
     try {
         // Open the file
         std::ifstream file(m_CSVPath);
@@ -36,46 +522,41 @@ bool DataParserCSV::parseData()
             return false;
         }
         
-        // Read the entire file into memory for faster processing
-        std::vector<char> buffer(std::istreambuf_iterator<char>(file), {});
-        std::istringstream fileContent(std::string(buffer.data(), buffer.size()));
-        
+        BatchSink sink(batchSize, onBatch);
         std::string line;
+        CSVRow row;
+
+        // The header line names the columns, as in the other modes
+        std::getline(file, line);
+        splitLine(line, row);
+        const CSVLayout layout = layoutFromHeader(row);
+        Logger::getInstance().log("Header Line read successfully", Logger::LogLevel::INFO);
         
-        // Skip header line
-        std::getline(fileContent, line);
-        Logger::getInstance().log("Header Line skipped successfully", Logger::LogLevel::INFO);
-        
-        // Process each line
-        while (std::getline(fileContent, line)) {
-            std::stringstream ss(line);
-            std::string timestamp;
-            double open, high, low, close, volume;
-            
-            // Parse the CSV line - expecting format: timestamp,open,high,low,close,volume
-            if (std::getline(ss, timestamp, ',') && 
-                ss >> open && ss.ignore(1) &&
-                ss >> high && ss.ignore(1) &&
-                ss >> low && ss.ignore(1) &&
-                ss >> close && ss.ignore(1) &&
-                ss >> volume) {
-                
-                m_data.emplace_back(timestamp, open, high, low, close, volume);
-            }
-            else {
+        // Process each line, only one line and one batch are held in memory
+        while (std::getline(file, line)) {
+            splitLine(line, row);
+            if (row.line.empty()) {
+                continue;
+            }
+            if (!parseCSVRow(row, layout, sink.batch())) {
                 Logger::getInstance().log("Bad Line: " + line, Logger::LogLevel::WARNING);
+                continue;
+            }
+            if (sink.batchFull() && !sink.flush()) {
+                break;
             }
         }
+        sink.flush();
         
         timer.end();
         timer.printTime();
         
         // Log successful parsing
         std::ostringstream logStream;
-        logStream << "Successfully parsed " << m_data.size() << " rows from CSV.";
+        logStream << "Successfully parsed " << sink.rows() << " rows from CSV.";
         Logger::getInstance().log(logStream.str(), Logger::LogLevel::INFO);
         
-        return !m_data.empty();
+        return sink.rows() > 0;
         
     } catch (const std::exception& e) {
         Logger::getInstance().log("Error parsing CSV: " + std::string(e.what()), Logger::LogLevel::ERROR);
@@ -84,7 +565,162 @@ bool DataParserCSV::parseData()
     }
 }
 
-const std::vector<MarketDataEntry>& DataParserCSV::getData() const
+bool DataParserCSV::parseMapped(size_t batchSize, const BatchCallback& onBatch)
+{
+    Timer timer;
+    timer.start();
+
+    try {
+        MappedFile file(m_CSVPath);
+        if (!file.isOpen()) {
+            Logger::getInstance().log("File not Open: " + m_CSVPath, Logger::LogLevel::ERROR);
+            return false;
+        }
+
+        size_t rows = parseContent(file.view(), &file, batchSize, onBatch);
+
+        timer.end();
+        timer.printTime();
+
+        // Log successful parsing
+        std::ostringstream logStream;
+        logStream << "Successfully parsed " << rows << " rows from mapped CSV.";
+        Logger::getInstance().log(logStream.str(), Logger::LogLevel::INFO);
+
+        return rows > 0;
+
+    } catch (const std::exception& e) {
+        Logger::getInstance().log("Error parsing CSV: " + std::string(e.what()), Logger::LogLevel::ERROR);
+        timer.end();
+        return false;
+    }
+}
+
+bool DataParserCSV::parseInMemory(size_t batchSize, const BatchCallback& onBatch)
+{
+    Timer timer;
+    timer.start();
+
+    try {
+        size_t rows = parseContent(m_content, nullptr, batchSize, onBatch);
+
+        timer.end();
+        timer.printTime();
+
+        // Log successful parsing
+        std::ostringstream logStream;
+        logStream << "Successfully parsed " << rows << " rows from " << m_content.size() << " bytes of CSV in memory.";
+        Logger::getInstance().log(logStream.str(), Logger::LogLevel::INFO);
+
+        return rows > 0;
+
+    } catch (const std::exception& e) {
+        Logger::getInstance().log("Error parsing CSV: " + std::string(e.what()), Logger::LogLevel::ERROR);
+        timer.end();
+        return false;
+    }
+}
+
+size_t DataParserCSV::parseContent(std::string_view content, MappedFile* file, size_t batchSize, const BatchCallback& onBatch)
+{
+    // The header line names the columns, it is split on its own rather than indexed
+    const void* newline = std::memchr(content.data(), '\n', content.size());
+    size_t headerEnd = newline ? static_cast<size_t>(static_cast<const char*>(newline) - content.data()) : content.size();
+    CSVRow header;
+    splitLine(content.substr(0, headerEnd), header);
+    CSVLayout layout = layoutFromHeader(header);
+    size_t bodyStart = std::min(headerEnd + 1, content.size());
+    Logger::getInstance().log("Header Line read successfully", Logger::LogLevel::INFO);
+
+    std::string_view body = content.substr(bodyStart);
+    size_t threads = m_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : m_threads;
+
+    // Small inputs are not worth the thread start up
+    threads = std::min(threads, std::max<size_t>(1, body.size() / MIN_PARALLEL_CHUNK_BYTES));
+    if (threads > 1) {
+        return parseParallel(body, layout, threads, batchSize, onBatch);
+    }
+
+    BatchSink sink(batchSize, onBatch);
+
+    // Structural characters are indexed with SIMD, rows are decoded from that index
+    CSVScanner scanner(body);
+    CSVRow row;
+
+    while (scanner.nextRow(row)) {
+        if (!parseCSVRow(row, layout, sink.batch())) {
+            Logger::getInstance().log("Bad Line: " + std::string(row.line), Logger::LogLevel::WARNING);
+            continue;
+        }
+        if (sink.batchFull()) {
+            if (!sink.flush()) {
+                break;
+            }
+            // Rows before this one are consumed, let the kernel drop their pages
+            if (file != nullptr) {
+                file->release(static_cast<size_t>(row.line.data() - content.data()));
+            }
+        }
+    }
+    sink.flush();
+    return sink.rows();
+}
+
+size_t DataParserCSV::parseParallel(std::string_view body, const CSVLayout& layout, size_t threads, size_t batchSize,
+                                    const BatchCallback& onBatch)
+{
+    // Cut the body in roughly equal chunks, each boundary moved just past the next newline
+    std::vector<std::string_view> chunks;
+    size_t start = 0;
+    for (size_t i = 1; i <= threads && start < body.size(); ++i) {
+        size_t end = body.size();
+        if (i < threads) {
+            size_t newline = body.find('\n', std::max(start, body.size() * i / threads));
+            end = (newline == std::string_view::npos) ? body.size() : newline + 1;
+        }
+        chunks.push_back(body.substr(start, end - start));
+        start = end;
+    }
+
+    // Each thread fills its own partition, nothing is shared while parsing
+    std::vector<MarketDataSeries> partitions(chunks.size());
+    std::vector<std::exception_ptr> errors(chunks.size());
+    std::vector<std::thread> workers;
+    workers.reserve(chunks.size());
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        workers.emplace_back([&, i]() {
+            try {
+                partitions[i].reserve(chunks[i].size() / AVG_CSV_LINE_BYTES);
+                parseCSVChunk(chunks[i], layout, partitions[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Hand the partitions to the consumer in file order, column slices are copied batch by batch
+    BatchSink sink(batchSize, onBatch);
+    for (auto& partition : partitions) {
+        if (!sink.append(partition.view())) {
+            return sink.rows();
+        }
+        // Release each partition as soon as it has been handed over
+        partition = MarketDataSeries();
+    }
+    sink.flush();
+    return sink.rows();
+}
+
+const MarketDataSeries& DataParserCSV::getData() const
 {
     return m_data;
 }
@@ -98,120 +734,57 @@ DataParserJson::DataParserJson(const std::string& jsonContent)
 {
 }
 
+DataParserJson::DataParserJson(std::istream& source)
+    : m_source(&source)
+{
+}
+
+DataParserJson::DataParserJson(const char* data, size_t size)
+    : m_content(data, size)
+{
+}
+
 bool DataParserJson::parseData()
+{
+    return collectAll(m_data);
+}
+
+bool DataParserJson::parseBatches(size_t batchSize, const BatchCallback& onBatch)
 {
     Timer timer;
     timer.start();
     
-    // Clear any previously parsed data
-    m_data.clear();
-    
     try {
-        // Parse the JSON content
-        json jsonData = json::parse(m_jsonContent);
+        BatchSink sink(batchSize, onBatch);
+        MarketDataSaxHandler handler(sink);
         
-        // First, check if this is a rate limit or error message
-        if (jsonData.contains("Information") || jsonData.contains("Error") || jsonData.contains("Note")) {
-            std::string message;
-            if (jsonData.contains("Information")) {
-                message = jsonData["Information"].get<std::string>();
-            } else if (jsonData.contains("Error")) {
-                message = jsonData["Error"].get<std::string>();
-            } else {
-                message = jsonData["Note"].get<std::string>();
-            }
-            
-            Logger::getInstance().log("API message: " + message, Logger::LogLevel::WARNING);
+        // Stream the tokens straight into bars, no DOM is built
+        if (m_source != nullptr) {
+            json::sax_parse(*m_source, &handler);
+        }
+        else {
+            std::string_view content = m_content.data() != nullptr ? m_content : std::string_view(m_jsonContent);
+            json::sax_parse(content.data(), content.data() + content.size(), &handler);
+        }
+        
+        if (handler.failed()) {
             timer.end();
             return false;
         }
         
-        // Reserve space for better performance
-        m_data.reserve(NUMELEMENTS); // Adjust based on expected data size
-        
-        // Handle different JSON formats
-        
-        // Alpha Vantage Time Series Daily format
-        if (jsonData.contains("Time Series (Daily)")) {
-            auto& timeSeries = jsonData["Time Series (Daily)"];
-            
-            for (auto it = timeSeries.begin(); it != timeSeries.end(); ++it) {
-                const std::string& timestamp = it.key();
-                auto& dataPoint = it.value();
-                
-                // Extract OHLCV data
-                double open = std::stod(dataPoint["1. open"].get<std::string>());
-                double high = std::stod(dataPoint["2. high"].get<std::string>());
-                double low = std::stod(dataPoint["3. low"].get<std::string>());
-                double close = std::stod(dataPoint["4. close"].get<std::string>());
-                double volume = std::stod(dataPoint["5. volume"].get<std::string>());
-                
-                // Add to our market data vector
-                m_data.emplace_back(timestamp, open, high, low, close, volume);
-            }
-        }
-        // Alpha Vantage Intraday format
-        else if (jsonData.contains("Time Series (1min)") || 
-                 jsonData.contains("Time Series (5min)") ||
-                 jsonData.contains("Time Series (15min)") ||
-                 jsonData.contains("Time Series (30min)") ||
-                 jsonData.contains("Time Series (60min)")) {
-            
-            // Find which time series we're working with
-            std::string timeSeriesKey;
-            for (const auto& key : {"Time Series (1min)", "Time Series (5min)", 
-                                   "Time Series (15min)", "Time Series (30min)", 
-                                   "Time Series (60min)"}) {
-                if (jsonData.contains(key)) {
-                    timeSeriesKey = key;
-                    break;
-                }
-            }
-            
-            auto& timeSeries = jsonData[timeSeriesKey];
-            
-            for (auto it = timeSeries.begin(); it != timeSeries.end(); ++it) {
-                const std::string& timestamp = it.key();
-                auto& dataPoint = it.value();
-                
-                // Extract OHLCV data
-                double open = std::stod(dataPoint["1. open"].get<std::string>());
-                double high = std::stod(dataPoint["2. high"].get<std::string>());
-                double low = std::stod(dataPoint["3. low"].get<std::string>());
-                double close = std::stod(dataPoint["4. close"].get<std::string>());
-                double volume = std::stod(dataPoint["5. volume"].get<std::string>());
-                
-                // Add to our market data vector
-                m_data.emplace_back(timestamp, open, high, low, close, volume);
-            }
+        // A rate limit or error message fails the response, bars or not
+        if (handler.foundMessage()) {
+            Logger::getInstance().log("API message: " + handler.apiMessage(), Logger::LogLevel::WARNING);
+            timer.end();
+            return false;
         }
+        
         // Custom or unknown format
-        else {
+        if (!handler.foundSeries()) {
             Logger::getInstance().log("JSON format not recognized as Alpha Vantage API response", 
                                     Logger::LogLevel::WARNING);
             
-            // Try to parse as a simple array of OHLCV data
-            if (jsonData.is_array()) {
-                for (const auto& entry : jsonData) {
-                    if (entry.contains("timestamp") && 
-                        entry.contains("open") && 
-                        entry.contains("high") && 
-                        entry.contains("low") && 
-                        entry.contains("close") && 
-                        entry.contains("volume")) {
-                        
-                        m_data.emplace_back(
-                            entry["timestamp"].get<std::string>(),
-                            entry["open"].get<double>(),
-                            entry["high"].get<double>(),
-                            entry["low"].get<double>(),
-                            entry["close"].get<double>(),
-                            entry["volume"].get<double>()
-                        );
-                    }
-                }
-            }
-            else {
+            if (!handler.topIsArray()) {
                 Logger::getInstance().log("Unable to parse JSON data in unknown format", 
                                         Logger::LogLevel::ERROR);
                 timer.end();
@@ -219,21 +792,20 @@ bool DataParserJson::parseData()
             }
         }
         
+        if (!handler.stopped()) {
+            sink.flush();
+        }
+        
         timer.end();
         timer.printTime();
         
         // Log successful parsing
         std::ostringstream logStream;
-        logStream << "Successfully parsed " << m_data.size() << " entries from JSON.";
+        logStream << "Successfully parsed " << sink.rows() << " entries from JSON.";
         Logger::getInstance().log(logStream.str(), Logger::LogLevel::INFO);
         
-        return !m_data.empty();
+        return sink.rows() > 0;
         
-    } catch (const json::parse_error& e) {
-        Logger::getInstance().log("JSON parsing error: " + std::string(e.what()), 
-                                Logger::LogLevel::ERROR);
-        timer.end();
-        return false;
     } catch (const std::exception& e) {
         Logger::getInstance().log("Error during JSON parsing: " + std::string(e.what()), 
                                 Logger::LogLevel::ERROR);
@@ -242,7 +814,7 @@ bool DataParserJson::parseData()
     }
 }
 
-const std::vector<MarketDataEntry>& DataParserJson::getData() const
+const MarketDataSeries& DataParserJson::getData() const
 {
     return m_data;
 }
@@ -273,9 +845,9 @@ std::unique_ptr<IDataParser> ParserFactory::createParser(const std::string& sour
     }
 }
 
-std::unique_ptr<IDataParser> ParserFactory::createCSVParser(const std::string& filePath)
+std::unique_ptr<IDataParser> ParserFactory::createCSVParser(const std::string& filePath, CSVReadMode mode, size_t threads)
 {
-    return std::make_unique<DataParserCSV>(filePath);
+    return std::make_unique<DataParserCSV>(filePath, mode, threads);
 }
 
 std::unique_ptr<IDataParser> ParserFactory::createJSONParser(const std::string& jsonContent)
@@ -283,6 +855,20 @@ std::unique_ptr<IDataParser> ParserFactory::createJSONParser(const std::string&
     return std::make_unique<DataParserJson>(jsonContent);
 }
 
+std::unique_ptr<IDataParser> ParserFactory::createBufferParser(std::string_view content)
+{
+    size_t first = content.find_first_not_of(" \t\r\n");
+    if (first != std::string_view::npos && (content[first] == '{' || content[first] == '[')) {
+        return std::make_unique<DataParserJson>(content.data(), content.size());
+    }
+    return createCSVBufferParser(content);
+}
+
+std::unique_ptr<IDataParser> ParserFactory::createCSVBufferParser(std::string_view content, size_t threads)
+{
+    return std::make_unique<DataParserCSV>(content.data(), content.size(), threads);
+}
+
 
 
 //----------------------------------------------
@@ -290,7 +876,7 @@ std::unique_ptr<IDataParser> ParserFactory::createJSONParser(const std::string&
 //----------------------------------------------
 
 namespace ParsingFunctions {
-    std::vector<MarketDataEntry> readCSV(const char* pathFileCSV)
+    MarketDataSeries readCSV(const char* pathFileCSV)
     {
         auto parser = ParserFactory::createCSVParser(pathFileCSV);
         if (parser->parseData()) {
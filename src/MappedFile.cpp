@@ -0,0 +1,71 @@
+#include "MappedFile.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        Logger::getInstance().log("Cannot open " + path + ": " + std::strerror(errno), Logger::LogLevel::ERROR);
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        Logger::getInstance().log("Cannot stat " + path + ": " + std::strerror(errno), Logger::LogLevel::ERROR);
+        ::close(fd);
+        return;
+    }
+
+    m_size = static_cast<size_t>(st.st_size);
+
+    // mmap refuses zero length mappings, an empty file is simply an empty view
+    if (m_size > 0)
+    {
+        void *addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            Logger::getInstance().log("Cannot mmap " + path + ": " + std::strerror(errno), Logger::LogLevel::ERROR);
+            ::close(fd);
+            m_size = 0;
+            return;
+        }
+
+        // We walk the file front to back once, let the kernel read ahead aggressively
+        ::madvise(addr, m_size, MADV_SEQUENTIAL);
+        m_data = static_cast<const char *>(addr);
+    }
+
+    // The mapping keeps the file alive, the descriptor is no longer needed
+    ::close(fd);
+    m_open = true;
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data != nullptr)
+    {
+        ::munmap(const_cast<char *>(m_data), m_size);
+    }
+}
+
+void MappedFile::release(size_t length)
+{
+    // madvise works on whole pages, keep the partially consumed one resident
+    static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    length = std::min(length, m_size) / pageSize * pageSize;
+
+    if (m_data != nullptr && length > m_released)
+    {
+        ::madvise(const_cast<char *>(m_data) + m_released, length - m_released, MADV_DONTNEED);
+        m_released = length;
+    }
+}
@@ -1,38 +1,51 @@
 #include "MarketDataClient.hpp"
+#include "WireDecoder.hpp"
+#include "Analytics.hpp"
+#include "Timestamp.hpp"
+#include "Protocol.hpp"
+#include "SharedMemoryRing.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <sstream>
 #include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <thread>
 #include <boost/asio.hpp>
 
 namespace MarketDataClient
 {
 
-    void connectToServer(const std::string &serverAddress, int port)
+    void connectToServer(const std::string &serverAddress, int port, WireFormat format)
     {
+        // The client runs on its own io thread, the console only waits for the answers
+        boost::asio::io_context io_context;
+        auto work = boost::asio::make_work_guard(io_context);
+        std::thread ioThread([&io_context]
+                             { io_context.run(); });
+        auto client = AsyncClient::create(io_context);
         try
         {
-            boost::asio::io_context io_context;
-            auto socket = std::make_shared<tcp::socket>(io_context);
-
-            // Resolve the server address
-            tcp::resolver resolver(io_context);
-            auto endpoints = resolver.resolve(serverAddress, std::to_string(port));
-
-            // Connect to the server
-            boost::asio::connect(*socket, endpoints);
-
+            client->connect(serverAddress, static_cast<unsigned short>(port)).get();
             std::cout << "Connected to market data server at " << serverAddress << ":" << port << std::endl;
 
-            runClientInteractionLoop(socket);
+            runClientInteractionLoop(client, format);
         }
         catch (const std::exception &e)
         {
             Logger::getInstance().log("Client error: " + std::string(e.what()),
                                       Logger::LogLevel::ERROR);
         }
+        client->close();
+        work.reset();
+        ioThread.join();
     }
 
-    void runClientInteractionLoop(std::shared_ptr<tcp::socket> socket)
+    void runClientInteractionLoop(const std::shared_ptr<AsyncClient> &client, WireFormat format)
     {
         while (true)
         {
@@ -48,12 +61,47 @@ namespace MarketDataClient
                     break;
                 }
 
-                // Send request for the selected symbol
-                std::string request = "GET " + symbol + "\n";
-                boost::asio::write(*socket, boost::asio::buffer(request));
+                // A conditional GET per symbol, pipelined on the one connection. Symbols fetched before
+                // come back from the local cache, with only what changed since transferred
+                std::vector<std::string> symbols;
+                std::istringstream tokens(symbol);
+                for (std::string token; tokens >> token;)
+                {
+                    symbols.push_back(token);
+                }
+                if (symbols.empty())
+                {
+                    continue;
+                }
+                // Last N and price filters are evaluated by the server, only the bars shown are sent
+                FilterChoice filter = promptForFilter();
+                Logger::getInstance().log("Waiting for data from server...", Logger::LogLevel::INFO);
+                std::vector<std::future<ClientResult>> answers;
+                for (const auto &requested : symbols)
+                {
+                    answers.push_back(filter.query.empty() ? client->fetch(requested, format)
+                                                           : client->query(requested, filter.query, format));
+                }
+                ClientResult result;
+                result.ok = true;
+                for (size_t i = 0; i < answers.size(); ++i)
+                {
+                    ClientResult answer = answers[i].get();
+                    if (!answer.ok)
+                    {
+                        Logger::getInstance().log(answer.error, Logger::LogLevel::ERROR);
+                        result.series.emplace_back();
+                        continue;
+                    }
+                    if (filter.query.empty() && !answer.modified)
+                    {
+                        std::cout << symbols[i] << " unchanged since version " << answer.version << std::endl;
+                    }
+                    result.series.push_back(std::move(answer.series.front()));
+                }
 
                 // Receive and process data
-                handleMarketData(socket);
+                handleMarketData(result, symbols, filter);
 
                 // Ask if user wants to continue
                 std::cout << "\nDo you want to fetch more data? (yes/no): ";
@@ -99,7 +147,7 @@ namespace MarketDataClient
     {
         std::cout << "\n=== Market Data Client ===\n";
         std::cout << "Available symbols: AAPL, MSFT, GOOGL\n";
-        std::cout << "Enter symbol: ";
+        std::cout << "Enter symbol(s), separated by spaces: ";
 
         std::string symbol;
         std::getline(std::cin, symbol);
@@ -114,95 +162,312 @@ namespace MarketDataClient
         return symbol;
     }
 
-    void handleMarketData(std::shared_ptr<tcp::socket> socket)
+    namespace
     {
-        try
+        // Next line from the connection, newline included. Bytes read past it stay in buffer
+        std::string readLine(tcp::socket &socket, boost::asio::streambuf &buffer)
         {
-            Logger::getInstance().log("Waiting for data from server...", Logger::LogLevel::INFO);
+            size_t length = boost::asio::read_until(socket, buffer, "\n");
+            std::string line(boost::asio::buffers_begin(buffer.data()), boost::asio::buffers_begin(buffer.data()) + length);
+            buffer.consume(length);
+            return line;
+        }
+
+        // Read a size byte body into body. Earlier reads may already have pulled some of it into buffer
+        bool readBody(tcp::socket &socket, boost::asio::streambuf &buffer, size_t size, std::string &body)
+        {
+            size_t buffered = 0;
+            if (!WireDecoder::startBody(buffer, size, Protocol::MAX_FRAME_BYTES, body, buffered))
+            {
+                Logger::getInstance().log("Body of " + std::to_string(size) + " bytes is over the frame limit",
+                                          Logger::LogLevel::ERROR);
+                return false;
+            }
 
-            // Read the header line with data size
-            boost::asio::streambuf header_buffer;
-            boost::asio::read_until(*socket, header_buffer, "\n");
+            boost::system::error_code error;
+            boost::asio::read(socket, boost::asio::buffer(body.data() + buffered, size - buffered), error);
+            if (error)
+            {
+                Logger::getInstance().log("Error reading data: " + error.message(),
+                                          Logger::LogLevel::ERROR);
+                throw boost::system::system_error(error);
+            }
+            return true;
+        }
+    }
 
-            std::string header_line(boost::asio::buffer_cast<const char *>(header_buffer.data()),
-                                    header_buffer.size());
+    void handleMarketData(const ClientResult &result, const std::vector<std::string> &symbols, const FilterChoice &filter)
+    {
+        if (!result.ok)
+        {
+            Logger::getInstance().log(result.error, Logger::LogLevel::ERROR);
+            return;
+        }
 
-            // Check if it's an error message
-            if (header_line.substr(0, 6) == "ERROR:")
+        for (size_t i = 0; i < result.series.size() && i < symbols.size(); ++i)
+        {
+            if (result.series[i].empty())
             {
-                Logger::getInstance().log(header_line, Logger::LogLevel::ERROR);
-                return;
+                Logger::getInstance().log("No market data received for " + symbols[i],
+                                          Logger::LogLevel::WARNING);
+                continue;
             }
 
-            // Parse the data size from header
-            size_t data_size = 0;
-            if (header_line.substr(0, 10) == "DATA_SIZE:")
+            // The server already filtered the bars
+            std::cout << "\n=== " << symbols[i] << " ===\n";
+            Logger::getInstance().log("Displaying filtered data...", Logger::LogLevel::INFO);
+            const MarketDataSeries &series = result.series[i];
+            if (filter.summary)
+            {
+                displaySummary(series.view());
+            }
+            else if (!filter.query.where.empty())
+            {
+                std::cout << "Found " << series.size() << " entries with price > " << std::defaultfloat
+                          << std::setprecision(6) << filter.query.where.front().value << std::endl;
+                displayMarketData(series.view());
+            }
+            else if (filter.query.limit != 0)
             {
-                data_size = std::stoull(header_line.substr(10));
-                Logger::getInstance().log("Expected data size: " + std::to_string(data_size) + " bytes",
-                                          Logger::LogLevel::INFO);
+                displayMarketData(series.view(), series.size());
             }
             else
             {
-                Logger::getInstance().log("Invalid header format: " + header_line, Logger::LogLevel::ERROR);
-                return;
+                displayMarketData(series.view());
             }
+        }
+    }
 
-            // Read the exact amount of data
-            boost::asio::streambuf data_buffer;
-            boost::system::error_code error;
-            size_t bytes_transferred = boost::asio::read(*socket, data_buffer,
-                                                         boost::asio::transfer_exactly(data_size),
-                                                         error);
+    bool receiveMarketData(std::shared_ptr<tcp::socket> socket, MarketDataSeries &out)
+    {
+        boost::asio::streambuf buffer;
+        return receiveMarketData(*socket, buffer, out);
+    }
 
-            if (error)
+    bool receiveBatch(tcp::socket &socket, boost::asio::streambuf &buffer, std::vector<MarketDataSeries> &out)
+    {
+        std::string header_line = readLine(socket, buffer);
+        if (header_line.substr(0, 6) == "ERROR:")
+        {
+            Logger::getInstance().log(header_line, Logger::LogLevel::ERROR);
+            return false;
+        }
+        if (header_line.substr(0, 6) != "BATCH:")
+        {
+            Logger::getInstance().log("Invalid batch header: " + header_line, Logger::LogLevel::ERROR);
+            return false;
+        }
+
+        // Each series is framed as a single response would be, a symbol without data is left empty
+        size_t count = 0;
+        auto parsed = std::from_chars(header_line.data() + 6, header_line.data() + header_line.size(), count);
+        if (parsed.ec != std::errc() || count > Protocol::MAX_BATCH_SYMBOLS)
+        {
+            Logger::getInstance().log("Invalid batch header: " + header_line, Logger::LogLevel::ERROR);
+            return false;
+        }
+        out.assign(count, MarketDataSeries());
+        for (auto &series : out)
+        {
+            receiveMarketData(socket, buffer, series);
+        }
+        return true;
+    }
+
+    bool receiveMarketData(tcp::socket &socket, boost::asio::streambuf &buffer, MarketDataSeries &out)
+    {
+        Logger::getInstance().log("Waiting for data from server...", Logger::LogLevel::INFO);
+
+        // Read the header line with data size
+        std::string header_line = readLine(socket, buffer);
+
+        // Check if it's an error message
+        if (header_line.substr(0, 6) == "ERROR:")
+        {
+            Logger::getInstance().log(header_line, Logger::LogLevel::ERROR);
+            return false;
+        }
+
+        WireFormat format;
+        size_t rows = 0;
+        size_t size = 0;
+        if (!WireDecoder::parseDataHeader(header_line, format, rows, size))
+        {
+            Logger::getInstance().log("Invalid header format: " + header_line, Logger::LogLevel::ERROR);
+            return false;
+        }
+
+        // Read the exact amount of data
+        std::string body;
+        if (!readBody(socket, buffer, size, body) || !WireDecoder::decodeBody(format, body.data(), size, rows, out))
+        {
+            return false;
+        }
+
+        Logger::getInstance().log("Received " + std::to_string(out.size()) + " bars as " +
+                                      WireEncoder::formatName(format) + " (" + std::to_string(size) + " bytes)",
+                                  Logger::LogLevel::INFO);
+        return true;
+    }
+
+    bool followSymbol(tcp::socket &socket, boost::asio::streambuf &buffer, const std::string &symbol,
+                      WireFormat format, const SubscriptionCallback &onUpdate)
+    {
+        Protocol::Request request;
+        request.command = Protocol::Command::Sub;
+        request.symbols.push_back(symbol);
+        request.format = format;
+        boost::asio::write(socket, boost::asio::buffer(Protocol::formatRequest(request)));
+
+        MarketDataSeries series;
+        bool subscribed = true;
+        while (true)
+        {
+            std::string line = readLine(socket, buffer);
+            if (line.substr(0, 6) == "ERROR:")
             {
-                Logger::getInstance().log("Error reading data: " + error.message(),
-                                          Logger::LogLevel::ERROR);
-                if (error != boost::asio::error::eof)
-                {
-                    throw boost::system::system_error(error);
-                }
+                Logger::getInstance().log(line, Logger::LogLevel::ERROR);
+                return false;
+            }
+            if (line.substr(0, 13) == "UNSUBSCRIBED:")
+            {
+                return true;
             }
 
-            // Convert to string
-            std::string data(boost::asio::buffer_cast<const char *>(data_buffer.data()),
-                             bytes_transferred);
-
-            Logger::getInstance().log("Received " + std::to_string(data.size()) + " bytes of data",
-                                      Logger::LogLevel::INFO);
+            std::string kind;
+            std::string streamSymbol;
+            uint64_t version = 0;
+            if (!WireDecoder::parseStreamHeader(line, kind, streamSymbol, version) || streamSymbol != symbol)
+            {
+                Logger::getInstance().log("Unexpected message on subscription: " + line, Logger::LogLevel::ERROR);
+                return false;
+            }
 
-            // Parse directly from memory instead of using a temporary file
-            auto parser = std::make_unique<DataParserCSV>(data);
-            if (!parser->parseData())
+            MarketDataSeries changed;
+            if (!receiveMarketData(socket, buffer, changed))
             {
-                Logger::getInstance().log("Failed to parse market data", Logger::LogLevel::ERROR);
-                return;
+                return false;
             }
 
-            // Get the parsed entries
-            const std::vector<MarketDataEntry> &entries = parser->getData();
-            Logger::getInstance().log("Parsed " + std::to_string(entries.size()) + " entries",
-                                      Logger::LogLevel::INFO);
+            // Updates still in flight after UNSUB are read and dropped
+            if (!subscribed)
+            {
+                continue;
+            }
+            if (kind == "UPDATE")
+            {
+                WireDecoder::applyChanges(series, changed.view());
+            }
+            else
+            {
+                series = changed;
+            }
 
-            if (entries.empty())
+            if (!onUpdate(series, changed, version))
             {
-                Logger::getInstance().log("No market data received", Logger::LogLevel::WARNING);
-                return;
+                subscribed = false;
+                request.command = Protocol::Command::Unsub;
+                boost::asio::write(socket, boost::asio::buffer(Protocol::formatRequest(request)));
             }
+        }
+    }
 
-            // Display filtered data
-            Logger::getInstance().log("Displaying filtered data...", Logger::LogLevel::INFO);
-            displayFilteredData(entries);
+    void subscribeToServer(const std::string &serverAddress, int port, const std::string &symbol, WireFormat format)
+    {
+        try
+        {
+            boost::asio::io_context io_context;
+            tcp::socket socket(io_context);
+            tcp::resolver resolver(io_context);
+            boost::asio::connect(socket, resolver.resolve(serverAddress, std::to_string(port)));
+            std::cout << "Subscribed to " << symbol << " at " << serverAddress << ":" << port
+                      << ", updates are printed as they arrive (Ctrl+C to stop)" << std::endl;
+
+            boost::asio::streambuf buffer;
+            followSymbol(socket, buffer, symbol, format,
+                         [&symbol](const MarketDataSeries &series, const MarketDataSeries &changed, uint64_t version)
+                         {
+                             std::cout << "\n" << symbol << " version " << version << ": " << changed.size()
+                                       << " bars changed, " << series.size() << " total" << std::endl;
+                             displayMarketData(changed.view(), std::min<size_t>(changed.size(), 10));
+                             return true;
+                         });
         }
-        catch (std::exception &e)
+        catch (const std::exception &e)
         {
-            Logger::getInstance().log("Error processing market data: " + std::string(e.what()),
-                                      Logger::LogLevel::ERROR);
+            Logger::getInstance().log("Subscription error: " + std::string(e.what()), Logger::LogLevel::ERROR);
+        }
+    }
+
+    void followMulticast(const MulticastConfig &config, const std::string &serverAddress, int port)
+    {
+        try
+        {
+            FeedReceiver receiver(config, serverAddress, static_cast<unsigned short>(port),
+                                  [](const FeedUpdate &update)
+                                  {
+                                      if (update.reset)
+                                      {
+                                          std::cout << "\n" << update.symbol << " reset at datagram " << update.sequence
+                                                    << ", GET it again for the full series" << std::endl;
+                                          return;
+                                      }
+                                      std::cout << "\n" << update.symbol << " version " << update.version << " datagram "
+                                                << update.sequence << (update.recovered ? " (retransmitted)" : "")
+                                                << ": " << update.bars.size() << " bars changed" << std::endl;
+                                      displayMarketData(update.bars.view(), std::min<size_t>(update.bars.size(), 10));
+                                  });
+            std::cout << "Receiving multicast feed " << config.group << ":" << config.port << " on "
+                      << config.interfaceAddress << ", updates are printed as they arrive (Ctrl+C to stop)" << std::endl;
+            receiver.run();
+        }
+        catch (const std::exception &e)
+        {
+            Logger::getInstance().log("Multicast receiver error: " + std::string(e.what()), Logger::LogLevel::ERROR);
+        }
+    }
+
+    void followSharedMemory(const std::string &name)
+    {
+        SharedMemoryReader reader(name);
+        if (!reader.isOpen())
+        {
+            std::cout << "Shared memory ring " << name << " is not available, is the server running with --shm?"
+                      << std::endl;
+            return;
+        }
+        std::cout << "Reading shared memory ring " << name << ", bars are printed as they are published (Ctrl+C to stop)"
+                  << std::endl;
+
+        SharedMemoryRing::Record record;
+        while (true)
+        {
+            switch (reader.next(record))
+            {
+            case SharedMemoryReader::ReadResult::Record:
+                if (record.flags & SharedMemoryRing::FLAG_RESET)
+                {
+                    std::cout << record.symbol << " version " << record.version << " replaced, GET it again" << std::endl;
+                }
+                else
+                {
+                    std::cout << record.symbol << " v" << record.version << " " << Timestamp::toString(record.bar.timestamp)
+                              << " O " << record.bar.open << " H " << record.bar.high << " L " << record.bar.low << " C "
+                              << record.bar.close << " V " << record.bar.volume << std::endl;
+                }
+                break;
+            case SharedMemoryReader::ReadResult::Overrun:
+                std::cout << "Fell behind the ring, " << reader.missed() << " records missed so far" << std::endl;
+                break;
+            case SharedMemoryReader::ReadResult::Empty:
+                // Only the console idles here, the reader itself never sleeps
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                break;
+            }
         }
     }
 
-    void displayFilteredData(const std::vector<MarketDataEntry> &entries)
+    FilterChoice promptForFilter()
     {
         // Show filtering options
         std::cout << "\n=== Filter Options ===\n";
@@ -210,17 +475,14 @@ namespace MarketDataClient
         std::cout << "1. Show all data\n";
         std::cout << "2. Show last N entries\n";
         std::cout << "3. Show entries with price > X\n";
+        std::cout << "4. Show summary statistics\n";
         std::cout << "Enter choice (default: 1): ";
 
         std::string choice;
         std::getline(std::cin, choice);
 
-        if (choice.empty() || choice == "1")
-        {
-            // Show all entries
-            displayMarketData(entries);
-        }
-        else if (choice == "2")
+        FilterChoice filter;
+        if (choice == "2")
         {
             // Show last N entries
             std::cout << "How many entries to show? ";
@@ -235,8 +497,7 @@ namespace MarketDataClient
             {
                 std::cout << "Invalid number, using default: 10" << std::endl;
             }
-
-            displayMarketData(entries, std::min(count, entries.size()));
+            filter.query.limit = count == 0 ? 10 : count;
         }
         else if (choice == "3")
         {
@@ -254,27 +515,24 @@ namespace MarketDataClient
                 std::cout << "Invalid price, using default: 0.0" << std::endl;
             }
 
-            std::vector<MarketDataEntry> filtered;
-            for (const auto &entry : entries)
-            {
-                if (entry.m_close > priceThreshold)
-                {
-                    filtered.push_back(entry);
-                }
-            }
-
-            std::cout << "Found " << filtered.size() << " entries with price > "
-                      << priceThreshold << std::endl;
-            displayMarketData(filtered);
+            Protocol::Predicate predicate;
+            predicate.column = Column::Close;
+            predicate.op = Analytics::Compare::Greater;
+            predicate.value = priceThreshold;
+            filter.query.where.push_back(predicate);
+        }
+        else if (choice == "4")
+        {
+            filter.summary = true;
         }
-        else
+        else if (!choice.empty() && choice != "1")
         {
             std::cout << "Invalid choice, showing all data." << std::endl;
-            displayMarketData(entries);
         }
+        return filter;
     }
 
-    void displayMarketData(const std::vector<MarketDataEntry> &data, size_t maxEntries)
+    void displayMarketData(const MarketDataView &data, size_t maxEntries)
     {
         if (data.empty())
         {
@@ -301,16 +559,52 @@ namespace MarketDataClient
         // Table data
         for (size_t i = startIndex; i < data.size(); ++i)
         {
-            const auto &entry = data[i];
-            std::cout << std::left << std::setw(25) << entry.m_timestamp
+            const auto entry = data[i];
+            std::cout << std::left << std::setw(25) << Timestamp::toString(entry.timestamp())
                       << std::fixed << std::setprecision(2)
-                      << std::setw(10) << entry.m_open
-                      << std::setw(10) << entry.m_high
-                      << std::setw(10) << entry.m_low
-                      << std::setw(10) << entry.m_close
-                      << std::setprecision(0) << entry.m_volume << std::endl;
+                      << std::setw(10) << entry.open()
+                      << std::setw(10) << entry.high()
+                      << std::setw(10) << entry.low()
+                      << std::setw(10) << entry.close()
+                      << std::setprecision(0) << entry.volume() << std::endl;
+        }
+
+        std::cout << std::string(70, '-') << std::endl;
+    }
+
+    void displaySummary(const MarketDataView &data, size_t window)
+    {
+        if (data.empty())
+        {
+            std::cout << "No market data received." << std::endl;
+            return;
         }
 
+        Analytics::Extremes low = Analytics::extremes(data.low(), data.size());
+        Analytics::Extremes high = Analytics::extremes(data.high(), data.size());
+        std::cout << "\n=== Summary (" << data.size() << " bars) ===\n"
+                  << std::fixed << std::setprecision(4)
+                  << "VWAP:        " << Analytics::vwap(data) << "\n"
+                  << "Range:       " << low.min << " - " << high.max << "\n"
+                  << "Last close:  " << data.close()[data.size() - 1] << "\n";
+        if (data.size() >= 2)
+        {
+            double lastReturn = 0.0;
+            Analytics::returns(data.close() + data.size() - 2, 2, &lastReturn);
+            std::cout << "Last return: " << lastReturn * 100.0 << "%\n";
+        }
+
+        // Only the last window of the close is needed, both kernels run over it alone
+        window = std::min(window, data.size());
+        const double *tail = data.close() + data.size() - window;
+        double mean = 0.0;
+        double deviation = 0.0;
+        Analytics::rollingMean(tail, window, window, &mean);
+        std::cout << "Mean close, last " << window << ": " << mean << "\n";
+        if (Analytics::rollingStdDev(tail, window, window, &deviation) == 1)
+        {
+            std::cout << "Std dev close, last " << window << ": " << deviation << "\n";
+        }
         std::cout << std::string(70, '-') << std::endl;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,88 @@
+#include "MarketDataSeries.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace
+{
+    // Gather column[order[i]] into a fresh column, keeping the spare capacity
+    template <typename T>
+    void permute(AlignedColumn<T> &column, const std::vector<size_t> &order)
+    {
+        AlignedColumn<T> sorted;
+        sorted.reserve(column.capacity());
+        for (size_t index : order)
+        {
+            sorted.push_back(column[index]);
+        }
+        column.swap(sorted);
+    }
+}
+
+MarketDataView MarketDataView::timeRange(int64_t from, int64_t to) const
+{
+    const int64_t *first = std::lower_bound(m_timestamp, m_timestamp + m_size, from);
+    const int64_t *last = std::upper_bound(first, m_timestamp + m_size, to);
+    return slice(static_cast<size_t>(first - m_timestamp), static_cast<size_t>(last - first));
+}
+
+size_t MarketDataSeries::capacity() const
+{
+    return std::min({m_timestamp.capacity(), m_open.capacity(), m_high.capacity(), m_low.capacity(),
+                     m_close.capacity(), m_volume.capacity()});
+}
+
+void MarketDataSeries::reserve(size_t rows)
+{
+    m_timestamp.reserve(rows);
+    m_open.reserve(rows);
+    m_high.reserve(rows);
+    m_low.reserve(rows);
+    m_close.reserve(rows);
+    m_volume.reserve(rows);
+}
+
+void MarketDataSeries::clear()
+{
+    m_timestamp.clear();
+    m_open.clear();
+    m_high.clear();
+    m_low.clear();
+    m_close.clear();
+    m_volume.clear();
+}
+
+void MarketDataSeries::append(const MarketDataView &rows)
+{
+    m_timestamp.insert(m_timestamp.end(), rows.timestamps(), rows.timestamps() + rows.size());
+    m_open.insert(m_open.end(), rows.open(), rows.open() + rows.size());
+    m_high.insert(m_high.end(), rows.high(), rows.high() + rows.size());
+    m_low.insert(m_low.end(), rows.low(), rows.low() + rows.size());
+    m_close.insert(m_close.end(), rows.close(), rows.close() + rows.size());
+    m_volume.insert(m_volume.end(), rows.volume(), rows.volume() + rows.size());
+}
+
+bool MarketDataSeries::isSortedByTime() const
+{
+    return std::is_sorted(m_timestamp.begin(), m_timestamp.end());
+}
+
+void MarketDataSeries::sortByTime()
+{
+    if (isSortedByTime())
+    {
+        return;
+    }
+
+    // Sort a permutation once, then apply it to every column
+    std::vector<size_t> order(size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [this](size_t a, size_t b) { return m_timestamp[a] < m_timestamp[b]; });
+
+    permute(m_timestamp, order);
+    permute(m_open, order);
+    permute(m_high, order);
+    permute(m_low, order);
+    permute(m_close, order);
+    permute(m_volume, order);
+}
@@ -2,6 +2,13 @@
 #include "Logger.hpp"
 #include "BenchMark.hpp"
 #include "DataParser.hpp"
+#include "Timestamp.hpp"
+#include "RefreshScheduler.hpp"
+#include "Protocol.hpp"
+#include "AsyncServer.hpp"
+#include "SubscriptionHub.hpp"
+#include "MulticastFeed.hpp"
+#include "SharedMemoryRing.hpp"
 #include <iostream>
 #include <thread>
 #include <vector>
@@ -11,6 +18,9 @@
 #include <boost/asio/ssl.hpp>
 #include <nlohmann/json.hpp>
 #include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <limits>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
@@ -21,16 +31,89 @@ using json = nlohmann::json;
 
 namespace
 {
+    std::shared_ptr<MarketDataServer::DataCache> makeDataCache();
+
+    // Multicast publisher of cache updates, null unless StartMulticast was called. Read with atomic_load
+    std::shared_ptr<MulticastPublisher> g_multicast;
+
+    // Shared memory ring for consumers on this host, null unless StartSharedMemory was called
+    std::shared_ptr<SharedMemoryPublisher> g_sharedMemory;
+
     // Global cache of market data
-    std::shared_ptr<MarketDataServer::DataCache> g_dataCache = std::make_shared<MarketDataServer::DataCache>();
+    std::shared_ptr<MarketDataServer::DataCache> g_dataCache = makeDataCache();
+
+    // Connections subscribed to a symbol, fed by every change published to the cache
+    SubscriptionHub g_subscriptions([](const std::string &symbol)
+                                    { return g_dataCache->snapshot(symbol); });
+
+    std::shared_ptr<MarketDataServer::DataCache> makeDataCache()
+    {
+        auto cache = std::make_shared<MarketDataServer::DataCache>();
+        cache->setUpdateListener([](const MarketDataServer::CacheUpdate &update)
+                                 {
+                                     // Single producer: the listener runs under the cache writer lock. First, as
+                                     // it is the cheapest to feed and its readers are waiting on no socket
+                                     if (auto ring = std::atomic_load(&g_sharedMemory))
+                                     {
+                                         ring->publish(update.symbol, update.snapshot->version, update.replaced,
+                                                       update.changed());
+                                     }
+                                     g_subscriptions.publish(update);
+                                     if (auto feed = std::atomic_load(&g_multicast))
+                                     {
+                                         feed->publish(update.symbol, update.snapshot->version, update.replaced,
+                                                       update.changed());
+                                     }
+                                 });
+        return cache;
+    }
+
+    // Upstream client shared by every fetch, so connections and TLS sessions outlive a refresh cycle
+    std::shared_ptr<UpstreamClient> g_upstream;
+    std::mutex g_upstreamMutex;
+
+    std::shared_ptr<UpstreamClient> upstreamFor(const MarketDataServer::ServerConfig &config)
+    {
+        std::lock_guard<std::mutex> lock(g_upstreamMutex);
+        if (!g_upstream || g_upstream->config().host != config.apiHost ||
+            g_upstream->config().port != config.apiPort || g_upstream->config().useTls != config.apiUseTls)
+        {
+            UpstreamConfig upstreamConfig;
+            upstreamConfig.host = config.apiHost;
+            upstreamConfig.port = config.apiPort;
+            upstreamConfig.useTls = config.apiUseTls;
+            upstreamConfig.maxIdleConnections = std::max<size_t>(upstreamConfig.maxIdleConnections,
+                                                                 config.maxConcurrentFetches);
+            g_upstream = std::make_shared<UpstreamClient>(upstreamConfig);
+        }
+        return g_upstream;
+    }
 
-    // Create SSL context for secure connections
-    std::shared_ptr<ssl::context> createSSLContext()
+    // Text a client sent, as it goes into the log: at most 80 characters, anything unprintable as \xNN
+    std::string printable(const std::string &text)
     {
-        auto ctx = std::make_shared<ssl::context>(ssl::context::tlsv12_client);
-        ctx->set_verify_mode(ssl::verify_none);
-        // ctx->set_default_verify_paths();
-        return ctx;
+        constexpr size_t MAX_LOGGED = 80;
+        static constexpr char HEX[] = "0123456789abcdef";
+        std::string out;
+        for (size_t i = 0; i < text.size() && i < MAX_LOGGED; ++i)
+        {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c < 0x7f && c != '\\')
+            {
+                out += static_cast<char>(c);
+            }
+            else
+            {
+                out += "\\x";
+                out += HEX[c >> 4];
+                out += HEX[c & 0xf];
+            }
+        }
+        if (text.size() > MAX_LOGGED)
+        {
+            out += "... (" + std::to_string(text.size()) + " bytes)";
+        }
+        return out;
     }
 }
 
@@ -38,173 +121,368 @@ namespace MarketDataServer
 {
     std::atomic<bool> g_shouldContinueFetching(false);
 
-    // Implement DataCache methods
-    void DataCache::updateData(const std::string &symbol, const std::vector<MarketDataEntry> &data)
+    namespace
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_cache[symbol] = data;
+        // Spare rows reserved whenever a series is (re)built, so later appends can go in place
+        size_t withHeadroom(size_t rows)
+        {
+            return rows + std::max<size_t>(rows / 4, 1024);
+        }
+
+        bool sameValues(const MarketDataRow &a, const MarketDataRow &b)
+        {
+            return a.open() == b.open() && a.high() == b.high() && a.low() == b.low() &&
+                   a.close() == b.close() && a.volume() == b.volume();
+        }
     }
 
-    std::vector<MarketDataEntry> DataCache::getData(const std::string &symbol) const
+    // Implement DataCache methods
+    DataCache::DataCache() : m_slots(std::make_shared<const SlotMap>())
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        auto it = m_cache.find(symbol);
-        return (it != m_cache.end()) ? it->second : std::vector<MarketDataEntry>();
     }
 
-    void StartServer(const ServerConfig &config)
+    void DataCache::updateData(const std::string &symbol, const MarketDataSeries &data)
     {
-        try
-        {
-            Logger::getInstance().log("Starting Market Data Server on port " +
-                                          std::to_string(config.port),
-                                      Logger::LogLevel::INFO);
+        // Build the new version before taking the writer lock, readers never wait on it anyway
+        auto storage = std::make_shared<MarketDataSeries>();
+        storage->reserve(withHeadroom(data.size()));
+        storage->append(data.view());
+        storage->sortByTime();
 
-            // Create IO context
-            net::io_context ioc;
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        Slot &slot = writableSlot(symbol);
+        publish(slot, std::move(storage), slot.current ? slot.current->version + 1 : 1, nullptr);
 
-            // Create the acceptor
-            tcp::acceptor acceptor(ioc);
-            tcp::endpoint endpoint(tcp::v4(), config.port);
+        if (m_listener)
+        {
+            CacheUpdate update;
+            update.symbol = symbol;
+            update.snapshot = slot.current;
+            update.replaced = true;
+            m_listener(update);
+        }
+    }
 
-            // Try to open and bind to the specified port
-            boost::system::error_code ec;
-            acceptor.open(endpoint.protocol(), ec);
+    void DataCache::setUpdateListener(UpdateListener listener)
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        m_listener = std::move(listener);
+    }
 
-            if (ec)
+    MergeResult DataCache::mergeData(const std::string &symbol, const MarketDataSeries &data)
+    {
+        // Alpha Vantage lists the newest bar first, order the fetch outside the lock. O(fetched bars)
+        MarketDataSeries sorted;
+        const MarketDataSeries *source = &data;
+        if (!data.isSortedByTime())
+        {
+            sorted = data;
+            sorted.sortByTime();
+            source = &sorted;
+        }
+        MarketDataView incoming = source->view();
+        const int64_t *in = incoming.timestamps();
+
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        Slot &slot = writableSlot(symbol);
+        MarketDataView cachedView = slot.current ? slot.current->view : MarketDataView();
+        uint64_t version = slot.current ? slot.current->version : 0;
+        MergeResult result;
+
+        const size_t cachedSize = cachedView.size();
+        const int64_t *cached = cachedView.timestamps();
+
+        // Everything past the cached tail is new, one binary search splits the fetch
+        size_t firstNew = cachedSize == 0
+                              ? 0
+                              : static_cast<size_t>(std::upper_bound(in, in + incoming.size(), cached[cachedSize - 1]) - in);
+
+        // Published bars are never written, so the merge is planned first and applied to the next version.
+        // The overlap is walked against the cached tail in step, starting at its first timestamp
+        MarketDataSeries revisions;
+        std::vector<size_t> revisedRows;
+        MarketDataSeries gaps;
+        size_t j = firstNew == 0 ? cachedSize : static_cast<size_t>(std::lower_bound(cached, cached + cachedSize, in[0]) - cached);
+        for (size_t i = 0; i < firstNew; ++i)
+        {
+            while (j < cachedSize && cached[j] < in[i])
             {
-                Logger::getInstance().log("Cannot open endpoint: " + ec.message(),
-                                          Logger::LogLevel::ERROR);
-                throw boost::system::system_error(ec);
+                ++j;
             }
 
-            // Set option to allow address reuse
-            acceptor.set_option(tcp::acceptor::reuse_address(true));
-
-            // Try to bind to the port
-            acceptor.bind(endpoint, ec);
-
-            if (ec)
+            MarketDataRow bar = incoming[i];
+            if (j < cachedSize && cached[j] == in[i])
+            {
+                if (!revisedRows.empty() && revisedRows.back() == j)
+                {
+                    revisions.setValues(revisions.size() - 1, bar.open(), bar.high(), bar.low(), bar.close(), bar.volume());
+                }
+                else if (!sameValues(cachedView[j], bar))
+                {
+                    revisions.push_back(bar);
+                    revisedRows.push_back(j);
+                }
+            }
+            else if (!gaps.empty() && gaps.timestamps()[gaps.size() - 1] == in[i])
             {
-                Logger::getInstance().log("Cannot bind to port " +
-                                              std::to_string(config.port) +
-                                              ": " + ec.message(),
-                                          Logger::LogLevel::WARNING);
-
-                // Close the current acceptor
-                acceptor.close();
-
-                // Create a new endpoint with port 0 (system-assigned port)
-                endpoint.port(0);
-
-                // Create a new acceptor
-                tcp::acceptor new_acceptor(ioc);
-                new_acceptor.open(endpoint.protocol());
-                new_acceptor.set_option(tcp::acceptor::reuse_address(true));
-                new_acceptor.bind(endpoint);
-
-                // Get the assigned port
-                int actual_port = new_acceptor.local_endpoint().port();
-                Logger::getInstance().log("Using alternative port: " +
-                                              std::to_string(actual_port),
-                                          Logger::LogLevel::INFO);
-
-                // Start listening on the new acceptor
-                new_acceptor.listen();
-
-                Logger::getInstance().log("Server started. Listening on port " +
-                                              std::to_string(actual_port),
-                                          Logger::LogLevel::INFO);
-
-                // Use the new acceptor for accepting connections
-                accept_connections(new_acceptor);
+                gaps.setValues(gaps.size() - 1, bar.open(), bar.high(), bar.low(), bar.close(), bar.volume());
             }
             else
             {
-                // Start listening on the original port
-                acceptor.listen();
+                gaps.push_back(bar);
+            }
+        }
+
+        // New bars go on the end, a timestamp repeated within the fetch keeps its last values
+        MarketDataSeries appended;
+        for (size_t i = firstNew; i < incoming.size(); ++i)
+        {
+            MarketDataRow bar = incoming[i];
+            if (!appended.empty() && appended.timestamps()[appended.size() - 1] == in[i])
+            {
+                appended.setValues(appended.size() - 1, bar.open(), bar.high(), bar.low(), bar.close(), bar.volume());
+                continue;
+            }
+            appended.push_back(bar);
+        }
 
-                Logger::getInstance().log("Server started. Listening on port " +
-                                              std::to_string(config.port),
-                                          Logger::LogLevel::INFO);
+        result.appended = appended.size();
+        result.revised = revisions.size();
+        result.inserted = gaps.size();
+        if (!result.changed())
+        {
+            result.version = version;
+            return result;
+        }
 
-                // Use the original acceptor for accepting connections
-                accept_connections(acceptor);
+        // Pure appends that fit the capacity are written past the end published snapshots see.
+        // Anything touching published rows, or needing a reallocation, builds a fresh copy
+        std::shared_ptr<MarketDataSeries> storage = slot.storage;
+        size_t newSize = cachedSize + appended.size() + gaps.size();
+        if (!storage || !revisions.empty() || !gaps.empty() || storage->capacity() < newSize)
+        {
+            storage = std::make_shared<MarketDataSeries>();
+            storage->reserve(withHeadroom(newSize));
+            storage->append(cachedView);
+            MarketDataView revised = revisions.view();
+            for (size_t k = 0; k < revisedRows.size(); ++k)
+            {
+                MarketDataRow bar = revised[k];
+                storage->setValues(revisedRows[k], bar.open(), bar.high(), bar.low(), bar.close(), bar.volume());
             }
         }
-        catch (const std::exception &e)
+        storage->append(appended.view());
+
+        // Back-filled history is rare, re-sorting the whole series is acceptable there
+        if (!gaps.empty())
         {
-            Logger::getInstance().log("Server error: " + std::string(e.what()),
-                                      Logger::LogLevel::ERROR);
+            storage->append(gaps.view());
+            storage->sortByTime();
+        }
+
+        // Kept with the next snapshots for conditional GETs, and handed to the listener
+        auto delta = std::make_shared<VersionDelta>();
+        delta->version = version + 1;
+        delta->changed.reserve(revisions.size() + gaps.size() + appended.size());
+        delta->changed.append(revisions.view());
+        delta->changed.append(gaps.view());
+        delta->changed.append(appended.view());
+        if (!delta->changed.isSortedByTime())
+        {
+            delta->changed.sortByTime();
         }
+
+        publish(slot, std::move(storage), version + 1, delta);
+        result.version = version + 1;
+
+        if (m_listener)
+        {
+            CacheUpdate update;
+            update.symbol = symbol;
+            update.snapshot = slot.current;
+            update.delta = std::move(delta);
+            m_listener(update);
+        }
+        return result;
+    }
+
+    std::shared_ptr<const MarketDataSnapshot> DataCache::snapshot(const std::string &symbol) const
+    {
+        std::shared_ptr<const SlotMap> slots = std::atomic_load(&m_slots);
+        auto it = slots->find(symbol);
+        return (it != slots->end()) ? std::atomic_load(&it->second->current) : nullptr;
     }
 
-    // Helper function to accept connections
-    void accept_connections(tcp::acceptor &acceptor)
+    MarketDataSeries DataCache::getData(const std::string &symbol) const
     {
-        // Accept connections in a loop
-        while (true)
+        MarketDataSeries data;
+        if (auto current = snapshot(symbol))
         {
-            // Create a socket
-            auto socket = std::make_shared<tcp::socket>(acceptor.get_executor());
+            data.append(current->view);
+        }
+        return data;
+    }
 
-            // Accept a connection
-            acceptor.accept(*socket);
+    MarketDataSeries DataCache::getRange(const std::string &symbol, int64_t from, int64_t to) const
+    {
+        MarketDataSeries range;
+        if (auto current = snapshot(symbol))
+        {
+            range.append(current->view.timeRange(from, to));
+        }
+        return range;
+    }
 
-            Logger::getInstance().log("Client connected: " +
-                                          socket->remote_endpoint().address().to_string(),
-                                      Logger::LogLevel::INFO);
+    uint64_t DataCache::version(const std::string &symbol) const
+    {
+        auto current = snapshot(symbol);
+        return current ? current->version : 0;
+    }
 
-            // Handle the client in a separate thread
-            std::thread clientThread(HandleClient, socket);
-            clientThread.detach();
+    DataCache::Slot &DataCache::writableSlot(const std::string &symbol)
+    {
+        std::shared_ptr<const SlotMap> slots = std::atomic_load(&m_slots);
+        auto it = slots->find(symbol);
+        if (it != slots->end())
+        {
+            return *it->second;
         }
+
+        // New symbols are rare, readers keep using the old map until the new one is stored
+        auto next = std::make_shared<SlotMap>(*slots);
+        auto slot = std::make_shared<Slot>();
+        (*next)[symbol] = slot;
+        std::atomic_store(&m_slots, std::shared_ptr<const SlotMap>(std::move(next)));
+        return *slot;
     }
 
-    void HandleClient(std::shared_ptr<tcp::socket> socket)
+    void DataCache::publish(Slot &slot, std::shared_ptr<MarketDataSeries> storage, uint64_t version,
+                            std::shared_ptr<const VersionDelta> delta)
     {
-        try
+        auto next = std::make_shared<MarketDataSnapshot>();
+        next->view = storage->view();
+        next->version = version;
+        next->keepAlive = storage;
+
+        // The deltas are shared with the previous snapshot, only the pointers are copied
+        if (delta)
         {
-            // Read client request for which symbol they want
-            boost::asio::streambuf buffer;
-            boost::asio::read_until(*socket, buffer, "\n");
+            if (slot.current)
+            {
+                next->recentChanges = slot.current->recentChanges;
+            }
+            if (next->recentChanges.size() == MAX_RECENT_CHANGES)
+            {
+                next->recentChanges.erase(next->recentChanges.begin());
+            }
+            next->recentChanges.push_back(std::move(delta));
+        }
 
-            // Extract the symbol from the request
-            std::string message(boost::asio::buffer_cast<const char *>(buffer.data()),
-                                buffer.size());
-            std::string symbol = "AAPL"; // Default to AAPL if no valid request
+        slot.storage = std::move(storage);
+        std::atomic_store(&slot.current, std::shared_ptr<const MarketDataSnapshot>(std::move(next)));
+    }
 
-            // Parse the message to get the symbol (simple protocol: "GET SYMBOL\n")
-            if (message.substr(0, 3) == "GET" && message.length() > 4)
-            {
-                symbol = message.substr(4, message.find('\n') - 4);
-                // Trim whitespace
-                symbol.erase(0, symbol.find_first_not_of(" \t"));
-                symbol.erase(symbol.find_last_not_of(" \t\n\r") + 1);
+    void StartServer(const ServerConfig &config)
+    {
+        try
+        {
+            Logger::getInstance().log("Starting Market Data Server on port " +
+                                          std::to_string(config.port),
+                                      Logger::LogLevel::INFO);
 
-                Logger::getInstance().log("Client requested symbol: " + symbol,
-                                          Logger::LogLevel::INFO);
+            // A fixed pool of io threads serves every connection, falls back to a system assigned port
+            AsyncServer server(HandleRequest, config.ioThreads);
+            if (config.enableMulticast)
+            {
+                StartMulticast(config.multicast);
+            }
+            if (config.enableSharedMemory)
+            {
+                StartSharedMemory(config.sharedMemoryName, config.sharedMemorySlots);
             }
+            unsigned short port = server.listen(static_cast<unsigned short>(config.port));
+
+            Logger::getInstance().log("Server started. Listening on port " + std::to_string(port) + " with " +
+                                          std::to_string(server.threadCount()) + " io threads",
+                                      Logger::LogLevel::INFO);
 
-            // Send the requested symbol's data
-            SendMarketData(socket, symbol);
+            server.start();
+            server.wait();
         }
         catch (const std::exception &e)
         {
-            Logger::getInstance().log("Client handler error: " + std::string(e.what()),
+            Logger::getInstance().log("Server error: " + std::string(e.what()),
                                       Logger::LogLevel::ERROR);
         }
+    }
 
-        // Close the socket
-        boost::system::error_code ec;
-        socket->close(ec);
-        if (ec)
+    ServerResponse HandleRequest(const std::string &line, const std::shared_ptr<ServerConnection> &connection)
+    {
+        // "GET SYMBOL [FORMAT=CSV|BIN1|DDC1]\n" and friends, see Protocol.hpp
+        Protocol::Request request;
+        std::string error;
+        if (Protocol::parseRequest(line, request, error))
         {
-            Logger::getInstance().log("Error closing socket: " + ec.message(),
-                                      Logger::LogLevel::WARNING);
+            if (request.command == Protocol::Command::Quit)
+            {
+                ServerResponse response;
+                response.closeConnection = true;
+                return response;
+            }
+
+            if (request.command == Protocol::Command::Get)
+            {
+                if (request.conditional)
+                {
+                    return ConditionalResponse(request.symbols.front(), request.since, request.format);
+                }
+                if (!request.query.empty())
+                {
+                    return QueryResponse(request.symbols.front(), request.query, request.format);
+                }
+                return MarketDataResponse(request.symbols.front(), request.format);
+            }
+            if (request.command == Protocol::Command::Sub || request.command == Protocol::Command::Unsub)
+            {
+                if (!connection)
+                {
+                    return ServerResponse::fromString("ERROR: Subscriptions need a connection\n");
+                }
+                if (request.command == Protocol::Command::Sub)
+                {
+                    return g_subscriptions.subscribe(request.symbols.front(), request.format, connection);
+                }
+                if (!g_subscriptions.unsubscribe(request.symbols.front(), connection))
+                {
+                    return ServerResponse::fromString("ERROR: Not subscribed to " + request.symbols.front() + "\n");
+                }
+                return ServerResponse::fromString("UNSUBSCRIBED:" + request.symbols.front() + "\n");
+            }
+            if (request.command == Protocol::Command::Retx)
+            {
+                auto feed = std::atomic_load(&g_multicast);
+                if (!feed)
+                {
+                    return ServerResponse::fromString("ERROR: Multicast feed is not enabled\n");
+                }
+                return feed->retransmit(request.symbols.front(), request.from, request.to);
+            }
+
+            // Every series of the batch in one response, each framed as it would be on its own
+            ServerResponse response = ServerResponse::fromString(Protocol::batchHeader(request.symbols.size()));
+            for (const auto &symbol : request.symbols)
+            {
+                response.append(request.query.empty() ? MarketDataResponse(symbol, request.format)
+                                                      : QueryResponse(symbol, request.query, request.format));
+            }
+            return response;
         }
 
-        Logger::getInstance().log("Client disconnected", Logger::LogLevel::INFO);
+        // Any line that does not parse, a blank line or a typo included, is answered with an error. The connection
+        // stays open, so a guess at what was meant would put unrequested data between the client's answers
+        Logger::getInstance().log("Rejected request \"" + printable(line) + "\": " + printable(error),
+                                  Logger::LogLevel::WARNING);
+        return ServerResponse::fromString("ERROR: " + error + "\n");
     }
 
     std::string FetchMarketData(const std::string &symbol, const std::string &apiKey)
@@ -212,172 +490,165 @@ namespace MarketDataServer
         Timer timer;
         timer.start();
 
-        std::string response;
+        // Request intraday data with 1min interval
+        std::string target = "/query?function=TIME_SERIES_INTRADAY&symbol=" + symbol +
+                             "&interval=1min&apikey=" + apiKey;
 
-        try
+        // Goes through the shared client of the default upstream, no per call connect or handshake
+        ServerConfig defaults;
+        std::string response;
+        bool fetched = upstreamFor(defaults)->get(target, [&response](std::istream &body)
+                                                  {
+                                                      response.assign(std::istreambuf_iterator<char>(body),
+                                                                      std::istreambuf_iterator<char>());
+                                                      return true;
+                                                  });
+
+        timer.end();
+        if (!fetched)
         {
-            // Host for Alpha Vantage API
-            const std::string host = "www.alphavantage.co";
+            Logger::getInstance().log("Error fetching market data for " + symbol, Logger::LogLevel::ERROR);
+            return {};
+        }
+        timer.printTime();
 
-            // Set up I/O context and SSL context
-            net::io_context ioc;
-            auto ctx = createSSLContext();
+        // Log the first 500 characters of the response for debugging
+        std::string response_preview = response.substr(0, std::min<size_t>(500, response.size()));
+        Logger::getInstance().log("API Response preview: " + response_preview + "...",
+                                  Logger::LogLevel::INFO);
 
-            // These objects perform our I/O
-            tcp::resolver resolver(ioc);
-            ssl::stream<tcp::socket> stream(ioc, *ctx);
+        Logger::getInstance().log("Successfully fetched market data for " + symbol,
+                                  Logger::LogLevel::INFO);
+        return response;
+    }
 
-            // Look up the domain name
-            auto const results = resolver.resolve(host, "443");
+    bool StreamMarketData(const ServerConfig &config, const std::string &symbol,
+                          const IDataParser::BatchCallback &onBatch)
+    {
+        return StreamMarketData(*upstreamFor(config), config.apiKey, symbol, onBatch);
+    }
 
-            // Make the connection
-            net::connect(stream.next_layer(), results.begin(), results.end());
+    bool StreamMarketData(UpstreamClient &client, const std::string &apiKey, const std::string &symbol,
+                          const IDataParser::BatchCallback &onBatch)
+    {
+        // Request intraday data with 1min interval
+        std::string target = "/query?function=TIME_SERIES_INTRADAY&symbol=" + symbol +
+                             "&interval=1min&apikey=" + apiKey;
 
-            if (!SSL_set_tlsext_host_name(stream.native_handle(), "www.alphavantage.co"))
-            {
-                throw boost::system::system_error(
-                    ::ERR_get_error(),
-                    boost::asio::error::get_ssl_category());
-            }
-            // Perform the SSL handshake
-            try
-            {
-                stream.handshake(ssl::stream_base::client);
-            }
-            catch (const boost::system::system_error &e)
-            {
-                std::cerr << "SSL Handshake Error: " << e.what() << std::endl;
-                std::cerr << "Error code: " << e.code() << std::endl;
-                throw; // Re-throw to be caught by the outer catch
-            }
-            // Set up an HTTP GET request
-            // Request intraday data with 1min interval
-            std::string target = "/query?function=TIME_SERIES_INTRADAY&symbol=" + symbol +
-                                 "&interval=1min&apikey=" + apiKey;
+        bool parsed = client.get(target, [&onBatch](std::istream &body)
+                                 {
+                                     DataParserJson parser(body);
+                                     return parser.parseBatches(IDataParser::DEFAULT_BATCH_SIZE, onBatch);
+                                 });
 
-            http::request<http::string_body> req{http::verb::get, target, 11};
-            req.set(http::field::host, host);
-            req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+        if (parsed)
+        {
+            Logger::getInstance().log("Successfully fetched market data for " + symbol + " in " +
+                                          std::to_string(client.stats().lastLatencyMs) + " ms",
+                                      Logger::LogLevel::INFO);
+        }
+        return parsed;
+    }
 
-            // Send the HTTP request
-            http::write(stream, req);
+    namespace
+    {
+        void logMerge(const std::string &symbol, const std::string &source, size_t fetched, const MergeResult &merged)
+        {
+            Logger::getInstance().log("Updated market data for " + symbol + source + ": " + std::to_string(fetched) +
+                                          " entries fetched, " + std::to_string(merged.appended) + " new, " +
+                                          std::to_string(merged.revised) + " revised, " +
+                                          std::to_string(merged.inserted) + " back-filled (version " +
+                                          std::to_string(merged.version) + ")",
+                                      Logger::LogLevel::INFO);
+        }
 
-            // This buffer is used for reading
-            beast::flat_buffer buffer;
+        // Fetch one symbol into the cache, falling back to the CSV file when the API gives nothing
+        bool RefreshSymbol(const ServerConfig &config, const std::string &symbol)
+        {
+            Logger &logger = Logger::getInstance();
+            try
+            {
+                logger.log("Fetching market data for " + symbol, Logger::LogLevel::INFO);
 
-            // Declare a container to hold the response
-            http::response<http::dynamic_body> res;
+                // Fetch data from API, bars are parsed while the body downloads
+                MarketDataSeries fetched;
+                bool apiDataProcessed = StreamMarketData(config, symbol, [&fetched](MarketDataSeries &batch)
+                                                         {
+                                                             fetched.append(batch.view());
+                                                             return true;
+                                                         });
 
-            // Receive the HTTP response
-            http::read(stream, buffer, res);
+                if (apiDataProcessed)
+                {
+                    // Only bars the cache has not seen are added
+                    MergeResult merged = MergeMarketData(symbol, fetched);
+                    logMerge(symbol, "", fetched.size(), merged);
+                    return true;
+                }
 
-            // Convert to string
-            response = beast::buffers_to_string(res.body().data());
+                // If API request failed or returned no data, fall back to CSV
+                logger.log("API request failed or returned no data for " + symbol +
+                               ". Falling back to CSV data.",
+                           Logger::LogLevel::INFO);
 
-            // Log the first 500 characters of the response for debugging
-            std::string response_preview = response.substr(0, std::min<size_t>(500, response.size()));
-            Logger::getInstance().log("API Response preview: " + response_preview + "...",
-                                      Logger::LogLevel::INFO);
+                // CSV fallback
+                auto csvParser = ParserFactory::createCSVParser(config.dataPath, CSVReadMode::MemoryMapped,
+                                                                config.csvParseThreads);
+                if (csvParser->parseData())
+                {
+                    MergeResult merged = MergeMarketData(symbol, csvParser->getData());
+                    logMerge(symbol, " from CSV", csvParser->getData().size(), merged);
+                    return true;
+                }
 
-            // Gracefully close the stream
-            beast::error_code ec;
-            stream.shutdown(ec);
-            if (ec == net::error::eof)
-            {
-                // Rationale: http://stackoverflow.com/questions/25587403/
-                ec = {};
+                logger.log("Failed to load CSV fallback data for " + symbol,
+                           Logger::LogLevel::ERROR);
             }
-            if (ec)
+            catch (const std::exception &e)
             {
-                Logger::getInstance().log("SSL shutdown error: " + ec.message(),
-                                          Logger::LogLevel::WARNING);
+                logger.log("Error updating market data for " + symbol +
+                               ": " + std::string(e.what()),
+                           Logger::LogLevel::ERROR);
             }
-
-            timer.end();
-            timer.printTime();
-
-            Logger::getInstance().log("Successfully fetched market data for " + symbol,
-                                      Logger::LogLevel::INFO);
+            return false;
         }
-        catch (const std::exception &e)
-        {
-            Logger::getInstance().log("Error fetching market data: " + std::string(e.what()),
-                                      Logger::LogLevel::ERROR);
-            timer.end();
-        }
-
-        return response;
     }
+
     // Fixed version with only the config parameter
     void DataUpdateTask(const ServerConfig config)
     {
         Logger &logger = Logger::getInstance();
         logger.log("Starting periodic market data fetch task", Logger::LogLevel::INFO);
 
+        // Lives across cycles so the rate limit carries over from one cycle to the next
+        RefreshScheduler scheduler(config.maxConcurrentFetches, config.requestsPerMinute, config.requestBurst);
+
         while (g_shouldContinueFetching)
         {
-            for (const auto &symbol : config.symbols)
+            RefreshCycleReport report = scheduler.runCycle(config.symbols, [&config](const std::string &symbol)
+                                                           { return RefreshSymbol(config, symbol); });
+
+            std::ostringstream summary;
+            summary << "Refresh cycle: " << report.succeeded << "/" << report.symbols << " symbols updated in "
+                    << report.elapsedMs << " ms (" << scheduler.maxConcurrent() << " concurrent, slowest "
+                    << report.slowestMs << " ms, " << report.throttledMs << " ms rate limited)";
+            logger.log(summary.str(), report.failed == 0 ? Logger::LogLevel::INFO : Logger::LogLevel::WARNING);
+
+            UpstreamStats upstream = upstreamFor(config)->stats();
+            logger.log("Upstream: " + std::to_string(upstream.requests) + " requests, " +
+                           std::to_string(upstream.connectionsOpened) + " connections opened, " +
+                           std::to_string(upstream.connectionsReused) + " reused, " +
+                           std::to_string(upstream.tlsResumed) + "/" + std::to_string(upstream.tlsHandshakes) +
+                           " TLS sessions resumed, mean latency " + std::to_string(upstream.meanLatencyMs()) + " ms",
+                       Logger::LogLevel::INFO);
+
+            // Wait for next update interval, counted from the start of this cycle
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::duration<double, std::milli>(report.elapsedMs));
+            if (elapsed < API_REFRESH_INTERVAL)
             {
-                try
-                {
-                    logger.log("Fetching market data for " + symbol, Logger::LogLevel::INFO);
-
-                    // Fetch data from API
-                    std::string jsonResponse = FetchMarketData(symbol, config.apiKey);
-
-                    bool apiDataProcessed = false;
-
-                    if (!jsonResponse.empty())
-                    {
-                        auto jsonParser = ParserFactory::createJSONParser(jsonResponse);
-                        if (jsonParser->parseData())
-                        {
-                            // Update cache with new data
-                            g_dataCache->updateData(symbol, jsonParser->getData());
-                            apiDataProcessed = true;
-
-                            logger.log("Updated market data for " + symbol +
-                                           ": " + std::to_string(jsonParser->getData().size()) +
-                                           " entries",
-                                       Logger::LogLevel::INFO);
-                        }
-                    }
-
-                    // If API request failed or returned no data, fall back to CSV
-                    if (!apiDataProcessed)
-                    {
-                        logger.log("API request failed or returned no data for " + symbol +
-                                       ". Falling back to CSV data.",
-                                   Logger::LogLevel::INFO);
-
-                        // CSV fallback
-                        auto csvParser = ParserFactory::createCSVParser(config.dataPath);
-                        if (csvParser->parseData())
-                        {
-                            g_dataCache->updateData(symbol, csvParser->getData());
-
-                            logger.log("Updated market data for " + symbol +
-                                           " from CSV: " + std::to_string(csvParser->getData().size()) +
-                                           " entries",
-                                       Logger::LogLevel::INFO);
-                        }
-                        else
-                        {
-                            logger.log("Failed to load CSV fallback data for " + symbol,
-                                       Logger::LogLevel::ERROR);
-                        }
-                    }
-                }
-                catch (const std::exception &e)
-                {
-                    logger.log("Error updating market data for " + symbol +
-                                   ": " + std::string(e.what()),
-                               Logger::LogLevel::ERROR);
-                }
+                std::this_thread::sleep_for(API_REFRESH_INTERVAL - elapsed);
             }
-
-            // Wait for next update interval
-            std::this_thread::sleep_for(API_REFRESH_INTERVAL);
         }
 
         logger.log("Periodic market data fetch task stopped", Logger::LogLevel::INFO);
@@ -397,62 +668,347 @@ namespace MarketDataServer
         g_shouldContinueFetching = false;
     }
 
-    void SendMarketData(std::shared_ptr<tcp::socket> socket, const std::string &symbol)
+    ServerResponse MarketDataResponse(const std::string &symbol, WireFormat format)
     {
-        // Use the global data cache instead of creating a new one
-        std::vector<MarketDataEntry> data = g_dataCache->getData(symbol);
+        // A snapshot, no lock and no copy of the history. It stays valid while newer versions get published
+        std::shared_ptr<const MarketDataSnapshot> snapshot = g_dataCache->snapshot(symbol);
+        if (!snapshot || snapshot->view.empty())
+        {
+            // Send a proper error message instead of nothing
+            Logger::getInstance().log("No data available for " + symbol + ", sent error message",
+                                      Logger::LogLevel::WARNING);
+            return ServerResponse::fromString("ERROR: No data available for symbol: " + symbol + "\n");
+        }
 
-        try
+        // Encoded once per version and shared by every client asking for it, header and body in one write.
+        // The response holds the payload, not a copy of it
+        std::shared_ptr<const EncodedPayload> payload = snapshot->payloads.get(snapshot->view, format);
+        ServerResponse response;
+        response.buffers.push_back(net::buffer(payload->bytes().data(), payload->bytes().size()));
+        response.owners.push_back(std::move(payload));
+        return response;
+    }
+
+    namespace
+    {
+        // Header line followed by an encoded payload, sent without copying the payload
+        ServerResponse versionedResponse(const char *kind, const std::string &symbol, uint64_t version,
+                                         std::shared_ptr<const EncodedPayload> payload)
         {
-            if (data.empty())
+            ServerResponse response =
+                ServerResponse::fromString(std::string(kind) + ":" + symbol + ":" + std::to_string(version) + "\n");
+            response.buffers.push_back(net::buffer(payload->bytes().data(), payload->bytes().size()));
+            response.owners.push_back(std::move(payload));
+            return response;
+        }
+
+        // Bars changed by changes[first] and every later delta. A bar changed more than once keeps its newest values
+        MarketDataSeries mergeChanges(const std::vector<std::shared_ptr<const VersionDelta>> &changes, size_t first)
+        {
+            MarketDataSeries all;
+            for (size_t k = first; k < changes.size(); ++k)
+            {
+                all.append(changes[k]->changed.view());
+            }
+            all.sortByTime(); // Stable: of equal timestamps the newest version comes last
+
+            MarketDataSeries merged;
+            merged.reserve(all.size());
+            const int64_t *timestamps = all.timestamps();
+            for (size_t i = 0; i < all.size(); ++i)
             {
-                // Send a proper error message instead of nothing
-                std::string errorMsg = "ERROR: No data available for symbol: " + symbol + "\n";
-                boost::asio::write(*socket, boost::asio::buffer(errorMsg));
-                Logger::getInstance().log("No data available for " + symbol + ", sent error message",
-                                          Logger::LogLevel::WARNING);
-                return;
+                if (i + 1 == all.size() || timestamps[i + 1] != timestamps[i])
+                {
+                    merged.push_back(all.view()[i]);
+                }
             }
+            return merged;
+        }
+    }
+
+    ServerResponse ConditionalResponse(const std::string &symbol, uint64_t since, WireFormat format)
+    {
+        std::shared_ptr<const MarketDataSnapshot> snapshot = g_dataCache->snapshot(symbol);
+        if (!snapshot || snapshot->view.empty())
+        {
+            Logger::getInstance().log("No data available for " + symbol + ", sent error message",
+                                      Logger::LogLevel::WARNING);
+            return ServerResponse::fromString("ERROR: No data available for symbol: " + symbol + "\n");
+        }
 
-            // Convert market data to CSV format for sending
-            std::stringstream ss;
-            ss << "timestamp,open,high,low,close,volume\n";
+        const uint64_t version = snapshot->version;
+        if (since == version)
+        {
+            return ServerResponse::fromString("NOT_MODIFIED:" + symbol + ":" + std::to_string(version) + "\n");
+        }
 
-            for (const auto &entry : data)
+        // Recent changes are consecutive versions ending at this one, since + 1 onwards is a suffix of them
+        const auto &changes = snapshot->recentChanges;
+        if (since != 0 && since < version && !changes.empty() && changes.front()->version <= since + 1)
+        {
+            size_t first = changes.size() - static_cast<size_t>(version - since);
+            if (first + 1 == changes.size())
             {
-                ss << entry.m_timestamp << ","
-                   << entry.m_open << ","
-                   << entry.m_high << ","
-                   << entry.m_low << ","
-                   << entry.m_close << ","
-                   << entry.m_volume << "\n";
+                // The usual poll, one version behind: encoded once and shared by every client asking
+                const VersionDelta &delta = *changes.back();
+                return versionedResponse("DELTA", symbol, version, delta.payloads.get(delta.changed.view(), format));
             }
 
-            std::string dataStr = ss.str();
+            // Bars revised over and over could outgrow the series, then it is sent whole
+            MarketDataSeries merged = mergeChanges(changes, first);
+            if (merged.size() < snapshot->view.size())
+            {
+                return versionedResponse("DELTA", symbol, version, WireEncoder::encode(merged.view(), format));
+            }
+        }
 
-            // First send a header with the data size
-            std::string header = "DATA_SIZE:" + std::to_string(dataStr.size()) + "\n";
-            boost::asio::write(*socket, boost::asio::buffer(header));
+        return versionedResponse("SNAPSHOT", symbol, version, snapshot->payloads.get(snapshot->view, format));
+    }
 
-            // Then send the actual data
-            boost::asio::write(*socket, boost::asio::buffer(dataStr));
+    namespace
+    {
+        // Rows a query's value conditions are evaluated in at a time, newest block first
+        constexpr size_t QUERY_BLOCK_ROWS = 4096;
 
-            Logger::getInstance().log("Sent " + std::to_string(data.size()) +
-                                          " market data entries to client",
-                                      Logger::LogLevel::INFO);
+        const double *columnValues(const MarketDataView &view, Column column)
+        {
+            switch (column)
+            {
+            case Column::Open:
+                return view.open();
+            case Column::High:
+                return view.high();
+            case Column::Low:
+                return view.low();
+            case Column::Close:
+                return view.close();
+            default:
+                return view.volume();
+            }
+        }
+
+        bool holds(double value, Analytics::Compare op, double threshold)
+        {
+            switch (op)
+            {
+            case Analytics::Compare::Less:
+                return value < threshold;
+            case Analytics::Compare::LessEqual:
+                return value <= threshold;
+            case Analytics::Compare::Greater:
+                return value > threshold;
+            case Analytics::Compare::GreaterEqual:
+                return value >= threshold;
+            case Analytics::Compare::Equal:
+                return value == threshold;
+            case Analytics::Compare::NotEqual:
+                break;
+            }
+            return value != threshold;
+        }
+    }
+
+    void SelectRows(const MarketDataView &view, const Protocol::Query &query, std::vector<size_t> &rows)
+    {
+        rows.clear();
+
+        // Timestamp conditions bound a range, the value ones are kept for the scan
+        int64_t from = std::numeric_limits<int64_t>::min();
+        int64_t to = std::numeric_limits<int64_t>::max();
+        std::vector<const Protocol::Predicate *> conditions;
+        for (const auto &predicate : query.where)
+        {
+            if (predicate.column != Column::Timestamp)
+            {
+                conditions.push_back(&predicate);
+                continue;
+            }
+            const int64_t time = predicate.time;
+            switch (predicate.op)
+            {
+            case Analytics::Compare::Less:
+                if (time == std::numeric_limits<int64_t>::min())
+                {
+                    return;
+                }
+                to = std::min(to, time - 1);
+                break;
+            case Analytics::Compare::LessEqual:
+                to = std::min(to, time);
+                break;
+            case Analytics::Compare::Greater:
+                if (time == std::numeric_limits<int64_t>::max())
+                {
+                    return;
+                }
+                from = std::max(from, time + 1);
+                break;
+            case Analytics::Compare::GreaterEqual:
+                from = std::max(from, time);
+                break;
+            default:
+                from = std::max(from, time);
+                to = std::min(to, time);
+                break;
+            }
+        }
+        if (from > to)
+        {
+            return;
+        }
+        const MarketDataView range = view.timeRange(from, to);
+        const size_t first = static_cast<size_t>(range.timestamps() - view.timestamps());
+
+        // Matches are taken newest first: every k-th of them, until the limit is met
+        size_t wanted = std::numeric_limits<size_t>::max();
+        if (query.limit != 0 && query.limit - 1 < (wanted - 1) / query.every)
+        {
+            wanted = (query.limit - 1) * query.every + 1;
+        }
+        size_t matched = 0;
+        if (conditions.empty())
+        {
+            for (size_t k = 0; k < range.size() && k < wanted; k += query.every)
+            {
+                rows.push_back(first + range.size() - 1 - k);
+            }
+        }
+        else
+        {
+            std::vector<size_t> block(std::min(QUERY_BLOCK_ROWS, range.size()));
+            for (size_t end = range.size(); end > 0 && matched < wanted;)
+            {
+                size_t begin = end > QUERY_BLOCK_ROWS ? end - QUERY_BLOCK_ROWS : 0;
+                const Protocol::Predicate &lead = *conditions.front();
+                size_t count = Analytics::select(columnValues(range, lead.column) + begin, end - begin, lead.op,
+                                                 lead.value, block.data());
+
+                // The first condition picked the candidates, the others only look at those
+                for (size_t c = 1; c < conditions.size() && count > 0; ++c)
+                {
+                    const double *values = columnValues(range, conditions[c]->column) + begin;
+                    size_t kept = 0;
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        block[kept] = block[j];
+                        kept += holds(values[block[j]], conditions[c]->op, conditions[c]->value);
+                    }
+                    count = kept;
+                }
+
+                for (size_t j = count; j-- > 0 && matched < wanted; ++matched)
+                {
+                    if (matched % query.every == 0)
+                    {
+                        rows.push_back(first + begin + block[j]);
+                    }
+                }
+                end = begin;
+            }
+        }
+        std::reverse(rows.begin(), rows.end());
+    }
+
+    ServerResponse QueryResponse(const std::string &symbol, const Protocol::Query &query, WireFormat format)
+    {
+        std::shared_ptr<const MarketDataSnapshot> snapshot = g_dataCache->snapshot(symbol);
+        if (!snapshot || snapshot->view.empty())
+        {
+            Logger::getInstance().log("No data available for " + symbol + ", sent error message",
+                                      Logger::LogLevel::WARNING);
+            return ServerResponse::fromString("ERROR: No data available for symbol: " + symbol + "\n");
+        }
+
+        std::vector<size_t> rows;
+        SelectRows(snapshot->view, query, rows);
+
+        // A run of consecutive bars is encoded straight from the snapshot, scattered ones are gathered first
+        MarketDataSeries gathered;
+        MarketDataView selected;
+        if (!rows.empty() && rows.back() - rows.front() + 1 == rows.size())
+        {
+            selected = snapshot->view.slice(rows.front(), rows.size());
+        }
+        else
+        {
+            gathered.reserve(rows.size());
+            for (size_t row : rows)
+            {
+                gathered.push_back(snapshot->view[row]);
+            }
+            selected = gathered.view();
+        }
+
+        std::shared_ptr<const EncodedPayload> payload = format == WireFormat::CSV
+                                                            ? WireEncoder::encodeCsv(selected, query.columns)
+                                                            : WireEncoder::encode(selected, format);
+        ServerResponse response;
+        response.buffers.push_back(net::buffer(payload->bytes().data(), payload->bytes().size()));
+        response.owners.push_back(std::move(payload));
+        return response;
+    }
+
+    MergeResult MergeMarketData(const std::string &symbol, const MarketDataSeries &data)
+    {
+        return g_dataCache->mergeData(symbol, data);
+    }
+
+    std::shared_ptr<MulticastPublisher> StartMulticast(const MulticastConfig &config)
+    {
+        try
+        {
+            auto feed = std::make_shared<MulticastPublisher>(config);
+            std::atomic_store(&g_multicast, feed);
+            return feed;
         }
         catch (const std::exception &e)
         {
-            Logger::getInstance().log("Error sending market data: " + std::string(e.what()),
-                                      Logger::LogLevel::ERROR);
+            Logger::getInstance().log("Multicast feed not started: " + std::string(e.what()), Logger::LogLevel::ERROR);
+            return nullptr;
         }
+    }
+
+    void StopMulticast()
+    {
+        std::atomic_store(&g_multicast, std::shared_ptr<MulticastPublisher>());
+    }
+
+    std::shared_ptr<SharedMemoryPublisher> StartSharedMemory(const std::string &name, size_t slots)
+    {
+        // Drop a running ring first, a new one with the same name unlinks its object
+        std::atomic_store(&g_sharedMemory, std::shared_ptr<SharedMemoryPublisher>());
+        auto ring = std::make_shared<SharedMemoryPublisher>(name, slots);
+        if (!ring->isOpen())
+        {
+            return nullptr;
+        }
+        std::atomic_store(&g_sharedMemory, ring);
+        return ring;
+    }
 
-        // Note: Do not close the socket here - let the client maintain the connection
+    void StopSharedMemory()
+    {
+        std::atomic_store(&g_sharedMemory, std::shared_ptr<SharedMemoryPublisher>());
     }
 
-    std::vector<MarketDataEntry> GetLatestData(const std::string &symbol)
+    size_t SubscriberCount(const std::string &symbol)
+    {
+        return g_subscriptions.subscriberCount(symbol);
+    }
+
+    std::shared_ptr<const MarketDataSnapshot> GetSnapshot(const std::string &symbol)
+    {
+        return g_dataCache->snapshot(symbol);
+    }
+
+    MarketDataSeries GetLatestData(const std::string &symbol)
     {
         // Use the global data cache instead of creating a new one
         return g_dataCache->getData(symbol);
     }
+
+    MarketDataSeries GetDataRange(const std::string &symbol, int64_t from, int64_t to)
+    {
+        return g_dataCache->getRange(symbol, from, to);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,618 @@
+#include "MulticastFeed.hpp"
+#include "Logger.hpp"
+#include "Protocol.hpp"
+#include "WireDecoder.hpp"
+#include "WireEncoder.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <vector>
+
+namespace net = boost::asio;
+using udp = net::ip::udp;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    constexpr bool HOST_IS_LITTLE_ENDIAN = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+    // Datagrams are kept with a 2 byte length in front, the form RETX sends them in
+    constexpr size_t LENGTH_PREFIX = 2;
+
+    // Most a RETX answer can carry, a larger byte count in its header is not from the feed
+    constexpr size_t MAX_RETRANSMIT_BYTES = Protocol::MAX_RETRANSMIT * (LENGTH_PREFIX + MulticastFeed::MAX_DATAGRAM);
+
+    template <typename T>
+    T littleEndian(T value)
+    {
+        if (HOST_IS_LITTLE_ENDIAN)
+        {
+            return value;
+        }
+        if constexpr (sizeof(T) == 2)
+        {
+            return static_cast<T>(__builtin_bswap16(value));
+        }
+        else if constexpr (sizeof(T) == 4)
+        {
+            return static_cast<T>(__builtin_bswap32(value));
+        }
+        else
+        {
+            return static_cast<T>(__builtin_bswap64(value));
+        }
+    }
+
+    template <typename T>
+    void put(char *out, T value)
+    {
+        value = littleEndian(value);
+        std::memcpy(out, &value, sizeof(value));
+    }
+
+    template <typename T>
+    T get(const char *in)
+    {
+        T value;
+        std::memcpy(&value, in, sizeof(value));
+        return littleEndian(value);
+    }
+
+    size_t paddedSymbolLength(size_t length)
+    {
+        return (length + 7) & ~size_t(7);
+    }
+
+    // One datagram with its length prefix
+    std::shared_ptr<const std::string> encodeDatagram(const std::string &symbol, uint8_t flags, uint64_t sequence,
+                                                      uint64_t version, const MarketDataView &bars)
+    {
+        size_t size = MulticastFeed::HEADER_SIZE + paddedSymbolLength(symbol.size()) + bars.size() * sizeof(WireRecord);
+        auto framed = std::make_shared<std::string>(LENGTH_PREFIX + size, '\0');
+        char *out = framed->data();
+        put(out, static_cast<uint16_t>(size));
+        out += LENGTH_PREFIX;
+
+        put(out, MulticastFeed::MAGIC);
+        out[4] = static_cast<char>(flags);
+        out[5] = static_cast<char>(symbol.size());
+        put(out + 6, static_cast<uint16_t>(bars.size()));
+        put(out + 8, sequence);
+        put(out + 16, version);
+        std::memcpy(out + MulticastFeed::HEADER_SIZE, symbol.data(), symbol.size());
+
+        char *cursor = out + MulticastFeed::HEADER_SIZE + paddedSymbolLength(symbol.size());
+        for (size_t i = 0; i < bars.size(); ++i)
+        {
+            WireRecord record{bars.timestamps()[i], bars.open()[i], bars.high()[i], bars.low()[i],
+                              bars.close()[i], bars.volume()[i]};
+            WireEncoder::toHostOrder(&record, 1);
+            std::memcpy(cursor, &record, sizeof(record));
+            cursor += sizeof(record);
+        }
+        return framed;
+    }
+}
+
+namespace MulticastFeed
+{
+    bool decode(const char *data, size_t size, Packet &out)
+    {
+        if (size < HEADER_SIZE || get<uint32_t>(data) != MAGIC)
+        {
+            return false;
+        }
+        size_t symbolLength = static_cast<uint8_t>(data[5]);
+        size_t barCount = get<uint16_t>(data + 6);
+        size_t barsOffset = HEADER_SIZE + paddedSymbolLength(symbolLength);
+        if (size != barsOffset + barCount * sizeof(WireRecord))
+        {
+            return false;
+        }
+
+        out.flags = static_cast<uint8_t>(data[4]);
+        out.sequence = get<uint64_t>(data + 8);
+        out.version = get<uint64_t>(data + 16);
+        out.symbol.assign(data + HEADER_SIZE, symbolLength);
+
+        std::vector<WireRecord> records(barCount);
+        std::memcpy(records.data(), data + barsOffset, barCount * sizeof(WireRecord));
+        WireEncoder::toHostOrder(records.data(), records.size());
+        out.bars.clear();
+        WireEncoder::decodeRecords(records.data(), records.size(), out.bars);
+        return true;
+    }
+}
+
+MulticastPublisher::MulticastPublisher(const MulticastConfig &config) : m_config(config), m_socket(m_ioc)
+{
+    net::ip::address_v4 group = net::ip::make_address_v4(config.group);
+    net::ip::address_v4 interfaceAddress = net::ip::make_address_v4(config.interfaceAddress);
+    m_destination = udp::endpoint(group, config.port);
+
+    m_socket.open(udp::v4());
+    if (!interfaceAddress.is_unspecified())
+    {
+        m_socket.set_option(net::ip::multicast::outbound_interface(interfaceAddress));
+    }
+    m_socket.set_option(net::ip::multicast::hops(config.ttl));
+    m_socket.set_option(net::ip::multicast::enable_loopback(config.loopback));
+    m_socket.non_blocking(true);
+
+    if (config.heartbeatInterval.count() > 0)
+    {
+        m_heartbeatThread = std::thread([this]
+                                        {
+                                            std::unique_lock<std::mutex> lock(m_heartbeatMutex);
+                                            while (!m_heartbeatWake.wait_for(lock, m_config.heartbeatInterval,
+                                                                             [this] { return m_stopping; }))
+                                            {
+                                                lock.unlock();
+                                                sendHeartbeats();
+                                                lock.lock();
+                                            }
+                                        });
+    }
+
+    Logger::getInstance().log("Multicast feed publishing to " + config.group + ":" + std::to_string(config.port) +
+                                  " via " + config.interfaceAddress,
+                              Logger::LogLevel::INFO);
+}
+
+MulticastPublisher::~MulticastPublisher()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_heartbeatMutex);
+        m_stopping = true;
+    }
+    m_heartbeatWake.notify_all();
+    if (m_heartbeatThread.joinable())
+    {
+        m_heartbeatThread.join();
+    }
+}
+
+void MulticastPublisher::publish(const std::string &symbol, uint64_t version, bool reset, const MarketDataView &bars)
+{
+    if (symbol.size() > 255)
+    {
+        Logger::getInstance().log("Symbol too long for the multicast feed: " + symbol, Logger::LogLevel::WARNING);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SymbolFeed &feed = m_feeds[symbol];
+    feed.lastVersion = version;
+
+    auto keep = [this, &feed](std::shared_ptr<const std::string> framed)
+    {
+        send(*framed);
+        feed.recent.push_back(std::move(framed));
+        if (feed.recent.size() > m_config.retransmitDepth)
+        {
+            feed.recent.pop_front();
+        }
+    };
+
+    if (reset)
+    {
+        keep(encodeDatagram(symbol, MulticastFeed::FLAG_RESET, feed.nextSequence++, version, MarketDataView()));
+        return;
+    }
+
+    const size_t barsPerDatagram =
+        (MulticastFeed::MAX_DATAGRAM - MulticastFeed::HEADER_SIZE - paddedSymbolLength(symbol.size())) / sizeof(WireRecord);
+    for (size_t first = 0; first < bars.size(); first += barsPerDatagram)
+    {
+        keep(encodeDatagram(symbol, 0, feed.nextSequence++, version, bars.slice(first, barsPerDatagram)));
+    }
+}
+
+ServerResponse MulticastPublisher::retransmit(const std::string &symbol, uint64_t from, uint64_t to)
+{
+    ServerResponse response;
+    size_t count = 0;
+    size_t bytes = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_feeds.find(symbol);
+        if (it != m_feeds.end())
+        {
+            const SymbolFeed &feed = it->second;
+            uint64_t oldest = feed.nextSequence - feed.recent.size();
+            for (uint64_t sequence = std::max(from, oldest); sequence <= to && sequence < feed.nextSequence; ++sequence)
+            {
+                // The buffered strings are shared, nothing is copied into the reply
+                const auto &framed = feed.recent[sequence - oldest];
+                response.buffers.push_back(net::buffer(*framed));
+                response.owners.push_back(framed);
+                bytes += framed->size();
+                ++count;
+            }
+        }
+        m_stats.retransmitted += count;
+    }
+
+    ServerResponse header = ServerResponse::fromString("RETX:" + symbol + ":" + std::to_string(count) + ":" +
+                                                       std::to_string(bytes) + "\n");
+    header.append(std::move(response));
+    return header;
+}
+
+void MulticastPublisher::sendHeartbeats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &[symbol, feed] : m_feeds)
+    {
+        send(*encodeDatagram(symbol, MulticastFeed::FLAG_HEARTBEAT, feed.nextSequence - 1, feed.lastVersion,
+                             MarketDataView()));
+        ++m_stats.heartbeats;
+    }
+}
+
+MulticastPublisherStats MulticastPublisher::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void MulticastPublisher::send(const std::string &framed)
+{
+    boost::system::error_code ec;
+    size_t sent = m_socket.send_to(net::buffer(framed.data() + LENGTH_PREFIX, framed.size() - LENGTH_PREFIX),
+                                   m_destination, 0, ec);
+    if (ec)
+    {
+        ++m_stats.dropped;
+        return;
+    }
+    ++m_stats.datagrams;
+    m_stats.bytes += sent;
+}
+
+FeedReceiver::FeedReceiver(const MulticastConfig &config, const std::string &serverAddress, unsigned short serverPort,
+                           UpdateCallback onUpdate)
+    : m_config(config), m_serverAddress(serverAddress), m_serverPort(serverPort), m_onUpdate(std::move(onUpdate)),
+      m_socket(m_ioc), m_resolver(m_ioc), m_retransmitSocket(m_ioc)
+{
+}
+
+void FeedReceiver::run()
+{
+    net::ip::address_v4 group = net::ip::make_address_v4(m_config.group);
+    net::ip::address_v4 interfaceAddress = net::ip::make_address_v4(m_config.interfaceAddress);
+
+    // Bound to the port on every address, so several receivers on one host each get every datagram
+    m_socket.open(udp::v4());
+    m_socket.set_option(udp::socket::reuse_address(true));
+    m_socket.bind(udp::endpoint(net::ip::address_v4::any(), m_config.port));
+    m_socket.set_option(net::ip::multicast::join_group(group, interfaceAddress));
+
+    std::vector<char> datagram(65536);
+    udp::endpoint sender;
+    std::function<void()> receive = [&]()
+    {
+        m_socket.async_receive_from(net::buffer(datagram), sender,
+                                    [&](const boost::system::error_code &ec, size_t size)
+                                    {
+                                        if (ec)
+                                        {
+                                            return;
+                                        }
+                                        onDatagram(datagram.data(), size);
+                                        receive();
+                                    });
+    };
+    receive();
+
+    if (!m_stopping)
+    {
+        m_ioc.run();
+    }
+
+    boost::system::error_code ignored;
+    m_socket.close(ignored);
+    m_retransmitSocket.close(ignored);
+}
+
+void FeedReceiver::serve()
+{
+    auto work = net::make_work_guard(m_ioc);
+    if (!m_stopping)
+    {
+        m_ioc.run();
+    }
+
+    boost::system::error_code ignored;
+    m_retransmitSocket.close(ignored);
+}
+
+void FeedReceiver::stop()
+{
+    m_stopping = true;
+    m_ioc.stop();
+}
+
+void FeedReceiver::post(const char *data, size_t size)
+{
+    net::post(m_ioc, [this, datagram = std::string(data, size)]
+              { onDatagram(datagram.data(), datagram.size()); });
+}
+
+void FeedReceiver::onDatagram(const char *data, size_t size)
+{
+    ++m_stats.datagrams;
+    MulticastFeed::Packet packet;
+    if (!MulticastFeed::decode(data, size, packet))
+    {
+        ++m_stats.malformed;
+        return;
+    }
+
+    std::string symbol = packet.symbol;
+    SymbolState &state = m_symbols[symbol];
+    if (packet.flags & MulticastFeed::FLAG_HEARTBEAT)
+    {
+        // The last datagram of a burst has no successor to reveal its loss, the heartbeat does
+        ++m_stats.heartbeats;
+        if (state.next != 0 && packet.sequence >= state.next && state.pending.count(packet.sequence) == 0)
+        {
+            recover(symbol, state, state.next, packet.sequence);
+        }
+        return;
+    }
+
+    if (state.next == 0)
+    {
+        state.next = packet.sequence;
+    }
+    if (packet.sequence < state.next || state.pending.count(packet.sequence) != 0)
+    {
+        ++m_stats.duplicates;
+        return;
+    }
+
+    uint64_t sequence = packet.sequence;
+    state.pending.emplace(sequence, Pending{std::move(packet), false});
+    if (sequence > state.next)
+    {
+        recover(symbol, state, state.next, sequence - 1);
+        return;
+    }
+    drain(symbol, state, 0);
+}
+
+void FeedReceiver::recover(const std::string &symbol, SymbolState &state, uint64_t from, uint64_t to)
+{
+    // Datagrams go on arriving while a RETX is out, so a later gap or heartbeat only asks for what is
+    // past the last one requested and not already pending
+    from = std::max(from, state.requested + 1);
+    for (auto it = state.pending.lower_bound(from); it != state.pending.end() && it->first == from && from <= to; ++it)
+    {
+        ++from;
+    }
+    if (from > to)
+    {
+        return;
+    }
+    state.requested = to;
+    ++m_stats.gaps;
+    m_retransmits.push_back(Retransmit{symbol, from, to});
+    if (m_retransmits.size() == 1)
+    {
+        sendRetransmit();
+    }
+}
+
+void FeedReceiver::drain(const std::string &symbol, SymbolState &state, uint64_t giveUpThrough)
+{
+    while (true)
+    {
+        auto it = state.pending.find(state.next);
+        if (it != state.pending.end())
+        {
+            deliver(it->second.packet, it->second.recovered);
+            state.pending.erase(it);
+            ++state.next;
+            continue;
+        }
+        if (state.next > giveUpThrough)
+        {
+            return;
+        }
+
+        // Neither received nor retransmitted, the receiver's copy of the symbol can no longer be trusted
+        uint64_t resume = giveUpThrough + 1;
+        if (!state.pending.empty())
+        {
+            resume = std::min(resume, state.pending.begin()->first);
+        }
+        m_stats.lost += resume - state.next;
+        Logger::getInstance().log("Multicast feed lost " + symbol + " datagrams " + std::to_string(state.next) + " to " +
+                                      std::to_string(resume - 1),
+                                  Logger::LogLevel::WARNING);
+        FeedUpdate lost;
+        lost.symbol = symbol;
+        lost.sequence = resume - 1;
+        lost.reset = true;
+        m_onUpdate(lost);
+        state.next = resume;
+    }
+}
+
+void FeedReceiver::deliver(MulticastFeed::Packet &packet, bool recovered)
+{
+    FeedUpdate update;
+    update.symbol = std::move(packet.symbol);
+    update.sequence = packet.sequence;
+    update.version = packet.version;
+    update.reset = (packet.flags & MulticastFeed::FLAG_RESET) != 0;
+    update.recovered = recovered;
+    update.bars = std::move(packet.bars);
+    m_onUpdate(update);
+}
+
+void FeedReceiver::sendRetransmit()
+{
+    const Retransmit &front = m_retransmits.front();
+    Protocol::Request request;
+    request.command = Protocol::Command::Retx;
+    request.symbols.push_back(front.symbol);
+    request.from = front.from;
+    // A RETX asks for a bounded range, a longer gap is recovered up to that bound and the rest counts as lost
+    request.to = std::min(front.to, front.from + Protocol::MAX_RETRANSMIT - 1);
+    m_retransmitLine = Protocol::formatRequest(request);
+
+    if (m_retransmitSocket.is_open())
+    {
+        writeRetransmit();
+        return;
+    }
+    m_resolver.async_resolve(m_serverAddress, std::to_string(m_serverPort),
+                             [this](const boost::system::error_code &ec, const tcp::resolver::results_type &endpoints)
+                             {
+                                 if (ec)
+                                 {
+                                     retransmitFailed(ec.message());
+                                     return;
+                                 }
+                                 net::async_connect(m_retransmitSocket, endpoints,
+                                                    [this](const boost::system::error_code &ec, const tcp::endpoint &)
+                                                    {
+                                                        if (ec)
+                                                        {
+                                                            retransmitFailed(ec.message());
+                                                            return;
+                                                        }
+                                                        m_retransmitBuffer.consume(m_retransmitBuffer.size());
+                                                        writeRetransmit();
+                                                    });
+                             });
+}
+
+void FeedReceiver::writeRetransmit()
+{
+    ++m_stats.retransmitRequests;
+    net::async_write(m_retransmitSocket, net::buffer(m_retransmitLine),
+                     [this](const boost::system::error_code &ec, size_t)
+                     {
+                         if (ec)
+                         {
+                             retransmitFailed(ec.message());
+                             return;
+                         }
+                         net::async_read_until(m_retransmitSocket, m_retransmitBuffer, '\n',
+                                               [this](const boost::system::error_code &ec, size_t length)
+                                               {
+                                                   if (ec)
+                                                   {
+                                                       retransmitFailed(ec.message());
+                                                       return;
+                                                   }
+                                                   onRetransmitHeader(length);
+                                               });
+                     });
+}
+
+void FeedReceiver::onRetransmitHeader(size_t length)
+{
+    std::string header(net::buffers_begin(m_retransmitBuffer.data()),
+                       net::buffers_begin(m_retransmitBuffer.data()) + length);
+    m_retransmitBuffer.consume(length);
+    const std::string &symbol = m_retransmits.front().symbol;
+    if (header.rfind("RETX:", 0) != 0)
+    {
+        Logger::getInstance().log("Retransmit of " + symbol + " refused: " + header, Logger::LogLevel::ERROR);
+        finishRetransmit({});
+        return;
+    }
+
+    // "RETX:<symbol>:<count>:<bytes>\n"
+    size_t bytesColon = header.rfind(':');
+    size_t bytes = 0;
+    auto parsed = std::from_chars(header.data() + bytesColon + 1, header.data() + header.size() - 1, bytes);
+    size_t buffered = 0;
+    if (parsed.ec != std::errc() || parsed.ptr != header.data() + header.size() - 1 ||
+        !WireDecoder::startBody(m_retransmitBuffer, bytes, MAX_RETRANSMIT_BYTES, m_retransmitBody, buffered))
+    {
+        // Where the next answer starts is unknown, the connection is dropped and the range given up on
+        Logger::getInstance().log("Invalid retransmit header for " + symbol + ": " + header, Logger::LogLevel::ERROR);
+        ++m_stats.malformed;
+        boost::system::error_code ignored;
+        m_retransmitSocket.close(ignored);
+        finishRetransmit({});
+        return;
+    }
+    if (buffered == bytes)
+    {
+        onRetransmitBody();
+        return;
+    }
+    net::async_read(m_retransmitSocket, net::buffer(m_retransmitBody.data() + buffered, bytes - buffered),
+                    [this](const boost::system::error_code &ec, size_t)
+                    {
+                        if (ec)
+                        {
+                            retransmitFailed(ec.message());
+                            return;
+                        }
+                        onRetransmitBody();
+                    });
+}
+
+void FeedReceiver::onRetransmitBody()
+{
+    const std::string &body = m_retransmitBody;
+    std::vector<MulticastFeed::Packet> packets;
+    for (size_t offset = 0; offset + LENGTH_PREFIX <= body.size();)
+    {
+        size_t size = get<uint16_t>(body.data() + offset);
+        offset += LENGTH_PREFIX;
+        MulticastFeed::Packet packet;
+        if (offset + size > body.size() || !MulticastFeed::decode(body.data() + offset, size, packet))
+        {
+            ++m_stats.malformed;
+            break;
+        }
+        packets.push_back(std::move(packet));
+        offset += size;
+    }
+    finishRetransmit(std::move(packets));
+}
+
+void FeedReceiver::retransmitFailed(const std::string &error)
+{
+    Retransmit &front = m_retransmits.front();
+    Logger::getInstance().log("Retransmit request for " + front.symbol + " failed: " + error, Logger::LogLevel::WARNING);
+    boost::system::error_code ignored;
+    m_retransmitSocket.close(ignored);
+    if (++front.attempt < 2)
+    {
+        sendRetransmit();
+        return;
+    }
+    finishRetransmit({});
+}
+
+void FeedReceiver::finishRetransmit(std::vector<MulticastFeed::Packet> packets)
+{
+    Retransmit done = std::move(m_retransmits.front());
+    m_retransmits.pop_front();
+    SymbolState &state = m_symbols[done.symbol];
+    for (auto &packet : packets)
+    {
+        uint64_t sequence = packet.sequence;
+        if (sequence >= state.next && state.pending.count(sequence) == 0 &&
+            !(packet.flags & MulticastFeed::FLAG_HEARTBEAT))
+        {
+            state.pending.emplace(sequence, Pending{std::move(packet), true});
+            ++m_stats.recovered;
+        }
+    }
+    drain(done.symbol, state, done.to);
+
+    if (!m_retransmits.empty())
+    {
+        sendRetransmit();
+    }
+}
@@ -0,0 +1,413 @@
+#include "Protocol.hpp"
+#include <charconv>
+#include "Timestamp.hpp"
+
+namespace Protocol
+{
+    namespace
+    {
+        // Next whitespace separated token of line, starting at pos
+        std::string_view nextToken(std::string_view line, size_t &pos)
+        {
+            size_t start = line.find_first_not_of(" \t\r\n", pos);
+            if (start == std::string_view::npos)
+            {
+                pos = line.size();
+                return {};
+            }
+            size_t end = line.find_first_of(" \t\r\n", start);
+            end = end == std::string_view::npos ? line.size() : end;
+            pos = end;
+            return line.substr(start, end - start);
+        }
+
+        constexpr unsigned TIMESTAMP_BIT = 1u << static_cast<unsigned>(Column::Timestamp);
+
+        // Operators of a condition, two character ones first so "<=" is not read as "<"
+        constexpr struct
+        {
+            std::string_view text;
+            Analytics::Compare op;
+        } OPERATORS[] = {{"<=", Analytics::Compare::LessEqual}, {">=", Analytics::Compare::GreaterEqual},
+                         {"!=", Analytics::Compare::NotEqual},  {"<", Analytics::Compare::Less},
+                         {">", Analytics::Compare::Greater},    {"=", Analytics::Compare::Equal}};
+
+        std::string_view operatorText(Analytics::Compare op)
+        {
+            for (const auto &entry : OPERATORS)
+            {
+                if (entry.op == op)
+                {
+                    return entry.text;
+                }
+            }
+            return "=";
+        }
+
+        // Next comma separated item of list, starting at pos
+        std::string_view nextItem(std::string_view list, size_t &pos)
+        {
+            size_t end = list.find(',', pos);
+            end = end == std::string_view::npos ? list.size() : end;
+            std::string_view item = list.substr(pos, end - pos);
+            pos = end + 1;
+            return item;
+        }
+
+        bool parseCount(std::string_view value, size_t &count)
+        {
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), count);
+            return ec == std::errc() && end == value.data() + value.size() && count != 0;
+        }
+
+        bool parseCondition(std::string_view text, Predicate &predicate, std::string &error)
+        {
+            size_t at = text.find_first_of("<>=!");
+            if (at == std::string_view::npos)
+            {
+                error = "Expected <column><op><value>, got " + std::string(text);
+                return false;
+            }
+            if (!WireEncoder::parseColumn(text.substr(0, at), predicate.column))
+            {
+                error = "Unknown column " + std::string(text.substr(0, at));
+                return false;
+            }
+            std::string_view rest = text.substr(at);
+            bool found = false;
+            for (const auto &entry : OPERATORS)
+            {
+                if (rest.substr(0, entry.text.size()) == entry.text)
+                {
+                    predicate.op = entry.op;
+                    rest.remove_prefix(entry.text.size());
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+            {
+                error = "Unknown operator in " + std::string(text);
+                return false;
+            }
+
+            if (predicate.column == Column::Timestamp)
+            {
+                if (predicate.op == Analytics::Compare::NotEqual)
+                {
+                    error = "timestamp takes < <= > >= = only";
+                    return false;
+                }
+                if (!Timestamp::parse(rest, predicate.time))
+                {
+                    error = "Invalid timestamp " + std::string(rest);
+                    return false;
+                }
+                return true;
+            }
+            auto [end, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), predicate.value);
+            if (rest.empty() || ec != std::errc() || end != rest.data() + rest.size())
+            {
+                error = "Invalid value in " + std::string(text);
+                return false;
+            }
+            return true;
+        }
+
+        bool parseOption(std::string_view token, Request &request, std::string &error)
+        {
+            size_t equals = token.find('=');
+            if (equals == std::string_view::npos)
+            {
+                error = "Expected OPTION=VALUE, got " + std::string(token);
+                return false;
+            }
+
+            std::string_view name = token.substr(0, equals);
+            std::string_view value = token.substr(equals + 1);
+            if (name == "FORMAT")
+            {
+                if (!WireEncoder::parseFormat(value, request.format))
+                {
+                    error = "Unsupported format " + std::string(value);
+                    return false;
+                }
+                return true;
+            }
+            if (name == "FROM" || name == "TO")
+            {
+                if (request.command != Command::Retx)
+                {
+                    error = "FROM and TO only apply to RETX";
+                    return false;
+                }
+                uint64_t &sequence = name == "FROM" ? request.from : request.to;
+                auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), sequence);
+                if (ec != std::errc() || end != value.data() + value.size())
+                {
+                    error = "Invalid sequence " + std::string(value);
+                    return false;
+                }
+                return true;
+            }
+
+            if (name == "SINCE")
+            {
+                auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), request.since);
+                if (ec != std::errc() || end != value.data() + value.size())
+                {
+                    error = "Invalid version " + std::string(value);
+                    return false;
+                }
+                request.conditional = true;
+                return true;
+            }
+
+            if (name == "WHERE")
+            {
+                for (size_t pos = 0; pos <= value.size();)
+                {
+                    if (request.query.where.size() == MAX_PREDICATES)
+                    {
+                        error = "More than " + std::to_string(MAX_PREDICATES) + " conditions";
+                        return false;
+                    }
+                    Predicate predicate;
+                    if (!parseCondition(nextItem(value, pos), predicate, error))
+                    {
+                        return false;
+                    }
+                    request.query.where.push_back(predicate);
+                }
+                return true;
+            }
+            if (name == "COLUMNS")
+            {
+                unsigned columns = TIMESTAMP_BIT;
+                for (size_t pos = 0; pos <= value.size();)
+                {
+                    std::string_view item = nextItem(value, pos);
+                    Column column;
+                    if (!WireEncoder::parseColumn(item, column))
+                    {
+                        error = "Unknown column " + std::string(item);
+                        return false;
+                    }
+                    columns |= 1u << static_cast<unsigned>(column);
+                }
+                request.query.columns = columns;
+                return true;
+            }
+            if (name == "EVERY" || name == "LIMIT")
+            {
+                if (!parseCount(value, name == "EVERY" ? request.query.every : request.query.limit))
+                {
+                    error = "Invalid " + std::string(name == "EVERY" ? "step " : "limit ") + std::string(value);
+                    return false;
+                }
+                return true;
+            }
+
+            error = "Unknown option " + std::string(name);
+            return false;
+        }
+    }
+
+    bool parseRequest(std::string_view line, Request &request, std::string &error)
+    {
+        request = Request();
+        size_t pos = 0;
+
+        std::string_view command = nextToken(line, pos);
+        if (command == "GET")
+        {
+            request.command = Command::Get;
+        }
+        else if (command == "MGET")
+        {
+            request.command = Command::MGet;
+        }
+        else if (command == "SUB")
+        {
+            request.command = Command::Sub;
+        }
+        else if (command == "UNSUB")
+        {
+            request.command = Command::Unsub;
+        }
+        else if (command == "RETX")
+        {
+            request.command = Command::Retx;
+        }
+        else if (command == "QUIT")
+        {
+            request.command = Command::Quit;
+            return true;
+        }
+        else
+        {
+            error = "Unknown command";
+            return false;
+        }
+
+        for (std::string_view token = nextToken(line, pos); !token.empty(); token = nextToken(line, pos))
+        {
+            if (token.find('=') != std::string_view::npos)
+            {
+                if (!parseOption(token, request, error))
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            if (request.command != Command::MGet && !request.symbols.empty())
+            {
+                error = std::string(command) + " takes one symbol, use MGET for several";
+                return false;
+            }
+            if (request.symbols.size() == MAX_BATCH_SYMBOLS)
+            {
+                error = "More than " + std::to_string(MAX_BATCH_SYMBOLS) + " symbols";
+                return false;
+            }
+            request.symbols.emplace_back(token);
+        }
+
+        if (request.symbols.empty())
+        {
+            error = "Missing symbol";
+            return false;
+        }
+        if (request.conditional && request.command != Command::Get)
+        {
+            error = "SINCE only applies to GET";
+            return false;
+        }
+        if (!request.query.empty())
+        {
+            if (request.command != Command::Get && request.command != Command::MGet)
+            {
+                error = "WHERE, COLUMNS, EVERY and LIMIT only apply to GET and MGET";
+                return false;
+            }
+            if (request.conditional)
+            {
+                error = "SINCE cannot be combined with WHERE, COLUMNS, EVERY or LIMIT";
+                return false;
+            }
+            if (request.query.columns != ALL_COLUMNS && request.format != WireFormat::CSV)
+            {
+                error = "COLUMNS needs FORMAT=CSV, binary records carry every column";
+                return false;
+            }
+        }
+        if (request.command == Command::Retx)
+        {
+            if (request.from == 0 || request.to < request.from)
+            {
+                error = "RETX needs FROM=<first> TO=<last> with 1 <= first <= last";
+                return false;
+            }
+            if (request.to - request.from >= MAX_RETRANSMIT)
+            {
+                error = "More than " + std::to_string(MAX_RETRANSMIT) + " datagrams";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string formatRequest(const Request &request)
+    {
+        if (request.command == Command::Quit)
+        {
+            return "QUIT\n";
+        }
+
+        std::string line;
+        switch (request.command)
+        {
+        case Command::MGet:
+            line = "MGET";
+            break;
+        case Command::Sub:
+            line = "SUB";
+            break;
+        case Command::Unsub:
+            line = "UNSUB";
+            break;
+        case Command::Retx:
+            line = "RETX";
+            break;
+        default:
+            line = "GET";
+            break;
+        }
+        for (const auto &symbol : request.symbols)
+        {
+            line += ' ';
+            line += symbol;
+        }
+
+        // CSV is the default, leaving it out keeps requests readable by older servers
+        if (request.format != WireFormat::CSV)
+        {
+            line += " FORMAT=";
+            line += WireEncoder::formatName(request.format);
+        }
+        if (request.command == Command::Retx)
+        {
+            line += " FROM=" + std::to_string(request.from) + " TO=" + std::to_string(request.to);
+        }
+        if (request.conditional)
+        {
+            line += " SINCE=" + std::to_string(request.since);
+        }
+
+        const Query &query = request.query;
+        for (size_t i = 0; i < query.where.size(); ++i)
+        {
+            const Predicate &predicate = query.where[i];
+            line += i == 0 ? " WHERE=" : ",";
+            line += WireEncoder::columnName(predicate.column);
+            line += operatorText(predicate.op);
+            if (predicate.column == Column::Timestamp)
+            {
+                line += Timestamp::toString(predicate.time);
+            }
+            else
+            {
+                char number[32];
+                line.append(number, std::to_chars(number, number + sizeof(number), predicate.value).ptr);
+            }
+        }
+        if (query.columns != ALL_COLUMNS)
+        {
+            std::string names;
+            for (unsigned c = 1; c < static_cast<unsigned>(Column::Count); ++c)
+            {
+                if (query.columns & (1u << c))
+                {
+                    names += (names.empty() ? "" : ",") + std::string(WireEncoder::columnName(static_cast<Column>(c)));
+                }
+            }
+            line += " COLUMNS=" + (names.empty() ? std::string(WireEncoder::columnName(Column::Timestamp)) : names);
+        }
+        if (query.every != 1)
+        {
+            line += " EVERY=" + std::to_string(query.every);
+        }
+        if (query.limit != 0)
+        {
+            line += " LIMIT=" + std::to_string(query.limit);
+        }
+        line += '\n';
+        return line;
+    }
+
+    std::string batchHeader(size_t count)
+    {
+        return "BATCH:" + std::to_string(count) + "\n";
+    }
+}
@@ -0,0 +1,61 @@
+#include "RateLimiter.hpp"
+#include <algorithm>
+#include <thread>
+
+TokenBucket::TokenBucket(double ratePerSecond, size_t burst)
+    : m_rate(ratePerSecond), m_capacity(static_cast<double>(std::max<size_t>(burst, 1))),
+      m_tokens(m_capacity), m_lastRefill(Clock::now())
+{
+}
+
+void TokenBucket::acquire()
+{
+    if (m_rate <= 0.0)
+    {
+        return;
+    }
+
+    while (true)
+    {
+        Clock::duration wait;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Clock::time_point now = Clock::now();
+            refill(now);
+            if (m_tokens >= 1.0)
+            {
+                m_tokens -= 1.0;
+                return;
+            }
+
+            // Sleep just long enough for the missing fraction of a token, then compete again
+            wait = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>((1.0 - m_tokens) / m_rate));
+        }
+        std::this_thread::sleep_for(wait);
+    }
+}
+
+bool TokenBucket::tryAcquire()
+{
+    if (m_rate <= 0.0)
+    {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    refill(Clock::now());
+    if (m_tokens >= 1.0)
+    {
+        m_tokens -= 1.0;
+        return true;
+    }
+    return false;
+}
+
+void TokenBucket::refill(Clock::time_point now)
+{
+    double elapsed = std::chrono::duration<double>(now - m_lastRefill).count();
+    m_tokens = std::min(m_capacity, m_tokens + elapsed * m_rate);
+    m_lastRefill = now;
+}
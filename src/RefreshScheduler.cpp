@@ -0,0 +1,69 @@
+#include "RefreshScheduler.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+RefreshScheduler::RefreshScheduler(size_t maxConcurrent, double requestsPerMinute, size_t burst)
+    : m_maxConcurrent(std::max<size_t>(maxConcurrent, 1)), m_limiter(requestsPerMinute / 60.0, burst)
+{
+}
+
+RefreshCycleReport RefreshScheduler::runCycle(const std::vector<std::string> &symbols, const RefreshFunction &refresh)
+{
+    using Clock = std::chrono::steady_clock;
+
+    RefreshCycleReport report;
+    report.symbols = symbols.size();
+    Clock::time_point cycleStart = Clock::now();
+
+    std::atomic<size_t> next{0};
+    std::mutex reportMutex;
+
+    // Workers pull the next symbol as soon as they are free, a slow ticker never holds up the rest
+    auto worker = [&]()
+    {
+        size_t index;
+        while ((index = next.fetch_add(1)) < symbols.size())
+        {
+            Clock::time_point waitStart = Clock::now();
+            m_limiter.acquire();
+            Clock::time_point fetchStart = Clock::now();
+
+            bool ok = false;
+            try
+            {
+                ok = refresh(symbols[index]);
+            }
+            catch (const std::exception &e)
+            {
+                Logger::getInstance().log("Refresh of " + symbols[index] + " failed: " + e.what(),
+                                          Logger::LogLevel::ERROR);
+            }
+
+            Clock::time_point fetchEnd = Clock::now();
+            std::lock_guard<std::mutex> lock(reportMutex);
+            ++(ok ? report.succeeded : report.failed);
+            report.throttledMs += std::chrono::duration<double, std::milli>(fetchStart - waitStart).count();
+            report.slowestMs = std::max(report.slowestMs,
+                                        std::chrono::duration<double, std::milli>(fetchEnd - fetchStart).count());
+        }
+    };
+
+    size_t workerCount = std::min(m_maxConcurrent, symbols.size());
+    std::vector<std::thread> workers;
+    workers.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+    for (auto &thread : workers)
+    {
+        thread.join();
+    }
+
+    report.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - cycleStart).count();
+    return report;
+}
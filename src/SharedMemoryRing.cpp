@@ -0,0 +1,241 @@
+#include "SharedMemoryRing.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace SharedMemoryRing;
+
+namespace
+{
+    // shm_open wants a single leading slash
+    std::string objectName(const std::string &name)
+    {
+        return name.empty() || name[0] != '/' ? "/" + name : name;
+    }
+
+    size_t roundUpToPowerOfTwo(size_t value)
+    {
+        size_t power = 1;
+        while (power < value)
+        {
+            power <<= 1;
+        }
+        return power;
+    }
+}
+
+SharedMemoryPublisher::SharedMemoryPublisher(const std::string &name, size_t capacity)
+    : m_name(objectName(name)), m_capacity(roundUpToPowerOfTwo(std::max<size_t>(capacity, 2)))
+{
+    // Start from a fresh object: readers still mapping an old one keep it, and see it never advance
+    ::shm_unlink(m_name.c_str());
+    int fd = ::shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0)
+    {
+        Logger::getInstance().log("Cannot create shared memory " + m_name + ": " + std::strerror(errno),
+                                  Logger::LogLevel::ERROR);
+        return;
+    }
+
+    m_mappedSize = sizeof(Header) + m_capacity * sizeof(Slot);
+    if (::ftruncate(fd, static_cast<off_t>(m_mappedSize)) != 0)
+    {
+        Logger::getInstance().log("Cannot size shared memory " + m_name + ": " + std::strerror(errno),
+                                  Logger::LogLevel::ERROR);
+        ::close(fd);
+        ::shm_unlink(m_name.c_str());
+        return;
+    }
+
+    void *addr = ::mmap(nullptr, m_mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        Logger::getInstance().log("Cannot map shared memory " + m_name + ": " + std::strerror(errno),
+                                  Logger::LogLevel::ERROR);
+        ::shm_unlink(m_name.c_str());
+        return;
+    }
+
+    // A new object is zero filled: every slot sequence and the written count already read 0
+    auto *header = static_cast<Header *>(addr);
+    header->slotSize = static_cast<uint32_t>(sizeof(Slot));
+    header->capacity = m_capacity;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = MAGIC;
+    m_header = header;
+    m_slots = reinterpret_cast<Slot *>(static_cast<char *>(addr) + sizeof(Header));
+
+    Logger::getInstance().log("Shared memory ring " + m_name + " with " + std::to_string(m_capacity) + " slots (" +
+                                  std::to_string(m_mappedSize / 1024) + " KB)",
+                              Logger::LogLevel::INFO);
+}
+
+SharedMemoryPublisher::~SharedMemoryPublisher()
+{
+    if (m_header)
+    {
+        ::munmap(m_header, m_mappedSize);
+        ::shm_unlink(m_name.c_str());
+    }
+}
+
+void SharedMemoryPublisher::publish(const std::string &symbol, uint64_t version, bool reset, const MarketDataView &bars)
+{
+    if (!m_header)
+    {
+        return;
+    }
+    if (symbol.size() > MAX_SYMBOL)
+    {
+        ++m_skipped;
+        return;
+    }
+
+    Record record{};
+    std::memcpy(record.symbol, symbol.data(), symbol.size());
+    record.version = version;
+    if (reset)
+    {
+        record.flags = FLAG_RESET;
+        write(record);
+        ++m_resets;
+        return;
+    }
+
+    for (size_t i = 0; i < bars.size(); ++i)
+    {
+        record.bar = WireRecord{bars.timestamps()[i], bars.open()[i], bars.high()[i], bars.low()[i], bars.close()[i],
+                                bars.volume()[i]};
+        write(record);
+    }
+}
+
+void SharedMemoryPublisher::write(const Record &record)
+{
+    uint64_t position = m_header->written.load(std::memory_order_relaxed);
+    Slot &slot = m_slots[position & (m_capacity - 1)];
+
+    // Odd while the record is incomplete, readers that copied it meanwhile see the sequence change
+    slot.sequence.store(2 * position + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(&slot.record, &record, sizeof(record));
+    slot.sequence.store(2 * (position + 1), std::memory_order_release);
+    m_header->written.store(position + 1, std::memory_order_release);
+}
+
+SharedMemoryPublisherStats SharedMemoryPublisher::stats() const
+{
+    SharedMemoryPublisherStats stats;
+    stats.records = m_header ? m_header->written.load(std::memory_order_relaxed) : 0;
+    stats.resets = m_resets;
+    stats.skipped = m_skipped;
+    return stats;
+}
+
+SharedMemoryReader::SharedMemoryReader(const std::string &name)
+{
+    std::string path = objectName(name);
+    int fd = ::shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        Logger::getInstance().log("Cannot open shared memory " + path + ": " + std::strerror(errno),
+                                  Logger::LogLevel::ERROR);
+        return;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header))
+    {
+        Logger::getInstance().log("Shared memory " + path + " is not a ring", Logger::LogLevel::ERROR);
+        ::close(fd);
+        return;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void *addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        Logger::getInstance().log("Cannot map shared memory " + path + ": " + std::strerror(errno),
+                                  Logger::LogLevel::ERROR);
+        return;
+    }
+
+    auto *header = static_cast<const Header *>(addr);
+    bool valid = header->magic == MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->slotSize == sizeof(Slot) && header->capacity > 0 &&
+            (header->capacity & (header->capacity - 1)) == 0 && size >= sizeof(Header) + header->capacity * sizeof(Slot);
+    if (!valid)
+    {
+        Logger::getInstance().log("Shared memory " + path + " has an unknown layout", Logger::LogLevel::ERROR);
+        ::munmap(addr, size);
+        return;
+    }
+
+    m_mappedSize = size;
+    m_header = header;
+    m_slots = reinterpret_cast<const Slot *>(static_cast<const char *>(addr) + sizeof(Header));
+    m_mask = header->capacity - 1;
+    m_position = header->written.load(std::memory_order_acquire);
+}
+
+SharedMemoryReader::~SharedMemoryReader()
+{
+    if (m_header)
+    {
+        ::munmap(const_cast<Header *>(m_header), m_mappedSize);
+    }
+}
+
+SharedMemoryReader::ReadResult SharedMemoryReader::next(Record &out)
+{
+    if (!m_header)
+    {
+        return ReadResult::Empty;
+    }
+
+    uint64_t written = m_header->written.load(std::memory_order_acquire);
+    if (m_position >= written)
+    {
+        return ReadResult::Empty;
+    }
+
+    const uint64_t capacity = m_mask + 1;
+    if (written - m_position <= capacity)
+    {
+        const Slot &slot = m_slots[m_position & m_mask];
+        const uint64_t complete = 2 * (m_position + 1);
+        if (slot.sequence.load(std::memory_order_acquire) == complete)
+        {
+            std::memcpy(&out, &slot.record, sizeof(out));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == complete)
+            {
+                ++m_position;
+                return ReadResult::Record;
+            }
+        }
+        written = m_header->written.load(std::memory_order_acquire);
+    }
+
+    // The slot was (or is being) overwritten by a later position: resume at the oldest one left
+    uint64_t oldest = written > capacity ? written - capacity : 0;
+    if (oldest > m_position)
+    {
+        m_missed += oldest - m_position;
+        m_position = oldest;
+    }
+    else
+    {
+        ++m_missed;
+        ++m_position;
+    }
+    return ReadResult::Overrun;
+}
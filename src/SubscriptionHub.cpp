@@ -0,0 +1,134 @@
+#include "SubscriptionHub.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <array>
+
+namespace
+{
+    // Header line followed by an encoded payload, both shared with whoever else is sent the same bytes
+    ServerResponse framed(std::shared_ptr<const std::string> header, std::shared_ptr<const EncodedPayload> payload)
+    {
+        ServerResponse response;
+        response.buffers.push_back(boost::asio::buffer(*header));
+        response.buffers.push_back(boost::asio::buffer(payload->bytes().data(), payload->bytes().size()));
+        response.owners.push_back(std::move(header));
+        response.owners.push_back(std::move(payload));
+        return response;
+    }
+
+    std::shared_ptr<const std::string> headerLine(const char *kind, const std::string &symbol, uint64_t version)
+    {
+        return std::make_shared<const std::string>(std::string(kind) + ":" + symbol + ":" + std::to_string(version) + "\n");
+    }
+}
+
+SubscriptionHub::SubscriptionHub(SnapshotSource source) : m_source(std::move(source))
+{
+}
+
+ServerResponse SubscriptionHub::subscribe(const std::string &symbol, WireFormat format,
+                                          const std::shared_ptr<ServerConnection> &connection)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Read under the lock: a version published after this one is pushed, this one and older are not
+    std::shared_ptr<const MarketDataServer::MarketDataSnapshot> snapshot = m_source(symbol);
+    uint64_t version = snapshot ? snapshot->version : 0;
+
+    auto &subscribers = m_subscribers[symbol];
+    auto existing = std::find_if(subscribers.begin(), subscribers.end(), [&connection](const Subscriber &subscriber)
+                                 { return subscriber.connection.lock() == connection; });
+    if (existing != subscribers.end())
+    {
+        existing->format = format;
+        existing->version = version;
+    }
+    else
+    {
+        subscribers.push_back({connection, format, version});
+    }
+
+    // A symbol without data yet still opens the stream, with no bars
+    std::shared_ptr<const EncodedPayload> payload = snapshot ? snapshot->payloads.get(snapshot->view, format)
+                                                             : WireEncoder::encode(MarketDataView(), format);
+    return framed(headerLine("SUBSCRIBED", symbol, version), std::move(payload));
+}
+
+bool SubscriptionHub::unsubscribe(const std::string &symbol, const std::shared_ptr<ServerConnection> &connection)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_subscribers.find(symbol);
+    if (it == m_subscribers.end())
+    {
+        return false;
+    }
+
+    auto &subscribers = it->second;
+    size_t before = subscribers.size();
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [&connection](const Subscriber &subscriber)
+                                     { return subscriber.connection.lock() == connection; }),
+                      subscribers.end());
+    return subscribers.size() != before;
+}
+
+void SubscriptionHub::publish(const MarketDataServer::CacheUpdate &update)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_subscribers.find(update.symbol);
+    if (it == m_subscribers.end() || !update.snapshot)
+    {
+        return;
+    }
+
+    const uint64_t version = update.snapshot->version;
+    auto header = headerLine(update.replaced ? "RESET" : "UPDATE", update.symbol, version);
+
+    // Encoded on first use per format, then shared by every subscriber in that format. An update's encodings live
+    // in its VersionDelta, where conditional GETs for the same version find them
+    std::array<ServerResponse, static_cast<size_t>(WireFormat::Count)> messages;
+    auto &subscribers = it->second;
+    size_t sent = 0;
+    for (auto subscriber = subscribers.begin(); subscriber != subscribers.end();)
+    {
+        std::shared_ptr<ServerConnection> connection = subscriber->connection.lock();
+        if (!connection)
+        {
+            subscriber = subscribers.erase(subscriber);
+            continue;
+        }
+        if (subscriber->version < version)
+        {
+            ServerResponse &message = messages[static_cast<size_t>(subscriber->format)];
+            if (message.buffers.empty())
+            {
+                message = framed(header, update.replaced
+                                             ? update.snapshot->payloads.get(update.snapshot->view, subscriber->format)
+                                             : update.delta->payloads.get(update.changed(), subscriber->format));
+            }
+            connection->send(message);
+            subscriber->version = version;
+            ++sent;
+        }
+        ++subscriber;
+    }
+
+    if (sent > 0)
+    {
+        Logger::getInstance().log("Pushed " + update.symbol + " version " + std::to_string(version) + " (" +
+                                      (update.replaced ? "all" : std::to_string(update.changed().size())) + " bars) to " +
+                                      std::to_string(sent) + " subscribers",
+                                  Logger::LogLevel::INFO);
+    }
+}
+
+size_t SubscriptionHub::subscriberCount(const std::string &symbol) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_subscribers.find(symbol);
+    if (it == m_subscribers.end())
+    {
+        return 0;
+    }
+    return static_cast<size_t>(std::count_if(it->second.begin(), it->second.end(), [](const Subscriber &subscriber)
+                                             { return !subscriber.connection.expired(); }));
+}
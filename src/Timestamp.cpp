@@ -0,0 +1,201 @@
+#include "Timestamp.hpp"
+
+namespace Timestamp
+{
+    namespace
+    {
+        // Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's days_from_civil)
+        int64_t daysFromCivil(int64_t year, unsigned month, unsigned day)
+        {
+            year -= month <= 2;
+            const int64_t era = (year >= 0 ? year : year - 399) / 400;
+            const unsigned yoe = static_cast<unsigned>(year - era * 400);
+            const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+            const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+            return era * 146097 + static_cast<int64_t>(doe) - 719468;
+        }
+
+        // Inverse of daysFromCivil
+        void civilFromDays(int64_t days, int64_t &year, unsigned &month, unsigned &day)
+        {
+            days += 719468;
+            const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+            const unsigned doe = static_cast<unsigned>(days - era * 146097);
+            const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+            const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+            const unsigned mp = (5 * doy + 2) / 153;
+            day = doy - (153 * mp + 2) / 5 + 1;
+            month = mp < 10 ? mp + 3 : mp - 9;
+            year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2);
+        }
+
+        // Days in each month of a common year, February gains one in leap years
+        constexpr unsigned char MONTH_DAYS[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+        // Digit value at a fixed position, anything that is not a digit sets bad instead of branching
+        inline unsigned digit(const char *text, size_t pos, unsigned &bad)
+        {
+            unsigned value = static_cast<unsigned char>(text[pos]) - '0';
+            bad |= value > 9;
+            return value;
+        }
+
+        inline unsigned twoDigits(const char *text, size_t pos, unsigned &bad)
+        {
+            return digit(text, pos, bad) * 10 + digit(text, pos + 1, bad);
+        }
+
+        // "00".."99" back to back, formatting copies two characters per lookup
+        constexpr char DIGIT_PAIRS[] =
+            "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+            "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+        inline char *writeTwo(char *out, unsigned value)
+        {
+            out[0] = DIGIT_PAIRS[value * 2];
+            out[1] = DIGIT_PAIRS[value * 2 + 1];
+            return out + 2;
+        }
+
+        inline char *writeDigits(char *out, uint64_t value, int width)
+        {
+            for (int i = width - 1; i >= 0; --i)
+            {
+                out[i] = static_cast<char>('0' + value % 10);
+                value /= 10;
+            }
+            return out + width;
+        }
+    }
+
+    bool parse(std::string_view text, int64_t &nanos)
+    {
+        // Every supported layout shares the "YYYY-MM-DD" prefix at fixed offsets
+        if (text.size() < 10)
+        {
+            return false;
+        }
+
+        const char *p = text.data();
+        unsigned bad = (p[4] != '-') | (p[7] != '-');
+        unsigned year = twoDigits(p, 0, bad) * 100 + twoDigits(p, 2, bad);
+        unsigned month = twoDigits(p, 5, bad);
+        unsigned day = twoDigits(p, 8, bad);
+        unsigned leap = (year % 4 == 0) & ((year % 100 != 0) | (year % 400 == 0));
+        unsigned monthDays = MONTH_DAYS[(month - 1) % 12] + (leap & (month == 2));
+        bad |= (month - 1 > 11) | (day - 1 >= monthDays);
+
+        int64_t seconds = daysFromCivil(year, month, day) * 86400;
+        int64_t fraction = 0;
+
+        // Date only, as in the daily series
+        if (text.size() > 10)
+        {
+            if (text.size() < 19)
+            {
+                return false;
+            }
+
+            // 'T' (ISO-8601) or ' ' (Alpha Vantage intraday) between date and time
+            bad |= (p[10] != 'T') & (p[10] != ' ');
+            bad |= (p[13] != ':') | (p[16] != ':');
+            unsigned hour = twoDigits(p, 11, bad);
+            unsigned minute = twoDigits(p, 14, bad);
+            unsigned second = twoDigits(p, 17, bad);
+            bad |= (hour > 23) | (minute > 59) | (second > 59);
+            seconds += hour * 3600 + minute * 60 + second;
+
+            if (text.size() > 19)
+            {
+                size_t digits = text.size() - 20;
+                if (p[19] != '.' || digits == 0 || digits > 9)
+                {
+                    return false;
+                }
+
+                // Accumulate up to nine fraction digits, then scale to nanoseconds
+                static constexpr int64_t SCALE[10] = {1000000000, 100000000, 10000000, 1000000, 100000,
+                                                      10000, 1000, 100, 10, 1};
+                for (size_t i = 0; i < digits; ++i)
+                {
+                    fraction = fraction * 10 + digit(p, 20 + i, bad);
+                }
+                fraction *= SCALE[digits];
+            }
+        }
+
+        if (bad != 0)
+        {
+            return false;
+        }
+        nanos = seconds * NANOS_PER_SECOND + fraction;
+        return true;
+    }
+
+    size_t format(int64_t nanos, char *out)
+    {
+        // Floor division so instants before 1970 still get a positive fraction
+        int64_t seconds = nanos / NANOS_PER_SECOND;
+        int64_t fraction = nanos % NANOS_PER_SECOND;
+        if (fraction < 0)
+        {
+            fraction += NANOS_PER_SECOND;
+            --seconds;
+        }
+        int64_t days = seconds / 86400;
+        int64_t secondOfDay = seconds % 86400;
+        if (secondOfDay < 0)
+        {
+            secondOfDay += 86400;
+            --days;
+        }
+
+        int64_t year;
+        unsigned month, day;
+        civilFromDays(days, year, month, day);
+
+        // Years outside 0000-9999 do not fit the fixed layout, clamp rather than overflow the buffer
+        year = year < 0 ? 0 : (year > 9999 ? 9999 : year);
+
+        char *cursor = out;
+        cursor = writeTwo(cursor, static_cast<unsigned>(year / 100));
+        cursor = writeTwo(cursor, static_cast<unsigned>(year % 100));
+        *cursor++ = '-';
+        cursor = writeTwo(cursor, month);
+        *cursor++ = '-';
+        cursor = writeTwo(cursor, day);
+        *cursor++ = 'T';
+        cursor = writeTwo(cursor, static_cast<unsigned>(secondOfDay / 3600));
+        *cursor++ = ':';
+        cursor = writeTwo(cursor, static_cast<unsigned>(secondOfDay / 60 % 60));
+        *cursor++ = ':';
+        cursor = writeTwo(cursor, static_cast<unsigned>(secondOfDay % 60));
+
+        // Shortest exact fraction: milli, micro or nano seconds
+        if (fraction != 0)
+        {
+            *cursor++ = '.';
+            if (fraction % 1000000 == 0)
+            {
+                cursor = writeDigits(cursor, static_cast<uint64_t>(fraction / 1000000), 3);
+            }
+            else if (fraction % 1000 == 0)
+            {
+                cursor = writeDigits(cursor, static_cast<uint64_t>(fraction / 1000), 6);
+            }
+            else
+            {
+                cursor = writeDigits(cursor, static_cast<uint64_t>(fraction), 9);
+            }
+        }
+
+        return static_cast<size_t>(cursor - out);
+    }
+
+    std::string toString(int64_t nanos)
+    {
+        char buffer[MAX_FORMATTED_LENGTH];
+        return std::string(buffer, format(nanos, buffer));
+    }
+}
@@ -0,0 +1,301 @@
+#include "UpstreamClient.hpp"
+#include "HttpBodyStream.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <limits>
+#include <boost/beast.hpp>
+#include <boost/beast/ssl.hpp>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+namespace ssl = net::ssl;
+using tcp = net::ip::tcp;
+
+namespace
+{
+    // Write a keep-alive GET and hand a 200 body to the handler while it is received.
+    // responseStarted turns true once a response header arrived, reusable once the body was read to
+    // the end and the server agreed to keep the connection open
+    template <typename SyncStream>
+    bool exchangeOn(SyncStream &stream, beast::flat_buffer &buffer, const std::string &host,
+                    const std::string &target, const UpstreamClient::BodyHandler &handler,
+                    bool &responseStarted, bool &reusable)
+    {
+        http::request<http::empty_body> req{http::verb::get, target, 11};
+        req.set(http::field::host, host);
+        req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
+        req.keep_alive(true);
+        http::write(stream, req);
+
+        HttpBodyStreambuf<SyncStream> body(stream, buffer);
+        responseStarted = true;
+        std::istream in(&body);
+
+        if (body.status() != 200)
+        {
+            Logger::getInstance().log("Upstream returned HTTP " + std::to_string(body.status()),
+                                      Logger::LogLevel::ERROR);
+            in.ignore(std::numeric_limits<std::streamsize>::max());
+            reusable = body.done() && body.keepAlive();
+            return false;
+        }
+
+        bool ok = handler(in);
+
+        // Parsers stop at the end of the document, eat the rest so the next response starts clean
+        if (ok)
+        {
+            in.ignore(std::numeric_limits<std::streamsize>::max());
+        }
+        reusable = ok && body.done() && body.keepAlive();
+        return ok;
+    }
+}
+
+// Either a TLS stream or a plain socket, plus the read buffer that belongs to the connection
+struct UpstreamClient::Connection
+{
+    std::unique_ptr<ssl::stream<tcp::socket>> tls;
+    std::unique_ptr<tcp::socket> plain;
+    beast::flat_buffer buffer;
+
+    ~Connection()
+    {
+        // Dropped without a close_notify round trip. Mark the TLS shutdown as done, otherwise OpenSSL
+        // flags the session as not resumable and the next handshake is a full one
+        if (tls)
+        {
+            SSL_set_shutdown(tls->native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+        }
+    }
+
+    tcp::socket &socket() { return tls ? tls->next_layer() : *plain; }
+};
+
+UpstreamClient::UpstreamClient(UpstreamConfig config)
+    : m_config(std::move(config)), m_sslContext(ssl::context::tlsv12_client)
+{
+    m_sslContext.set_verify_mode(ssl::verify_none);
+}
+
+UpstreamClient::~UpstreamClient()
+{
+    closeIdle();
+    if (m_session != nullptr)
+    {
+        SSL_SESSION_free(m_session);
+    }
+}
+
+bool UpstreamClient::get(const std::string &target, const BodyHandler &handler)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&start]()
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    // A second attempt is only made when a pooled connection turned out to be closed by the server
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        bool reused = false;
+        bool responseStarted = false;
+        bool reusable = false;
+
+        try
+        {
+            std::unique_ptr<Connection> connection = acquire(reused);
+            bool ok = exchange(*connection, target, handler, responseStarted, reusable);
+            if (reusable)
+            {
+                release(std::move(connection));
+            }
+            record(elapsedMs(), ok);
+            return ok;
+        }
+        catch (const std::exception &e)
+        {
+            if (reused && !responseStarted)
+            {
+                // The rest of the pool is as old as this one, start over on a fresh connection
+                closeIdle();
+                continue;
+            }
+
+            Logger::getInstance().log("Upstream request failed: " + std::string(e.what()),
+                                      Logger::LogLevel::ERROR);
+            break;
+        }
+    }
+
+    record(elapsedMs(), false);
+    return false;
+}
+
+void UpstreamClient::closeIdle()
+{
+    std::vector<std::unique_ptr<Connection>> idle;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        idle.swap(m_idle);
+    }
+
+    for (auto &connection : idle)
+    {
+        boost::system::error_code ec;
+        connection->socket().close(ec);
+    }
+}
+
+UpstreamStats UpstreamClient::stats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::unique_ptr<UpstreamClient::Connection> UpstreamClient::acquire(bool &reused)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_idle.empty())
+        {
+            std::unique_ptr<Connection> connection = std::move(m_idle.back());
+            m_idle.pop_back();
+            ++m_stats.connectionsReused;
+            reused = true;
+            return connection;
+        }
+    }
+
+    reused = false;
+    return connect();
+}
+
+std::unique_ptr<UpstreamClient::Connection> UpstreamClient::connect()
+{
+    auto connection = std::make_unique<Connection>();
+    if (m_config.useTls)
+    {
+        connection->tls = std::make_unique<ssl::stream<tcp::socket>>(m_ioc, m_sslContext);
+    }
+    else
+    {
+        connection->plain = std::make_unique<tcp::socket>(m_ioc);
+    }
+
+    try
+    {
+        net::connect(connection->socket(), resolve());
+    }
+    catch (const std::exception &)
+    {
+        // The cached address may have gone stale, look it up again next time
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_endpoints = {};
+        throw;
+    }
+    connection->socket().set_option(tcp::no_delay(true));
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.connectionsOpened;
+    }
+
+    if (connection->tls)
+    {
+        SSL *ssl = connection->tls->native_handle();
+        if (!SSL_set_tlsext_host_name(ssl, m_config.host.c_str()))
+        {
+            throw boost::system::system_error(
+                ::ERR_get_error(),
+                boost::asio::error::get_ssl_category());
+        }
+
+        // Offer the last session, the server skips the key exchange if it still knows it
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_session != nullptr)
+            {
+                SSL_set_session(ssl, m_session);
+            }
+        }
+
+        connection->tls->handshake(ssl::stream_base::client);
+
+        SSL_SESSION *session = SSL_get1_session(ssl);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.tlsHandshakes;
+        if (SSL_session_reused(ssl))
+        {
+            ++m_stats.tlsResumed;
+        }
+        if (m_session != nullptr)
+        {
+            SSL_SESSION_free(m_session);
+        }
+        m_session = session;
+    }
+
+    return connection;
+}
+
+void UpstreamClient::release(std::unique_ptr<Connection> connection)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_idle.size() < m_config.maxIdleConnections)
+    {
+        m_idle.push_back(std::move(connection));
+    }
+}
+
+tcp::resolver::results_type UpstreamClient::resolve()
+{
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_endpoints.empty() && now - m_resolvedAt < m_config.resolveTtl)
+        {
+            return m_endpoints;
+        }
+    }
+
+    // Resolve outside the lock, a slow DNS answer must not stall requests on pooled connections
+    tcp::resolver resolver(m_ioc);
+    auto endpoints = resolver.resolve(m_config.host, m_config.port);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_endpoints = endpoints;
+    m_resolvedAt = now;
+    ++m_stats.resolves;
+    return endpoints;
+}
+
+bool UpstreamClient::exchange(Connection &connection, const std::string &target, const BodyHandler &handler,
+                              bool &responseStarted, bool &reusable)
+{
+    if (connection.tls)
+    {
+        return exchangeOn(*connection.tls, connection.buffer, m_config.host, target, handler,
+                          responseStarted, reusable);
+    }
+    return exchangeOn(*connection.plain, connection.buffer, m_config.host, target, handler,
+                      responseStarted, reusable);
+}
+
+void UpstreamClient::record(double latencyMs, bool ok)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.requests;
+    if (!ok)
+    {
+        ++m_stats.failures;
+        return;
+    }
+
+    bool first = m_stats.requests - m_stats.failures == 1;
+    m_stats.totalLatencyMs += latencyMs;
+    m_stats.minLatencyMs = first ? latencyMs : std::min(m_stats.minLatencyMs, latencyMs);
+    m_stats.maxLatencyMs = std::max(m_stats.maxLatencyMs, latencyMs);
+    m_stats.lastLatencyMs = latencyMs;
+}
@@ -0,0 +1,181 @@
+#include "WireDecoder.hpp"
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "Protocol.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace WireDecoder
+{
+    bool parseDataHeader(const std::string &line, WireFormat &format, size_t &rows, size_t &bodySize)
+    {
+        std::string_view text(line);
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r'))
+        {
+            text.remove_suffix(1);
+        }
+        auto number = [](std::string_view digits, size_t &value)
+        {
+            auto result = std::from_chars(digits.data(), digits.data() + digits.size(), value);
+            return !digits.empty() && result.ec == std::errc() && result.ptr == digits.data() + digits.size();
+        };
+
+        // The body is allocated from the header before any of it arrives, so its size is bounded first
+        if (text.substr(0, 10) == "DATA_SIZE:")
+        {
+            format = WireFormat::CSV;
+            rows = 0;
+            return number(text.substr(10), bodySize) && bodySize <= Protocol::MAX_FRAME_BYTES;
+        }
+        if (text.substr(0, 5) == "BIN1:")
+        {
+            format = WireFormat::BIN1;
+            if (!number(text.substr(5), rows) || rows > Protocol::MAX_FRAME_BYTES / sizeof(WireRecord))
+            {
+                return false;
+            }
+            bodySize = rows * sizeof(WireRecord);
+            return true;
+        }
+        if (text.substr(0, 5) == "DDC1:")
+        {
+            format = WireFormat::DDC1;
+            size_t colon = text.find(':', 5);
+            return colon != std::string_view::npos && number(text.substr(5, colon - 5), rows) &&
+                   number(text.substr(colon + 1), bodySize) && bodySize <= Protocol::MAX_FRAME_BYTES;
+        }
+        return false;
+    }
+
+    bool startBody(boost::asio::streambuf &buffer, size_t size, size_t limit, std::string &body, size_t &buffered)
+    {
+        // The size comes from the peer, it is checked before anything is allocated for it
+        if (size > limit)
+        {
+            return false;
+        }
+        body.resize(size);
+        buffered = std::min(size, buffer.size());
+        boost::asio::buffer_copy(boost::asio::buffer(body.data(), buffered), buffer.data());
+        buffer.consume(buffered);
+        return true;
+    }
+
+    bool decodeBody(WireFormat format, char *body, size_t size, size_t rows, MarketDataSeries &out)
+    {
+        if (format == WireFormat::BIN1)
+        {
+            if (size != rows * sizeof(WireRecord))
+            {
+                return false;
+            }
+            // Used in place when the buffer is aligned for records, as heap buffers are
+            if (reinterpret_cast<uintptr_t>(body) % alignof(WireRecord) == 0)
+            {
+                auto *records = reinterpret_cast<WireRecord *>(body);
+                WireEncoder::toHostOrder(records, rows);
+                WireEncoder::decodeRecords(records, rows, out);
+                return true;
+            }
+            std::vector<WireRecord> records(rows);
+            std::memcpy(records.data(), body, size);
+            WireEncoder::toHostOrder(records.data(), rows);
+            WireEncoder::decodeRecords(records.data(), rows, out);
+            return true;
+        }
+
+        if (format == WireFormat::DDC1)
+        {
+            if (!WireEncoder::decodeCompressed(body, size, rows, out))
+            {
+                Logger::getInstance().log("Malformed DDC1 body of " + std::to_string(size) + " bytes",
+                                          Logger::LogLevel::ERROR);
+                return false;
+            }
+            return true;
+        }
+
+        // Parsed in place from the receive buffer, the whole body as one batch moved straight into out
+        DataParserCSV parser(body, size);
+        bool parsed = parser.parseBatches(std::numeric_limits<size_t>::max(), [&out](MarketDataSeries &batch)
+                                          {
+                                              if (out.empty())
+                                              {
+                                                  out = std::move(batch);
+                                              }
+                                              else
+                                              {
+                                                  out.append(batch.view());
+                                              }
+                                              return true;
+                                          });
+
+        // A header line alone is an empty series, not a failure
+        std::string_view text(body, size);
+        size_t newline = text.find('\n');
+        if (!parsed && newline != std::string_view::npos && newline + 1 < size)
+        {
+            Logger::getInstance().log("Failed to parse market data", Logger::LogLevel::ERROR);
+            return false;
+        }
+        return true;
+    }
+
+    bool parseVersionedHeader(const std::string &line, std::string &kind, std::string &symbol, uint64_t &version)
+    {
+        size_t first = line.find(':');
+        size_t last = line.rfind(':');
+        if (first == std::string::npos || last == first)
+        {
+            return false;
+        }
+        kind = line.substr(0, first);
+        symbol = line.substr(first + 1, last - first - 1);
+
+        size_t end = line.find_first_of("\r\n", last + 1);
+        end = end == std::string::npos ? line.size() : end;
+        auto result = std::from_chars(line.data() + last + 1, line.data() + end, version);
+        return result.ec == std::errc() && result.ptr == line.data() + end && end > last + 1;
+    }
+
+    bool parseStreamHeader(const std::string &line, std::string &kind, std::string &symbol, uint64_t &version)
+    {
+        return parseVersionedHeader(line, kind, symbol, version) &&
+               (kind == "SUBSCRIBED" || kind == "UPDATE" || kind == "RESET");
+    }
+
+    void applyChanges(MarketDataSeries &series, const MarketDataView &changed)
+    {
+        // Every lookup is against the bars held before this change, the only part known to be sorted. A
+        // change carries revisions, gap fills and appends together, so a gap fill pushed to the back must
+        // not hide the revision of a later bar from the search
+        const size_t sorted = series.size();
+        bool resort = false;
+        for (size_t i = 0; i < changed.size(); ++i)
+        {
+            MarketDataRow bar = changed[i];
+            const int64_t *timestamps = series.timestamps();
+            const int64_t *end = timestamps + sorted;
+            const int64_t *found = std::lower_bound(timestamps, end, bar.timestamp());
+            if (found != end && *found == bar.timestamp())
+            {
+                series.setValues(static_cast<size_t>(found - timestamps), bar.open(), bar.high(), bar.low(),
+                                 bar.close(), bar.volume());
+                continue;
+            }
+
+            // New bars go to the back and are sorted in once, pushed bars are almost always past the end
+            resort = resort || found != end ||
+                     (series.size() > sorted && series.timestamps()[series.size() - 1] >= bar.timestamp());
+            series.push_back(bar);
+        }
+        if (resort)
+        {
+            series.sortByTime();
+        }
+    }
+}
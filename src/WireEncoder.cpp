@@ -0,0 +1,573 @@
+#include "WireEncoder.hpp"
+#include "Timestamp.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr std::string_view CSV_HEADER = "timestamp,open,high,low,close,volume\n";
+    constexpr std::string_view SIZE_PREFIX = "DATA_SIZE:";
+    constexpr std::string_view BIN1_PREFIX = "BIN1:";
+    constexpr std::string_view DDC1_PREFIX = "DDC1:";
+
+    constexpr bool HOST_IS_LITTLE_ENDIAN = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+    // Prefix, up to two 20 digit numbers and the newline
+    constexpr size_t MAX_SIZE_HEADER_LENGTH = 48;
+
+    // Writes "<prefix><count>\n", or "<prefix><count>:<second>\n", so it ends where the body starts.
+    // Returns the offset of the header
+    size_t placeHeader(std::string &buffer, std::string_view prefix, size_t count, const size_t *second = nullptr)
+    {
+        char header[MAX_SIZE_HEADER_LENGTH];
+        char *end = header;
+        std::memcpy(end, prefix.data(), prefix.size());
+        end += prefix.size();
+        end = std::to_chars(end, end + 20, count).ptr;
+        if (second)
+        {
+            *end++ = ':';
+            end = std::to_chars(end, end + 20, *second).ptr;
+        }
+        *end++ = '\n';
+
+        size_t headerSize = static_cast<size_t>(end - header);
+        size_t offset = MAX_SIZE_HEADER_LENGTH - headerSize;
+        std::memcpy(buffer.data() + offset, header, headerSize);
+        return offset;
+    }
+
+    // Reverse the byte order of an 8 byte value
+    template <typename T>
+    inline T swapped(T value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bits = __builtin_bswap64(bits);
+        std::memcpy(&value, &bits, sizeof(bits));
+        return value;
+    }
+
+    // Shortest text that parses back to the same double
+    inline char *writeDouble(char *out, double value)
+    {
+        return std::to_chars(out, out + 25, value).ptr;
+    }
+
+    // Header line naming the columns of the mask, newline included
+    std::string csvHeader(unsigned columns)
+    {
+        if (columns == ALL_COLUMNS)
+        {
+            return std::string(CSV_HEADER);
+        }
+        std::string header = WireEncoder::columnName(Column::Timestamp);
+        for (unsigned c = 1; c < static_cast<unsigned>(Column::Count); ++c)
+        {
+            if (columns & (1u << c))
+            {
+                header += ',';
+                header += WireEncoder::columnName(static_cast<Column>(c));
+            }
+        }
+        header += '\n';
+        return header;
+    }
+
+    std::shared_ptr<EncodedPayload> encodeCsv(const MarketDataView &view, unsigned columns)
+    {
+        auto payload = std::make_shared<EncodedPayload>();
+        payload->rows = view.size();
+        const std::string header = csvHeader(columns);
+
+        // One allocation for the worst case, shrunk once at the end: rows run well under the worst case and
+        // the payload may stay cached as long as its snapshot
+        payload->buffer.resize(MAX_SIZE_HEADER_LENGTH + header.size() + view.size() * WireEncoder::MAX_CSV_ROW_LENGTH);
+        char *const bodyStart = payload->buffer.data() + MAX_SIZE_HEADER_LENGTH;
+        char *cursor = bodyStart;
+
+        std::memcpy(cursor, header.data(), header.size());
+        cursor += header.size();
+        if (columns == ALL_COLUMNS)
+        {
+            for (size_t i = 0; i < view.size(); ++i)
+            {
+                cursor += WireEncoder::writeCsvRow(view, i, cursor);
+            }
+        }
+        else
+        {
+            // Value columns in wire order, only the selected ones are written
+            const double *selected[5];
+            size_t count = 0;
+            const double *values[5] = {view.open(), view.high(), view.low(), view.close(), view.volume()};
+            for (unsigned c = 1; c < static_cast<unsigned>(Column::Count); ++c)
+            {
+                if (columns & (1u << c))
+                {
+                    selected[count++] = values[c - 1];
+                }
+            }
+            for (size_t i = 0; i < view.size(); ++i)
+            {
+                cursor += Timestamp::format(view.timestamps()[i], cursor);
+                for (size_t k = 0; k < count; ++k)
+                {
+                    *cursor++ = ',';
+                    cursor = writeDouble(cursor, selected[k][i]);
+                }
+                *cursor++ = '\n';
+            }
+        }
+        size_t bodySize = static_cast<size_t>(cursor - bodyStart);
+        payload->buffer.resize(MAX_SIZE_HEADER_LENGTH + bodySize);
+        payload->buffer.shrink_to_fit();
+
+        // Now the size is known, put the header directly in front of the body
+        payload->offset = placeHeader(payload->buffer, SIZE_PREFIX, bodySize);
+        return payload;
+    }
+
+    std::shared_ptr<EncodedPayload> encodeBin1(const MarketDataView &view)
+    {
+        auto payload = std::make_shared<EncodedPayload>();
+        payload->rows = view.size();
+        payload->buffer.resize(MAX_SIZE_HEADER_LENGTH + view.size() * sizeof(WireRecord));
+
+        // Columns are gathered into rows, the receiver uses the records as they arrive
+        char *cursor = payload->buffer.data() + MAX_SIZE_HEADER_LENGTH;
+        for (size_t i = 0; i < view.size(); ++i)
+        {
+            WireRecord record{view.timestamps()[i], view.open()[i], view.high()[i], view.low()[i],
+                              view.close()[i], view.volume()[i]};
+            if (!HOST_IS_LITTLE_ENDIAN)
+            {
+                WireEncoder::toHostOrder(&record, 1);
+            }
+            std::memcpy(cursor, &record, sizeof(record));
+            cursor += sizeof(record);
+        }
+
+        payload->offset = placeHeader(payload->buffer, BIN1_PREFIX, view.size());
+        return payload;
+    }
+
+    constexpr double POW10[WireEncoder::MAX_DDC1_DECIMALS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+    // Below 2^53 every tick count converts to double exactly
+    constexpr double MAX_TICKS = 9007199254740992.0;
+
+    // Varint, zigzag and raw double helpers shared by the DDC1 encoder and decoder
+    inline uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    inline char *writeVarint(char *out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            *out++ = static_cast<char>(value | 0x80);
+            value >>= 7;
+        }
+        *out++ = static_cast<char>(value);
+        return out;
+    }
+
+    inline bool readVarint(const char *&in, const char *end, uint64_t &value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64 && in != end; shift += 7)
+        {
+            uint8_t byte = static_cast<uint8_t>(*in++);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (byte < 0x80)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    inline char *writeRawDouble(char *out, double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        if (!HOST_IS_LITTLE_ENDIAN)
+        {
+            bits = __builtin_bswap64(bits);
+        }
+        std::memcpy(out, &bits, sizeof(bits));
+        return out + sizeof(bits);
+    }
+
+    inline bool readRawDouble(const char *&in, const char *end, double &value)
+    {
+        if (end - in < static_cast<std::ptrdiff_t>(sizeof(value)))
+        {
+            return false;
+        }
+        uint64_t bits;
+        std::memcpy(&bits, in, sizeof(bits));
+        if (!HOST_IS_LITTLE_ENDIAN)
+        {
+            bits = __builtin_bswap64(bits);
+        }
+        std::memcpy(&value, &bits, sizeof(value));
+        in += sizeof(bits);
+        return true;
+    }
+
+    // Ticks of value at decimals, false unless the decoder's ticks / 10^decimals gives value back exactly
+    inline bool toTicks(double value, uint8_t decimals, int64_t &ticks)
+    {
+        ticks = 0;
+        double scaled = value * POW10[decimals];
+        if (!(std::fabs(scaled) < MAX_TICKS))
+        {
+            return false;
+        }
+        ticks = std::llround(scaled);
+        // -0.0 compares equal to the 0.0 it would come back as, keep its sign by sending it raw
+        return static_cast<double>(ticks) / POW10[decimals] == value && (ticks != 0 || !std::signbit(value));
+    }
+
+    // Fewest decimals every value of the columns round trips at, DDC1_RAW if there is none
+    uint8_t chooseDecimals(std::initializer_list<const double *> columns, size_t rows)
+    {
+        uint8_t decimals = 0;
+        int64_t ticks;
+        for (const double *column : columns)
+        {
+            for (size_t i = 0; i < rows; ++i)
+            {
+                while (!toTicks(column[i], decimals, ticks))
+                {
+                    if (++decimals > WireEncoder::MAX_DDC1_DECIMALS)
+                    {
+                        return WireEncoder::DDC1_RAW;
+                    }
+                }
+            }
+        }
+        // A value that fit fewer decimals does at more too, but the encoder relies on it: check once more
+        for (const double *column : columns)
+        {
+            for (size_t i = 0; i < rows; ++i)
+            {
+                if (!toTicks(column[i], decimals, ticks))
+                {
+                    return WireEncoder::DDC1_RAW;
+                }
+            }
+        }
+        return decimals;
+    }
+
+    std::shared_ptr<EncodedPayload> encodeDdc1(const MarketDataView &view)
+    {
+        auto payload = std::make_shared<EncodedPayload>();
+        payload->rows = view.size();
+
+        const uint8_t priceDecimals = chooseDecimals({view.open(), view.high(), view.low(), view.close()}, view.size());
+        const uint8_t volumeDecimals = chooseDecimals({view.volume()}, view.size());
+
+        // Worst case: a 10 byte varint per field, raw doubles are smaller than that
+        payload->buffer.resize(MAX_SIZE_HEADER_LENGTH + 2 + view.size() * 6 * 10);
+        char *const bodyStart = payload->buffer.data() + MAX_SIZE_HEADER_LENGTH;
+        char *cursor = bodyStart;
+        *cursor++ = static_cast<char>(priceDecimals);
+        *cursor++ = static_cast<char>(volumeDecimals);
+
+        // Unsigned arithmetic wraps, the decoder undoes it the same way for any timestamps
+        uint64_t previousTimestamp = 0;
+        uint64_t previousDelta = 0;
+        int64_t previousClose = 0;
+        for (size_t i = 0; i < view.size(); ++i)
+        {
+            uint64_t timestamp = static_cast<uint64_t>(view.timestamps()[i]);
+            uint64_t delta = timestamp - previousTimestamp;
+            cursor = writeVarint(cursor, zigzag(static_cast<int64_t>(delta - previousDelta)));
+            previousTimestamp = timestamp;
+            previousDelta = delta;
+
+            if (priceDecimals == WireEncoder::DDC1_RAW)
+            {
+                cursor = writeRawDouble(cursor, view.close()[i]);
+                cursor = writeRawDouble(cursor, view.open()[i]);
+                cursor = writeRawDouble(cursor, view.high()[i]);
+                cursor = writeRawDouble(cursor, view.low()[i]);
+            }
+            else
+            {
+                int64_t close, open, high, low;
+                toTicks(view.close()[i], priceDecimals, close);
+                toTicks(view.open()[i], priceDecimals, open);
+                toTicks(view.high()[i], priceDecimals, high);
+                toTicks(view.low()[i], priceDecimals, low);
+                cursor = writeVarint(cursor, zigzag(close - previousClose));
+                cursor = writeVarint(cursor, zigzag(open - close));
+                cursor = writeVarint(cursor, zigzag(high - close));
+                cursor = writeVarint(cursor, zigzag(low - close));
+                previousClose = close;
+            }
+
+            if (volumeDecimals == WireEncoder::DDC1_RAW)
+            {
+                cursor = writeRawDouble(cursor, view.volume()[i]);
+            }
+            else
+            {
+                int64_t volume;
+                toTicks(view.volume()[i], volumeDecimals, volume);
+                cursor = writeVarint(cursor, zigzag(volume));
+            }
+        }
+
+        size_t bodySize = static_cast<size_t>(cursor - bodyStart);
+        payload->buffer.resize(MAX_SIZE_HEADER_LENGTH + bodySize);
+        payload->buffer.shrink_to_fit();
+        payload->offset = placeHeader(payload->buffer, DDC1_PREFIX, view.size(), &bodySize);
+        return payload;
+    }
+}
+
+namespace WireEncoder
+{
+    size_t writeCsvRow(const MarketDataView &view, size_t index, char *out)
+    {
+        char *cursor = out;
+        cursor += Timestamp::format(view.timestamps()[index], cursor);
+        *cursor++ = ',';
+        cursor = writeDouble(cursor, view.open()[index]);
+        *cursor++ = ',';
+        cursor = writeDouble(cursor, view.high()[index]);
+        *cursor++ = ',';
+        cursor = writeDouble(cursor, view.low()[index]);
+        *cursor++ = ',';
+        cursor = writeDouble(cursor, view.close()[index]);
+        *cursor++ = ',';
+        cursor = writeDouble(cursor, view.volume()[index]);
+        *cursor++ = '\n';
+        return static_cast<size_t>(cursor - out);
+    }
+
+    std::shared_ptr<const EncodedPayload> encode(const MarketDataView &view, WireFormat format)
+    {
+        switch (format)
+        {
+        case WireFormat::BIN1:
+            return encodeBin1(view);
+        case WireFormat::DDC1:
+            return encodeDdc1(view);
+        case WireFormat::CSV:
+        default:
+            return encodeCsv(view, ALL_COLUMNS);
+        }
+    }
+
+    std::shared_ptr<const EncodedPayload> encodeCsv(const MarketDataView &view, unsigned columns)
+    {
+        return ::encodeCsv(view, columns | 1u << static_cast<unsigned>(Column::Timestamp));
+    }
+
+    const char *columnName(Column column)
+    {
+        switch (column)
+        {
+        case Column::Timestamp:
+            return "timestamp";
+        case Column::Open:
+            return "open";
+        case Column::High:
+            return "high";
+        case Column::Low:
+            return "low";
+        case Column::Close:
+            return "close";
+        case Column::Volume:
+        default:
+            return "volume";
+        }
+    }
+
+    bool parseColumn(std::string_view name, Column &column)
+    {
+        for (size_t i = 0; i < static_cast<size_t>(Column::Count); ++i)
+        {
+            if (name == columnName(static_cast<Column>(i)))
+            {
+                column = static_cast<Column>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *formatName(WireFormat format)
+    {
+        switch (format)
+        {
+        case WireFormat::BIN1:
+            return "BIN1";
+        case WireFormat::DDC1:
+            return "DDC1";
+        case WireFormat::CSV:
+        default:
+            return "CSV";
+        }
+    }
+
+    bool parseFormat(std::string_view name, WireFormat &format)
+    {
+        for (size_t i = 0; i < static_cast<size_t>(WireFormat::Count); ++i)
+        {
+            if (name == formatName(static_cast<WireFormat>(i)))
+            {
+                format = static_cast<WireFormat>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void decodeRecords(const WireRecord *records, size_t count, MarketDataSeries &out)
+    {
+        out.reserve(out.size() + count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const WireRecord &record = records[i];
+            out.push_back(record.timestamp, record.open, record.high, record.low, record.close, record.volume);
+        }
+    }
+
+    void toHostOrder(WireRecord *records, size_t count)
+    {
+        if (HOST_IS_LITTLE_ENDIAN)
+        {
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            WireRecord &record = records[i];
+            record.timestamp = swapped(record.timestamp);
+            record.open = swapped(record.open);
+            record.high = swapped(record.high);
+            record.low = swapped(record.low);
+            record.close = swapped(record.close);
+            record.volume = swapped(record.volume);
+        }
+    }
+
+    bool decodeCompressed(const char *data, size_t size, size_t rows, MarketDataSeries &out)
+    {
+        if (size < 2)
+        {
+            return false;
+        }
+        const uint8_t priceDecimals = static_cast<uint8_t>(data[0]);
+        const uint8_t volumeDecimals = static_cast<uint8_t>(data[1]);
+        if ((priceDecimals > MAX_DDC1_DECIMALS && priceDecimals != DDC1_RAW) ||
+            (volumeDecimals > MAX_DDC1_DECIMALS && volumeDecimals != DDC1_RAW))
+        {
+            return false;
+        }
+        const bool rawPrices = priceDecimals == DDC1_RAW;
+        const bool rawVolume = volumeDecimals == DDC1_RAW;
+        const double priceScale = rawPrices ? 1.0 : POW10[priceDecimals];
+        const double volumeScale = rawVolume ? 1.0 : POW10[volumeDecimals];
+
+        // A bar takes at least a one byte varint per field, or 8 bytes per raw double. Rows are reserved up
+        // front, so a count the body cannot hold is rejected before anything is allocated for it
+        const size_t minBarBytes = 1 + (rawPrices ? 4 * sizeof(double) : 4) + (rawVolume ? sizeof(double) : 1);
+        if (rows > (size - 2) / minBarBytes)
+        {
+            return false;
+        }
+
+        const char *in = data + 2;
+        const char *const end = data + size;
+        const size_t before = out.size();
+        out.reserve(before + rows);
+
+        // Everything accumulates unsigned: a hostile body may overflow the sums, which must wrap, not be UB
+        uint64_t timestamp = 0;
+        uint64_t delta = 0;
+        uint64_t close = 0;
+        for (size_t i = 0; i < rows; ++i)
+        {
+            uint64_t value;
+            if (!readVarint(in, end, value))
+            {
+                break;
+            }
+            delta += static_cast<uint64_t>(unzigzag(value));
+            timestamp += delta;
+
+            double o, h, l, c, v;
+            if (rawPrices)
+            {
+                if (!readRawDouble(in, end, c) || !readRawDouble(in, end, o) || !readRawDouble(in, end, h) ||
+                    !readRawDouble(in, end, l))
+                {
+                    break;
+                }
+            }
+            else
+            {
+                uint64_t closeDelta, open, high, low;
+                if (!readVarint(in, end, closeDelta) || !readVarint(in, end, open) || !readVarint(in, end, high) ||
+                    !readVarint(in, end, low))
+                {
+                    break;
+                }
+                close += static_cast<uint64_t>(unzigzag(closeDelta));
+                c = static_cast<double>(static_cast<int64_t>(close)) / priceScale;
+                o = static_cast<double>(static_cast<int64_t>(close + static_cast<uint64_t>(unzigzag(open)))) / priceScale;
+                h = static_cast<double>(static_cast<int64_t>(close + static_cast<uint64_t>(unzigzag(high)))) / priceScale;
+                l = static_cast<double>(static_cast<int64_t>(close + static_cast<uint64_t>(unzigzag(low)))) / priceScale;
+            }
+
+            if (rawVolume)
+            {
+                if (!readRawDouble(in, end, v))
+                {
+                    break;
+                }
+            }
+            else
+            {
+                if (!readVarint(in, end, value))
+                {
+                    break;
+                }
+                v = static_cast<double>(unzigzag(value)) / volumeScale;
+            }
+            out.push_back(static_cast<int64_t>(timestamp), o, h, l, c, v);
+        }
+
+        // Every row decoded and nothing left over, or the body is not what the header announced
+        if (out.size() != before + rows || in != end)
+        {
+            MarketDataSeries kept;
+            kept.append(out.view().slice(0, before));
+            out = std::move(kept);
+            return false;
+        }
+        return true;
+    }
+}
+
+std::shared_ptr<const EncodedPayload> PayloadCache::get(const MarketDataView &view, WireFormat format) const
+{
+    size_t index = static_cast<size_t>(format);
+    std::call_once(m_once[index], [&]
+                   { m_payloads[index] = WireEncoder::encode(view, format); });
+    return m_payloads[index];
+}
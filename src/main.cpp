@@ -10,6 +10,10 @@ int main(int argc, char *argv[])
 
     // Check if running as client or server
     bool runAsClient = false;
+    WireFormat format = WireFormat::CSV;
+    std::string subscribeSymbol;
+    bool multicast = false;
+    bool sharedMemory = false;
 
     // Parse command line arguments
     for (int i = 1; i < argc; i++)
@@ -19,6 +23,32 @@ int main(int argc, char *argv[])
         {
             runAsClient = true;
         }
+        else if (arg == "--binary" || arg == "-b")
+        {
+            // Client asks for the BIN1 wire format instead of CSV
+            format = WireFormat::BIN1;
+        }
+        else if (arg == "--compressed" || arg == "-z")
+        {
+            // Client asks for the DDC1 compressed wire format
+            format = WireFormat::DDC1;
+        }
+        else if ((arg == "--subscribe" || arg == "-s") && i + 1 < argc)
+        {
+            // Client follows one symbol's pushed updates instead of the interactive menu
+            runAsClient = true;
+            subscribeSymbol = argv[++i];
+        }
+        else if (arg == "--multicast" || arg == "-m")
+        {
+            // Server publishes updates to the multicast group, a client receives them from it
+            multicast = true;
+        }
+        else if (arg == "--shm")
+        {
+            // Server writes updates to a /dev/shm ring, a client on the same host reads them from it
+            sharedMemory = true;
+        }
     }
 
     if (runAsClient)
@@ -31,7 +61,24 @@ int main(int argc, char *argv[])
         int port = MarketDataServer::DEFAULT_PORT;
 
         // Connect to server
-        MarketDataClient::connectToServer(serverAddress, port);
+        if (sharedMemory)
+        {
+            MarketDataClient::followSharedMemory(MarketDataServer::ServerConfig().sharedMemoryName);
+        }
+        else if (multicast)
+        {
+            MulticastConfig feed;
+            feed.interfaceAddress = serverAddress;
+            MarketDataClient::followMulticast(feed, serverAddress, port);
+        }
+        else if (!subscribeSymbol.empty())
+        {
+            MarketDataClient::subscribeToServer(serverAddress, port, subscribeSymbol, format);
+        }
+        else
+        {
+            MarketDataClient::connectToServer(serverAddress, port, format);
+        }
     }
     else
     {
@@ -45,6 +92,9 @@ int main(int argc, char *argv[])
         config.symbols = {"AAPL", "MSFT", "GOOGL"};
         config.useCSV = true;                     // Enable CSV fallback
         config.dataPath = std::string(DATA_FOLDER) +  std::string("/market_data.csv"); // Path to your CSV file
+        config.enableMulticast = multicast;
+        config.multicast.interfaceAddress = "127.0.0.1"; // Feed stays on this host, like the client default
+        config.enableSharedMemory = sharedMemory;
 
         // Start periodic fetching (only once)
         std::thread fetchThread = MarketDataServer::StartPeriodicFetching(config);
@@ -0,0 +1,327 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "Analytics.hpp"
+#include "Logger.hpp"
+#include "MarketDataSeries.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// Analytics kernels on the AVX2 path (when the CPU has it) and the scalar one against naive loops:
+// VWAP, extremes, returns, rolling mean / standard deviation / min / max over every window, select with
+// each comparison, lengths that leave a vector tail, windows of one and of the whole series, a long series
+// crossing the rolling sums' recomputation. Then each kernel timed against the naive loop.
+
+namespace
+{
+    using namespace TestSupport;
+    using Analytics::SimdLevel;
+
+    bool close(double a, double b, double tolerance = 1e-9)
+    {
+        return std::fabs(a - b) <= tolerance * std::max(1.0, std::max(std::fabs(a), std::fabs(b)));
+    }
+
+    bool closeAll(const std::vector<double> &a, const std::vector<double> &b, double tolerance = 1e-9)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (!close(a[i], b[i], tolerance))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The loops the kernels replace, every window recomputed from scratch
+
+    double naiveVwap(const double *price, const double *volume, size_t n)
+    {
+        double notional = 0.0;
+        double traded = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            notional += price[i] * volume[i];
+            traded += volume[i];
+        }
+        return traded != 0.0 ? notional / traded : 0.0;
+    }
+
+    std::vector<double> naiveRolling(const double *values, size_t n, size_t window, int kind)
+    {
+        std::vector<double> out;
+        for (size_t i = 0; i + window <= n; ++i)
+        {
+            double sum = 0.0;
+            double low = values[i];
+            double high = values[i];
+            for (size_t k = i; k < i + window; ++k)
+            {
+                sum += values[k];
+                low = std::min(low, values[k]);
+                high = std::max(high, values[k]);
+            }
+            double mean = sum / window;
+            if (kind == 0)
+            {
+                out.push_back(mean);
+            }
+            else if (kind == 1)
+            {
+                double squares = 0.0;
+                for (size_t k = i; k < i + window; ++k)
+                {
+                    squares += (values[k] - mean) * (values[k] - mean);
+                }
+                out.push_back(std::sqrt(squares / (window - 1)));
+            }
+            else
+            {
+                out.push_back(kind == 2 ? low : high);
+            }
+        }
+        return out;
+    }
+
+    std::vector<SimdLevel> levels()
+    {
+        std::vector<SimdLevel> result = {SimdLevel::Scalar};
+        if (CSVScan::detectSimdLevel() == SimdLevel::AVX2)
+        {
+            result.push_back(SimdLevel::AVX2);
+        }
+        return result;
+    }
+
+    void checkKernels(const MarketDataSeries &series, SimdLevel level)
+    {
+        const std::string name = CSVScan::simdLevelName(level);
+        const size_t n = series.size();
+        const double *closes = series.close();
+
+        check(close(Analytics::vwap(closes, series.volume(), n, level), naiveVwap(closes, series.volume(), n)),
+              name + ": VWAP of the close");
+        std::vector<double> typical(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            typical[i] = (series.high()[i] + series.low()[i] + series.close()[i]) * (1.0 / 3.0);
+        }
+        check(close(Analytics::vwap(series.view(), level), naiveVwap(typical.data(), series.volume(), n)),
+              name + ": VWAP of the typical price");
+        std::vector<double> noVolume(n, 0.0);
+        check(Analytics::vwap(closes, noVolume.data(), n, level) == 0.0, name + ": VWAP without volume is 0");
+
+        Analytics::Extremes range = Analytics::extremes(closes, n, level);
+        check(range.min == *std::min_element(closes, closes + n) && range.max == *std::max_element(closes, closes + n),
+              name + ": extremes");
+        check(std::isnan(Analytics::extremes(closes, 0, level).min), name + ": extremes of nothing are NaN");
+
+        std::vector<double> returns(n - 1);
+        bool returnsOk = Analytics::returns(closes, n, returns.data(), level) == n - 1;
+        for (size_t i = 0; i + 1 < n; ++i)
+        {
+            returnsOk = returnsOk && close(returns[i], closes[i + 1] / closes[i] - 1.0, 1e-12);
+        }
+        check(returnsOk, name + ": returns");
+
+        for (size_t window : {size_t(1), size_t(2), size_t(3), size_t(20), size_t(390), n - 1, n})
+        {
+            const std::string label = name + " window " + std::to_string(window);
+            std::vector<double> out(n - window + 1);
+            check(Analytics::rollingMean(closes, n, window, out.data(), level) == out.size() &&
+                      closeAll(out, naiveRolling(closes, n, window, 0)),
+                  label + ": rolling mean");
+            if (window >= 2)
+            {
+                check(Analytics::rollingStdDev(closes, n, window, out.data(), level) == out.size() &&
+                          closeAll(out, naiveRolling(closes, n, window, 1), 1e-6),
+                      label + ": rolling standard deviation");
+            }
+            check(Analytics::rollingMin(closes, n, window, out.data()) == out.size() &&
+                      out == naiveRolling(closes, n, window, 2),
+                  label + ": rolling min");
+            check(Analytics::rollingMax(closes, n, window, out.data()) == out.size() &&
+                      out == naiveRolling(closes, n, window, 3),
+                  label + ": rolling max");
+        }
+        double unused = 0.0;
+        check(Analytics::rollingMean(closes, n, n + 1, &unused, level) == 0 &&
+                  Analytics::rollingStdDev(closes, n, 1, &unused, level) == 0 &&
+                  Analytics::rollingMax(closes, n, 0, &unused) == 0,
+              name + ": windows that do not fit write nothing");
+
+        double threshold = closes[n / 2];
+        std::vector<size_t> indices(n);
+        for (Analytics::Compare op : {Analytics::Compare::Less, Analytics::Compare::LessEqual,
+                                      Analytics::Compare::Greater, Analytics::Compare::GreaterEqual,
+                                      Analytics::Compare::Equal, Analytics::Compare::NotEqual})
+        {
+            std::vector<size_t> expected;
+            for (size_t i = 0; i < n; ++i)
+            {
+                double v = closes[i];
+                bool match = op == Analytics::Compare::Less           ? v < threshold
+                             : op == Analytics::Compare::LessEqual    ? v <= threshold
+                             : op == Analytics::Compare::Greater      ? v > threshold
+                             : op == Analytics::Compare::GreaterEqual ? v >= threshold
+                             : op == Analytics::Compare::Equal        ? v == threshold
+                                                                      : v != threshold;
+                if (match)
+                {
+                    expected.push_back(i);
+                }
+            }
+            indices.resize(n);
+            indices.resize(Analytics::select(closes, n, op, threshold, indices.data(), level));
+            check(indices == expected, name + ": select, comparison " + std::to_string(static_cast<int>(op)));
+        }
+    }
+
+    // Rolling sums carried across many recomputations stay on the exact values
+    void checkLongSeries(const MarketDataSeries &series, SimdLevel level)
+    {
+        const size_t n = series.size();
+        const size_t window = 50;
+        std::vector<double> mean(n - window + 1);
+        std::vector<double> deviation(n - window + 1);
+        Analytics::rollingMean(series.close(), n, window, mean.data(), level);
+        Analytics::rollingStdDev(series.close(), n, window, deviation.data(), level);
+        bool ok = true;
+        for (size_t i = 0; i < mean.size(); i += 997)
+        {
+            std::vector<double> expectedMean = naiveRolling(series.close() + i, window, window, 0);
+            std::vector<double> expectedDeviation = naiveRolling(series.close() + i, window, window, 1);
+            ok = ok && close(mean[i], expectedMean[0]) && close(deviation[i], expectedDeviation[0], 1e-6);
+        }
+        check(ok, std::string(CSVScan::simdLevelName(level)) + ": long series stays exact");
+    }
+
+    template <typename Work>
+    double bestMs(Work work, int runs = 5)
+    {
+        double best = 1e300;
+        for (int r = 0; r < runs; ++r)
+        {
+            auto start = Clock::now();
+            work();
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void benchmark(const MarketDataSeries &series)
+    {
+        const size_t n = series.size();
+        const size_t window = 20;
+        const double *closes = series.close();
+        std::vector<double> out(n);
+        std::vector<size_t> indices(n);
+        volatile double sink = 0.0;
+        SimdLevel best = CSVScan::detectSimdLevel();
+
+        auto report = [&](const std::string &kernel, double naiveMs, double scalarMs, double simdMs)
+        {
+            std::cout << "  " << kernel << ": naive " << naiveMs << " ms, scalar " << scalarMs << " ms, "
+                      << CSVScan::simdLevelName(best) << " " << simdMs << " ms (" << naiveMs / simdMs << "x)"
+                      << std::endl;
+        };
+
+        std::cout << n << " bars, window " << window << ":" << std::endl;
+        report("VWAP",
+               bestMs([&]
+                      { sink = naiveVwap(closes, series.volume(), n); }),
+               bestMs([&]
+                      { sink = Analytics::vwap(closes, series.volume(), n, SimdLevel::Scalar); }),
+               bestMs([&]
+                      { sink = Analytics::vwap(closes, series.volume(), n, best); }));
+        report("min/max",
+               bestMs([&]
+                      { sink = *std::min_element(closes, closes + n) + *std::max_element(closes, closes + n); }),
+               bestMs([&]
+                      { sink = Analytics::extremes(closes, n, SimdLevel::Scalar).max; }),
+               bestMs([&]
+                      { sink = Analytics::extremes(closes, n, best).max; }));
+        report("returns",
+               bestMs([&]
+                      {
+                          std::vector<double> naive;
+                          for (size_t i = 0; i + 1 < n; ++i)
+                          {
+                              naive.push_back(closes[i + 1] / closes[i] - 1.0);
+                          }
+                          sink = naive.back();
+                      }),
+               bestMs([&]
+                      { sink = Analytics::returns(closes, n, out.data(), SimdLevel::Scalar); }),
+               bestMs([&]
+                      { sink = Analytics::returns(closes, n, out.data(), best); }));
+        report("rolling mean",
+               bestMs([&]
+                      { sink = naiveRolling(closes, n, window, 0).back(); }, 2),
+               bestMs([&]
+                      { sink = Analytics::rollingMean(closes, n, window, out.data(), SimdLevel::Scalar); }),
+               bestMs([&]
+                      { sink = Analytics::rollingMean(closes, n, window, out.data(), best); }));
+        report("rolling std dev",
+               bestMs([&]
+                      { sink = naiveRolling(closes, n, window, 1).back(); }, 2),
+               bestMs([&]
+                      { sink = Analytics::rollingStdDev(closes, n, window, out.data(), SimdLevel::Scalar); }),
+               bestMs([&]
+                      { sink = Analytics::rollingStdDev(closes, n, window, out.data(), best); }));
+        double naiveMaxMs = bestMs([&]
+                                   { sink = naiveRolling(closes, n, window, 3).back(); }, 2);
+        double maxMs = bestMs([&]
+                              { sink = Analytics::rollingMax(closes, n, window, out.data()); });
+        std::cout << "  rolling max: naive " << naiveMaxMs << " ms, van Herk / Gil-Werman " << maxMs << " ms ("
+                  << naiveMaxMs / maxMs << "x)" << std::endl;
+        double threshold = closes[n / 2];
+        report("select close > X",
+               bestMs([&]
+                      {
+                          std::vector<size_t> naive;
+                          for (size_t i = 0; i < n; ++i)
+                          {
+                              if (closes[i] > threshold)
+                              {
+                                  naive.push_back(i);
+                              }
+                          }
+                          sink = static_cast<double>(naive.size());
+                      }),
+               bestMs([&]
+                      {
+                          sink = Analytics::select(closes, n, Analytics::Compare::Greater, threshold, indices.data(),
+                                                   SimdLevel::Scalar);
+                      }),
+               bestMs([&]
+                      {
+                          sink = Analytics::select(closes, n, Analytics::Compare::Greater, threshold, indices.data(),
+                                                   best);
+                      }));
+        (void)sink;
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("analytics_log.txt");
+    MarketDataSeries series = makeSeries(1003, 187.33, 0, 1.0);
+    MarketDataSeries longSeries = makeSeries(200003, 187.33, 0, 1.0);
+    for (SimdLevel level : levels())
+    {
+        checkKernels(series, level);
+        checkLongSeries(longSeries, level);
+    }
+    benchmark(makeSeries(2000000, 187.33, 0, 1.0));
+
+    return finish();
+}
@@ -0,0 +1,315 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "AsyncClient.hpp"
+#include "AsyncServer.hpp"
+#include "Logger.hpp"
+#include "MarketDataClient.hpp"
+#include "MarketDataServer.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// AsyncClient against the market data request handler on a loopback AsyncServer: many requests outstanding
+// on one connection matched to their answers, futures and callbacks, error replies, a subscription kept
+// current while requests go on, and closing with requests in flight. Then pipelined requests against the
+// blocking request / response round trips of the console client.
+
+namespace
+{
+    using namespace TestSupport;
+    using boost::asio::ip::tcp;
+
+    constexpr size_t BARS = 390;
+    constexpr size_t OUTSTANDING = 300;
+    constexpr size_t ROUNDS = 2000;
+
+    bool ready(std::future<ClientResult> &future)
+    {
+        return future.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("async_client_log.txt");
+
+    std::vector<std::string> symbols = {"ACA", "ACB", "ACC"};
+    std::vector<MarketDataSeries> series;
+    for (size_t i = 0; i < symbols.size(); ++i)
+    {
+        series.push_back(makeSeries(BARS, 100.0 * (i + 1)));
+        MarketDataServer::MergeMarketData(symbols[i], series.back());
+    }
+
+    AsyncServer server(MarketDataServer::HandleRequest, 1);
+    unsigned short port = server.listen(0);
+    server.start();
+
+    boost::asio::io_context ioc;
+    auto work = boost::asio::make_work_guard(ioc);
+    std::thread ioThread([&ioc]
+                         { ioc.run(); });
+
+    auto client = AsyncClient::create(ioc);
+    client->connect("127.0.0.1", port).get();
+
+    // Requests issued back to back, every one outstanding before the first answer is read
+    {
+        std::vector<std::future<ClientResult>> gets;
+        std::vector<std::future<ClientResult>> batches;
+        for (size_t i = 0; i < OUTSTANDING; ++i)
+        {
+            WireFormat format = i % 3 == 0 ? WireFormat::BIN1 : i % 3 == 1 ? WireFormat::DDC1 : WireFormat::BIN1;
+            gets.push_back(client->get(symbols[i % symbols.size()], format));
+            if (i % 10 == 0)
+            {
+                batches.push_back(client->mget({symbols[2], "ACMISSING", symbols[0]}, WireFormat::DDC1));
+            }
+        }
+
+        size_t matched = 0;
+        for (size_t i = 0; i < gets.size(); ++i)
+        {
+            if (!ready(gets[i]))
+            {
+                break;
+            }
+            ClientResult result = gets[i].get();
+            matched += result.ok && result.series.size() == 1 && sameBars(result.series[0], series[i % symbols.size()]);
+        }
+        check(matched == OUTSTANDING, "every outstanding GET matched to its own answer");
+
+        size_t batched = 0;
+        for (auto &batch : batches)
+        {
+            if (!ready(batch))
+            {
+                break;
+            }
+            ClientResult result = batch.get();
+            batched += result.ok && result.series.size() == 3 && sameBars(result.series[0], series[2]) &&
+                       result.series[1].empty() && sameBars(result.series[2], series[0]);
+        }
+        check(batched == batches.size(), "MGET answers in symbol order, a symbol without data left empty");
+    }
+
+    // Callbacks, and error replies failing only their own request
+    {
+        std::promise<void> done;
+        std::atomic<size_t> answered{0};
+        std::atomic<size_t> good{0};
+        std::string missingError;
+        auto count = [&](bool ok)
+        {
+            good += ok;
+            if (++answered == 3)
+            {
+                done.set_value();
+            }
+        };
+        client->get(symbols[1], WireFormat::BIN1, [&](ClientResult result)
+                    { count(result.ok && sameBars(result.series[0], series[1])); });
+        client->get("ACMISSING", WireFormat::BIN1, [&](ClientResult result)
+                    {
+                        missingError = result.error;
+                        count(!result.ok && result.series.empty());
+                    });
+        client->get(symbols[0], WireFormat::DDC1, [&](ClientResult result)
+                    { count(result.ok && sameBars(result.series[0], series[0])); });
+        check(done.get_future().wait_for(std::chrono::seconds(10)) == std::future_status::ready && good == 3,
+              "callbacks answered in order around an error reply");
+        check(missingError.rfind("ERROR:", 0) == 0, "error reply carries the server's ERROR line");
+
+        std::promise<ClientResult> tooMany;
+        client->mget(std::vector<std::string>(Protocol::MAX_BATCH_SYMBOLS + 1, "ACA"), WireFormat::BIN1,
+                     [&tooMany](ClientResult result)
+                     { tooMany.set_value(std::move(result)); });
+        check(!tooMany.get_future().get().ok, "oversized MGET refused without a round trip");
+    }
+
+    // A subscription follows pushed changes while requests keep being answered on the same connection
+    {
+        const std::string symbol = symbols[0];
+        std::promise<ClientResult> ended;
+        std::atomic<size_t> calls{0};
+        std::atomic<uint64_t> lastVersion{0};
+        client->subscribe(symbol, WireFormat::BIN1,
+                          [&](const MarketDataSeries &, const MarketDataSeries &changed, uint64_t version)
+                          {
+                              ++calls;
+                              lastVersion = version;
+                              return changed.size() != 1 || changed.timestamps()[0] != START + 5 * BARS * MINUTE;
+                          },
+                          [&ended](ClientResult result)
+                          { ended.set_value(std::move(result)); });
+
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+        while (MarketDataServer::SubscriberCount(symbol) == 0 && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        MarketDataSeries expected = series[0];
+        std::vector<std::future<ClientResult>> between;
+        for (size_t r = 1; r <= 5; ++r)
+        {
+            MarketDataSeries bar;
+            bar.push_back(START + static_cast<int64_t>(r * BARS) * MINUTE, 1.0 * r, 2.0 * r, 0.5 * r, 1.5 * r, 10.0 * r);
+            expected.push_back(bar.view()[0]);
+            MarketDataServer::MergeMarketData(symbol, bar);
+            between.push_back(client->get(symbols[1], WireFormat::BIN1));
+        }
+
+        std::future<ClientResult> end = ended.get_future();
+        check(end.wait_for(std::chrono::seconds(10)) == std::future_status::ready, "subscription ended");
+        ClientResult result = end.get();
+        check(result.ok && result.series.size() == 1 && sameBars(result.series[0], expected),
+              "local copy kept current, ended by returning false");
+        check(calls == 6 && lastVersion == MarketDataServer::GetSnapshot(symbol)->version,
+              "one call when subscribed and one per change");
+        size_t answered = 0;
+        for (auto &future : between)
+        {
+            answered += ready(future) && future.get().ok;
+        }
+        check(answered == between.size(), "requests answered between pushes");
+        check(MarketDataServer::SubscriberCount(symbol) == 0, "unsubscribed on the server");
+        series[0] = expected;
+    }
+
+    // Pipelined requests against blocking round trips, the console client's way
+    {
+        tcp::socket socket(ioc);
+        socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+        boost::asio::streambuf buffer;
+        std::string line = "GET " + symbols[1] + " FORMAT=BIN1\n";
+        auto start = Clock::now();
+        size_t good = 0;
+        for (size_t i = 0; i < ROUNDS; ++i)
+        {
+            boost::asio::write(socket, boost::asio::buffer(line));
+            MarketDataSeries received;
+            good += MarketDataClient::receiveMarketData(socket, buffer, received) && received.size() == BARS;
+        }
+        double blockingMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        check(good == ROUNDS, "blocking round trips answered");
+
+        start = Clock::now();
+        std::promise<void> done;
+        std::atomic<size_t> answered{0};
+        std::atomic<size_t> pipelined{0};
+        for (size_t i = 0; i < ROUNDS; ++i)
+        {
+            client->get(symbols[1], WireFormat::BIN1, [&](ClientResult result)
+                        {
+                            pipelined += result.ok && result.series[0].size() == BARS;
+                            if (++answered == ROUNDS)
+                            {
+                                done.set_value();
+                            }
+                        });
+        }
+        done.get_future().wait_for(std::chrono::seconds(30));
+        double pipelinedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        check(pipelined == ROUNDS, "pipelined requests answered");
+
+        std::cout << ROUNDS << " GETs of " << BARS << " bars on one connection: blocking round trips "
+                  << ROUNDS / blockingMs * 1000.0 << " req/s, AsyncClient pipelined " << ROUNDS / pipelinedMs * 1000.0
+                  << " req/s" << std::endl;
+    }
+
+    // Closing fails whatever is still outstanding, later requests fail at once
+    {
+        std::vector<std::future<ClientResult>> inFlight;
+        for (size_t i = 0; i < 50; ++i)
+        {
+            inFlight.push_back(client->get(symbols[i % symbols.size()], WireFormat::BIN1));
+        }
+        client->close();
+        size_t settled = 0;
+        for (auto &future : inFlight)
+        {
+            if (ready(future))
+            {
+                ClientResult result = future.get();
+                settled += result.ok || result.error == "Connection closed";
+            }
+        }
+        check(settled == inFlight.size(), "outstanding requests answered or failed on close");
+        ClientResult after = client->get(symbols[0], WireFormat::BIN1).get();
+        check(!after.ok && after.error == "Not connected", "requests after close fail");
+
+        client->connect("127.0.0.1", port).get();
+        ClientResult again = client->get(symbols[2], WireFormat::DDC1).get();
+        check(again.ok && sameBars(again.series[0], series[2]), "reconnected");
+
+        // Reconnecting right after close: completions of the old socket must not fail the new connection
+        size_t reconnected = 0;
+        for (size_t i = 0; i < 20; ++i)
+        {
+            client->close();
+            client->connect("127.0.0.1", port).get();
+            ClientResult result = client->get(symbols[i % symbols.size()], WireFormat::BIN1).get();
+            reconnected += result.ok && sameBars(result.series[0], series[i % symbols.size()]);
+        }
+        check(reconnected == 20, "close and connect back to back");
+        client->close();
+    }
+
+    // A frame header the client cannot take fails its request and the connection, the io thread keeps serving
+    for (const std::string header : {"NONSENSE:1\n", "DATA_SIZE:1125899906842624\n"})
+    {
+        tcp::acceptor liar(ioc, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        std::thread peer([&liar, &header]
+                         {
+                             tcp::socket socket = liar.accept();
+                             boost::asio::streambuf request;
+                             boost::asio::read_until(socket, request, '\n');
+                             boost::asio::write(socket, boost::asio::buffer(header));
+                             boost::system::error_code ignored;
+                             boost::asio::read(socket, request, ignored);
+                         });
+        auto victim = AsyncClient::create(ioc);
+        victim->connect("127.0.0.1", liar.local_endpoint().port()).get();
+        std::future<ClientResult> rejected = victim->get(symbols[0], WireFormat::CSV);
+        check(ready(rejected) && !rejected.get().ok, "bad frame header fails the request: " + header);
+        peer.join();
+
+        client->connect("127.0.0.1", port).get();
+        ClientResult after = client->get(symbols[1], WireFormat::BIN1).get();
+        check(after.ok && sameBars(after.series[0], series[1]), "io thread still serves after: " + header);
+        client->close();
+    }
+
+    // A refused connection surfaces through the future
+    {
+        auto refused = AsyncClient::create(ioc);
+        unsigned short closedPort = 0;
+        {
+            tcp::acceptor probe(ioc, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+            closedPort = probe.local_endpoint().port();
+        }
+        bool threw = false;
+        try
+        {
+            refused->connect("127.0.0.1", closedPort).get();
+        }
+        catch (const boost::system::system_error &)
+        {
+            threw = true;
+        }
+        check(threw, "refused connection throws from the future");
+    }
+
+    work.reset();
+    ioThread.join();
+    server.stop();
+    server.wait();
+
+    return finish();
+}
@@ -0,0 +1,279 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include "AsyncServer.hpp"
+#include "TestSupport.hpp"
+
+// Holds N concurrent clients (10000 by default, first argument) on an AsyncServer, then has every
+// client send a request at once and reads all responses, reporting connection count and throughput.
+// Clients run in a forked process so client and server sockets each get the full file descriptor limit.
+// Also checks error handling: a throwing handler, an overlong request line and a client that disconnects,
+// and that stop() closes the listening socket and the connections still open.
+
+namespace
+{
+    using namespace TestSupport;
+    namespace net = boost::asio;
+    using tcp = net::ip::tcp;
+
+    constexpr size_t PAYLOAD_SIZE = 16 * 1024;
+
+    // Soft file descriptor limit up to the hard limit, returns the soft limit now in effect
+    rlim_t raiseFileLimit()
+    {
+        rlimit limit{};
+        getrlimit(RLIMIT_NOFILE, &limit);
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        getrlimit(RLIMIT_NOFILE, &limit);
+        return limit.rlim_cur;
+    }
+
+    std::string makePayload()
+    {
+        std::string payload = "DATA_SIZE:" + std::to_string(PAYLOAD_SIZE) + "\n";
+        for (size_t i = 0; i < PAYLOAD_SIZE; ++i)
+        {
+            payload += static_cast<char>('a' + i % 26);
+        }
+        return payload;
+    }
+
+    void writeAll(int fd, const void *data, size_t size)
+    {
+        check(::write(fd, data, size) == static_cast<ssize_t>(size), "pipe write");
+    }
+
+    void readAll(int fd, void *data, size_t size)
+    {
+        check(::read(fd, data, size) == static_cast<ssize_t>(size), "pipe read");
+    }
+
+    /// @brief Client side of the benchmark, runs in the child process
+    int runClients(size_t clients, int fromServer, int toServer, const std::string &expected)
+    {
+        unsigned short port = 0;
+        readAll(fromServer, &port, sizeof(port));
+        tcp::endpoint endpoint(net::ip::address_v4::loopback(), port);
+
+        // Open every connection first, they all sit idle on the server at the same time
+        net::io_context ioc;
+        std::vector<tcp::socket> sockets;
+        sockets.reserve(clients);
+        for (size_t i = 0; i < clients; ++i)
+        {
+            sockets.emplace_back(ioc);
+            boost::system::error_code ec;
+            sockets.back().connect(endpoint, ec);
+            if (ec)
+            {
+                std::cerr << "connect " << i << " failed: " << ec.message() << std::endl;
+                return 1;
+            }
+        }
+        char ready = 'c';
+        writeAll(toServer, &ready, 1);
+        readAll(fromServer, &ready, 1);
+
+        // Every client sends its request at once, reads its response and hangs up
+        const std::string request = "GET TEST\n";
+        std::vector<std::string> responses(clients);
+        size_t good = 0;
+        for (size_t i = 0; i < clients; ++i)
+        {
+            net::async_write(sockets[i], net::buffer(request),
+                             [&, i](const boost::system::error_code &ec, size_t)
+                             {
+                                 if (ec)
+                                 {
+                                     return;
+                                 }
+                                 net::async_read(sockets[i], net::dynamic_buffer(responses[i]),
+                                                 net::transfer_exactly(expected.size()),
+                                                 [&, i](const boost::system::error_code &, size_t)
+                                                 {
+                                                     good += responses[i] == expected;
+                                                     responses[i].clear();
+                                                     sockets[i].close();
+                                                 });
+                             });
+        }
+        ioc.run();
+
+        if (good != clients)
+        {
+            std::cerr << good << " of " << clients << " clients received the full response" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::string roundTrip(unsigned short port, const std::string &request)
+    {
+        net::io_context ioc;
+        tcp::socket socket(ioc);
+        socket.connect(tcp::endpoint(net::ip::address_v4::loopback(), port));
+        net::write(socket, net::buffer(request));
+
+        // Connections are persistent, the server closes once it has answered and sees the end of the requests.
+        // A request the server rejects may already have closed it
+        boost::system::error_code ec;
+        socket.shutdown(tcp::socket::shutdown_send, ec);
+        std::string response;
+        net::read(socket, net::dynamic_buffer(response), ec);
+        return response;
+    }
+
+    void checkErrorHandling(AsyncServer &server)
+    {
+        AsyncServerStats before = server.stats();
+
+        check(roundTrip(server.port(), "THROW\n") == "ERROR: internal server error\n", "throwing handler answered with an error");
+        check(roundTrip(server.port(), std::string(AsyncServer::MAX_REQUEST_LENGTH + 10, 'x')).empty(),
+              "overlong request line dropped without a response");
+
+        // A client leaving before it sends anything only releases its connection
+        {
+            net::io_context ioc;
+            tcp::socket socket(ioc);
+            socket.connect(tcp::endpoint(net::ip::address_v4::loopback(), server.port()));
+        }
+
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+        while ((server.stats().acceptedConnections < before.acceptedConnections + 3 ||
+                server.stats().activeConnections != 0) &&
+               Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        AsyncServerStats after = server.stats();
+        check(after.activeConnections == 0, "connections left open after errors");
+        check(after.acceptedConnections == before.acceptedConnections + 3, "error connections were not all accepted");
+        check(after.requests == before.requests + 1, "only the complete line counts as a request");
+    }
+
+    void checkStop(AsyncServer &server)
+    {
+        net::io_context ioc;
+        tcp::socket idle(ioc);
+        idle.connect(tcp::endpoint(net::ip::address_v4::loopback(), server.port()));
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(5);
+        while (server.stats().activeConnections == 0 && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // The io threads return on their own once the idle connection is closed
+        server.stop();
+        server.wait();
+        check(server.stats().activeConnections == 0, "stop() closes the connections still open");
+
+        boost::system::error_code ec;
+        char byte = 0;
+        idle.read_some(net::buffer(&byte, 1), ec);
+        check(ec == net::error::eof || ec == net::error::connection_reset, "client sees its connection closed");
+
+        tcp::socket late(ioc);
+        late.connect(tcp::endpoint(net::ip::address_v4::loopback(), server.port()), ec);
+        check(ec == net::error::connection_refused, "stop() closes the listening socket");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t clients = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const std::string payload = makePayload();
+
+    // Fork before any thread exists. Each process needs one descriptor per client plus a few spare
+    rlim_t fileLimit = raiseFileLimit();
+    if (fileLimit < clients + 64)
+    {
+        std::cerr << "file descriptor limit " << fileLimit << " is too low for " << clients << " clients" << std::endl;
+        return 1;
+    }
+
+    int toClient[2];
+    int toServer[2];
+    if (pipe(toClient) != 0 || pipe(toServer) != 0)
+    {
+        std::cerr << "pipe failed" << std::endl;
+        return 1;
+    }
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(toClient[1]);
+        close(toServer[0]);
+        _exit(runClients(clients, toClient[0], toServer[1], payload));
+    }
+    close(toClient[0]);
+    close(toServer[1]);
+
+    {
+        // Responses share one payload buffer, as the market data server shares an encoded snapshot
+        auto shared = std::make_shared<const std::string>(payload);
+        AsyncServer server([shared](const std::string &line, const std::shared_ptr<ServerConnection> &)
+                           {
+                               if (line == "THROW")
+                               {
+                                   throw std::runtime_error("handler failure");
+                               }
+                               ServerResponse response;
+                               response.buffers.push_back(net::buffer(*shared));
+                               response.owners.push_back(shared);
+                               return response;
+                           });
+        unsigned short port = server.listen(0);
+        server.start();
+        writeAll(toClient[1], &port, sizeof(port));
+
+        // Wait until the server holds every client at once
+        char signal = 0;
+        readAll(toServer[0], &signal, 1);
+        Clock::time_point connectDeadline = Clock::now() + std::chrono::seconds(30);
+        while (server.stats().activeConnections < clients && Clock::now() < connectDeadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        AsyncServerStats connected = server.stats();
+        check(connected.activeConnections == clients,
+              "server holds " + std::to_string(connected.activeConnections) + " of " + std::to_string(clients) + " connections");
+
+        // Release the requests and time until every response is written
+        Clock::time_point start = Clock::now();
+        writeAll(toClient[1], &signal, 1);
+        Clock::time_point deadline = start + std::chrono::seconds(60);
+        while ((server.stats().requests < clients || server.stats().activeConnections != 0) && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        int status = 0;
+        waitpid(child, &status, 0);
+        check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "client process reported failures");
+
+        AsyncServerStats served = server.stats();
+        check(served.requests == clients, "served " + std::to_string(served.requests) + " requests");
+        check(served.bytesSent == clients * payload.size(), "bytes sent do not add up");
+        check(served.peakConnections == clients, "peak connection count");
+        check(served.acceptErrors == 0, "accept errors");
+
+        std::cout << clients << " concurrent connections on " << server.threadCount() << " io threads (peak "
+                  << served.peakConnections << "), " << served.requests << " requests in " << elapsed * 1000.0
+                  << " ms: " << served.requests / elapsed << " requests/s, "
+                  << served.bytesSent / elapsed / (1024.0 * 1024.0) << " MB/s" << std::endl;
+
+        checkErrorHandling(server);
+        checkStop(server);
+    }
+
+    return finish();
+}
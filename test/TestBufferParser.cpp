@@ -0,0 +1,196 @@
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include "AsyncClient.hpp"
+#include "AsyncServer.hpp"
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "MarketDataClient.hpp"
+#include "MarketDataServer.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+#include "WireDecoder.hpp"
+#include "WireEncoder.hpp"
+
+// Parsers over bytes already in memory: CSV serial, parallel and in batches, JSON, the factory's choice
+// between them, header only and bad input. Then CSV responses received by the blocking client and by
+// AsyncClient, which used to hand the body to a parser that took it for a file path, and in place parsing
+// against the temporary file round trip.
+
+namespace
+{
+    using namespace TestSupport;
+    using boost::asio::ip::tcp;
+
+    // CSV body of a response, past its DATA_SIZE line
+    std::string_view csvBody(const EncodedPayload &payload)
+    {
+        std::string_view bytes = payload.bytes();
+        return bytes.substr(bytes.find('\n') + 1);
+    }
+
+    void checkParsers(const MarketDataSeries &series)
+    {
+        auto payload = WireEncoder::encode(series.view(), WireFormat::CSV);
+        std::string_view text = csvBody(*payload);
+
+        auto parser = ParserFactory::createCSVBufferParser(text);
+        check(parser->parseData() && exact(parser->getData(), series), "CSV buffer parses exactly");
+
+        auto parallel = ParserFactory::createCSVBufferParser(text, 4);
+        check(parallel->parseData() && exact(parallel->getData(), series), "CSV buffer parses exactly in parallel");
+
+        MarketDataSeries batched;
+        size_t batches = 0;
+        auto streaming = ParserFactory::createCSVBufferParser(text);
+        bool ok = streaming->parseBatches(1000, [&](MarketDataSeries &batch)
+                                          {
+                                              ++batches;
+                                              batched.append(batch.view());
+                                              return true;
+                                          });
+        check(ok && batches == (series.size() + 999) / 1000 && exact(batched, series), "CSV buffer parsed in batches");
+
+        auto chosen = ParserFactory::createBufferParser(text);
+        check(dynamic_cast<DataParserCSV *>(chosen.get()) != nullptr, "factory picks CSV for CSV text");
+
+        std::string json = "[";
+        for (size_t i = 0; i < 3; ++i)
+        {
+            json += std::string(i ? "," : "") + "{\"timestamp\":\"" + Timestamp::toString(series.timestamps()[i]) +
+                    "\",\"open\":" + std::to_string(series.open()[i]) + ",\"high\":1,\"low\":1,\"close\":1,\"volume\":7}";
+        }
+        json += "]";
+        std::string padded = "  " + json;
+        auto jsonParser = ParserFactory::createBufferParser(padded);
+        check(dynamic_cast<DataParserJson *>(jsonParser.get()) != nullptr, "factory picks JSON for JSON text");
+        check(jsonParser->parseData() && jsonParser->getData().size() == 3 &&
+                  jsonParser->getData().timestamps()[2] == series.timestamps()[2],
+              "JSON buffer parses in place");
+
+        std::string headerOnly = "timestamp,open,high,low,close,volume\n";
+        auto empty = ParserFactory::createCSVBufferParser(headerOnly);
+        check(!empty->parseData() && empty->getData().empty(), "header only buffer has no rows");
+
+        std::string mixed = "timestamp,open,high,low,close,volume\n" + Timestamp::toString(START) +
+                            ",1,2,0.5,1.5,100\nnot,a,row\n" + Timestamp::toString(START + MINUTE) + ",2,3,1,2.5,200";
+        auto partial = ParserFactory::createCSVBufferParser(mixed);
+        check(partial->parseData() && partial->getData().size() == 2 && partial->getData().close()[1] == 2.5,
+              "bad lines skipped, last line without a newline parsed");
+
+        // The client's body decoder, including an empty series
+        MarketDataSeries decoded;
+        std::string body(text);
+        check(WireDecoder::decodeBody(WireFormat::CSV, body.data(), body.size(), 0, decoded) && exact(decoded, series),
+              "client decodes a CSV body");
+        decoded.clear();
+        check(WireDecoder::decodeBody(WireFormat::CSV, headerOnly.data(), headerOnly.size(), 0, decoded) &&
+                  decoded.empty(),
+              "client decodes an empty CSV body");
+    }
+
+    void checkReceive(const MarketDataSeries &series)
+    {
+        auto payload = WireEncoder::encode(series.view(), WireFormat::CSV);
+        std::string_view bytes = payload->bytes();
+
+        boost::asio::io_context ioc;
+        tcp::acceptor acceptor(ioc, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        std::thread server([&]
+                           {
+                               tcp::socket peer = acceptor.accept();
+                               boost::asio::write(peer, boost::asio::buffer(bytes.data(), bytes.size()));
+                           });
+        auto socket = std::make_shared<tcp::socket>(ioc);
+        socket->connect(acceptor.local_endpoint());
+        MarketDataSeries received;
+        bool ok = MarketDataClient::receiveMarketData(socket, received);
+        server.join();
+        check(ok && exact(received, series), "blocking client receives a CSV response");
+    }
+
+    void checkAsyncClient(const MarketDataSeries &series)
+    {
+        MarketDataServer::MergeMarketData("BUFP", series);
+        AsyncServer server(MarketDataServer::HandleRequest, 1);
+        unsigned short port = server.listen(0);
+        server.start();
+
+        boost::asio::io_context ioc;
+        auto work = boost::asio::make_work_guard(ioc);
+        std::thread ioThread([&ioc]
+                             { ioc.run(); });
+        auto client = AsyncClient::create(ioc);
+        client->connect("127.0.0.1", port).get();
+
+        ClientResult result = client->get("BUFP", WireFormat::CSV).get();
+        check(result.ok && exact(result.series[0], series), "AsyncClient receives a CSV response");
+        ClientResult batch = client->mget({"BUFP", "BUFPMISSING", "BUFP"}, WireFormat::CSV).get();
+        check(batch.ok && batch.series.size() == 3 && exact(batch.series[2], series) && batch.series[1].empty(),
+              "AsyncClient receives a CSV batch");
+
+        client->close();
+        work.reset();
+        ioThread.join();
+        server.stop();
+        server.wait();
+    }
+
+    template <typename Work>
+    double bestMs(Work work, int runs = 5)
+    {
+        double best = 1e300;
+        for (int r = 0; r < runs; ++r)
+        {
+            auto start = Clock::now();
+            work();
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void benchmark(const MarketDataSeries &series)
+    {
+        auto payload = WireEncoder::encode(series.view(), WireFormat::CSV);
+        std::string_view text = csvBody(*payload);
+
+        // What a caller without a buffer parser had to do: write the body out and parse the file
+        std::string path = (std::filesystem::temp_directory_path() / "market_parser_buffer_bench.csv").string();
+        double fileMs = bestMs([&]
+                               {
+                                   {
+                                       std::ofstream out(path, std::ios::binary);
+                                       out << text;
+                                   }
+                                   auto parser = ParserFactory::createCSVParser(path);
+                                   parser->parseData();
+                               });
+        std::remove(path.c_str());
+
+        double bufferMs = bestMs([&]
+                                 {
+                                     auto parser = ParserFactory::createCSVBufferParser(text);
+                                     parser->parseData();
+                                 });
+
+        std::cout << series.size() << " bars, " << text.size() / 1e6 << " MB of CSV: temporary file + parse " << fileMs
+                  << " ms, in place " << bufferMs << " ms (" << fileMs / bufferMs << "x)" << std::endl;
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("buffer_parser_log.txt");
+    MarketDataSeries series = makeSeries(100000);
+    checkParsers(series);
+    checkReceive(series);
+    checkAsyncClient(makeSeries(390));
+    benchmark(makeSeries(500000));
+
+    return finish();
+}
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "CSVScanner.hpp"
+#include "TestSupport.hpp"
+
+// The structural index of every instruction set the CPU supports against the scalar one, over lengths on
+// both sides of the 64 byte steps and inputs with quotes, CRLF line ends and ragged last lines. Then the
+// rows a CSVScanner decodes at each level, window boundaries included.
+
+namespace
+{
+    using namespace TestSupport;
+    using CSVScan::SimdLevel;
+
+    std::vector<SimdLevel> levels()
+    {
+        std::vector<SimdLevel> result = {SimdLevel::Scalar};
+        SimdLevel best = CSVScan::detectSimdLevel();
+        if (best >= SimdLevel::SSE2)
+        {
+            result.push_back(SimdLevel::SSE2);
+        }
+        if (best >= SimdLevel::AVX2)
+        {
+            result.push_back(SimdLevel::AVX2);
+        }
+        return result;
+    }
+
+    std::vector<size_t> structurals(const std::string &text, size_t base, SimdLevel level)
+    {
+        std::vector<size_t> out(text.size() + 1);
+        out.resize(CSVScan::findStructurals(text.data(), text.size(), base, out.data(), level));
+        return out;
+    }
+
+    // Pseudo random bytes drawn mostly from the characters a CSV line holds
+    std::string noise(size_t length, size_t seed)
+    {
+        static const char ALPHABET[] = ",,\n\r\"0123456789.-:T ab";
+        std::string text;
+        for (size_t i = 0; i < length; ++i)
+        {
+            text += ALPHABET[((i + seed) * 2654435761u >> 7) % (sizeof(ALPHABET) - 1)];
+        }
+        return text;
+    }
+
+    std::vector<std::string> rows(std::string_view text, SimdLevel level)
+    {
+        std::vector<std::string> out;
+        CSVScanner scanner(text, level);
+        CSVRow row;
+        while (scanner.nextRow(row))
+        {
+            std::string decoded(row.line);
+            for (size_t f = 0; f < std::min(row.count, CSVRow::MAX_FIELDS); ++f)
+            {
+                decoded += '|';
+                decoded += row.fields[f];
+            }
+            out.push_back(decoded + '#' + std::to_string(row.count));
+        }
+        return out;
+    }
+}
+
+int main()
+{
+    std::vector<std::string> inputs = {
+        "",
+        ",",
+        "\n",
+        "timestamp,open,high,low,close,volume\r\n2025-01-16T09:30:00,1,2,0.5,1.5,100\r\n",
+        "\"quoted, with a comma\",\"and \"\"escaped\"\" quotes\"\n\"multi\nline\",x",
+        "2025-01-16T09:30:00,1,2,0.5,1.5,100\n2025-01-16T09:31:00,1,2",
+        "a,b,,,c\r\n\r\n\n,,\n" + std::string(100, 'x') + ",tail",
+    };
+    // Every length around the 64 byte steps of the vector scans, so each tail length is covered
+    for (size_t length = 0; length <= 200; ++length)
+    {
+        inputs.push_back(noise(length, length));
+    }
+    inputs.push_back(noise(100000, 7));
+
+    const std::vector<SimdLevel> supported = levels();
+    std::cout << "Levels compared:";
+    for (SimdLevel level : supported)
+    {
+        std::cout << ' ' << CSVScan::simdLevelName(level);
+    }
+    std::cout << std::endl;
+
+    for (SimdLevel level : supported)
+    {
+        size_t agree = 0;
+        for (const std::string &input : inputs)
+        {
+            agree += structurals(input, 1000, level) == structurals(input, 1000, SimdLevel::Scalar);
+        }
+        check(agree == inputs.size(), std::string("structural index at ") + CSVScan::simdLevelName(level));
+
+        // Starting part way into a buffer leaves the vector loads unaligned
+        std::string shifted = "###" + inputs.back();
+        check(structurals(shifted.substr(3), 0, level) == structurals(inputs.back(), 0, SimdLevel::Scalar),
+              std::string("unaligned input at ") + CSVScan::simdLevelName(level));
+    }
+
+    // Lines long enough to straddle the scanner's 64 KB windows
+    std::string large;
+    for (size_t i = 0; i < 20000; ++i)
+    {
+        large += noise(i % 37, i) + (i % 3 == 0 ? "\r\n" : "\n");
+    }
+    large += std::string(70000, 'y') + ",z";
+    inputs.push_back(large);
+    for (SimdLevel level : supported)
+    {
+        size_t agree = 0;
+        for (const std::string &input : inputs)
+        {
+            agree += rows(input, level) == rows(input, SimdLevel::Scalar);
+        }
+        check(agree == inputs.size(), std::string("decoded rows at ") + CSVScan::simdLevelName(level));
+    }
+
+    std::vector<std::string> decoded = rows(inputs[5], CSVScan::detectSimdLevel());
+    check(decoded.size() == 2 && decoded[1] == "2025-01-16T09:31:00,1,2|2025-01-16T09:31:00|1|2#3",
+          "last line without a newline");
+    decoded = rows(inputs[3], CSVScan::detectSimdLevel());
+    check(decoded.size() == 2 && decoded[0].find('\r') == std::string::npos, "CRLF stripped from the line");
+
+    return finish();
+}
@@ -0,0 +1,198 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "MarketDataClient.hpp"
+#include "Protocol.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+#include "WireEncoder.hpp"
+
+// DDC1 compressed encoding: exact round trips for quoted prices, for arbitrary doubles (raw fallback)
+// and for special values, malformed bodies rejected without touching the output, and a response
+// received through MarketDataClient. Then bytes on the wire and encode / decode throughput against CSV.
+
+namespace
+{
+    using namespace TestSupport;
+    using boost::asio::ip::tcp;
+
+    // Minute bars quoted to the cent with whole share volumes, as the upstream API sends them
+    MarketDataSeries quotedSeries(size_t rows)
+    {
+        MarketDataSeries series;
+        int64_t cents = 18733;
+        for (size_t i = 0; i < rows; ++i)
+        {
+            cents += static_cast<int64_t>((i * 2654435761u) % 41) - 20;
+            double close = cents / 100.0;
+            series.push_back(START + static_cast<int64_t>(i) * MINUTE, (cents - 3) / 100.0, (cents + 12) / 100.0,
+                             (cents - 9) / 100.0, close, static_cast<double>(1000 + (i * 7919) % 90000));
+        }
+        return series;
+    }
+
+    // Body of a DDC1 payload, past its header line
+    std::string_view body(const EncodedPayload &payload)
+    {
+        std::string_view bytes = payload.bytes();
+        return bytes.substr(bytes.find('\n') + 1);
+    }
+
+    bool roundTrip(const MarketDataSeries &series, MarketDataSeries &decoded)
+    {
+        auto payload = WireEncoder::encode(series.view(), WireFormat::DDC1);
+        std::string_view data = body(*payload);
+        decoded.clear();
+        return WireEncoder::decodeCompressed(data.data(), data.size(), series.size(), decoded);
+    }
+
+    void checkCodec()
+    {
+        MarketDataSeries decoded;
+        MarketDataSeries quoted = quotedSeries(1000);
+        auto payload = WireEncoder::encode(quoted.view(), WireFormat::DDC1);
+        std::string_view bytes = payload->bytes();
+        std::string header = "DDC1:1000:" + std::to_string(body(*payload).size()) + "\n";
+        check(bytes.substr(0, header.size()) == header, "DDC1 header carries rows and bytes");
+        check(body(*payload)[0] == 2 && body(*payload)[1] == 0, "cents and whole shares picked as the scales");
+        check(roundTrip(quoted, decoded) && exact(decoded, quoted), "quoted bars round trip exactly");
+
+        MarketDataSeries arbitrary = arbitrarySeries(1000);
+        check(roundTrip(arbitrary, decoded) && exact(decoded, arbitrary), "arbitrary doubles round trip exactly");
+        auto raw = WireEncoder::encode(arbitrary.view(), WireFormat::DDC1);
+        check(static_cast<uint8_t>(body(*raw)[0]) == WireEncoder::DDC1_RAW, "unquotable prices sent raw");
+
+        MarketDataSeries special;
+        special.push_back(0, -0.0, std::numeric_limits<double>::infinity(), -1e300, 0.0,
+                          std::numeric_limits<double>::quiet_NaN());
+        special.push_back(-5 * MINUTE, -12.5, 3.75, -20.25, -7.0, 0.0);
+        special.push_back(std::numeric_limits<int64_t>::max(), 1, 2, 3, 4, 5);
+        special.push_back(std::numeric_limits<int64_t>::min(), 1, 2, 3, 4, 5);
+        check(roundTrip(special, decoded) && exact(decoded, special), "special values and wrapping timestamps round trip");
+
+        MarketDataSeries empty;
+        check(roundTrip(empty, decoded) && decoded.empty(), "empty series round trips");
+
+        // Truncated or padded bodies fail and leave what was already decoded alone
+        std::string data(body(*payload));
+        MarketDataSeries kept = quotedSeries(3);
+        check(!WireEncoder::decodeCompressed(data.data(), data.size() - 1, 1000, kept) && exact(kept, quotedSeries(3)),
+              "truncated body rejected");
+        check(!WireEncoder::decodeCompressed((data + "x").data(), data.size() + 1, 1000, kept) && kept.size() == 3,
+              "trailing bytes rejected");
+        check(!WireEncoder::decodeCompressed("\x0c\x00", 2, 0, kept), "unknown scale rejected");
+        check(!WireEncoder::decodeCompressed(data.data(), data.size(), size_t(1) << 50, kept) && kept.size() == 3,
+              "row count the body cannot hold rejected before allocating");
+        check(!WireEncoder::decodeCompressed(data.data(), 2, 1, kept) && kept.size() == 3, "bars with no bytes rejected");
+        check(WireEncoder::decodeCompressed(data.data(), data.size(), 1000, kept) && kept.size() == 1003,
+              "decoded bars are appended");
+
+        // Deltas of INT64_MAX ticks twice over: the sums wrap instead of overflowing
+        const std::string largest("\xfe\xff\xff\xff\xff\xff\xff\xff\xff\x01", 10);
+        std::string hostile("\x00\x00", 2);
+        for (int row = 0; row < 2; ++row)
+        {
+            hostile += largest + largest + largest + largest + largest + largest;
+        }
+        MarketDataSeries wrapped;
+        check(WireEncoder::decodeCompressed(hostile.data(), hostile.size(), 2, wrapped) && wrapped.size() == 2 &&
+                  wrapped.close()[1] == static_cast<double>(static_cast<int64_t>(2 * static_cast<uint64_t>(INT64_MAX))),
+              "overflowing deltas decode with wrapping sums");
+
+        Protocol::Request request;
+        std::string error;
+        check(Protocol::parseRequest("GET AAPL FORMAT=DDC1", request, error) && request.format == WireFormat::DDC1,
+              "FORMAT=DDC1 negotiated");
+    }
+
+    void checkReceive(const MarketDataSeries &series)
+    {
+        auto payload = WireEncoder::encode(series.view(), WireFormat::DDC1);
+        std::string_view bytes = payload->bytes();
+
+        boost::asio::io_context ioc;
+        tcp::acceptor acceptor(ioc, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        std::thread server([&]
+                           {
+                               tcp::socket peer = acceptor.accept();
+                               boost::asio::write(peer, boost::asio::buffer(bytes.data(), bytes.size()));
+                           });
+        auto socket = std::make_shared<tcp::socket>(ioc);
+        socket->connect(acceptor.local_endpoint());
+        MarketDataSeries received;
+        bool ok = MarketDataClient::receiveMarketData(socket, received);
+        server.join();
+        check(ok && exact(received, series), "client receives a DDC1 response exactly");
+    }
+
+    template <typename Work>
+    double bestMs(Work work, int runs = 5)
+    {
+        double best = 1e300;
+        for (int r = 0; r < runs; ++r)
+        {
+            auto start = Clock::now();
+            work();
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+        return best;
+    }
+
+    void benchmark(const char *name, const MarketDataSeries &series)
+    {
+        const size_t rows = series.size();
+        std::shared_ptr<const EncodedPayload> csv, ddc1, bin1;
+        double csvEncodeMs = bestMs([&]
+                                    { csv = WireEncoder::encode(series.view(), WireFormat::CSV); });
+        double ddc1EncodeMs = bestMs([&]
+                                     { ddc1 = WireEncoder::encode(series.view(), WireFormat::DDC1); });
+        bin1 = WireEncoder::encode(series.view(), WireFormat::BIN1);
+
+        std::string_view data = body(*ddc1);
+        MarketDataSeries decoded;
+        double ddc1DecodeMs = bestMs([&]
+                                     {
+                                         decoded.clear();
+                                         WireEncoder::decodeCompressed(data.data(), data.size(), rows, decoded);
+                                     });
+        check(exact(decoded, series), std::string(name) + ": benchmark decode exact");
+
+        // The client's CSV path parses the body text in place
+        std::string_view text = body(*csv);
+        double csvDecodeMs = bestMs([&]
+                                    {
+                                        auto parser = ParserFactory::createCSVBufferParser(text);
+                                        parser->parseData();
+                                    });
+
+        auto perSecond = [rows](double ms)
+        { return rows / ms / 1000.0; };
+        std::cout << name << ", " << rows << " bars: CSV " << csv->bytes().size() << " bytes, BIN1 "
+                  << bin1->bytes().size() << " bytes, DDC1 " << ddc1->bytes().size() << " bytes ("
+                  << static_cast<double>(ddc1->bytes().size()) / rows << " per bar, "
+                  << static_cast<double>(csv->bytes().size()) / ddc1->bytes().size() << "x smaller than CSV)\n"
+                  << "  encode: CSV " << perSecond(csvEncodeMs) << " M bars/s, DDC1 " << perSecond(ddc1EncodeMs)
+                  << " M bars/s; decode: CSV parse " << perSecond(csvDecodeMs) << " M bars/s, DDC1 "
+                  << perSecond(ddc1DecodeMs) << " M bars/s" << std::endl;
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("compressed_encoding_log.txt");
+    checkCodec();
+    checkReceive(quotedSeries(100000));
+    checkReceive(arbitrarySeries(10000));
+
+    benchmark("Quoted prices", quotedSeries(200000));
+    benchmark("Arbitrary doubles", arbitrarySeries(200000));
+
+    return finish();
+}
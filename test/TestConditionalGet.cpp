@@ -0,0 +1,248 @@
+#include <iostream>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "AsyncClient.hpp"
+#include "AsyncServer.hpp"
+#include "Logger.hpp"
+#include "MarketDataServer.hpp"
+#include "Protocol.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+#include "WireDecoder.hpp"
+
+// Conditional GET (SINCE=<version>): the recent changes kept with each snapshot, NOT_MODIFIED, DELTA and
+// SNAPSHOT answers from the request handler, and AsyncClient::fetch keeping its versioned cache current
+// against a loopback server. Then bytes and time per poll of an unchanged and of a refreshed symbol,
+// conditional against a plain GET.
+
+namespace
+{
+    using namespace TestSupport;
+
+    constexpr size_t BARS = 5000;
+    constexpr size_t POLLS = 1000;
+
+    // First line of an answer, and the bars of the BIN1 frame after it if there is one
+    std::string answer(const std::string &line, MarketDataSeries &bars)
+    {
+        std::string bytes = text(MarketDataServer::HandleRequest(line, nullptr));
+        std::string first = bytes.substr(0, bytes.find('\n') + 1);
+        bars.clear();
+        std::string frame = bytes.substr(first.size());
+        size_t newline = frame.find('\n');
+        WireFormat format;
+        size_t rows = 0;
+        size_t size = 0;
+        if (newline != std::string::npos &&
+            WireDecoder::parseDataHeader(frame.substr(0, newline + 1), format, rows, size))
+        {
+            std::string body = frame.substr(newline + 1);
+            check(body.size() == size && WireDecoder::decodeBody(format, body.data(), size, rows, bars),
+                  "frame after " + first + " decodes");
+        }
+        return first;
+    }
+
+    void checkProtocol()
+    {
+        Protocol::Request request;
+        std::string error;
+        check(Protocol::parseRequest("GET AAPL SINCE=42 FORMAT=BIN1", request, error) && request.conditional &&
+                  request.since == 42 && request.format == WireFormat::BIN1,
+              "GET with SINCE");
+        check(Protocol::formatRequest(request) == "GET AAPL FORMAT=BIN1 SINCE=42\n", "SINCE request line");
+        check(Protocol::parseRequest("GET AAPL", request, error) && !request.conditional, "plain GET is unconditional");
+        check(!Protocol::parseRequest("GET AAPL SINCE=x", request, error), "bad version rejected");
+        check(!Protocol::parseRequest("MGET AAPL MSFT SINCE=1", request, error), "SINCE only on GET");
+    }
+
+    void checkRecentChanges()
+    {
+        MarketDataServer::DataCache cache;
+        cache.mergeData("RC", makeSeries(10, 100.0));
+        cache.mergeData("RC", makeSeries(1, 100.0, 10));
+        auto snapshot = cache.snapshot("RC");
+        check(snapshot->recentChanges.size() == 2 && snapshot->recentChanges.back()->version == 2 &&
+                  snapshot->recentChanges.back()->changed.size() == 1,
+              "a merge records its changes with the snapshot");
+
+        for (size_t i = 0; i < MarketDataServer::MAX_RECENT_CHANGES + 5; ++i)
+        {
+            cache.mergeData("RC", makeSeries(1, 100.0, 11 + i));
+        }
+        snapshot = cache.snapshot("RC");
+        check(snapshot->recentChanges.size() == MarketDataServer::MAX_RECENT_CHANGES &&
+                  snapshot->recentChanges.front()->version + MarketDataServer::MAX_RECENT_CHANGES - 1 == snapshot->version,
+              "only the latest versions are kept");
+
+        cache.updateData("RC", makeSeries(3, 50.0));
+        check(cache.snapshot("RC")->recentChanges.empty(), "a replacement clears the recent changes");
+        cache.mergeData("RC", makeSeries(1, 50.0, 3));
+        check(cache.snapshot("RC")->recentChanges.size() == 1, "changes recorded again after a replacement");
+    }
+
+    void checkHandler()
+    {
+        MarketDataSeries bars;
+        MarketDataServer::MergeMarketData("CGH", makeSeries(100, 100.0));
+        uint64_t v1 = MarketDataServer::GetSnapshot("CGH")->version;
+        const std::string tag = "CGH:" + std::to_string(v1);
+
+        check(answer("GET CGH SINCE=0 FORMAT=BIN1", bars) == "SNAPSHOT:" + tag + "\n" && bars.size() == 100,
+              "SINCE=0 answered with every bar");
+        check(answer("GET CGH SINCE=" + std::to_string(v1), bars) == "NOT_MODIFIED:" + tag + "\n",
+              "current version answered NOT_MODIFIED");
+
+        MarketDataServer::MergeMarketData("CGH", makeSeries(1, 100.0, 100));
+        check(answer("GET CGH SINCE=" + std::to_string(v1) + " FORMAT=BIN1", bars) ==
+                      "DELTA:CGH:" + std::to_string(v1 + 1) + "\n" &&
+                  bars.size() == 1 && bars.timestamps()[0] == START + 100 * MINUTE,
+              "one version behind answered with the new bar");
+
+        // The bar just added is revised and another appended: both, with the newest values
+        MarketDataSeries revised = makeSeries(2, 200.0, 100);
+        MarketDataServer::MergeMarketData("CGH", revised);
+        check(answer("GET CGH SINCE=" + std::to_string(v1) + " FORMAT=BIN1", bars) ==
+                      "DELTA:CGH:" + std::to_string(v1 + 2) + "\n" &&
+                  sameBars(bars, revised.view()),
+              "two versions behind answered with the changes merged");
+
+        check(answer("GET CGH SINCE=" + std::to_string(v1 + 99), bars).rfind("SNAPSHOT:", 0) == 0,
+              "version the server never published answered with every bar");
+        for (size_t i = 0; i < MarketDataServer::MAX_RECENT_CHANGES; ++i)
+        {
+            MarketDataServer::MergeMarketData("CGH", makeSeries(1, 100.0, 102 + i));
+        }
+        check(answer("GET CGH SINCE=" + std::to_string(v1) + " FORMAT=BIN1", bars).rfind("SNAPSHOT:", 0) == 0 &&
+                  sameBars(bars, MarketDataServer::GetSnapshot("CGH")->view),
+              "version older than the recent changes answered with every bar");
+        check(answer("GET CGHMISSING SINCE=3", bars).rfind("ERROR:", 0) == 0, "unknown symbol answered with an error");
+    }
+
+    void checkClient()
+    {
+        MarketDataServer::MergeMarketData("CGC", makeSeries(BARS, 100.0));
+        MarketDataServer::MergeMarketData("CGX", makeSeries(BARS, 300.0));
+
+        AsyncServer server(MarketDataServer::HandleRequest, 1);
+        unsigned short port = server.listen(0);
+        server.start();
+        boost::asio::io_context ioc;
+        auto work = boost::asio::make_work_guard(ioc);
+        std::thread ioThread([&ioc]
+                             { ioc.run(); });
+        auto client = AsyncClient::create(ioc);
+        client->connect("127.0.0.1", port).get();
+
+        ClientResult first = client->fetch("CGC", WireFormat::BIN1).get();
+        check(first.ok && first.modified && first.version == MarketDataServer::GetSnapshot("CGC")->version &&
+                  sameBars(first.series[0], MarketDataServer::GetSnapshot("CGC")->view),
+              "first fetch transfers every bar");
+        ClientResult again = client->fetch("CGC", WireFormat::BIN1).get();
+        check(again.ok && !again.modified && again.version == first.version && sameBars(again.series[0], first.series[0].view()),
+              "unchanged symbol comes from the cache");
+
+        // A refresh revising the last bar and appending one
+        MarketDataServer::MergeMarketData("CGC", makeSeries(2, 150.0, BARS - 1));
+        ClientResult refreshed = client->fetch("CGC", WireFormat::DDC1).get();
+        check(refreshed.ok && refreshed.modified && refreshed.version == first.version + 1 &&
+                  sameBars(refreshed.series[0], MarketDataServer::GetSnapshot("CGC")->view),
+              "refreshed symbol patched from a delta");
+
+        // Outstanding fetches of the same symbol, all conditional on the same version
+        MarketDataServer::MergeMarketData("CGC", makeSeries(1, 150.0, BARS + 1));
+        std::vector<std::future<ClientResult>> pipelined;
+        for (int i = 0; i < 5; ++i)
+        {
+            pipelined.push_back(client->fetch("CGC", WireFormat::BIN1));
+        }
+        size_t current = 0;
+        for (auto &future : pipelined)
+        {
+            ClientResult result = future.get();
+            current += result.ok && sameBars(result.series[0], MarketDataServer::GetSnapshot("CGC")->view);
+        }
+        check(current == pipelined.size(), "pipelined fetches of one symbol agree");
+
+        // A refresh that fills a gap and revises a later bar: the delta lists both, the gap fill first
+        MarketDataSeries gappy;
+        for (size_t minute : {1, 2, 3, 4, 6, 7, 8})
+        {
+            addBar(gappy, minute, 1.0);
+        }
+        MarketDataServer::MergeMarketData("CGG", gappy);
+        client->fetch("CGG", WireFormat::BIN1).get();
+        MarketDataSeries backFill;
+        addBar(backFill, 5, 2.0);
+        addBar(backFill, 7, 9.0);
+        MarketDataServer::MergeMarketData("CGG", backFill);
+        ClientResult filled = client->fetch("CGG", WireFormat::BIN1).get();
+        check(filled.ok && filled.modified && exact(filled.series[0], MarketDataServer::GetSnapshot("CGG")->view),
+              "delta with a gap fill and a revision patches the cache exactly");
+        MarketDataServer::MergeMarketData("CGG", refresh(8, 3.0));
+        ClientResult after = client->fetch("CGG", WireFormat::BIN1).get();
+        check(after.ok && exact(after.series[0], MarketDataServer::GetSnapshot("CGG")->view),
+              "cache still exact after the next delta");
+
+        ClientResult missing = client->fetch("CGMISSING", WireFormat::BIN1).get();
+        check(!missing.ok && missing.error.rfind("ERROR:", 0) == 0, "fetch of an unknown symbol fails");
+
+        // Bytes and time per poll, the plain GET a client without the cache sends against the conditional one
+        auto poll = [&](auto request)
+        {
+            uint64_t before = server.stats().bytesSent;
+            auto start = Clock::now();
+            size_t good = 0;
+            for (size_t i = 0; i < POLLS; ++i)
+            {
+                good += request(i);
+            }
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / POLLS;
+            check(good == POLLS, "every poll answered");
+            return std::make_pair(static_cast<double>(server.stats().bytesSent - before) / POLLS, us);
+        };
+        auto plain = poll([&](size_t)
+                          {
+                              ClientResult result = client->get("CGX", WireFormat::BIN1).get();
+                              return result.ok && result.series[0].size() == BARS;
+                          });
+        client->fetch("CGX", WireFormat::BIN1).get();
+        auto unchanged = poll([&](size_t)
+                              {
+                                  ClientResult result = client->fetch("CGX", WireFormat::BIN1).get();
+                                  return result.ok && !result.modified && result.series[0].size() == BARS;
+                              });
+        auto refreshing = poll([&](size_t i)
+                               {
+                                   MarketDataServer::MergeMarketData("CGX", makeSeries(1, 300.0, BARS + i));
+                                   ClientResult result = client->fetch("CGX", WireFormat::BIN1).get();
+                                   return result.ok && result.modified && result.series[0].size() == BARS + i + 1;
+                               });
+
+        std::cout << "Polling a " << BARS << " bar symbol as BIN1: plain GET " << plain.first << " bytes, "
+                  << plain.second << " us; conditional, unchanged " << unchanged.first << " bytes, " << unchanged.second
+                  << " us; conditional, one new bar " << refreshing.first << " bytes, " << refreshing.second << " us"
+                  << std::endl;
+
+        client->close();
+        work.reset();
+        ioThread.join();
+        server.stop();
+        server.wait();
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("conditional_get_log.txt");
+    checkProtocol();
+    checkRecentChanges();
+    checkHandler();
+    checkClient();
+
+    return finish();
+}
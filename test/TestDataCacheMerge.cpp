@@ -0,0 +1,96 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include "MarketDataServer.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// Checks DataCache::mergeData on overlapping refreshes: only new bars are appended, revised bars are
+// updated in place, gaps are back-filled in order and the version only moves when something changed.
+// Also times a small merge against a full replacement of a long history.
+
+namespace
+{
+    using namespace TestSupport;
+
+    // Bars for minutes [first, first + count), newest first like the Alpha Vantage response
+    MarketDataSeries makeFetch(size_t first, size_t count)
+    {
+        MarketDataSeries fetch;
+        for (size_t i = first + count; i-- > first;)
+        {
+            double price = 100.0 + static_cast<double>(i % 50);
+            fetch.push_back(START + static_cast<int64_t>(i) * MINUTE, price, price + 1, price - 1, price + 0.5, 1000.0 + i);
+        }
+        return fetch;
+    }
+}
+
+int main()
+{
+    MarketDataServer::DataCache cache;
+    check(cache.version("TEST") == 0, "unknown symbol has version 0");
+
+    // First fetch fills the cache in time order
+    MarketDataServer::MergeResult merged = cache.mergeData("TEST", makeFetch(0, 100));
+    check(merged.appended == 100 && merged.version == 1, "initial merge appends every bar");
+    MarketDataSeries cached = cache.getData("TEST");
+    check(cached.size() == 100 && cached.isSortedByTime(), "cache sorted after the first merge");
+
+    // Same window again: nothing changes, the version stays
+    merged = cache.mergeData("TEST", makeFetch(0, 100));
+    check(!merged.changed() && merged.version == 1, "identical fetch is a no-op");
+
+    // Window moved by two minutes and the last known bar was revised
+    MarketDataSeries next = makeFetch(2, 100);
+    MarketDataSeries revised;
+    for (MarketDataRow bar : next.view())
+    {
+        bool last = bar.timestamp() == START + 99 * MINUTE;
+        revised.push_back(bar.timestamp(), bar.open(), bar.high(), bar.low(), last ? 123.0 : bar.close(), bar.volume());
+    }
+    merged = cache.mergeData("TEST", revised);
+    check(merged.appended == 2 && merged.revised == 1 && merged.inserted == 0, "moved window appends 2 and revises 1");
+    check(merged.version == 2, "version bumped once per changing merge");
+    cached = cache.getData("TEST");
+    check(cached.size() == 102 && cached.close()[99] == 123.0, "revised close stored in place");
+
+    // A fetch with a timestamp listed twice and one missing minute further back
+    MarketDataSeries gapped = makeFetch(0, 102);
+    MarketDataSeries withGap;
+    withGap.append(gapped.view().slice(0, 101)); // newest first, so minute 0 is left out
+    cache.updateData("GAP", withGap);
+    MarketDataSeries withDuplicate;
+    withDuplicate.append(gapped.view());
+    withDuplicate.push_back(START + 105 * MINUTE, 1, 2, 0.5, 1.5, 10);
+    withDuplicate.push_back(START + 105 * MINUTE, 1, 2, 0.5, 1.75, 20);
+    merged = cache.mergeData("GAP", withDuplicate);
+    check(merged.inserted == 1 && merged.appended == 1, "gap back-filled and duplicate appended once");
+    cached = cache.getData("GAP");
+    check(cached.size() == 103 && cached.isSortedByTime(), "back-filled series stays sorted");
+    check(cached.timestamps()[0] == START && cached.close()[102] == 1.75, "duplicate keeps its last values");
+
+    // Cost of a 100 bar refresh against a 1M bar history
+    {
+        MarketDataServer::DataCache big;
+        MarketDataSeries history = makeFetch(0, 1000000);
+        big.mergeData("BIG", history);
+
+        MarketDataSeries refresh = makeFetch(1000000 - 98, 100);
+        auto start = Clock::now();
+        big.mergeData("BIG", refresh);
+        double mergeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        history.sortByTime();
+        history.append(refresh.view().slice(0, 2));
+        start = Clock::now();
+        big.updateData("BIG", history);
+        double replaceMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        check(big.getData("BIG").size() == 1000002, "merged history size");
+        std::cout << "100 bar refresh into 1M bars: merge " << mergeMs << " ms, full replace " << replaceMs << " ms"
+                  << std::endl;
+    }
+
+    return finish();
+}
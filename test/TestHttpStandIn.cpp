@@ -0,0 +1,131 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "MarketDataServer.hpp"
+#include "Timestamp.hpp"
+
+// Runs StreamMarketData against a local plain HTTP stand-in for the upstream API.
+// The stand-in sends a chunked intraday response slowly, so the test can check that
+// bars reach the caller before the last byte of the body has been sent.
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+    using boost::asio::ip::tcp;
+
+    constexpr size_t BAR_COUNT = 20000;
+    constexpr size_t CHUNK_COUNT = 10;
+    constexpr auto CHUNK_DELAY = std::chrono::milliseconds(30);
+
+    std::string makeIntradayJson(size_t bars)
+    {
+        std::string json = R"J({"Meta Data":{"1. Information":"Intraday (1min)","2. Symbol":"TEST"},)J"
+                           R"J("Time Series (1min)":{)J";
+
+        const int64_t start = 1737019800LL * Timestamp::NANOS_PER_SECOND; // 2025-01-16 09:30:00
+        char line[256];
+        for (size_t i = 0; i < bars; ++i)
+        {
+            std::string timestamp = Timestamp::toString(start + static_cast<int64_t>(i) * 60 * Timestamp::NANOS_PER_SECOND);
+            timestamp[10] = ' ';
+            double price = 100.0 + (i % 100) / 10.0;
+            std::snprintf(line, sizeof(line),
+                          R"J(%s"%s":{"1. open":"%.4f","2. high":"%.4f","3. low":"%.4f","4. close":"%.4f","5. volume":"%zu"})J",
+                          i == 0 ? "" : ",", timestamp.c_str(), price, price + 0.5, price - 0.5, price + 0.1, 1000 + i);
+            json += line;
+        }
+        json += "}}";
+        return json;
+    }
+
+    // Serves one request with a chunked body split into CHUNK_COUNT pieces, pausing between them
+    void serveOnce(tcp::acceptor &acceptor, const std::string &body, Clock::time_point &lastByteSent)
+    {
+        tcp::socket socket = acceptor.accept();
+
+        boost::asio::streambuf request;
+        boost::asio::read_until(socket, request, "\r\n\r\n");
+
+        std::string header = "HTTP/1.1 200 OK\r\n"
+                             "Content-Type: application/json\r\n"
+                             "Transfer-Encoding: chunked\r\n"
+                             "Connection: close\r\n\r\n";
+        boost::asio::write(socket, boost::asio::buffer(header));
+
+        size_t chunkSize = (body.size() + CHUNK_COUNT - 1) / CHUNK_COUNT;
+        for (size_t offset = 0; offset < body.size(); offset += chunkSize)
+        {
+            std::this_thread::sleep_for(CHUNK_DELAY);
+
+            size_t length = std::min(chunkSize, body.size() - offset);
+            char size[32];
+            std::snprintf(size, sizeof(size), "%zx\r\n", length);
+            boost::asio::write(socket, boost::asio::buffer(std::string(size) + body.substr(offset, length) + "\r\n"));
+        }
+        boost::asio::write(socket, boost::asio::buffer(std::string("0\r\n\r\n")));
+        lastByteSent = Clock::now();
+
+        boost::system::error_code ec;
+        socket.shutdown(tcp::socket::shutdown_both, ec);
+    }
+}
+
+int main()
+{
+    boost::asio::io_context ioc;
+    tcp::acceptor acceptor(ioc, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    const std::string body = makeIntradayJson(BAR_COUNT);
+
+    Clock::time_point lastByteSent;
+    std::thread server([&] { serveOnce(acceptor, body, lastByteSent); });
+
+    MarketDataServer::ServerConfig config;
+    config.apiKey = "demo";
+    config.apiHost = "127.0.0.1";
+    config.apiPort = std::to_string(acceptor.local_endpoint().port());
+    config.apiUseTls = false;
+
+    size_t bars = 0;
+    size_t batches = 0;
+    Clock::time_point firstBatch;
+    bool ok = MarketDataServer::StreamMarketData(config, "TEST", [&](MarketDataSeries &batch)
+                                                 {
+                                                     if (batches++ == 0)
+                                                     {
+                                                         firstBatch = Clock::now();
+                                                     }
+                                                     bars += batch.size();
+                                                     return true;
+                                                 });
+    server.join();
+
+    int failures = 0;
+    if (!ok)
+    {
+        std::cerr << "FAIL: StreamMarketData returned false" << std::endl;
+        ++failures;
+    }
+    if (bars != BAR_COUNT)
+    {
+        std::cerr << "FAIL: expected " << BAR_COUNT << " bars, got " << bars << std::endl;
+        ++failures;
+    }
+    if (batches < 2 || firstBatch >= lastByteSent)
+    {
+        std::cerr << "FAIL: first batch was not delivered before the body finished" << std::endl;
+        ++failures;
+    }
+
+    if (failures == 0)
+    {
+        auto lead = std::chrono::duration_cast<std::chrono::milliseconds>(lastByteSent - firstBatch);
+        std::cout << "PASS: " << bars << " bars in " << batches << " batches, first batch "
+                  << lead.count() << " ms before the last byte" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
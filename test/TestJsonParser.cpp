@@ -0,0 +1,210 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// The SAX JSON parser against the DOM parser it replaced, kept here as the reference: field mapping of the
+// "Time Series (...)" shapes, the array form, API messages, and which bad bars are skipped and which fail
+// the whole response. The DOM gave bars in key order, the SAX parser in document order, so both are
+// compared sorted by time.
+
+namespace
+{
+    using namespace TestSupport;
+    using json = nlohmann::json;
+
+    // The pre-SAX DataParserJson::parseData, less its logging
+    bool parseDom(const std::string &content, MarketDataSeries &out)
+    {
+        out.clear();
+        try
+        {
+            json jsonData = json::parse(content);
+            if (jsonData.contains("Information") || jsonData.contains("Error") || jsonData.contains("Note"))
+            {
+                return false;
+            }
+
+            std::string timeSeriesKey;
+            for (const auto &key : {"Time Series (Daily)", "Time Series (1min)", "Time Series (5min)",
+                                    "Time Series (15min)", "Time Series (30min)", "Time Series (60min)"})
+            {
+                if (jsonData.contains(key))
+                {
+                    timeSeriesKey = key;
+                    break;
+                }
+            }
+
+            if (!timeSeriesKey.empty())
+            {
+                auto &timeSeries = jsonData[timeSeriesKey];
+                for (auto it = timeSeries.begin(); it != timeSeries.end(); ++it)
+                {
+                    int64_t timestamp;
+                    if (!Timestamp::parse(it.key(), timestamp))
+                    {
+                        continue;
+                    }
+                    auto &dataPoint = it.value();
+                    double open = std::stod(dataPoint["1. open"].get<std::string>());
+                    double high = std::stod(dataPoint["2. high"].get<std::string>());
+                    double low = std::stod(dataPoint["3. low"].get<std::string>());
+                    double close = std::stod(dataPoint["4. close"].get<std::string>());
+                    double volume = std::stod(dataPoint["5. volume"].get<std::string>());
+                    out.push_back(timestamp, open, high, low, close, volume);
+                }
+            }
+            else if (jsonData.is_array())
+            {
+                for (const auto &entry : jsonData)
+                {
+                    int64_t timestamp;
+                    if (entry.contains("timestamp") && entry.contains("open") && entry.contains("high") &&
+                        entry.contains("low") && entry.contains("close") && entry.contains("volume") &&
+                        Timestamp::parse(entry["timestamp"].get<std::string>(), timestamp))
+                    {
+                        out.push_back(timestamp, entry["open"].get<double>(), entry["high"].get<double>(),
+                                      entry["low"].get<double>(), entry["close"].get<double>(),
+                                      entry["volume"].get<double>());
+                    }
+                }
+            }
+            else
+            {
+                return false;
+            }
+            return out.size() > 0;
+        }
+        catch (const std::exception &)
+        {
+            out.clear();
+            return false;
+        }
+    }
+
+    bool parseSax(const std::string &content, MarketDataSeries &out)
+    {
+        DataParserJson parser(content);
+        bool ok = parser.parseData();
+        out = parser.getData();
+        return ok;
+    }
+
+    // Both parsers accept or both reject content, and accepted bars are the same
+    void same(const std::string &what, const std::string &content, bool accepted)
+    {
+        MarketDataSeries dom;
+        MarketDataSeries sax;
+        bool domOk = parseDom(content, dom);
+        bool saxOk = parseSax(content, sax);
+        check(domOk == accepted, what + ": DOM reference " + (accepted ? "accepts" : "rejects"));
+        check(saxOk == domOk, what + ": SAX accepts as the DOM did");
+        if (domOk && saxOk)
+        {
+            dom.sortByTime();
+            sax.sortByTime();
+            check(exact(sax, dom), what + ": same bars");
+        }
+    }
+
+    // One Alpha Vantage bar, every number quoted
+    std::string bar(const std::string &time, const std::string &open, const std::string &volume = "\"1200\"")
+    {
+        return "\"" + time + "\":{\"1. open\":" + open + ",\"2. high\":\"187.5\",\"3. low\":\"186.25\"," +
+               "\"4. close\":\"187.0625\",\"5. volume\":" + volume + "}";
+    }
+
+    std::string series(const std::string &name, const std::string &bars)
+    {
+        return "{\"Meta Data\":{\"1. Information\":\"Intraday\",\"2. Symbol\":\"IBM\"},\"Time Series (" + name +
+               ")\":{" + bars + "}}";
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("json_parser_log.txt");
+
+    // Field mapping: every field distinct, keys out of order and an extra one, bars newest first
+    std::string shuffled = "\"2025-01-16 09:31:00\":{\"5. volume\":\"1500\",\"4. close\":\"187.33\","
+                           "\"3. low\":\"186.9\",\"6. extra\":\"x\",\"2. high\":\"188.1\",\"1. open\":\"187.01\"},";
+    same("intraday, fields in any order", series("1min", shuffled + bar("2025-01-16 09:30:00", "\"187.2\"")), true);
+    for (const char *interval : {"5min", "15min", "30min", "60min"})
+    {
+        same(std::string(interval) + " series",
+             series(interval, bar("2025-01-16 10:00:00", "\"1.5\"") + "," + bar("2025-01-16 09:00:00", "\"2.5e1\"")),
+             true);
+    }
+    same("daily series", series("Daily", bar("2025-01-17", "\"0.1\"") + "," + bar("2025-01-16", "\"123456.789\"")),
+         true);
+
+    MarketDataSeries parsed;
+    check(parseSax(series("1min", shuffled.substr(0, shuffled.size() - 1)), parsed) && parsed.size() == 1 &&
+              parsed.open()[0] == 187.01 && parsed.high()[0] == 188.1 && parsed.low()[0] == 186.9 &&
+              parsed.close()[0] == 187.33 && parsed.volume()[0] == 1500,
+          "1. open to 5. volume map to their columns");
+
+    // Bad bars of a time series: a key that is no timestamp is skipped, whatever its bar holds
+    same("bad timestamp key skipped",
+         series("1min", bar("2025-01-16 09:30:00", "\"1\"") + "," + bar("not a time", "\"2\"") + "," +
+                            bar("2025-13-40 09:30:00", "\"oops\"")),
+         true);
+    same("only bad timestamp keys", series("1min", bar("yesterday", "\"1\"")), false);
+    same("unparseable price", series("1min", bar("2025-01-16 09:30:00", "\"1\"") + "," +
+                                                 bar("2025-01-16 09:31:00", "\"abc\"")),
+         false);
+    same("empty price", series("1min", bar("2025-01-16 09:30:00", "\"\"")), false);
+    same("unquoted price", series("1min", bar("2025-01-16 09:30:00", "187.5")), false);
+    same("null volume", series("1min", bar("2025-01-16 09:30:00", "\"1\"", "null")), false);
+    same("missing field",
+         series("1min", "\"2025-01-16 09:30:00\":{\"1. open\":\"1\",\"2. high\":\"1\",\"3. low\":\"1\","
+                        "\"4. close\":\"1\"}"),
+         false);
+    same("bar that is no object", series("1min", "\"2025-01-16 09:30:00\":\"187.5\""), false);
+    same("empty series", series("1min", ""), false);
+
+    // std::stod read the number at the start of a field and dropped the rest, from_chars takes the whole field
+    std::string trailing = series("1min", bar("2025-01-16 09:30:00", "\"187.5abc\""));
+    check(parseDom(trailing, parsed) && !parseSax(trailing, parsed), "trailing characters fail the response");
+
+    // API messages fail the response, with or without bars
+    for (const char *message : {"Information", "Note", "Error", "Error Message"})
+    {
+        same(std::string(message) + " message", "{\"" + std::string(message) + "\":\"Thank you for using Alpha Vantage\"}",
+             false);
+    }
+    same("note next to a series",
+         "{\"Note\":\"call frequency\",\"Time Series (1min)\":{" + bar("2025-01-16 09:30:00", "\"1\"") + "}}", false);
+
+    // The array form: entries without every key or with a bad timestamp are skipped, wrong types fail
+    std::string entry = "{\"timestamp\":\"2025-01-16T09:30:00\",\"open\":187.01,\"high\":188,\"low\":186.5,"
+                        "\"close\":187.25,\"volume\":1500}";
+    same("array form",
+         "[" + entry + ",{\"timestamp\":\"2025-01-16T09:29:00\",\"open\":1,\"high\":2,\"low\":0.5,\"close\":1.5,"
+                       "\"volume\":7,\"note\":\"extra\"}]",
+         true);
+    same("array entry without volume skipped",
+         "[" + entry + ",{\"timestamp\":\"2025-01-16T09:31:00\",\"open\":1,\"high\":1,\"low\":1,\"close\":1}]", true);
+    same("array entry with a bad timestamp skipped",
+         "[" + entry + ",{\"timestamp\":\"soon\",\"open\":\"1\",\"high\":1,\"low\":1,\"close\":1,\"volume\":1}]", true);
+    same("quoted price in the array form",
+         "[{\"timestamp\":\"2025-01-16T09:30:00\",\"open\":\"187.01\",\"high\":1,\"low\":1,\"close\":1,\"volume\":1}]",
+         false);
+    same("numeric timestamp in the array form",
+         "[{\"timestamp\":1737019800,\"open\":1,\"high\":1,\"low\":1,\"close\":1,\"volume\":1}]", false);
+    same("nested price in the array form",
+         "[{\"timestamp\":\"2025-01-16T09:30:00\",\"open\":[1],\"high\":1,\"low\":1,\"close\":1,\"volume\":1}]",
+         false);
+    same("empty array", "[]", false);
+
+    // Neither shape, and not JSON at all
+    same("unknown object", "{\"Meta Data\":{\"2. Symbol\":\"IBM\"}}", false);
+    same("truncated document", series("1min", bar("2025-01-16 09:30:00", "\"1\"")).substr(0, 80), false);
+
+    return finish();
+}
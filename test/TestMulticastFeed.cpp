@@ -0,0 +1,352 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include "AsyncServer.hpp"
+#include "Logger.hpp"
+#include "MarketDataServer.hpp"
+#include "MulticastFeed.hpp"
+#include "Protocol.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// Multicast feed over loopback. One receiver takes the group as is and must rebuild the cached series
+// from the datagrams alone. A second one is fed the same datagrams with some dropped on purpose, and
+// must notice the gaps, fill them with RETX over the TCP port (the last datagram of the run only through
+// a heartbeat) and rebuild the same series. A publisher with a tiny retransmit buffer then shows
+// datagrams that can no longer be recovered reported as lost, and a server that sits on a RETX shows
+// the other symbols delivered while it is out.
+
+namespace
+{
+    using namespace TestSupport;
+    namespace net = boost::asio;
+
+    constexpr size_t HISTORY = 100;
+    constexpr size_t REFRESHES = 200;
+    constexpr size_t DROP_EVERY = 7;
+    // Sequence of the last MCT datagram: the history split 24 bars to a datagram, then one per refresh
+    constexpr uint64_t LAST_SEQUENCE = (HISTORY + 23) / 24 + REFRESHES;
+
+    /// @brief Local copy of the feed's symbols, bars folded in as updates arrive
+    struct Replica
+    {
+        void apply(const FeedUpdate &update)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (update.reset)
+            {
+                ++resets;
+            }
+            else
+            {
+                cache.mergeData(update.symbol, update.bars);
+            }
+            lastSequence[update.symbol] = update.sequence;
+            ++updates;
+            recovered += update.recovered ? 1 : 0;
+        }
+
+        uint64_t sequenceOf(const std::string &symbol)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = lastSequence.find(symbol);
+            return it == lastSequence.end() ? 0 : it->second;
+        }
+
+        std::mutex mutex;
+        MarketDataServer::DataCache cache;
+        std::unordered_map<std::string, uint64_t> lastSequence;
+        size_t updates = 0;
+        size_t resets = 0;
+        size_t recovered = 0;
+    };
+
+    template <typename Condition>
+    bool waitFor(Condition condition, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000))
+    {
+        Clock::time_point deadline = Clock::now() + timeout;
+        while (!condition())
+        {
+            if (Clock::now() > deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return true;
+    }
+
+    // Every datagram sent to the group, in arrival order, until stop is set
+    void captureGroup(const MulticastConfig &config, std::atomic<bool> &joined, std::atomic<bool> &stop,
+                      const std::function<void(const char *, size_t)> &onDatagram)
+    {
+        net::io_context ioc;
+        net::ip::udp::socket socket(ioc);
+        socket.open(net::ip::udp::v4());
+        socket.set_option(net::ip::udp::socket::reuse_address(true));
+        socket.bind(net::ip::udp::endpoint(net::ip::address_v4::any(), config.port));
+        socket.set_option(net::ip::multicast::join_group(net::ip::make_address_v4(config.group),
+                                                         net::ip::make_address_v4(config.interfaceAddress)));
+        joined = true;
+
+        std::vector<char> datagram(65536);
+        while (!stop)
+        {
+            pollfd ready{socket.native_handle(), POLLIN, 0};
+            if (::poll(&ready, 1, 20) <= 0)
+            {
+                continue;
+            }
+            size_t size = socket.receive(net::buffer(datagram));
+            onDatagram(datagram.data(), size);
+        }
+    }
+
+    void checkCodec()
+    {
+        MulticastFeed::Packet packet;
+        char garbage[64] = {};
+        check(!MulticastFeed::decode(garbage, sizeof(garbage), packet), "datagram without the magic rejected");
+        check(!MulticastFeed::decode(garbage, 8, packet), "short datagram rejected");
+
+        Protocol::Request request;
+        std::string error;
+        check(Protocol::parseRequest("RETX AAPL FROM=3 TO=9", request, error) &&
+                  request.command == Protocol::Command::Retx && request.from == 3 && request.to == 9,
+              "RETX parsed");
+        check(Protocol::formatRequest(request) == "RETX AAPL FROM=3 TO=9\n", "RETX formatted");
+        check(!Protocol::parseRequest("RETX AAPL FROM=9 TO=3", request, error), "backwards range rejected");
+        check(!Protocol::parseRequest("RETX AAPL FROM=1 TO=5000", request, error), "oversized range rejected");
+        check(!Protocol::parseRequest("RETX AAPL FROM=x TO=2", request, error), "non numeric sequence rejected");
+        check(!Protocol::parseRequest("GET AAPL FROM=1", request, error) &&
+                  !Protocol::parseRequest("SUB AAPL FROM=0 TO=2", request, error),
+              "FROM and TO rejected outside RETX");
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("multicast_log.txt");
+    checkCodec();
+
+    check(text(MarketDataServer::HandleRequest("RETX MCT FROM=1 TO=2", nullptr)) ==
+              "ERROR: Multicast feed is not enabled\n",
+          "RETX refused while the feed is off");
+
+    AsyncServer server(MarketDataServer::HandleRequest, 1);
+    unsigned short tcpPort = server.listen(0);
+    server.start();
+
+    // A port of its own per run, so concurrent test runs do not see each other's datagrams
+    MulticastConfig config;
+    config.interfaceAddress = "127.0.0.1";
+    config.port = static_cast<unsigned short>(40000 + ::getpid() % 20000);
+    config.heartbeatInterval = std::chrono::milliseconds(20);
+    std::shared_ptr<MulticastPublisher> feed = MarketDataServer::StartMulticast(config);
+    check(feed != nullptr, "multicast feed started");
+    if (!feed)
+    {
+        return 1;
+    }
+
+    // Receiver A: the group as delivered
+    Replica clean;
+    FeedReceiver receiver(config, "127.0.0.1", tcpPort, [&clean](const FeedUpdate &update)
+                          { clean.apply(update); });
+    std::thread receiverThread([&receiver]
+                               { receiver.run(); });
+
+    // Receiver B: the same datagrams with every DROP_EVERY-th thrown away, and the final one of MCT,
+    // which only a heartbeat can reveal as missing
+    Replica lossy;
+    FeedReceiver gappy(config, "127.0.0.1", tcpPort, [&lossy](const FeedUpdate &update)
+                       { lossy.apply(update); });
+    std::thread gappyThread([&gappy]
+                            { gappy.serve(); });
+    std::atomic<bool> joined{false};
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> dropped{0};
+    size_t seen = 0;
+    std::thread captureThread([&]
+                              {
+                                  captureGroup(config, joined, stop, [&](const char *data, size_t size)
+                                               {
+                                                   MulticastFeed::Packet packet;
+                                                   bool heartbeat = MulticastFeed::decode(data, size, packet) &&
+                                                                    (packet.flags & MulticastFeed::FLAG_HEARTBEAT);
+                                                   bool last = packet.symbol == "MCT" && packet.sequence == LAST_SEQUENCE;
+                                                   if (!heartbeat && (++seen % DROP_EVERY == 0 || last))
+                                                   {
+                                                       ++dropped;
+                                                       return;
+                                                   }
+                                                   gappy.post(data, size);
+                                               });
+                              });
+
+    // Warm up until receiver A is joined: it only sees what is sent after it joined
+    check(waitFor([&]
+                  { return joined.load(); }),
+          "capture socket joined");
+    size_t warmup = 0;
+    check(waitFor([&]
+                  {
+                      MarketDataServer::MergeMarketData("WARM", refresh(warmup++, 1.0));
+                      return clean.sequenceOf("WARM") > 0;
+                  }),
+          "receiver joined the group");
+
+    MarketDataSeries history;
+    for (size_t i = 0; i < HISTORY; ++i)
+    {
+        addBar(history, i, 100.0 + i);
+    }
+    MarketDataServer::MergeMarketData("MCT", history);
+    for (size_t r = 1; r <= REFRESHES; ++r)
+    {
+        MarketDataServer::MergeMarketData("MCT", refresh(HISTORY - 2 + r, 500.0 + r));
+        if (r % 20 == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    check(waitFor([&]
+                  { return clean.sequenceOf("MCT") == LAST_SEQUENCE && lossy.sequenceOf("MCT") == LAST_SEQUENCE; }),
+          "both receivers reached the last datagram");
+
+    MarketDataSeries cached = MarketDataServer::GetLatestData("MCT");
+    check(sameBars(clean.cache.getData("MCT").view(), cached.view()), "clean receiver matches the cache");
+    check(sameBars(lossy.cache.getData("MCT").view(), cached.view()), "lossy receiver matches the cache after RETX");
+
+    receiver.stop();
+    receiverThread.join();
+    gappy.stop();
+    gappyThread.join();
+    FeedReceiverStats cleanStats = receiver.stats();
+    FeedReceiverStats lossyStats = gappy.stats();
+    stop = true;
+    captureThread.join();
+
+    check(cleanStats.gaps == 0 && cleanStats.lost == 0 && cleanStats.malformed == 0, "no gaps on the clean receiver");
+    check(lossyStats.gaps > 0 && lossyStats.lost == 0, "lossy receiver saw gaps and lost nothing");
+    check(lossyStats.recovered == dropped, "every dropped datagram recovered with RETX");
+    check(lossy.recovered == dropped, "recovered datagrams delivered marked as such");
+    check(lossyStats.heartbeats > 0, "heartbeats received");
+    check(clean.resets == 0 && lossy.resets == 0, "no resets");
+
+    // RETX straight through the request handler
+    ServerResponse retx = MarketDataServer::HandleRequest("RETX MCT FROM=1 TO=3", nullptr);
+    std::string retxHeader(static_cast<const char *>(retx.buffers[0].data()), retx.buffers[0].size());
+    check(retxHeader.rfind("RETX:MCT:3:", 0) == 0 && retx.buffers.size() == 4, "RETX returns the buffered datagrams");
+    ServerResponse unknown = MarketDataServer::HandleRequest("RETX NOPE FROM=1 TO=3", nullptr);
+    check(std::string(static_cast<const char *>(unknown.buffers[0].data()), unknown.buffers[0].size()) ==
+              "RETX:NOPE:0:0\n",
+          "RETX of an unknown symbol is empty");
+
+    // Datagrams past the retransmit buffer are lost for good and reported with a reset update
+    MarketDataServer::StopMulticast();
+    MulticastConfig shallow = config;
+    shallow.retransmitDepth = 3;
+    shallow.heartbeatInterval = std::chrono::milliseconds(0);
+    std::shared_ptr<MulticastPublisher> shallowFeed = MarketDataServer::StartMulticast(shallow);
+    Replica stale;
+    FeedReceiver late(shallow, "127.0.0.1", tcpPort, [&stale](const FeedUpdate &update)
+                      { stale.apply(update); });
+    std::vector<std::string> datagrams;
+    std::atomic<bool> lateJoined{false};
+    std::atomic<bool> lateStop{false};
+    std::mutex datagramsMutex;
+    std::thread lateCapture([&]
+                            {
+                                captureGroup(shallow, lateJoined, lateStop, [&](const char *data, size_t size)
+                                             {
+                                                 // The first feed may still send a heartbeat on its way out
+                                                 MulticastFeed::Packet packet;
+                                                 if (MulticastFeed::decode(data, size, packet) &&
+                                                     !(packet.flags & MulticastFeed::FLAG_HEARTBEAT))
+                                                 {
+                                                     std::lock_guard<std::mutex> lock(datagramsMutex);
+                                                     datagrams.emplace_back(data, size);
+                                                 }
+                                             });
+                            });
+    waitFor([&]
+            { return lateJoined.load(); });
+    for (size_t r = 1; r <= 6; ++r)
+    {
+        MarketDataServer::MergeMarketData("MCT", refresh(HISTORY - 2 + REFRESHES + r, 900.0 + r));
+    }
+    MarketDataServer::MergeMarketData("MCU", refresh(0, 1.0));
+    check(waitFor([&]
+                  {
+                      std::lock_guard<std::mutex> lock(datagramsMutex);
+                      return datagrams.size() >= 7;
+                  }),
+          "shallow feed datagrams captured");
+    lateStop = true;
+    lateCapture.join();
+    // Deliver 1, then 6: 2..3 have left the three deep buffer, 4..5 come back with RETX
+    std::thread lateThread([&late]
+                           { late.serve(); });
+    late.post(datagrams[0].data(), datagrams[0].size());
+    late.post(datagrams[5].data(), datagrams[5].size());
+    check(waitFor([&]
+                  { return stale.sequenceOf("MCT") == 6; }),
+          "late receiver caught up");
+    late.stop();
+    lateThread.join();
+    FeedReceiverStats lateStats = late.stats();
+    check(lateStats.lost == 2 && lateStats.recovered == 2, "datagrams gone from the buffer reported lost");
+    check(stale.resets == 1 && stale.sequenceOf("MCT") == 6, "loss surfaces as a reset, delivery goes on");
+
+    // A server that takes the RETX and does not answer holds back MCT alone, MCU is delivered meanwhile.
+    // Its answer then claims a body no RETX can carry, which is refused and the gap counted lost
+    net::io_context peerContext;
+    net::ip::tcp::acceptor acceptor(peerContext, net::ip::tcp::endpoint(net::ip::address_v4::loopback(), 0));
+    Replica held;
+    FeedReceiver stalled(shallow, "127.0.0.1", acceptor.local_endpoint().port(), [&held](const FeedUpdate &update)
+                         { held.apply(update); });
+    std::thread stalledThread([&stalled]
+                              { stalled.serve(); });
+    stalled.post(datagrams[0].data(), datagrams[0].size());
+    stalled.post(datagrams[2].data(), datagrams[2].size());
+    net::ip::tcp::socket peer(peerContext);
+    acceptor.accept(peer);
+    net::streambuf request;
+    net::read_until(peer, request, '\n');
+    stalled.post(datagrams[6].data(), datagrams[6].size());
+    check(waitFor([&]
+                  { return held.sequenceOf("MCU") == 1; }) &&
+              held.sequenceOf("MCT") == 1,
+          "other symbols delivered while a RETX is out");
+    net::write(peer, net::buffer(std::string("RETX:MCT:1:1125899906842624\n")));
+    check(waitFor([&]
+                  { return held.sequenceOf("MCT") == 3; }) &&
+              held.resets == 1,
+          "oversized RETX answer refused, the gap reported lost");
+    stalled.stop();
+    stalledThread.join();
+    check(stalled.stats().lost == 1 && stalled.stats().recovered == 0 && stalled.stats().malformed == 1,
+          "refused RETX answer counted malformed");
+
+    MulticastPublisherStats publisherStats = feed->stats();
+    std::cout << REFRESHES << " refreshes: " << publisherStats.datagrams << " datagrams, "
+              << publisherStats.bytes / std::max<uint64_t>(publisherStats.datagrams, 1) << " bytes each on average, "
+              << publisherStats.heartbeats << " heartbeats; lossy receiver dropped " << dropped << ", recovered "
+              << lossyStats.recovered << " with " << lossyStats.retransmitRequests << " RETX requests" << std::endl;
+
+    MarketDataServer::StopMulticast();
+    server.stop();
+
+    return finish();
+}
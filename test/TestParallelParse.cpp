@@ -0,0 +1,141 @@
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// Parallel parse of a memory mapped CSV file against the serial parse, bar for bar. The file is laid out so
+// the chunk cuts of 2, 3 and 7 threads land inside CRLF pairs, on a CR, on blank lines, and it ends on a
+// line without a newline.
+
+namespace
+{
+    using namespace TestSupport;
+
+    // Body bytes, past the header line. A multiple of 2, 3 and 7 so every cut is known while writing, and
+    // over 1 MiB per thread so 7 threads are not scaled back
+    constexpr size_t BODY_BYTES = 42 * 200000;
+
+    enum class Cut
+    {
+        InsideCrlf, // The cut lands on the LF of a CRLF pair
+        OnCr,       // The cut lands on the CR of a CRLF pair
+        BlankLine   // The cut lands inside a run of empty lines
+    };
+
+    std::string line(size_t i)
+    {
+        double price = 100.0 + static_cast<double>((i * 2654435761u) % 10000) / 100.0;
+        char fields[128];
+        std::snprintf(fields, sizeof(fields), ",%.2f,%.2f,%.2f,%.4f,%zu", price, price + 1.25, price - 0.75,
+                      price + 0.0625, 1000 + (i * 7919) % 5000);
+        return Timestamp::toString(START + static_cast<int64_t>(i) * MINUTE) + fields;
+    }
+
+    // Writes a body of exactly BODY_BYTES with the given structure at each cut, returns the rows written
+    size_t writeFile(const std::string &path, const std::vector<std::pair<size_t, Cut>> &cuts)
+    {
+        std::string body;
+        body.reserve(BODY_BYTES);
+        size_t rows = 0;
+        // Empty lines are one byte each, they move the next line to any position
+        auto padTo = [&body](size_t position)
+        {
+            body.append(position - body.size(), '\n');
+        };
+
+        for (const auto &[position, cut] : cuts)
+        {
+            while (body.size() + 200 < position)
+            {
+                // LF and CRLF lines mixed
+                body += line(rows) + (rows % 3 == 0 ? "\r\n" : "\n");
+                ++rows;
+            }
+            std::string next = line(rows++) + "\r\n";
+            switch (cut)
+            {
+            case Cut::InsideCrlf:
+                padTo(position + 1 - next.size());
+                break;
+            case Cut::OnCr:
+                padTo(position + 2 - next.size());
+                break;
+            case Cut::BlankLine:
+                padTo(position + 2);
+                break;
+            }
+            body += next;
+        }
+
+        while (body.size() + 200 < BODY_BYTES)
+        {
+            body += line(rows++) + "\n";
+        }
+        // The last line has no newline
+        std::string last = line(rows++);
+        padTo(BODY_BYTES - last.size());
+        body += last;
+
+        bool placed = body.size() == BODY_BYTES;
+        for (const auto &[position, cut] : cuts)
+        {
+            switch (cut)
+            {
+            case Cut::InsideCrlf:
+                placed = placed && body[position - 1] == '\r' && body[position] == '\n';
+                break;
+            case Cut::OnCr:
+                placed = placed && body[position] == '\r' && body[position + 1] == '\n';
+                break;
+            case Cut::BlankLine:
+                placed = placed && body[position - 1] == '\n' && body[position] == '\n';
+                break;
+            }
+        }
+        check(placed, "every cut lands where it is meant to");
+
+        std::ofstream out(path, std::ios::binary);
+        out << "timestamp,open,high,low,close,volume\r\n" << body;
+        return rows;
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("parallel_parse_log.txt");
+
+    std::vector<std::pair<size_t, Cut>> cuts;
+    size_t kind = 0;
+    for (size_t threads : {2, 3, 7})
+    {
+        for (size_t i = 1; i < threads; ++i)
+        {
+            cuts.emplace_back(BODY_BYTES * i / threads, static_cast<Cut>(kind++ % 3));
+        }
+    }
+    std::sort(cuts.begin(), cuts.end());
+
+    std::string path = (std::filesystem::temp_directory_path() / "market_parser_parallel_parse.csv").string();
+    size_t rows = writeFile(path, cuts);
+
+    // The serial reference: the file read line by line
+    DataParserCSV serial(path, CSVReadMode::Buffered);
+    check(serial.parseData() && serial.getData().size() == rows, "serial parse reads every row, blank lines skipped");
+
+    for (size_t threads : {1, 2, 3, 7})
+    {
+        DataParserCSV parallel(path, CSVReadMode::MemoryMapped, threads);
+        check(parallel.parseData() && exact(parallel.getData(), serial.getData()),
+              std::to_string(threads) + " threads match the serial parse");
+    }
+
+    std::filesystem::remove(path);
+    return finish();
+}
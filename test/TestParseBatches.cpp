@@ -0,0 +1,111 @@
+#include <iostream>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+#include "WireEncoder.hpp"
+
+// parseBatches on CSV files, buffered and memory mapped, and on JSON: batch count and sizes with a short
+// last batch, batches that concatenate to what parseData() materializes, and a consumer that stops early.
+
+namespace
+{
+    using namespace TestSupport;
+
+    constexpr size_t ROWS = 10050;
+    constexpr size_t BATCH = 1000;
+
+    // Runs parseBatches on a fresh parser, stopping after stopAfter batches (0 to read everything)
+    struct Batches
+    {
+        bool ok = false;
+        std::vector<size_t> sizes;
+        MarketDataSeries rows;
+    };
+
+    template <typename MakeParser>
+    Batches collect(MakeParser makeParser, size_t stopAfter = 0)
+    {
+        Batches result;
+        auto parser = makeParser();
+        result.ok = parser->parseBatches(BATCH, [&](MarketDataSeries &batch)
+                                         {
+                                             result.sizes.push_back(batch.size());
+                                             result.rows.append(batch.view());
+                                             return stopAfter == 0 || result.sizes.size() < stopAfter;
+                                         });
+        return result;
+    }
+
+    template <typename MakeParser>
+    void checkBatches(const std::string &name, MakeParser makeParser, size_t rows)
+    {
+        auto whole = makeParser();
+        check(whole->parseData() && whole->getData().size() == rows, name + ": parseData reads every row");
+
+        Batches all = collect(makeParser);
+        size_t full = 0;
+        for (size_t i = 0; i + 1 < all.sizes.size(); ++i)
+        {
+            full += all.sizes[i] == BATCH;
+        }
+        check(all.ok && all.sizes.size() == (rows + BATCH - 1) / BATCH && full == all.sizes.size() - 1 &&
+                  all.sizes.back() == rows % BATCH,
+              name + ": full batches then a short last one");
+        check(exact(all.rows, whole->getData()), name + ": batches concatenate to parseData()");
+
+        Batches stopped = collect(makeParser, 2);
+        check(stopped.ok && stopped.sizes.size() == 2 && stopped.rows.size() == 2 * BATCH &&
+                  exact(stopped.rows, whole->getData().view().slice(0, 2 * BATCH)),
+              name + ": no batch after the consumer returns false");
+    }
+
+    std::string intradayJson(const MarketDataSeries &series)
+    {
+        std::string json = "{\"Meta Data\":{\"2. Symbol\":\"IBM\"},\"Time Series (1min)\":{";
+        char fields[160];
+        for (size_t i = 0; i < series.size(); ++i)
+        {
+            std::snprintf(fields, sizeof(fields),
+                          "\":{\"1. open\":\"%.4f\",\"2. high\":\"%.4f\",\"3. low\":\"%.4f\",\"4. close\":\"%.4f\","
+                          "\"5. volume\":\"%.0f\"}",
+                          series.open()[i], series.high()[i], series.low()[i], series.close()[i], series.volume()[i]);
+            json += std::string(i ? ",\"" : "\"") + Timestamp::toString(series.timestamps()[i]) + fields;
+        }
+        return json + "}}";
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("parse_batches_log.txt");
+
+    MarketDataSeries series = makeSeries(ROWS);
+    auto payload = WireEncoder::encode(series.view(), WireFormat::CSV);
+    std::string_view bytes = payload->bytes();
+    std::string path = (std::filesystem::temp_directory_path() / "market_parser_parse_batches.csv").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << bytes.substr(bytes.find('\n') + 1);
+    }
+
+    checkBatches("buffered CSV", [&]
+                 { return std::make_unique<DataParserCSV>(path, CSVReadMode::Buffered); },
+                 ROWS);
+    checkBatches("mapped CSV", [&]
+                 { return std::make_unique<DataParserCSV>(path, CSVReadMode::MemoryMapped); },
+                 ROWS);
+    std::filesystem::remove(path);
+
+    std::string json = intradayJson(makeSeries(2500));
+    checkBatches("JSON", [&]
+                 { return std::make_unique<DataParserJson>(json); },
+                 2500);
+
+    return finish();
+}
@@ -0,0 +1,188 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <thread>
+#include "CSVScanner.hpp"
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "MappedFile.hpp"
+#include "Timestamp.hpp"
+#include <nlohmann/json.hpp>
+
+// Benchmark the CSV ingestion paths on a synthetic file using the repo's OHLCV layout
+// Usage: TestParserBenchmark [rows]
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::string writeSyntheticCSV(size_t rows)
+    {
+        std::string path = (std::filesystem::temp_directory_path() / "market_parser_bench.csv").string();
+        std::ofstream out(path);
+        out << "timestamp,open,high,low,close,volume\n";
+
+        double price = 100.5;
+        for (size_t i = 0; i < rows; ++i)
+        {
+            size_t seconds = i % 60, minutes = (i / 60) % 60, hours = 9 + (i / 3600) % 8;
+            char timestamp[32];
+            std::snprintf(timestamp, sizeof(timestamp), "2025-01-16T%02zu:%02zu:%02zu.%03zu",
+                          hours, minutes, seconds, (i * 7) % 1000);
+
+            price += ((i * 2654435761u) % 200 - 100) / 1000.0;
+            out << timestamp << ',' << price << ',' << price + 1.1 << ',' << price - 0.7 << ','
+                << price + 0.3 << ',' << 1000 + (i * 31) % 5000 << '\n';
+        }
+        return path;
+    }
+
+    // Alpha Vantage intraday response with the given number of bars, newest first like the API
+    std::string makeIntradayJson(size_t bars)
+    {
+        std::ostringstream out;
+        out << "{\"Meta Data\":{\"1. Information\":\"Intraday (1min)\",\"2. Symbol\":\"IBM\"},"
+            << "\"Time Series (1min)\":{";
+
+        for (size_t i = 0; i < bars; ++i)
+        {
+            size_t minute = bars - i;
+            char timestamp[32];
+            std::snprintf(timestamp, sizeof(timestamp), "2025-%02zu-%02zu %02zu:%02zu:00",
+                          1 + minute / 40000 % 12, 1 + minute / 1440 % 28, minute / 60 % 24, minute % 60);
+
+            double price = 100.0 + (i % 1000) / 100.0;
+            out << (i ? "," : "") << '"' << timestamp << "\":{"
+                << "\"1. open\":\"" << price << "\",\"2. high\":\"" << price + 0.5
+                << "\",\"3. low\":\"" << price - 0.5 << "\",\"4. close\":\"" << price + 0.1
+                << "\",\"5. volume\":\"" << 1000 + i % 777 << "\"}";
+        }
+        out << "}}";
+        return out.str();
+    }
+
+    // The pre-SAX implementation: full DOM, then get<std::string>() and std::stod per field
+    size_t parseJsonDom(const std::string &content)
+    {
+        nlohmann::json jsonData = nlohmann::json::parse(content);
+        auto &timeSeries = jsonData["Time Series (1min)"];
+        MarketDataSeries series;
+
+        for (auto it = timeSeries.begin(); it != timeSeries.end(); ++it)
+        {
+            auto &dataPoint = it.value();
+            int64_t timestamp = 0;
+            Timestamp::parse(it.key(), timestamp);
+            series.push_back(timestamp,
+                             std::stod(dataPoint["1. open"].get<std::string>()),
+                             std::stod(dataPoint["2. high"].get<std::string>()),
+                             std::stod(dataPoint["3. low"].get<std::string>()),
+                             std::stod(dataPoint["4. close"].get<std::string>()),
+                             std::stod(dataPoint["5. volume"].get<std::string>()));
+        }
+        return series.size();
+    }
+
+    void report(const std::string &name, size_t bytes, double seconds, size_t rows)
+    {
+        std::cout << std::left << std::setw(28) << name
+                  << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(10) << bytes / seconds / 1e9 << " GB/s"
+                  << std::setw(12) << std::setprecision(1) << rows / seconds / 1e6 << " Mrows/s\n";
+    }
+
+    void benchScan(const MappedFile &file, CSVScan::SimdLevel level)
+    {
+        std::vector<size_t> positions(64 * 1024);
+        const size_t window = positions.size();
+        constexpr int REPEATS = 5;
+        size_t structurals = 0;
+
+        auto start = Clock::now();
+        for (int r = 0; r < REPEATS; ++r)
+        {
+            for (size_t offset = 0; offset < file.size(); offset += window)
+            {
+                size_t length = std::min(window, file.size() - offset);
+                structurals += CSVScan::findStructurals(file.data() + offset, length, offset, positions.data(), level);
+            }
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count() / REPEATS;
+
+        report(std::string("scan ") + CSVScan::simdLevelName(level), file.size(), seconds, structurals / REPEATS / 6);
+    }
+
+    void benchParse(const std::string &name, const std::string &path, CSVReadMode mode, size_t bytes, size_t threads = 1)
+    {
+        DataParserCSV parser(path, mode, threads);
+        auto start = Clock::now();
+        bool ok = parser.parseData();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (!ok)
+        {
+            std::cout << name << ": parse failed\n";
+            return;
+        }
+        report(name, bytes, seconds, parser.getData().size());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t rows = argc > 1 ? std::stoull(argv[1]) : 2000000;
+
+    // Keep the parser's log lines out of the results
+    Logger::getInstance().setLogFile("benchmark_log.txt");
+
+    std::string path = writeSyntheticCSV(rows);
+    MappedFile file(path);
+    std::cout << "Synthetic OHLCV file: " << rows << " rows, " << file.size() / 1e6 << " MB\n";
+    std::cout << "Runtime SIMD level: " << CSVScan::simdLevelName(CSVScan::detectSimdLevel()) << "\n\n";
+
+    // Structural index stage alone, every level the CPU supports
+    CSVScan::SimdLevel best = CSVScan::detectSimdLevel();
+    benchScan(file, CSVScan::SimdLevel::Scalar);
+    if (best >= CSVScan::SimdLevel::SSE2)
+    {
+        benchScan(file, CSVScan::SimdLevel::SSE2);
+    }
+    if (best >= CSVScan::SimdLevel::AVX2)
+    {
+        benchScan(file, CSVScan::SimdLevel::AVX2);
+    }
+
+    // End to end parse into a columnar series
+    benchParse("parse Buffered (getline)", path, CSVReadMode::Buffered, file.size());
+    benchParse("parse MemoryMapped (SIMD)", path, CSVReadMode::MemoryMapped, file.size());
+
+    // Chunked parallel parse, doubling the thread count up to the core count
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads = 2; threads <= std::max<size_t>(cores, 2); threads *= 2)
+    {
+        benchParse("parse MemoryMapped x" + std::to_string(threads), path, CSVReadMode::MemoryMapped, file.size(), threads);
+    }
+
+    // Alpha Vantage JSON: DOM baseline against the SAX parser
+    std::string content = makeIntradayJson(rows / 10);
+    std::cout << "\nSynthetic intraday JSON: " << rows / 10 << " bars, " << content.size() / 1e6 << " MB\n";
+
+    auto start = Clock::now();
+    size_t domRows = parseJsonDom(content);
+    report("json DOM + stod", content.size(), std::chrono::duration<double>(Clock::now() - start).count(), domRows);
+
+    DataParserJson saxParser(content);
+    start = Clock::now();
+    saxParser.parseData();
+    report("json SAX + from_chars", content.size(), std::chrono::duration<double>(Clock::now() - start).count(),
+           saxParser.getData().size());
+
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+#include "AsyncServer.hpp"
+#include "MarketDataClient.hpp"
+#include "MarketDataServer.hpp"
+#include "Protocol.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// Serves the market data request handler on a loopback AsyncServer. Checks that one connection answers
+// pipelined GET and MGET requests in order until QUIT, then compares fetching symbols over one persistent
+// connection against a new connection per request.
+
+namespace
+{
+    using namespace TestSupport;
+    using boost::asio::ip::tcp;
+
+    constexpr size_t BARS = 390; // One trading day of minute bars
+    constexpr size_t ROUNDS = 500;
+
+    void checkRequests()
+    {
+        Protocol::Request request;
+        std::string error;
+
+        check(Protocol::parseRequest("MGET AAPL MSFT GOOGL FORMAT=BIN1", request, error) &&
+                  request.command == Protocol::Command::MGet && request.symbols.size() == 3 &&
+                  request.symbols[2] == "GOOGL" && request.format == WireFormat::BIN1,
+              "MGET with three symbols");
+        check(Protocol::parseRequest("QUIT\r\n", request, error) && request.command == Protocol::Command::Quit, "QUIT");
+        check(!Protocol::parseRequest("GET AAPL MSFT", request, error), "GET with two symbols rejected");
+        check(!Protocol::parseRequest("MGET", request, error), "MGET without symbols rejected");
+
+        std::string tooMany = "MGET";
+        for (size_t i = 0; i <= Protocol::MAX_BATCH_SYMBOLS; ++i)
+        {
+            tooMany += " S" + std::to_string(i);
+        }
+        check(!Protocol::parseRequest(tooMany, request, error), "oversized batch rejected");
+
+        request = Protocol::Request();
+        request.command = Protocol::Command::MGet;
+        request.symbols = {"AAPL", "MSFT"};
+        check(Protocol::formatRequest(request) == "MGET AAPL MSFT\n", "MGET request line");
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("pipelining_log.txt");
+    checkRequests();
+
+    std::vector<std::string> symbols = {"AAPL", "MSFT", "GOOGL"};
+    std::vector<MarketDataSeries> series;
+    for (size_t i = 0; i < symbols.size(); ++i)
+    {
+        series.push_back(makeSeries(BARS, 100.0 * (i + 1)));
+        MarketDataServer::MergeMarketData(symbols[i], series.back());
+    }
+
+    AsyncServer server(MarketDataServer::HandleRequest, 1);
+    unsigned short port = server.listen(0);
+    server.start();
+    tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+    boost::asio::io_context ioc;
+
+    // Requests written at once on one connection, answered in order
+    {
+        tcp::socket socket(ioc);
+        socket.connect(endpoint);
+        boost::asio::write(socket, boost::asio::buffer(std::string("GET MSFT FORMAT=BIN1\n"
+                                                                   "MGET GOOGL NOPE AAPL FORMAT=BIN1\n"
+                                                                   "GET AAPL FORMAT=XML\n"
+                                                                   "\n"
+                                                                   "quit\n"
+                                                                   "GTE AAPL\n"
+                                                                   "GET AAPL FORMAT=BIN1\n"
+                                                                   "QUIT\n")));
+        boost::asio::streambuf buffer;
+        MarketDataSeries received;
+        check(MarketDataClient::receiveMarketData(socket, buffer, received) && sameBars(received, series[1]),
+              "first pipelined GET");
+
+        std::vector<MarketDataSeries> batch;
+        check(MarketDataClient::receiveBatch(socket, buffer, batch) && batch.size() == 3, "MGET answered with 3 series");
+        check(batch.size() == 3 && sameBars(batch[0], series[2]) && batch[1].empty() && sameBars(batch[2], series[0]),
+              "MGET series in request order, unknown symbol empty");
+
+        check(!MarketDataClient::receiveMarketData(socket, buffer, received), "bad request answered with an error");
+
+        // Stray lines get an error each, never data that was not asked for
+        size_t unknown = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            size_t length = boost::asio::read_until(socket, buffer, '\n');
+            auto begin = boost::asio::buffers_begin(buffer.data());
+            unknown += std::string(begin, begin + length) == "ERROR: Unknown command\n";
+            buffer.consume(length);
+        }
+        check(unknown == 3, "blank line, lowercase quit and a typo answered ERROR: Unknown command");
+        received = MarketDataSeries();
+        check(MarketDataClient::receiveMarketData(socket, buffer, received) && sameBars(received, series[0]),
+              "GET after an error on the same connection");
+
+        // QUIT closes the connection
+        boost::system::error_code ec;
+        char byte;
+        boost::asio::read(socket, boost::asio::buffer(&byte, 1), ec);
+        check(ec == boost::asio::error::eof && buffer.size() == 0, "connection closed after QUIT");
+    }
+    AsyncServerStats stats = server.stats();
+    check(stats.acceptedConnections == 1 && stats.requests == 8, "pipelined requests shared one connection");
+
+    // Every symbol each round: one persistent connection with MGET against a new connection per GET
+    Clock::time_point start = Clock::now();
+    {
+        tcp::socket socket(ioc);
+        socket.connect(endpoint);
+        boost::asio::streambuf buffer;
+        std::vector<MarketDataSeries> batch;
+        size_t good = 0;
+        for (size_t round = 0; round < ROUNDS; ++round)
+        {
+            boost::asio::write(socket, boost::asio::buffer(std::string("MGET AAPL MSFT GOOGL FORMAT=BIN1\n")));
+            good += MarketDataClient::receiveBatch(socket, buffer, batch) && batch.size() == 3 && batch[2].size() == BARS;
+        }
+        check(good == ROUNDS, "persistent MGET rounds");
+    }
+    double persistentMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    size_t good = 0;
+    for (size_t round = 0; round < ROUNDS; ++round)
+    {
+        for (const auto &symbol : symbols)
+        {
+            tcp::socket socket(ioc);
+            socket.connect(endpoint);
+            boost::asio::write(socket, boost::asio::buffer("GET " + symbol + " FORMAT=BIN1\n"));
+            boost::asio::streambuf buffer;
+            MarketDataSeries received;
+            good += MarketDataClient::receiveMarketData(socket, buffer, received) && received.size() == BARS;
+        }
+    }
+    double perConnectionMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    check(good == ROUNDS * symbols.size(), "connection per request rounds");
+
+    std::cout << ROUNDS << " rounds of " << symbols.size() << " symbols x " << BARS << " bars: persistent MGET "
+              << persistentMs << " ms, connection per GET " << perConnectionMs << " ms ("
+              << perConnectionMs / persistentMs << "x)" << std::endl;
+
+    return finish();
+}
@@ -0,0 +1,442 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "AsyncClient.hpp"
+#include "AsyncServer.hpp"
+#include "DataParser.hpp"
+#include "Logger.hpp"
+#include "MarketDataServer.hpp"
+#include "Protocol.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+#include "WireDecoder.hpp"
+
+// Queries evaluated by the server: WHERE, COLUMNS, EVERY and LIMIT parsed and written back, rejected where
+// they do not apply, SelectRows against a naive filter for many combinations across its scan blocks,
+// projected CSV read back by the header aware parser, GET and MGET through the request handler and
+// AsyncClient. Then bytes and time per request against downloading every bar and filtering locally.
+
+namespace
+{
+    using namespace TestSupport;
+    using Analytics::Compare;
+
+    constexpr size_t BARS = 10000;
+    constexpr size_t ROUNDS = 200;
+
+    Protocol::Predicate condition(Column column, Compare op, double value, int64_t time = 0)
+    {
+        Protocol::Predicate predicate;
+        predicate.column = column;
+        predicate.op = op;
+        predicate.value = value;
+        predicate.time = time;
+        return predicate;
+    }
+
+    bool holds(double value, Compare op, double threshold)
+    {
+        switch (op)
+        {
+        case Compare::Less:
+            return value < threshold;
+        case Compare::LessEqual:
+            return value <= threshold;
+        case Compare::Greater:
+            return value > threshold;
+        case Compare::GreaterEqual:
+            return value >= threshold;
+        case Compare::Equal:
+            return value == threshold;
+        default:
+            return value != threshold;
+        }
+    }
+
+    // Every row tested against every condition, then the steps and the limit counted from the newest
+    std::vector<size_t> naiveSelect(const MarketDataView &view, const Protocol::Query &query)
+    {
+        std::vector<size_t> matches;
+        for (size_t i = 0; i < view.size(); ++i)
+        {
+            bool keep = true;
+            for (const auto &predicate : query.where)
+            {
+                const MarketDataRow row = view[i];
+                switch (predicate.column)
+                {
+                case Column::Timestamp:
+                    keep = keep && holds(static_cast<double>(row.timestamp() - predicate.time), predicate.op, 0.0);
+                    break;
+                case Column::Open:
+                    keep = keep && holds(row.open(), predicate.op, predicate.value);
+                    break;
+                case Column::High:
+                    keep = keep && holds(row.high(), predicate.op, predicate.value);
+                    break;
+                case Column::Low:
+                    keep = keep && holds(row.low(), predicate.op, predicate.value);
+                    break;
+                case Column::Close:
+                    keep = keep && holds(row.close(), predicate.op, predicate.value);
+                    break;
+                default:
+                    keep = keep && holds(row.volume(), predicate.op, predicate.value);
+                    break;
+                }
+            }
+            if (keep)
+            {
+                matches.push_back(i);
+            }
+        }
+        std::vector<size_t> rows;
+        for (size_t k = 0; k < matches.size(); k += query.every)
+        {
+            rows.insert(rows.begin(), matches[matches.size() - 1 - k]);
+        }
+        if (query.limit != 0 && rows.size() > query.limit)
+        {
+            rows.erase(rows.begin(), rows.end() - static_cast<std::ptrdiff_t>(query.limit));
+        }
+        return rows;
+    }
+
+    // Bars of one response frame as the client decodes them
+    bool decodeFrame(const std::string &bytes, MarketDataSeries &out)
+    {
+        size_t newline = bytes.find('\n');
+        WireFormat format;
+        size_t rows = 0;
+        size_t size = 0;
+        if (newline == std::string::npos ||
+            !WireDecoder::parseDataHeader(bytes.substr(0, newline + 1), format, rows, size) ||
+            bytes.size() - newline - 1 != size)
+        {
+            return false;
+        }
+        std::string body = bytes.substr(newline + 1);
+        return WireDecoder::decodeBody(format, body.data(), size, rows, out);
+    }
+
+    bool sameRows(const MarketDataView &view, const std::vector<size_t> &rows, const MarketDataSeries &received)
+    {
+        if (received.size() != rows.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < rows.size(); ++i)
+        {
+            if (received.timestamps()[i] != view.timestamps()[rows[i]] || received.close()[i] != view.close()[rows[i]] ||
+                received.volume()[i] != view.volume()[rows[i]])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void checkProtocol()
+    {
+        Protocol::Request request;
+        std::string error;
+        const std::string line = "GET AAPL WHERE=close>100.5,volume>=2000,timestamp<2025-01-16T09:30:00 COLUMNS=close,open "
+                                 "EVERY=5 LIMIT=10";
+        check(Protocol::parseRequest(line, request, error) && request.query.where.size() == 3 &&
+                  request.query.where[0].column == Column::Close && request.query.where[0].op == Compare::Greater &&
+                  request.query.where[0].value == 100.5 && request.query.where[1].op == Compare::GreaterEqual &&
+                  request.query.where[2].column == Column::Timestamp && request.query.every == 5 &&
+                  request.query.limit == 10,
+              "query options parsed");
+        int64_t cutoff = 0;
+        Timestamp::parse("2025-01-16T09:30:00", cutoff);
+        check(request.query.where[2].time == cutoff, "timestamp condition parsed");
+        check(request.query.columns == (1u << static_cast<unsigned>(Column::Timestamp) |
+                                        1u << static_cast<unsigned>(Column::Open) |
+                                        1u << static_cast<unsigned>(Column::Close)),
+              "projection keeps the timestamp");
+
+        Protocol::Request again;
+        check(Protocol::parseRequest(Protocol::formatRequest(request), again, error) &&
+                  Protocol::formatRequest(again) == Protocol::formatRequest(request) &&
+                  again.query.where.size() == 3 && again.query.where[2].time == cutoff,
+              "query request line round trips");
+        check(Protocol::formatRequest(again).find("WHERE=close>100.5,volume>=2000,timestamp<") != std::string::npos,
+              "query request line readable");
+        check(Protocol::parseRequest("MGET A B WHERE=low!=3 FORMAT=DDC1", request, error) &&
+                  request.query.where.front().op == Compare::NotEqual,
+              "MGET takes a query");
+        check(Protocol::parseRequest("GET A COLUMNS=close,volume", request, error) && !request.query.empty(),
+              "projection alone is a query");
+
+        const char *rejected[] = {
+            "GET A WHERE=price>1",              // Unknown column
+            "GET A WHERE=close~1",              // No operator
+            "GET A WHERE=close>",               // No value
+            "GET A WHERE=close>1x",             // Bad value
+            "GET A WHERE=timestamp!=2025-01-16", // Not for the timestamp
+            "GET A WHERE=timestamp>yesterday",  // Bad timestamp
+            "GET A WHERE=close>1,",             // Empty condition
+            "GET A COLUMNS=close,price",        // Unknown column
+            "GET A LIMIT=0",                    // Zero
+            "GET A EVERY=x",                    // Not a number
+            "GET A COLUMNS=close FORMAT=BIN1",  // Binary carries every column
+            "GET A SINCE=4 LIMIT=3",            // Not with SINCE
+            "SUB A WHERE=close>1",              // Not for subscriptions
+            "GET A WHERE=close>1,close>2,close>3,close>4,close>5,close>6,close>7,close>8,close>9"};
+        for (const char *bad : rejected)
+        {
+            check(!Protocol::parseRequest(bad, request, error), std::string("rejected: ") + bad);
+        }
+    }
+
+    void checkSelection(const MarketDataSeries &series)
+    {
+        const MarketDataView view = series.view();
+        const double median = view.close()[view.size() / 2];
+        const int64_t middle = view.timestamps()[view.size() / 3];
+        const int64_t late = view.timestamps()[view.size() * 4 / 5];
+
+        std::vector<std::vector<Protocol::Predicate>> wheres = {
+            {},
+            {condition(Column::Close, Compare::Greater, median)},
+            {condition(Column::Close, Compare::LessEqual, median), condition(Column::Volume, Compare::Greater, 3000)},
+            {condition(Column::High, Compare::GreaterEqual, median + 5.0)}, // Rare: only the top of the range
+            {condition(Column::Open, Compare::Less, 0.0)},                  // Nothing
+            {condition(Column::Timestamp, Compare::GreaterEqual, 0, middle)},
+            {condition(Column::Timestamp, Compare::Greater, 0, middle), condition(Column::Timestamp, Compare::Less, 0, late),
+             condition(Column::Volume, Compare::NotEqual, 1000.0)},
+            {condition(Column::Timestamp, Compare::Equal, 0, late)},
+            {condition(Column::Timestamp, Compare::Less, 0, middle), condition(Column::Timestamp, Compare::Greater, 0, late)},
+        };
+        size_t cases = 0;
+        size_t agreed = 0;
+        std::vector<size_t> rows;
+        for (const auto &where : wheres)
+        {
+            for (size_t every : {size_t(1), size_t(2), size_t(7)})
+            {
+                for (size_t limit : {size_t(0), size_t(1), size_t(10), size_t(5000), BARS * 2})
+                {
+                    Protocol::Query query;
+                    query.where = where;
+                    query.every = every;
+                    query.limit = limit;
+                    MarketDataServer::SelectRows(view, query, rows);
+                    ++cases;
+                    agreed += rows == naiveSelect(view, query);
+                }
+            }
+        }
+        check(agreed == cases, "SelectRows agrees with the naive filter, " + std::to_string(agreed) + " of " +
+                                   std::to_string(cases));
+
+        Protocol::Query huge;
+        huge.every = std::numeric_limits<size_t>::max() / 2;
+        huge.limit = std::numeric_limits<size_t>::max() / 2;
+        MarketDataServer::SelectRows(view, huge, rows);
+        check(rows.size() == 1 && rows[0] == view.size() - 1, "huge steps and limits do not overflow");
+    }
+
+    void checkParser()
+    {
+        std::string projected = "timestamp,close\n2025-01-16T09:30:00,101.5\n2025-01-16T09:31:00,102\n";
+        auto parser = ParserFactory::createCSVBufferParser(projected);
+        check(parser->parseData() && parser->getData().size() == 2 && parser->getData().close()[1] == 102.0 &&
+                  std::isnan(parser->getData().open()[0]) && std::isnan(parser->getData().volume()[1]),
+              "projected CSV parsed, missing columns NaN");
+
+        std::string reordered = "volume,close,timestamp,open,high,low\n7,2.5,2025-01-16T09:30:00,1,3,0.5\n";
+        parser = ParserFactory::createCSVBufferParser(reordered);
+        check(parser->parseData() && parser->getData().size() == 1 && parser->getData().volume()[0] == 7.0 &&
+                  parser->getData().close()[0] == 2.5 && parser->getData().low()[0] == 0.5,
+              "columns found by name");
+
+        std::string unnamed = "a,b,c,d,e,f\n2025-01-16T09:30:00,1,2,0.5,1.5,100\n";
+        parser = ParserFactory::createCSVBufferParser(unnamed);
+        check(parser->parseData() && parser->getData().size() == 1 && parser->getData().volume()[0] == 100.0,
+              "header without the column names read positionally");
+
+        // The same from a file in either read mode, the reordered one with Windows line endings
+        std::string path = (std::filesystem::temp_directory_path() / "market_parser_projected.csv").string();
+        for (CSVReadMode mode : {CSVReadMode::Buffered, CSVReadMode::MemoryMapped})
+        {
+            const std::string name = mode == CSVReadMode::Buffered ? " (buffered)" : " (mapped)";
+            {
+                std::ofstream out(path, std::ios::binary);
+                out << projected;
+            }
+            auto file = ParserFactory::createCSVParser(path, mode);
+            check(file->parseData() && file->getData().size() == 2 && file->getData().close()[1] == 102.0 &&
+                      std::isnan(file->getData().open()[0]),
+                  "projected CSV file parsed" + name);
+            {
+                std::ofstream out(path, std::ios::binary);
+                out << "volume,close,timestamp,open,high,low\r\n7,2.5,2025-01-16T09:30:00,1,3,0.5\r\n";
+            }
+            file = ParserFactory::createCSVParser(path, mode);
+            check(file->parseData() && file->getData().size() == 1 && file->getData().volume()[0] == 7.0 &&
+                      file->getData().low()[0] == 0.5,
+                  "columns of a file found by name" + name);
+        }
+        std::remove(path.c_str());
+    }
+
+    void checkHandler(const MarketDataSeries &series)
+    {
+        MarketDataServer::MergeMarketData("QPH", series);
+        const MarketDataView view = MarketDataServer::GetSnapshot("QPH")->view;
+        const double median = view.close()[view.size() / 2];
+
+        for (const char *format : {"CSV", "BIN1", "DDC1"})
+        {
+            Protocol::Query query;
+            query.where.push_back(condition(Column::Close, Compare::Greater, median));
+            query.every = 3;
+            query.limit = 400;
+            std::vector<size_t> expected;
+            MarketDataServer::SelectRows(view, query, expected);
+            MarketDataSeries received;
+            std::string line = "GET QPH WHERE=close>" + std::to_string(median) + " EVERY=3 LIMIT=400 FORMAT=" + format;
+            check(decodeFrame(text(MarketDataServer::HandleRequest(line, nullptr)), received), line + " decodes");
+            check(expected.size() == 400 && sameRows(view, expected, received), line + " sends only the selected bars");
+        }
+
+        MarketDataSeries lastBars;
+        check(decodeFrame(text(MarketDataServer::HandleRequest("GET QPH LIMIT=25 FORMAT=BIN1", nullptr)), lastBars) &&
+                  lastBars.size() == 25 && lastBars.timestamps()[24] == view.timestamps()[view.size() - 1],
+              "LIMIT sends the newest bars");
+
+        MarketDataSeries projected;
+        check(decodeFrame(text(MarketDataServer::HandleRequest("GET QPH LIMIT=5 COLUMNS=close", nullptr)), projected) &&
+                  projected.size() == 5 && projected.close()[4] == view.close()[view.size() - 1] &&
+                  std::isnan(projected.open()[0]),
+              "projected CSV carries the timestamp and close only");
+        std::string header = text(MarketDataServer::HandleRequest("GET QPH LIMIT=1 COLUMNS=volume,high", nullptr));
+        check(header.find("\ntimestamp,high,volume\n") != std::string::npos, "projected header in wire order");
+
+        MarketDataSeries none;
+        check(decodeFrame(text(MarketDataServer::HandleRequest("GET QPH WHERE=close<0 FORMAT=BIN1", nullptr)), none) &&
+                  none.empty(),
+              "no match sends an empty series");
+        check(text(MarketDataServer::HandleRequest("GET QPHMISSING LIMIT=3", nullptr)).rfind("ERROR:", 0) == 0,
+              "unknown symbol answered with an error");
+        check(text(MarketDataServer::HandleRequest("GET QPH WHERE=close>1 SINCE=2", nullptr)).rfind("ERROR:", 0) == 0,
+              "query with SINCE refused");
+    }
+
+    void checkClient(const MarketDataSeries &series)
+    {
+        MarketDataServer::MergeMarketData("QPC", series);
+        MarketDataServer::MergeMarketData("QPD", makeSeries(50));
+        const MarketDataView view = MarketDataServer::GetSnapshot("QPC")->view;
+        // The top 5% of closes
+        std::vector<double> closes(view.close(), view.close() + view.size());
+        std::nth_element(closes.begin(), closes.begin() + closes.size() * 95 / 100, closes.end());
+        const double high = closes[closes.size() * 95 / 100];
+
+        AsyncServer server(MarketDataServer::HandleRequest, 1);
+        unsigned short port = server.listen(0);
+        server.start();
+        boost::asio::io_context ioc;
+        auto work = boost::asio::make_work_guard(ioc);
+        std::thread ioThread([&ioc]
+                             { ioc.run(); });
+        auto client = AsyncClient::create(ioc);
+        client->connect("127.0.0.1", port).get();
+
+        Protocol::Query above;
+        above.where.push_back(condition(Column::Close, Compare::Greater, high));
+        std::vector<size_t> expected;
+        MarketDataServer::SelectRows(view, above, expected);
+        ClientResult result = client->query("QPC", above, WireFormat::BIN1).get();
+        check(result.ok && !expected.empty() && sameRows(view, expected, result.series[0]),
+              "AsyncClient receives only the matching bars");
+
+        // Each symbol of an MGET framed on its own, the query applied to every one
+        std::string bytes = text(MarketDataServer::HandleRequest("MGET QPC QPD LIMIT=20 FORMAT=BIN1", nullptr));
+        const size_t frame = std::string("BIN1:20\n").size() + 20 * sizeof(WireRecord);
+        MarketDataSeries first;
+        MarketDataSeries second;
+        check(bytes.rfind("BATCH:2\n", 0) == 0 && bytes.size() == 8 + 2 * frame &&
+                  decodeFrame(bytes.substr(8, frame), first) && decodeFrame(bytes.substr(8 + frame), second) &&
+                  first.timestamps()[19] == view.timestamps()[view.size() - 1] && second.size() == 20,
+              "MGET applies the query to every symbol");
+
+        Protocol::Query last;
+        last.limit = 20;
+        ClientResult limited = client->query("QPD", last, WireFormat::CSV).get();
+        check(limited.ok && limited.series[0].size() == 20, "AsyncClient LIMIT over CSV");
+
+        // What the console client used to do: download every bar, keep the few it shows
+        auto measure = [&](auto request)
+        {
+            uint64_t before = server.stats().bytesSent;
+            auto start = Clock::now();
+            size_t good = 0;
+            for (size_t i = 0; i < ROUNDS; ++i)
+            {
+                good += request();
+            }
+            double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / ROUNDS;
+            check(good == ROUNDS, "every request answered");
+            return std::make_pair(static_cast<double>(server.stats().bytesSent - before) / ROUNDS, us);
+        };
+        auto local = measure([&]
+                             {
+                                 ClientResult all = client->get("QPC", WireFormat::CSV).get();
+                                 std::vector<size_t> kept(all.series[0].size());
+                                 kept.resize(Analytics::select(all.series[0].close(), all.series[0].size(),
+                                                               Compare::Greater, high, kept.data()));
+                                 return all.ok && kept.size() == expected.size();
+                             });
+        auto pushed = measure([&]
+                              {
+                                  ClientResult some = client->query("QPC", above, WireFormat::CSV).get();
+                                  return some.ok && some.series[0].size() == expected.size();
+                              });
+        auto localLast = measure([&]
+                                 {
+                                     ClientResult all = client->get("QPC", WireFormat::CSV).get();
+                                     return all.ok && all.series[0].size() == view.size();
+                                 });
+        auto pushedLast = measure([&]
+                                  {
+                                      ClientResult some = client->query("QPC", last, WireFormat::CSV).get();
+                                      return some.ok && some.series[0].size() == 20;
+                                  });
+
+        std::cout << BARS << " bars as CSV, close > X keeping " << expected.size() << ": download and filter "
+                  << local.first << " bytes, " << local.second << " us; on the server " << pushed.first << " bytes, "
+                  << pushed.second << " us" << std::endl;
+        std::cout << "Last 20 bars: download and filter " << localLast.first << " bytes, " << localLast.second
+                  << " us; on the server " << pushedLast.first << " bytes, " << pushedLast.second << " us" << std::endl;
+
+        client->close();
+        work.reset();
+        ioThread.join();
+        server.stop();
+        server.wait();
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("query_pushdown_log.txt");
+    MarketDataSeries series = makeSeries(BARS, 187.33, 0, 0.1);
+    checkProtocol();
+    checkSelection(series);
+    checkParser();
+    checkHandler(series);
+    checkClient(series);
+
+    return finish();
+}
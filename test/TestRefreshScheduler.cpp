@@ -0,0 +1,92 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "RateLimiter.hpp"
+#include "RefreshScheduler.hpp"
+#include "TestSupport.hpp"
+
+// Checks the refresh scheduler with stand-in fetches that just sleep: the concurrency cap holds,
+// concurrent fetches shorten the cycle, failures are counted and the token bucket paces requests.
+
+namespace
+{
+    using namespace TestSupport;
+
+    std::vector<std::string> makeSymbols(size_t count)
+    {
+        std::vector<std::string> symbols;
+        for (size_t i = 0; i < count; ++i)
+        {
+            symbols.push_back("SYM" + std::to_string(i));
+        }
+        return symbols;
+    }
+}
+
+int main()
+{
+    // 16 fetches of 25 ms with 4 in flight: about 100 ms instead of 400 ms
+    {
+        RefreshScheduler scheduler(4, 0, 1);
+        std::atomic<int> inFlight{0};
+        std::atomic<int> peak{0};
+        std::atomic<int> calls{0};
+
+        RefreshCycleReport report = scheduler.runCycle(makeSymbols(16), [&](const std::string &symbol)
+                                                       {
+                                                           int now = ++inFlight;
+                                                           int seen = peak;
+                                                           while (now > seen && !peak.compare_exchange_weak(seen, now))
+                                                           {
+                                                           }
+                                                           std::this_thread::sleep_for(std::chrono::milliseconds(25));
+                                                           --inFlight;
+                                                           ++calls;
+                                                           // SYM5, SYM10 and SYM15 fail, one of them by throwing
+                                                           if (symbol == "SYM5")
+                                                           {
+                                                               throw std::runtime_error("stand-in failure");
+                                                           }
+                                                           return symbol != "SYM10" && symbol != "SYM15";
+                                                       });
+
+        check(calls == 16, "every symbol is refreshed once");
+        check(peak <= 4, "concurrency cap exceeded: " + std::to_string(peak.load()));
+        check(peak >= 2, "fetches never overlapped");
+        check(report.succeeded == 13 && report.failed == 3, "success and failure counts");
+        check(report.elapsedMs < 16 * 25 * 0.75, "concurrent cycle took " + std::to_string(report.elapsedMs) + " ms");
+        check(report.slowestMs >= 25, "slowest fetch shorter than the stand-in latency");
+        std::cout << "16 x 25 ms fetches, 4 concurrent: " << report.elapsedMs << " ms" << std::endl;
+    }
+
+    // 600 requests per minute with a burst of 2: 8 fetches need at least 6 refills of 100 ms
+    {
+        RefreshScheduler scheduler(8, 600, 2);
+        RefreshCycleReport report = scheduler.runCycle(makeSymbols(8), [](const std::string &) { return true; });
+
+        check(report.succeeded == 8, "rate limited cycle refreshes every symbol");
+        check(report.elapsedMs >= 550, "rate limit not applied, cycle took " + std::to_string(report.elapsedMs) + " ms");
+        check(report.throttledMs > 0, "no time reported as rate limited");
+        std::cout << "8 fetches at 10/s, burst 2: " << report.elapsedMs << " ms" << std::endl;
+    }
+
+    // The bucket refills up to its burst and no further
+    {
+        TokenBucket bucket(100, 3);
+        check(bucket.tryAcquire() && bucket.tryAcquire() && bucket.tryAcquire(), "burst tokens available at start");
+        check(!bucket.tryAcquire(), "bucket empty after the burst");
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        int tokens = 0;
+        while (bucket.tryAcquire())
+        {
+            ++tokens;
+        }
+        check(tokens == 3, "refill capped at the burst, got " + std::to_string(tokens));
+    }
+
+    return finish();
+}
@@ -0,0 +1,311 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include "AsyncServer.hpp"
+#include "Logger.hpp"
+#include "MarketDataClient.hpp"
+#include "MarketDataServer.hpp"
+#include "SharedMemoryRing.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// Shared memory ring: records come out in order, a lapped reader reports the overrun and resumes, and
+// concurrent readers never see a torn record while the producer runs flat out. Then the latency from
+// a cache merge to a same-host consumer, through the ring against a SUB connection over loopback TCP.
+
+namespace
+{
+    using namespace TestSupport;
+    using boost::asio::ip::tcp;
+
+    constexpr size_t STRESS_RECORDS = 200000;
+    constexpr size_t STRESS_BATCH = 1600; // More than the ring holds, so slow readers get lapped
+    constexpr size_t LATENCY_UPDATES = 300;
+
+    // Bars whose fields all derive from i, so a record mixing two writes is easy to spot
+    MarketDataSeries bars(size_t first, size_t count)
+    {
+        MarketDataSeries series;
+        for (size_t i = first; i < first + count; ++i)
+        {
+            double close = static_cast<double>(i);
+            series.push_back(START + static_cast<int64_t>(i) * MINUTE, close - 0.5, close + 1.0, close - 1.0, close,
+                             close * 2);
+        }
+        return series;
+    }
+
+    bool consistent(const SharedMemoryRing::Record &record)
+    {
+        const WireRecord &bar = record.bar;
+        return bar.open == bar.close - 0.5 && bar.high == bar.close + 1.0 && bar.low == bar.close - 1.0 &&
+               bar.volume == bar.close * 2 && bar.timestamp == START + static_cast<int64_t>(bar.close) * MINUTE;
+    }
+
+    std::string ringName(const char *what)
+    {
+        return std::string("market_data_test_") + what + "_" + std::to_string(::getpid());
+    }
+
+    void checkOrderAndOverrun()
+    {
+        SharedMemoryPublisher publisher(ringName("order"), 6);
+        check(publisher.isOpen() && publisher.capacity() == 8, "capacity rounded up to a power of two");
+        SharedMemoryReader reader(publisher.name());
+        check(reader.isOpen(), "reader maps the ring");
+
+        SharedMemoryRing::Record record;
+        check(reader.next(record) == SharedMemoryReader::ReadResult::Empty, "new ring is empty");
+
+        publisher.publish("AAPL", 7, false, bars(0, 5).view());
+        bool ordered = true;
+        for (size_t i = 0; i < 5; ++i)
+        {
+            ordered = ordered && reader.next(record) == SharedMemoryReader::ReadResult::Record &&
+                      std::string(record.symbol) == "AAPL" && record.version == 7 && record.bar.close == i &&
+                      consistent(record);
+        }
+        check(ordered, "records read back in order");
+        check(reader.next(record) == SharedMemoryReader::ReadResult::Empty, "empty after the last record");
+
+        publisher.publish("AAPL", 8, true, MarketDataView());
+        check(reader.next(record) == SharedMemoryReader::ReadResult::Record &&
+                  (record.flags & SharedMemoryRing::FLAG_RESET) && record.version == 8,
+              "replaced series published as a reset record");
+
+        // A second reader opened now starts at the newest record
+        SharedMemoryReader late(publisher.name());
+        check(late.next(record) == SharedMemoryReader::ReadResult::Empty, "late reader starts at the end");
+
+        // 20 records into 8 slots: the reader lost the first 12
+        publisher.publish("MSFT", 9, false, bars(100, 20).view());
+        check(reader.next(record) == SharedMemoryReader::ReadResult::Overrun && reader.missed() == 12,
+              "lapped reader reports the overrun");
+        size_t after = 0;
+        bool resumed = true;
+        while (reader.next(record) == SharedMemoryReader::ReadResult::Record)
+        {
+            resumed = resumed && record.bar.close == 112 + after;
+            ++after;
+        }
+        check(resumed && after == 8, "lapped reader resumes at the oldest record left");
+
+        // Cost of a read once the records are there: loads and one copy, no system call
+        SharedMemoryPublisher big(ringName("cost"), 1 << 14);
+        SharedMemoryReader fast(big.name());
+        big.publish("COST", 1, false, bars(0, 1 << 14).view());
+        Clock::time_point start = Clock::now();
+        size_t got = 0;
+        while (fast.next(record) == SharedMemoryReader::ReadResult::Record)
+        {
+            ++got;
+        }
+        double nanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        check(got == (1 << 14), "every record read");
+        std::cout << "Reading " << got << " records from the ring: " << nanos / got << " ns per record" << std::endl;
+
+        publisher.publish("A_SYMBOL_TOO_LONG_FOR_THE_RING", 1, false, bars(0, 1).view());
+        check(publisher.stats().skipped == 1 && reader.next(record) == SharedMemoryReader::ReadResult::Empty,
+              "long symbol skipped");
+
+        SharedMemoryReader missing(ringName("missing"));
+        check(!missing.isOpen(), "reader of a missing ring is closed");
+    }
+
+    // Producer flat out, readers chasing it: every record read is whole and every one not read is counted
+    void checkConcurrentReaders()
+    {
+        SharedMemoryPublisher publisher(ringName("stress"), 1024);
+        std::atomic<bool> done{false};
+        std::vector<size_t> read(2, 0), missed(2, 0), torn(2, 0), disordered(2, 0);
+        std::vector<std::thread> readers;
+        std::atomic<size_t> ready{0};
+        for (size_t r = 0; r < 2; ++r)
+        {
+            readers.emplace_back([&, r]
+                                 {
+                                     SharedMemoryReader reader(publisher.name());
+                                     ++ready;
+                                     SharedMemoryRing::Record record;
+                                     double last = -1;
+                                     while (true)
+                                     {
+                                         SharedMemoryReader::ReadResult result = reader.next(record);
+                                         if (result == SharedMemoryReader::ReadResult::Record)
+                                         {
+                                             ++read[r];
+                                             torn[r] += consistent(record) ? 0 : 1;
+                                             disordered[r] += record.bar.close > last ? 0 : 1;
+                                             last = record.bar.close;
+                                         }
+                                         else if (result == SharedMemoryReader::ReadResult::Empty)
+                                         {
+                                             if (done)
+                                             {
+                                                 break;
+                                             }
+                                             std::this_thread::yield();
+                                         }
+                                     }
+                                     missed[r] = reader.missed();
+                                 });
+        }
+        while (ready < 2)
+        {
+            std::this_thread::yield();
+        }
+
+        for (size_t i = 0; i < STRESS_RECORDS; i += STRESS_BATCH)
+        {
+            publisher.publish("STRESS", i, false, bars(i, STRESS_BATCH).view());
+            // Give the readers a chance to run in between even on one core, and to be lapped mid-copy
+            std::this_thread::yield();
+        }
+        done = true;
+        for (auto &reader : readers)
+        {
+            reader.join();
+        }
+
+        for (size_t r = 0; r < 2; ++r)
+        {
+            check(torn[r] == 0, "reader " + std::to_string(r) + " saw no torn record");
+            check(disordered[r] == 0, "reader " + std::to_string(r) + " saw records in order");
+            check(read[r] + missed[r] == STRESS_RECORDS, "reader " + std::to_string(r) + " accounts for every record");
+        }
+        std::cout << STRESS_RECORDS << " records through a 1024 slot ring: readers got " << read[0] << " and " << read[1]
+                  << ", missed " << missed[0] << " and " << missed[1] << std::endl;
+    }
+
+    struct Latency
+    {
+        std::vector<double> micros;
+
+        void report(const char *path)
+        {
+            std::sort(micros.begin(), micros.end());
+            double total = 0;
+            for (double value : micros)
+            {
+                total += value;
+            }
+            std::cout << path << ": " << micros.size() << " updates, mean " << total / std::max<size_t>(micros.size(), 1)
+                      << " us, p50 " << micros[micros.size() / 2] << " us, p99 " << micros[micros.size() * 99 / 100]
+                      << " us" << std::endl;
+        }
+    };
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("shared_memory_log.txt");
+    checkOrderAndOverrun();
+    checkConcurrentReaders();
+
+    // Same update stream to both consumers: one new bar per merge
+    MarketDataServer::MergeMarketData("LAT", bars(0, 1000));
+    const uint64_t firstVersion = MarketDataServer::GetSnapshot("LAT")->version;
+    const uint64_t lastVersion = firstVersion + LATENCY_UPDATES;
+
+    std::shared_ptr<SharedMemoryPublisher> ring = MarketDataServer::StartSharedMemory(ringName("server"), 1 << 12);
+    check(ring != nullptr, "server ring started");
+    if (!ring)
+    {
+        return 1;
+    }
+    AsyncServer server(MarketDataServer::HandleRequest, 1);
+    unsigned short port = server.listen(0);
+    server.start();
+
+    std::vector<std::atomic<int64_t>> publishedAt(LATENCY_UPDATES + 1);
+    Latency shm;
+    Latency tcpPath;
+    std::atomic<bool> shmReady{false};
+    std::thread shmThread([&]
+                          {
+                              SharedMemoryReader reader(ring->name());
+                              shmReady = true;
+                              SharedMemoryRing::Record record;
+                              uint64_t version = firstVersion;
+                              while (version < lastVersion)
+                              {
+                                  if (reader.next(record) != SharedMemoryReader::ReadResult::Record)
+                                  {
+                                      std::this_thread::yield();
+                                      continue;
+                                  }
+                                  if (std::string(record.symbol) == "LAT" && record.version > version)
+                                  {
+                                      version = record.version;
+                                      shm.micros.push_back(
+                                          (Clock::now().time_since_epoch().count() -
+                                           publishedAt[version - firstVersion].load()) / 1000.0);
+                                  }
+                              }
+                          });
+
+    std::atomic<bool> tcpDone{false};
+    std::thread tcpThread([&]
+                          {
+                              boost::asio::io_context ioc;
+                              tcp::socket socket(ioc);
+                              socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+                              boost::asio::streambuf buffer;
+                              MarketDataClient::followSymbol(
+                                  socket, buffer, "LAT", WireFormat::BIN1,
+                                  [&](const MarketDataSeries &, const MarketDataSeries &, uint64_t version)
+                                  {
+                                      if (version > firstVersion)
+                                      {
+                                          tcpPath.micros.push_back((Clock::now().time_since_epoch().count() -
+                                                                    publishedAt[version - firstVersion].load()) /
+                                                                   1000.0);
+                                      }
+                                      return version < lastVersion;
+                                  });
+                              tcpDone = true;
+                          });
+
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+    while ((!shmReady || MarketDataServer::SubscriberCount("LAT") == 0) && Clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (size_t u = 1; u <= LATENCY_UPDATES; ++u)
+    {
+        publishedAt[u] = Clock::now().time_since_epoch().count();
+        MarketDataServer::MergeMarketData("LAT", bars(1000 + u, 1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    shmThread.join();
+    tcpThread.join();
+    server.stop();
+
+    check(shm.micros.size() == LATENCY_UPDATES, "every update reached the ring reader");
+    check(tcpDone && tcpPath.micros.size() == LATENCY_UPDATES, "every update reached the TCP subscriber");
+    check(ring->stats().records == LATENCY_UPDATES, "one record per new bar");
+    if (!shm.micros.empty() && !tcpPath.micros.empty())
+    {
+        shm.report("shared memory ring");
+        tcpPath.report("TCP SUB (BIN1)   ");
+        if (std::thread::hardware_concurrency() < 2)
+        {
+            std::cout << "(one core: both consumers wait for the producer thread to be descheduled, "
+                         "which dominates these numbers)" << std::endl;
+        }
+    }
+
+    MarketDataServer::StopSharedMemory();
+    ring.reset();
+    SharedMemoryReader gone(ringName("server"));
+    check(!gone.isOpen(), "ring unlinked once stopped");
+
+    return finish();
+}
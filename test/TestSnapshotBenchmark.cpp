@@ -0,0 +1,178 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MarketDataServer.hpp"
+#include "Timestamp.hpp"
+
+// Reader contention on the data cache: N reader threads fetch the latest data of one symbol while a
+// writer appends a bar every 100 us. Compares the previous mutex + full copy read with the RCU
+// snapshot read, and checks every snapshot a reader sees is internally consistent.
+// Usage: TestSnapshotBenchmark [history bars] [milliseconds per run]
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int64_t MINUTE = 60 * Timestamp::NANOS_PER_SECOND;
+    constexpr int64_t START = 1737019800LL * Timestamp::NANOS_PER_SECOND;
+
+    void appendBars(MarketDataSeries &series, size_t first, size_t count)
+    {
+        for (size_t i = first; i < first + count; ++i)
+        {
+            double price = 100.0 + static_cast<double>(i % 50);
+            series.push_back(START + static_cast<int64_t>(i) * MINUTE, price, price + 1, price - 1, price + 0.5, 1000.0);
+        }
+    }
+
+    // The cache as it was before snapshots: one mutex, readers copy the whole series
+    class LockedCache
+    {
+    public:
+        void append(const MarketDataSeries &bars)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_series.append(bars.view());
+        }
+
+        MarketDataSeries getData() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_series;
+        }
+
+    private:
+        MarketDataSeries m_series;
+        mutable std::mutex m_mutex;
+    };
+
+    struct RunResult
+    {
+        double readsPerSecond = 0.0;
+        size_t writes = 0;
+        size_t inconsistent = 0;
+    };
+
+    // Runs readers against read() while one writer calls write(), read returns the last close seen
+    template <typename Read, typename Write>
+    RunResult run(size_t readers, std::chrono::milliseconds duration, Read read, Write write)
+    {
+        std::atomic<bool> stop{false};
+        std::atomic<size_t> reads{0};
+        std::atomic<size_t> inconsistent{0};
+        size_t writes = 0;
+
+        std::vector<std::thread> threads;
+        for (size_t r = 0; r < readers; ++r)
+        {
+            threads.emplace_back([&]
+                                 {
+                                     size_t local = 0;
+                                     while (!stop.load(std::memory_order_relaxed))
+                                     {
+                                         if (!read())
+                                         {
+                                             ++inconsistent;
+                                         }
+                                         ++local;
+                                     }
+                                     reads += local;
+                                 });
+        }
+
+        Clock::time_point start = Clock::now();
+        while (Clock::now() - start < duration)
+        {
+            write(writes++);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        stop = true;
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return {reads / seconds, writes, inconsistent.load()};
+    }
+
+    // Sorted one minute bars starting at START, so the last timestamp follows from the size
+    bool consistent(const MarketDataView &view)
+    {
+        return !view.empty() && view.timestamps()[view.size() - 1] == START + static_cast<int64_t>(view.size() - 1) * MINUTE &&
+               view.close()[view.size() - 1] > 0.0;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t history = argc > 1 ? std::stoul(argv[1]) : 100000;
+    std::chrono::milliseconds duration(argc > 2 ? std::stoul(argv[2]) : 500);
+
+    MarketDataSeries initial;
+    appendBars(initial, 0, history);
+
+    std::cout << "History " << history << " bars, one writer appending every 100 us, "
+              << duration.count() << " ms per run" << std::endl;
+    std::cout << std::left << std::setw(10) << "readers" << std::setw(22) << "mutex+copy reads/s"
+              << std::setw(22) << "snapshot reads/s" << "speed-up" << std::endl;
+
+    size_t failures = 0;
+    for (size_t readers : {1, 2, 4, 8, 16})
+    {
+        LockedCache locked;
+        locked.append(initial);
+        RunResult lockedRun = run(
+            readers, duration,
+            [&locked]
+            {
+                MarketDataSeries data = locked.getData();
+                return consistent(data.view());
+            },
+            [&locked, history](size_t i)
+            {
+                MarketDataSeries bar;
+                appendBars(bar, history + i, 1);
+                locked.append(bar);
+            });
+
+        MarketDataServer::DataCache cache;
+        cache.updateData("BENCH", initial);
+        RunResult snapshotRun = run(
+            readers, duration,
+            [&cache]
+            {
+                auto snapshot = cache.snapshot("BENCH");
+                return snapshot && consistent(snapshot->view);
+            },
+            [&cache, history](size_t i)
+            {
+                MarketDataSeries bar;
+                appendBars(bar, history + i, 1);
+                cache.mergeData("BENCH", bar);
+            });
+
+        failures += lockedRun.inconsistent + snapshotRun.inconsistent;
+        if (cache.getData("BENCH").size() != history + snapshotRun.writes)
+        {
+            std::cerr << "FAIL: snapshot cache lost bars" << std::endl;
+            ++failures;
+        }
+
+        std::cout << std::left << std::setw(10) << readers << std::setw(22) << std::fixed << std::setprecision(0)
+                  << lockedRun.readsPerSecond << std::setw(22) << snapshotRun.readsPerSecond << std::setprecision(1)
+                  << snapshotRun.readsPerSecond / lockedRun.readsPerSecond << "x" << std::endl;
+    }
+
+    if (failures != 0)
+    {
+        std::cerr << "FAIL: " << failures << " inconsistent reads" << std::endl;
+        return 1;
+    }
+    return 0;
+}
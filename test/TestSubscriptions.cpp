@@ -0,0 +1,290 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include "AsyncClient.hpp"
+#include "AsyncServer.hpp"
+#include "MarketDataClient.hpp"
+#include "MarketDataServer.hpp"
+#include "SubscriptionHub.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// SubscriptionHub against recording connections: snapshot then only changed bars, one encode shared by
+// every subscriber of a format, no version sent twice, closed connections forgotten. Then SUB end to end:
+// followers on loopback connections track a symbol through a series of refreshes and must end up with
+// exactly the cached series, with push latency and bytes compared against polling the whole history.
+// Last, one merge that fills a gap and revises a later bar must leave both clients with the server's series.
+
+namespace
+{
+    using namespace TestSupport;
+    using boost::asio::ip::tcp;
+
+    constexpr size_t HISTORY = 5000;
+    constexpr size_t REFRESHES = 20;
+    constexpr size_t FOLLOWERS = 8;
+
+    /// @brief Connection that keeps what is sent to it
+    class RecordingConnection : public ServerConnection
+    {
+    public:
+        void send(ServerResponse response) override { sent.push_back(std::move(response)); }
+
+        // The bytes of message index as one string
+        std::string text(size_t index) const
+        {
+            std::string out;
+            for (const auto &buffer : sent[index].buffers)
+            {
+                out.append(static_cast<const char *>(buffer.data()), buffer.size());
+            }
+            return out;
+        }
+
+        std::vector<ServerResponse> sent;
+    };
+
+    void checkHub()
+    {
+        MarketDataServer::DataCache cache;
+        SubscriptionHub hub([&cache](const std::string &symbol)
+                            { return cache.snapshot(symbol); });
+        cache.setUpdateListener([&hub](const MarketDataServer::CacheUpdate &update)
+                                { hub.publish(update); });
+
+        MarketDataSeries history;
+        for (size_t i = 0; i < 100; ++i)
+        {
+            addBar(history, i, 100.0 + i);
+        }
+        cache.mergeData("HUB", history);
+
+        auto csvA = std::make_shared<RecordingConnection>();
+        auto csvB = std::make_shared<RecordingConnection>();
+        auto binary = std::make_shared<RecordingConnection>();
+        auto gone = std::make_shared<RecordingConnection>();
+
+        ServerResponse opened = hub.subscribe("HUB", WireFormat::CSV, csvA);
+        std::string openedText;
+        for (const auto &buffer : opened.buffers)
+        {
+            openedText.append(static_cast<const char *>(buffer.data()), buffer.size());
+        }
+        check(openedText.rfind("SUBSCRIBED:HUB:1\nDATA_SIZE:", 0) == 0, "subscription opens with the snapshot");
+        hub.subscribe("HUB", WireFormat::CSV, csvB);
+        hub.subscribe("HUB", WireFormat::BIN1, binary);
+        hub.subscribe("HUB", WireFormat::BIN1, gone);
+        check(hub.subscriberCount("HUB") == 4, "four subscribers");
+        gone.reset();
+        check(hub.subscriberCount("HUB") == 3, "a closed connection no longer counts");
+
+        // Revise the last bar and add one: only those two bars go out
+        cache.mergeData("HUB", refresh(99, 250.0));
+        check(csvA->sent.size() == 1 && csvB->sent.size() == 1 && binary->sent.size() == 1, "one push per subscriber");
+        check(csvA->text(0).rfind("UPDATE:HUB:2\nDATA_SIZE:", 0) == 0, "CSV update header");
+        check(binary->text(0) == "UPDATE:HUB:2\nBIN1:2\n" + binary->text(0).substr(20) &&
+                  binary->text(0).size() == 20 + 2 * sizeof(WireRecord),
+              "BIN1 update carries the two changed bars");
+        check(csvA->sent[0].owners[1] == csvB->sent[0].owners[1], "subscribers of a format share one encoded payload");
+        check(csvA->sent[0].owners[1] != binary->sent[0].owners[1], "each format encoded separately");
+        const auto &delta = *cache.snapshot("HUB")->recentChanges.back();
+        check(binary->sent[0].owners[1] == delta.payloads.get(delta.changed.view(), WireFormat::BIN1),
+              "push shares its encoding with conditional GETs of the version");
+
+        // Nothing changed, nothing pushed
+        cache.mergeData("HUB", refresh(99, 250.0));
+        check(csvA->sent.size() == 1, "unchanged refresh not pushed");
+
+        // A subscriber that (re)subscribes after a version was published is not sent it again
+        hub.subscribe("HUB", WireFormat::CSV, csvB);
+        MarketDataServer::CacheUpdate stale;
+        stale.symbol = "HUB";
+        stale.snapshot = cache.snapshot("HUB");
+        hub.publish(stale);
+        check(csvB->sent.size() == 1, "version already in the snapshot not pushed twice");
+
+        // Replacing the series resets subscribers with every bar
+        cache.updateData("HUB", history);
+        check(csvA->text(1).rfind("RESET:HUB:3\nDATA_SIZE:", 0) == 0, "replaced series pushed as a reset");
+
+        check(hub.unsubscribe("HUB", csvA) && !hub.unsubscribe("HUB", csvA), "unsubscribe once");
+        cache.mergeData("HUB", refresh(99, 300.0));
+        check(csvA->sent.size() == 2 && csvB->sent.size() == 3, "no pushes after unsubscribe");
+    }
+
+    // Minutes 1-4 and 6-8, then one merge with minute 5 and a revised minute 7. The pushed change lists
+    // both, the gap fill first, and both clients must end up with exactly the server's bars
+    void checkBackFill(unsigned short port)
+    {
+        MarketDataSeries history;
+        for (size_t minute : {1, 2, 3, 4, 6, 7, 8})
+        {
+            addBar(history, minute, 1.0);
+        }
+        MarketDataServer::MergeMarketData("FILL", history);
+        const uint64_t filled = MarketDataServer::GetSnapshot("FILL")->version + 1;
+
+        MarketDataSeries followed;
+        std::thread follower([&]
+                             {
+                                 boost::asio::io_context ioc;
+                                 tcp::socket socket(ioc);
+                                 socket.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), port));
+                                 boost::asio::streambuf buffer;
+                                 MarketDataClient::followSymbol(
+                                     socket, buffer, "FILL", WireFormat::BIN1,
+                                     [&](const MarketDataSeries &series, const MarketDataSeries &, uint64_t version)
+                                     {
+                                         followed = series;
+                                         return version < filled;
+                                     });
+                             });
+
+        boost::asio::io_context ioc;
+        auto work = boost::asio::make_work_guard(ioc);
+        std::thread ioThread([&ioc]
+                             { ioc.run(); });
+        auto client = AsyncClient::create(ioc);
+        client->connect("127.0.0.1", port).get();
+        std::promise<MarketDataSeries> pushed;
+        client->subscribe("FILL", WireFormat::BIN1,
+                          [&](const MarketDataSeries &series, const MarketDataSeries &, uint64_t version)
+                          {
+                              if (version < filled)
+                              {
+                                  return true;
+                              }
+                              pushed.set_value(series);
+                              return false;
+                          });
+
+        Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+        while (MarketDataServer::SubscriberCount("FILL") < 2 && Clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        MarketDataSeries change;
+        addBar(change, 5, 2.0);
+        addBar(change, 7, 9.0);
+        MarketDataServer::MergeMarketData("FILL", change);
+
+        follower.join();
+        std::future<MarketDataSeries> result = pushed.get_future();
+        bool arrived = result.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+        auto snapshot = MarketDataServer::GetSnapshot("FILL");
+        check(snapshot->version == filled && snapshot->view.size() == 8, "gap filled on the server");
+        check(exact(followed.view(), snapshot->view), "SUB follower applies a gap fill and a revision in one update");
+        check(arrived && exact(result.get().view(), snapshot->view),
+              "AsyncClient applies a gap fill and a revision in one update");
+
+        client->close();
+        work.reset();
+        ioThread.join();
+    }
+}
+
+int main()
+{
+    Logger::getInstance().setLogFile("subscriptions_log.txt");
+    checkHub();
+
+    MarketDataSeries history;
+    for (size_t i = 0; i < HISTORY; ++i)
+    {
+        addBar(history, i, 100.0 + (i % 50));
+    }
+    MarketDataServer::MergeMarketData("SUBT", history);
+    const uint64_t firstVersion = MarketDataServer::GetSnapshot("SUBT")->version;
+    const uint64_t lastVersion = firstVersion + REFRESHES;
+
+    AsyncServer server(MarketDataServer::HandleRequest, 2);
+    unsigned short port = server.listen(0);
+    server.start();
+    tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), port);
+
+    // Publication time of each version, read by the followers to measure push latency
+    std::vector<std::atomic<int64_t>> publishedAt(REFRESHES + 1);
+    std::atomic<int64_t> latencyTotalNs{0};
+    std::atomic<int64_t> latencyMaxNs{0};
+    std::atomic<size_t> updates{0};
+
+    std::vector<MarketDataSeries> finalSeries(FOLLOWERS);
+    std::vector<int> results(FOLLOWERS, 0);
+    std::vector<std::thread> followers;
+    for (size_t f = 0; f < FOLLOWERS; ++f)
+    {
+        followers.emplace_back([&, f]
+                               {
+                                   boost::asio::io_context ioc;
+                                   tcp::socket socket(ioc);
+                                   socket.connect(endpoint);
+                                   boost::asio::streambuf buffer;
+                                   bool ok = MarketDataClient::followSymbol(
+                                       socket, buffer, "SUBT", WireFormat::BIN1,
+                                       [&, f](const MarketDataSeries &series, const MarketDataSeries &, uint64_t version)
+                                       {
+                                           if (version > firstVersion)
+                                           {
+                                               int64_t latency = Clock::now().time_since_epoch().count() -
+                                                                 publishedAt[version - firstVersion].load();
+                                               latencyTotalNs += latency;
+                                               int64_t seen = latencyMaxNs.load();
+                                               while (latency > seen && !latencyMaxNs.compare_exchange_weak(seen, latency))
+                                               {
+                                               }
+                                               ++updates;
+                                           }
+                                           finalSeries[f] = series;
+                                           return version < lastVersion;
+                                       });
+                                   results[f] = ok ? 1 : -1;
+                               });
+    }
+
+    Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+    while (MarketDataServer::SubscriberCount("SUBT") < FOLLOWERS && Clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    check(MarketDataServer::SubscriberCount("SUBT") == FOLLOWERS, "every follower subscribed");
+
+    // Refreshes as DataUpdateTask would merge them, spaced so each push is timed on its own
+    for (size_t r = 1; r <= REFRESHES; ++r)
+    {
+        size_t lastMinute = HISTORY - 2 + r;
+        publishedAt[r] = Clock::now().time_since_epoch().count();
+        MarketDataServer::MergeMarketData("SUBT", refresh(lastMinute, 500.0 + r));
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+
+    for (auto &follower : followers)
+    {
+        follower.join();
+    }
+    MarketDataSeries cached = MarketDataServer::GetLatestData("SUBT");
+    for (size_t f = 0; f < FOLLOWERS; ++f)
+    {
+        check(results[f] == 1, "follower " + std::to_string(f) + " ended with UNSUBSCRIBED");
+        check(sameBars(finalSeries[f].view(), cached.view()), "follower " + std::to_string(f) + " matches the cache");
+    }
+    check(updates == FOLLOWERS * REFRESHES, "every refresh reached every follower");
+    check(MarketDataServer::SubscriberCount("SUBT") == 0, "followers unsubscribed");
+    checkBackFill(port);
+
+    // Bytes per follower: each push carries two bars, a poll the whole history
+    size_t pushBytes = REFRESHES * (std::string("UPDATE:SUBT:00\n").size() + 8 + 2 * sizeof(WireRecord));
+    size_t pollBytes = REFRESHES * WireEncoder::encode(cached.view(), WireFormat::BIN1)->bytes().size();
+    std::cout << FOLLOWERS << " followers x " << REFRESHES << " refreshes of a " << cached.size()
+              << " bar history: push latency mean "
+              << latencyTotalNs / 1000.0 / std::max<size_t>(updates, 1) << " us, max " << latencyMaxNs / 1000.0
+              << " us; ~" << pushBytes << " bytes per follower pushed vs " << pollBytes << " polling with GET"
+              << std::endl;
+
+    return finish();
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "AsyncServer.hpp"
+#include "MarketDataSeries.hpp"
+#include "Timestamp.hpp"
+
+// Shared by the self-checking tests: check() counts failures, finish() prints PASS when there were none and
+// gives main its exit code. The series factories are deterministic so failures reproduce.
+
+namespace TestSupport
+{
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int64_t MINUTE = 60 * Timestamp::NANOS_PER_SECOND;
+    constexpr int64_t START = 1737019800LL * Timestamp::NANOS_PER_SECOND; // 2025-01-16 09:30:00
+
+    inline int g_failures = 0;
+
+    inline void check(bool condition, const std::string &what)
+    {
+        if (!condition)
+        {
+            std::cerr << "FAIL: " << what << std::endl;
+            ++g_failures;
+        }
+    }
+
+    inline int finish()
+    {
+        if (g_failures == 0)
+        {
+            std::cout << "PASS" << std::endl;
+        }
+        return g_failures == 0 ? 0 : 1;
+    }
+
+    // Minute bars [first, first + rows) on a random walk from price, moving up to step a bar
+    inline MarketDataSeries makeSeries(size_t rows, double price = 187.33, size_t first = 0, double step = 0.01)
+    {
+        MarketDataSeries series;
+        for (size_t i = first; i < first + rows; ++i)
+        {
+            price += (static_cast<double>((i * 2654435761u) % 2001) - 1000.0) / 1000.0 * step;
+            series.push_back(START + static_cast<int64_t>(i) * MINUTE, price, price + 0.125, price - 0.25,
+                             price + 0.0625, 1000.0 + (i * 7919) % 5000);
+        }
+        return series;
+    }
+
+    // Prices no short decimal represents, timestamps off the minute grid, for exact round trips
+    inline MarketDataSeries arbitrarySeries(size_t rows)
+    {
+        MarketDataSeries series;
+        double price = 187.3312;
+        for (size_t i = 0; i < rows; ++i)
+        {
+            price += (static_cast<double>((i * 2654435761u) % 2001) - 1000.0) / 100000.0;
+            series.push_back(START + static_cast<int64_t>(i) * MINUTE + (i % 7) * 1000003, price, price + 0.123456789,
+                             price - 0.1 / 3, price + 1e-7 * i, 1000.5 + (i * 37) % 5000);
+        }
+        return series;
+    }
+
+    // A bar whose fields derive from its minute and close
+    inline void addBar(MarketDataSeries &series, size_t minute, double close)
+    {
+        series.push_back(START + static_cast<int64_t>(minute) * MINUTE, close - 0.5, close + 1.0, close - 1.0, close,
+                         1000.0 + minute);
+    }
+
+    // A refresh as the upstream API returns it: the bar still forming is revised and one new bar starts
+    inline MarketDataSeries refresh(size_t lastMinute, double close)
+    {
+        MarketDataSeries fetched;
+        addBar(fetched, lastMinute, close);
+        addBar(fetched, lastMinute + 1, close + 0.25);
+        return fetched;
+    }
+
+    inline bool sameBits(double a, double b)
+    {
+        return std::memcmp(&a, &b, sizeof(a)) == 0;
+    }
+
+    // Same timestamps, closes and volumes. A and B are each a MarketDataSeries or a MarketDataView
+    template <typename A, typename B>
+    bool sameBars(const A &a, const B &b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (a.timestamps()[i] != b.timestamps()[i] || a.close()[i] != b.close()[i] || a.volume()[i] != b.volume()[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Same timestamps and the same bits in every column, NaN included
+    template <typename A, typename B>
+    bool exact(const A &a, const B &b)
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (a.timestamps()[i] != b.timestamps()[i] || !sameBits(a.open()[i], b.open()[i]) ||
+                !sameBits(a.high()[i], b.high()[i]) || !sameBits(a.low()[i], b.low()[i]) ||
+                !sameBits(a.close()[i], b.close()[i]) || !sameBits(a.volume()[i], b.volume()[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The bytes of a response as one string
+    inline std::string text(const ServerResponse &response)
+    {
+        std::string out;
+        for (const auto &buffer : response.buffers)
+        {
+            out.append(static_cast<const char *>(buffer.data()), buffer.size());
+        }
+        return out;
+    }
+}
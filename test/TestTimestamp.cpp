@@ -0,0 +1,98 @@
+#include <iostream>
+#include <string>
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+
+// Timestamp::parse and format: the accepted layouts, fractions, instants before 1970, days checked against
+// the length of their month, malformed text and leap seconds rejected, and format / parse round trips.
+
+namespace
+{
+    using namespace TestSupport;
+
+    constexpr int64_t DAY = 86400 * Timestamp::NANOS_PER_SECOND;
+
+    bool parsesTo(const std::string &text, int64_t expected)
+    {
+        int64_t nanos = 0;
+        return Timestamp::parse(text, nanos) && nanos == expected;
+    }
+
+    // Rejected and the out-parameter left as it was
+    bool rejects(const std::string &text)
+    {
+        int64_t nanos = 12345;
+        return !Timestamp::parse(text, nanos) && nanos == 12345;
+    }
+}
+
+int main()
+{
+    // Layouts
+    check(parsesTo("2025-01-16", START - (9 * 3600 + 30 * 60) * Timestamp::NANOS_PER_SECOND), "date only");
+    check(parsesTo("2025-01-16T09:30:00", START), "ISO-8601 'T' separator");
+    check(parsesTo("2025-01-16 09:30:00", START), "Alpha Vantage ' ' separator");
+    check(parsesTo("1970-01-01T00:00:00", 0), "epoch");
+
+    // Fractions of one to nine digits
+    check(parsesTo("2025-01-16T09:30:00.5", START + 500000000), "one fraction digit");
+    check(parsesTo("2025-01-16T09:30:00.123", START + 123000000), "milliseconds");
+    check(parsesTo("2025-01-16T09:30:00.000123", START + 123000), "microseconds");
+    check(parsesTo("2025-01-16T09:30:00.123456789", START + 123456789), "nanoseconds");
+
+    // Before 1970
+    check(parsesTo("1969-12-31T23:59:59", -Timestamp::NANOS_PER_SECOND), "one second before the epoch");
+    check(parsesTo("1969-12-31T23:59:59.75", -250000000), "fraction before the epoch");
+    check(parsesTo("1900-03-01", -25508 * DAY), "1900, not a leap year");
+
+    // Days against the month
+    check(parsesTo("2024-02-29", 19782 * DAY), "29 February in a leap year");
+    check(parsesTo("2000-02-29", 11016 * DAY), "29 February 2000, divisible by 400");
+    check(rejects("2025-02-29"), "29 February in a common year");
+    check(rejects("1900-02-29"), "29 February 1900, divisible by 100");
+    check(rejects("2025-02-31"), "31 February");
+    check(rejects("2025-04-31"), "31 April");
+    check(rejects("2025-06-31"), "31 June");
+    check(rejects("2025-09-31") && rejects("2025-11-31"), "31 September and November");
+    check(parsesTo("2025-01-31", 20119 * DAY) && parsesTo("2025-04-30", 20208 * DAY) &&
+              parsesTo("2025-12-31", 20453 * DAY),
+          "last days of the months");
+    check(rejects("2025-01-00") && rejects("2025-01-32"), "day out of range");
+    check(rejects("2025-00-10") && rejects("2025-13-10"), "month out of range");
+
+    // Malformed text
+    check(rejects("") && rejects("2025-01-1") && rejects("2025/01/16"), "bad date layout");
+    check(rejects("2025-01-16X09:30:00") && rejects("2025-01-16T09:30") && rejects("2025-01-16T09-30-00"),
+          "bad time layout");
+    check(rejects("2025-01-16T24:00:00") && rejects("2025-01-16T09:60:00") && rejects("2025-01-16T09:30:61"),
+          "time out of range");
+    check(rejects("2016-12-31T23:59:60") && rejects("2025-01-16T09:30:60.5"), "leap second rejected");
+    check(rejects("2025-01-16T09:30:00.") && rejects("2025-01-16T09:30:00.1234567890") &&
+              rejects("2025-01-16T09:30:00,5") && rejects("2025-01-16T09:30:00.5x"),
+          "bad fraction");
+    check(rejects("2a25-01-16") && rejects(" 2025-01-16"), "non digits");
+
+    // Format writes the shortest exact fraction
+    check(Timestamp::toString(START) == "2025-01-16T09:30:00", "whole seconds");
+    check(Timestamp::toString(START + 5000000) == "2025-01-16T09:30:00.005", "milliseconds written");
+    check(Timestamp::toString(START + 5000) == "2025-01-16T09:30:00.000005", "microseconds written");
+    check(Timestamp::toString(START + 5) == "2025-01-16T09:30:00.000000005", "nanoseconds written");
+    check(Timestamp::toString(-1) == "1969-12-31T23:59:59.999999999", "instant before the epoch");
+
+    // Round trips across four centuries around 1970, whole seconds with each kind of fraction
+    size_t roundTrips = 0;
+    size_t total = 0;
+    for (int64_t second = -200 * 365 * 86400LL; second < 200 * 365 * 86400LL; second += 7 * 86400 + 3601)
+    {
+        for (int64_t fraction : {0, 250000000, 1000, 999999999})
+        {
+            int64_t nanos = second * Timestamp::NANOS_PER_SECOND + fraction;
+            int64_t parsed = 0;
+            roundTrips += Timestamp::parse(Timestamp::toString(nanos), parsed) && parsed == nanos;
+            ++total;
+        }
+    }
+    check(roundTrips == total, "format then parse gives the instant back");
+
+    return finish();
+}
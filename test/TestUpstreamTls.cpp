@@ -0,0 +1,243 @@
+#include <iostream>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast.hpp>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include "MarketDataServer.hpp"
+#include "TestSupport.hpp"
+#include "UpstreamClient.hpp"
+
+// Runs UpstreamClient against a local TLS stand-in with a self-signed certificate made at start-up.
+// Checks that requests share one keep-alive connection, that a new connection resumes the TLS
+// session, that a pooled connection dropped by the server is retried, and that stats add up.
+
+namespace
+{
+    using namespace TestSupport;
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+    namespace ssl = boost::asio::ssl;
+    using boost::asio::ip::tcp;
+
+    constexpr size_t BAR_COUNT = 500;
+
+    std::string makeIntradayJson(size_t bars)
+    {
+        std::string json = R"J({"Meta Data":{"2. Symbol":"TEST"},"Time Series (1min)":{)J";
+        char line[192];
+        for (size_t i = 0; i < bars; ++i)
+        {
+            std::snprintf(line, sizeof(line),
+                          R"J(%s"2025-01-16 %02zu:%02zu:00":{"1. open":"100.0","2. high":"101.0","3. low":"99.0","4. close":"100.5","5. volume":"%zu"})J",
+                          i == 0 ? "" : ",", 9 + i / 60, i % 60, 1000 + i);
+            json += line;
+        }
+        json += "}}";
+        return json;
+    }
+
+    // Self-signed P-256 certificate for CN=localhost, valid for a day
+    void useSelfSignedCertificate(ssl::context &ctx)
+    {
+        EVP_PKEY *key = EVP_EC_gen("P-256");
+        X509 *cert = X509_new();
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME *name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, key, EVP_sha256());
+
+        SSL_CTX_use_certificate(ctx.native_handle(), cert);
+        SSL_CTX_use_PrivateKey(ctx.native_handle(), key);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+    }
+
+    /// @brief Keep-alive HTTPS server on a loopback port, one thread per connection.
+    /// A request for symbol STALE is answered and then the connection is dropped without notice
+    class TlsStandIn
+    {
+    public:
+        TlsStandIn()
+            : m_ctx(ssl::context::tlsv12_server),
+              m_acceptor(m_ioc, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0)),
+              m_body(makeIntradayJson(BAR_COUNT))
+        {
+            useSelfSignedCertificate(m_ctx);
+            static const unsigned char SESSION_CONTEXT[] = "standin";
+            SSL_CTX_set_session_id_context(m_ctx.native_handle(), SESSION_CONTEXT, sizeof(SESSION_CONTEXT));
+            m_acceptThread = std::thread([this] { acceptLoop(); });
+        }
+
+        ~TlsStandIn()
+        {
+            // Wake the blocking accept with a connection of our own
+            m_stopping = true;
+            tcp::socket wake(m_ioc);
+            boost::system::error_code ec;
+            wake.connect(m_acceptor.local_endpoint(), ec);
+            m_acceptThread.join();
+            for (auto &thread : m_connectionThreads)
+            {
+                thread.join();
+            }
+        }
+
+        std::string port() const { return std::to_string(m_acceptor.local_endpoint().port()); }
+        size_t accepted() const { return m_accepted; }
+        size_t served() const { return m_served; }
+
+    private:
+        void acceptLoop()
+        {
+            while (true)
+            {
+                tcp::socket socket(m_ioc);
+                m_acceptor.accept(socket);
+                if (m_stopping)
+                {
+                    return;
+                }
+                ++m_accepted;
+                socket.set_option(tcp::no_delay(true));
+                m_connectionThreads.emplace_back([this, s = std::move(socket)]() mutable { serve(std::move(s)); });
+            }
+        }
+
+        void serve(tcp::socket socket)
+        {
+            try
+            {
+                ssl::stream<tcp::socket> stream(std::move(socket), m_ctx);
+                stream.handshake(ssl::stream_base::server);
+
+                beast::flat_buffer buffer;
+                while (true)
+                {
+                    http::request<http::empty_body> req;
+                    http::read(stream, buffer, req);
+
+                    http::response<http::string_body> res{http::status::ok, req.version()};
+                    res.set(http::field::content_type, "application/json");
+                    res.keep_alive(req.keep_alive());
+                    res.body() = m_body;
+                    res.prepare_payload();
+                    http::write(stream, res);
+                    ++m_served;
+
+                    if (std::string(req.target()).find("symbol=STALE") != std::string::npos || !req.keep_alive())
+                    {
+                        return;
+                    }
+                }
+            }
+            catch (const std::exception &)
+            {
+                // Client went away
+            }
+        }
+
+        boost::asio::io_context m_ioc;
+        ssl::context m_ctx;
+        tcp::acceptor m_acceptor;
+        std::string m_body;
+        std::thread m_acceptThread;
+        std::vector<std::thread> m_connectionThreads;
+        std::atomic<bool> m_stopping{false};
+        std::atomic<size_t> m_accepted{0};
+        std::atomic<size_t> m_served{0};
+    };
+
+    size_t fetchBars(UpstreamClient &client, const std::string &symbol, bool &ok)
+    {
+        size_t bars = 0;
+        ok = MarketDataServer::StreamMarketData(client, "demo", symbol, [&bars](MarketDataSeries &batch)
+                                                {
+                                                    bars += batch.size();
+                                                    return true;
+                                                });
+        return bars;
+    }
+}
+
+int main()
+{
+    TlsStandIn server;
+    {
+        UpstreamConfig config;
+        config.host = "localhost";
+        config.port = server.port();
+        UpstreamClient client(config);
+        bool ok = false;
+
+        // Back to back requests share one connection and one handshake
+        for (int i = 0; i < 5; ++i)
+        {
+            check(fetchBars(client, "TEST", ok) == BAR_COUNT && ok, "keep-alive request " + std::to_string(i));
+        }
+        UpstreamStats stats = client.stats();
+        check(stats.connectionsOpened == 1, "5 requests opened " + std::to_string(stats.connectionsOpened) + " connections");
+        check(stats.connectionsReused == 4, "expected 4 reused connections");
+        check(stats.resolves == 1, "host resolved more than once");
+        check(stats.tlsHandshakes == 1 && stats.tlsResumed == 0, "expected one full handshake");
+        check(server.accepted() == 1, "stand-in accepted more than one connection");
+
+        // A new connection resumes the cached session
+        client.closeIdle();
+        check(fetchBars(client, "TEST", ok) == BAR_COUNT && ok, "request after closeIdle");
+        stats = client.stats();
+        check(stats.tlsHandshakes == 2 && stats.tlsResumed == 1, "second handshake did not resume the session");
+
+        // The stand-in drops this connection silently, the next request must retry on a fresh one
+        check(fetchBars(client, "STALE", ok) == BAR_COUNT && ok, "request before the drop");
+        check(fetchBars(client, "TEST", ok) == BAR_COUNT && ok, "request on a dropped pooled connection");
+        stats = client.stats();
+        check(stats.connectionsOpened == 3, "dropped connection was not replaced");
+        check(stats.failures == 0, "requests failed: " + std::to_string(stats.failures));
+
+        // Concurrent requests each take their own pooled connection
+        std::vector<std::thread> workers;
+        std::atomic<size_t> good{0};
+        for (int t = 0; t < 4; ++t)
+        {
+            workers.emplace_back([&client, &good]
+                                 {
+                                     for (int i = 0; i < 5; ++i)
+                                     {
+                                         bool fetched = false;
+                                         if (fetchBars(client, "TEST", fetched) == BAR_COUNT && fetched)
+                                         {
+                                             ++good;
+                                         }
+                                     }
+                                 });
+        }
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        check(good == 20, "concurrent requests failed");
+
+        stats = client.stats();
+        check(stats.requests == 28 && stats.failures == 0, "request count does not add up");
+        check(stats.minLatencyMs > 0.0 && stats.minLatencyMs <= stats.meanLatencyMs() &&
+                  stats.meanLatencyMs() <= stats.maxLatencyMs,
+              "latency stats out of order");
+
+        std::cout << stats.requests << " requests on " << stats.connectionsOpened << " connections, "
+                  << stats.tlsResumed << "/" << stats.tlsHandshakes << " handshakes resumed, latency min/mean/max "
+                  << stats.minLatencyMs << "/" << stats.meanLatencyMs() << "/" << stats.maxLatencyMs << " ms"
+                  << std::endl;
+    }
+
+    return finish();
+}
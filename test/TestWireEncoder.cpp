@@ -0,0 +1,110 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DataParser.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+#include "WireEncoder.hpp"
+
+// Checks the CSV wire encoding: the size header matches the body, the body parses back to the exact
+// same bars, and a PayloadCache encodes once no matter how many senders ask. Also times the encoder
+// against the previous stringstream formatting.
+
+namespace
+{
+    using namespace TestSupport;
+
+    // What SendMarketData did before the encoder
+    std::string encodeWithStream(const MarketDataView &data)
+    {
+        std::stringstream ss;
+        ss << "timestamp,open,high,low,close,volume\n";
+        for (const auto &row : data)
+        {
+            ss << Timestamp::toString(row.timestamp()) << "," << row.open() << "," << row.high() << ","
+               << row.low() << "," << row.close() << "," << row.volume() << "\n";
+        }
+        std::string body = ss.str();
+        return "DATA_SIZE:" + std::to_string(body.size()) + "\n" + body;
+    }
+}
+
+int main()
+{
+    const size_t rows = 100000;
+    MarketDataSeries series = arbitrarySeries(rows);
+    MarketDataView view = series.view();
+
+    auto start = Clock::now();
+    std::shared_ptr<const EncodedPayload> payload = WireEncoder::encode(view, WireFormat::CSV);
+    double encoderMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    std::string streamed = encodeWithStream(view);
+    double streamMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    // Header announces exactly the body that follows
+    std::string_view bytes = payload->bytes();
+    size_t newline = bytes.find('\n');
+    check(bytes.substr(0, 10) == "DATA_SIZE:", "payload starts with the size header");
+    size_t announced = std::stoul(std::string(bytes.substr(10, newline - 10)));
+    check(announced == bytes.size() - newline - 1, "DATA_SIZE matches the body length");
+    check(payload->rows == rows, "row count recorded");
+    check(payload->buffer.capacity() == payload->buffer.size(), "worst case allocation given back");
+
+    // The body parses back to the same bars, doubles included
+    std::string path = (std::filesystem::temp_directory_path() / "market_parser_wire.csv").string();
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << bytes.substr(newline + 1);
+    }
+    auto parser = ParserFactory::createCSVParser(path);
+    check(parser->parseData(), "encoded body parses");
+    const MarketDataSeries &parsed = parser->getData();
+    check(exact(parsed, view), "round trip through the CSV parser is exact");
+    std::remove(path.c_str());
+
+    // Many senders, one encode
+    PayloadCache cache;
+    std::vector<std::thread> senders;
+    std::atomic<size_t> distinct{0};
+    std::shared_ptr<const EncodedPayload> first = cache.get(view, WireFormat::CSV);
+    for (int t = 0; t < 8; ++t)
+    {
+        senders.emplace_back([&]
+                             {
+                                 for (int i = 0; i < 1000; ++i)
+                                 {
+                                     if (cache.get(view, WireFormat::CSV) != first)
+                                     {
+                                         ++distinct;
+                                     }
+                                 }
+                             });
+    }
+    for (auto &sender : senders)
+    {
+        sender.join();
+    }
+    check(distinct == 0, "every send shares the first encoded payload");
+
+    start = Clock::now();
+    for (int i = 0; i < 1000; ++i)
+    {
+        cache.get(view, WireFormat::CSV);
+    }
+    double cachedUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / 1000;
+
+    std::cout << rows << " bars: stringstream " << streamMs << " ms (" << streamed.size() << " bytes), encoder "
+              << encoderMs << " ms (" << bytes.size() << " bytes), cached payload " << cachedUs << " us per send"
+              << std::endl;
+
+    return finish();
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+#include "MarketDataClient.hpp"
+#include "Protocol.hpp"
+#include "TestSupport.hpp"
+#include "Timestamp.hpp"
+#include "WireDecoder.hpp"
+#include "WireEncoder.hpp"
+
+// Checks request parsing and format negotiation, response headers bounded by the frame limit, and the BIN1
+// framing end to end: a payload written
+// to a loopback socket is received by MarketDataClient::receiveMarketData bit for bit.
+
+namespace
+{
+    using namespace TestSupport;
+    using boost::asio::ip::tcp;
+
+    void checkRequests()
+    {
+        Protocol::Request request;
+        std::string error;
+
+        check(Protocol::parseRequest("GET AAPL\n", request, error) && request.symbols.front() == "AAPL" &&
+                  request.format == WireFormat::CSV,
+              "plain GET defaults to CSV");
+        check(Protocol::parseRequest("GET  MSFT   FORMAT=BIN1\r\n", request, error) && request.symbols.front() == "MSFT" &&
+                  request.format == WireFormat::BIN1,
+              "FORMAT=BIN1 negotiated");
+        check(!Protocol::parseRequest("GET AAPL FORMAT=XML", request, error) && error.find("XML") != std::string::npos,
+              "unknown format rejected");
+        check(!Protocol::parseRequest("GET AAPL COLOR=RED", request, error), "unknown option rejected");
+        check(!Protocol::parseRequest("GET", request, error), "missing symbol rejected");
+        check(!Protocol::parseRequest("PUT AAPL", request, error), "unknown command rejected");
+
+        request = Protocol::Request();
+        request.symbols = {"GOOGL"};
+        check(Protocol::formatRequest(request) == "GET GOOGL\n", "CSV request stays a plain GET");
+        request.format = WireFormat::BIN1;
+        check(Protocol::formatRequest(request) == "GET GOOGL FORMAT=BIN1\n", "BIN1 request line");
+        check(Protocol::parseRequest(Protocol::formatRequest(request), request, error) && request.format == WireFormat::BIN1,
+              "formatted request parses back");
+    }
+
+    // Response headers, whose sizes are bounded before anything is allocated for the body
+    void checkHeaders()
+    {
+        WireFormat format;
+        size_t rows = 0;
+        size_t size = 0;
+        const std::string max = std::to_string(Protocol::MAX_FRAME_BYTES);
+        const std::string over = std::to_string(Protocol::MAX_FRAME_BYTES + 1);
+
+        check(WireDecoder::parseDataHeader("DATA_SIZE:" + max + "\n", format, rows, size) &&
+                  format == WireFormat::CSV && size == Protocol::MAX_FRAME_BYTES,
+              "CSV body up to the frame limit accepted");
+        check(!WireDecoder::parseDataHeader("DATA_SIZE:" + over + "\n", format, rows, size) &&
+                  !WireDecoder::parseDataHeader("DATA_SIZE:99999999999999999999\n", format, rows, size),
+              "CSV body over the frame limit rejected");
+        const size_t maxRows = Protocol::MAX_FRAME_BYTES / sizeof(WireRecord);
+        check(WireDecoder::parseDataHeader("BIN1:" + std::to_string(maxRows) + "\n", format, rows, size) &&
+                  rows == maxRows && size == maxRows * sizeof(WireRecord),
+              "BIN1 rows up to the frame limit accepted");
+        check(!WireDecoder::parseDataHeader("BIN1:" + std::to_string(maxRows + 1) + "\n", format, rows, size),
+              "BIN1 rows over the frame limit rejected");
+        check(WireDecoder::parseDataHeader("DDC1:10:" + max + "\n", format, rows, size) && rows == 10,
+              "DDC1 body up to the frame limit accepted");
+        check(!WireDecoder::parseDataHeader("DDC1:10:" + over + "\n", format, rows, size),
+              "DDC1 body over the frame limit rejected");
+    }
+}
+
+int main()
+{
+    checkRequests();
+    checkHeaders();
+
+    const size_t rows = 200000;
+    MarketDataSeries series = arbitrarySeries(rows);
+    auto binary = WireEncoder::encode(series.view(), WireFormat::BIN1);
+    auto csv = WireEncoder::encode(series.view(), WireFormat::CSV);
+
+    std::string_view bytes = binary->bytes();
+    std::string header = "BIN1:" + std::to_string(rows) + "\n";
+    check(bytes.substr(0, header.size()) == header, "BIN1 header line");
+    check(bytes.size() == header.size() + rows * sizeof(WireRecord), "BIN1 body is 48 bytes per bar");
+
+    // Serve the payload on a loopback socket and receive it with the client
+    boost::asio::io_context ioc;
+    tcp::acceptor acceptor(ioc, tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    std::thread server([&]
+                       {
+                           tcp::socket peer = acceptor.accept();
+                           boost::asio::write(peer, boost::asio::buffer(bytes.data(), bytes.size()));
+                       });
+
+    auto socket = std::make_shared<tcp::socket>(ioc);
+    socket->connect(acceptor.local_endpoint());
+    MarketDataSeries received;
+    auto start = Clock::now();
+    bool ok = MarketDataClient::receiveMarketData(socket, received);
+    double receiveMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    server.join();
+
+    check(ok && received.size() == rows, "client received every record");
+    bool exact = received.size() == rows;
+    for (size_t i = 0; exact && i < rows; ++i)
+    {
+        exact = received.timestamps()[i] == series.timestamps()[i] && received.open()[i] == series.open()[i] &&
+                received.high()[i] == series.high()[i] && received.low()[i] == series.low()[i] &&
+                received.close()[i] == series.close()[i] && received.volume()[i] == series.volume()[i];
+    }
+    check(exact, "BIN1 round trip is bit exact");
+
+    std::cout << rows << " bars: CSV " << csv->bytes().size() << " bytes, BIN1 " << bytes.size()
+              << " bytes, BIN1 receive and decode " << receiveMs << " ms" << std::endl;
+
+    return finish();
+}